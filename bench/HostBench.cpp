@@ -0,0 +1,458 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+// Host-side microbenchmarks of the CPU primitives on the mining hot path.
+// Every benchmark runs on realistic inputs(a mining.notify line with a long merkle branch,
+// pool sized coinbase, real block header layout) and reports ns/op and ops/s.
+// Output is one line per benchmark in a fixed order and format, so results of two builds can be diffed.
+//
+// Usage: lyclHostBench [--min-time seconds] [--json file]
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h> // _dup, _dup2
+#else
+#include <unistd.h> // dup, dup2
+#include <sys/socket.h> // socketpair
+#endif
+
+#include <jansson.h>
+#include <lyclCore/OtherThreads.hpp>
+#include <lyclCore/Global.hpp>
+#include <lyclCore/Log.hpp>
+#include <lyclCore/Sha256.hpp>
+#include <lyclCore/Blake256.hpp>
+#include <lyclCore/Uint256.hpp>
+#include <lyclCore/Utils.hpp>
+
+namespace
+{
+    //! number of merkle branches in the synthetic notify. Pools with busy mempools send 10-14.
+    const int c_numMerkleBranches = 12;
+    //! coinbase parts size in bytes.
+    const size_t c_coinb1Size = 59;
+    const size_t c_coinb2Size = 120;
+    //! minimum duration of a single timed batch.
+    const double c_minBatchSeconds = 0.01;
+
+    //! prevents the compiler from dropping benchmarked work.
+    volatile uint32_t g_sink = 0;
+
+    struct benchResult
+    {
+        std::string name;
+        double nsPerOp;
+        double opsPerSec;
+        uint64_t iterations;
+    };
+
+    typedef void (*benchFunc)(void* userdata, uint64_t iterations);
+    //-----------------------------------------------------------------------------
+    //! Runs (func) in batches for at least (min_time) seconds.
+    //! Reports the fastest batch, which is the most stable figure on a busy host.
+    benchResult runBench(const char* name, benchFunc func, void* userdata, double min_time)
+    {
+        typedef std::chrono::steady_clock clock;
+
+        // calibrate batch size
+        uint64_t batch = 1;
+        for (;;)
+        {
+            clock::time_point start = clock::now();
+            func(userdata, batch);
+            const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+            if (seconds >= c_minBatchSeconds)
+                break;
+            batch *= 2;
+        }
+
+        benchResult result;
+        result.name = name;
+        result.iterations = 0;
+        double bestNs = 0.0;
+        double totalSeconds = 0.0;
+        do
+        {
+            clock::time_point start = clock::now();
+            func(userdata, batch);
+            const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+            const double ns = seconds * 1e9 / (double)batch;
+            if (!result.iterations || ns < bestNs)
+                bestNs = ns;
+            result.iterations += batch;
+            totalSeconds += seconds;
+        } while (totalSeconds < min_time);
+
+        result.nsPerOp = bestNs;
+        result.opsPerSec = (bestNs > 0.0) ? (1e9 / bestNs) : 0.0;
+        return result;
+    }
+    //-----------------------------------------------------------------------------
+    //! deterministic hex string of (num_bytes) bytes.
+    std::string genHex(size_t num_bytes, uint32_t seed)
+    {
+        static const char* digits = "0123456789abcdef";
+        std::string s(num_bytes * 2, '0');
+        uint32_t x = seed;
+        for (size_t i = 0; i < num_bytes; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            s[2 * i] = digits[(x >> 28) & 0xF];
+            s[2 * i + 1] = digits[(x >> 24) & 0xF];
+        }
+        return s;
+    }
+    //-----------------------------------------------------------------------------
+    //! mining.notify line as received from a pool.
+    std::string genNotifyLine()
+    {
+        // coinb1 carries the block height(BIP34) after the 0xffff tag, like real pools do.
+        std::string coinb1 = "01000000010000000000000000000000000000000000000000000000000000000000000000ffffffff2703e83313";
+        coinb1 += genHex(c_coinb1Size - coinb1.size() / 2, 1);
+        std::string coinb2 = genHex(c_coinb2Size, 2);
+
+        std::string line = "{\"params\":[\"6e1a\",\"" + genHex(32, 3) + "\",\"" + coinb1 + "\",\"" + coinb2 + "\",[";
+        for (int i = 0; i < c_numMerkleBranches; ++i)
+        {
+            if (i)
+                line += ",";
+            line += "\"" + genHex(32, 100 + i) + "\"";
+        }
+        line += "],\"20000000\",\"1c05ea29\",\"5b3f1a2c\",false],\"id\":null,\"method\":\"mining.notify\"}";
+        return line;
+    }
+    //-----------------------------------------------------------------------------
+    // Benchmarks
+    //-----------------------------------------------------------------------------
+    struct stratumData
+    {
+        stratum_ctx sctx;
+        std::string notifyLine;
+        work workInfo;
+        int sockets[2];
+    };
+    //-----------------------------------------------------------------------------
+    void benchSha256d(void* userdata, uint64_t iterations)
+    {
+        stratumData* data = (stratumData*)userdata;
+        unsigned char hash[32];
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            data->sctx.job.coinbase[0] = (unsigned char)i;
+            sha256d(hash, data->sctx.job.coinbase, (int)data->sctx.job.coinbase_size);
+        }
+        g_sink += hash[0];
+    }
+    //-----------------------------------------------------------------------------
+    void benchSha256dMidstate(void* userdata, uint64_t iterations)
+    {
+        stratumData* data = (stratumData*)userdata;
+        const stratum_job& job = data->sctx.job;
+        unsigned char hash[32];
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            job.xnonce2[0] = (unsigned char)i;
+            sha256d_resume(hash, job.coinbase_midstate, job.coinbase_midstate_size,
+                           job.coinbase + job.coinbase_midstate_size,
+                           (int)(job.coinbase_size - job.coinbase_midstate_size));
+        }
+        g_sink += hash[0];
+    }
+    //-----------------------------------------------------------------------------
+    void benchSha256dMerkle(void* userdata, uint64_t iterations)
+    {
+        (void)userdata;
+        unsigned char node[64];
+        memset(node, 0x5A, sizeof(node));
+        for (uint64_t i = 0; i < iterations; ++i)
+            sha256d_64(node, node);
+        g_sink += node[0];
+    }
+    //-----------------------------------------------------------------------------
+    //! one op is a single node of a batch.
+    void benchSha256dMerkleBatch(void* userdata, uint64_t iterations)
+    {
+        (void)userdata;
+        const size_t batchSize = 64;
+        unsigned char nodes[64 * batchSize];
+        unsigned char hashes[32 * batchSize];
+        memset(nodes, 0x5A, sizeof(nodes));
+        for (uint64_t i = 0; i < iterations; i += batchSize)
+        {
+            nodes[0] = (unsigned char)i;
+            lycl::sha256dBatch(hashes, sha256_h, 0, nodes, 64, 64, batchSize);
+        }
+        g_sink += hashes[0];
+    }
+    //-----------------------------------------------------------------------------
+    void benchBuildExtraHeader(void* userdata, uint64_t iterations)
+    {
+        stratumData* data = (stratumData*)userdata;
+        for (uint64_t i = 0; i < iterations; ++i)
+            buildExtraHeader(&data->workInfo, &data->sctx);
+        g_sink += data->workInfo.data[9];
+    }
+    //-----------------------------------------------------------------------------
+    void benchStratumNotify(void* userdata, uint64_t iterations)
+    {
+        stratumData* data = (stratumData*)userdata;
+        for (uint64_t i = 0; i < iterations; ++i)
+            g_sink += stratum_handle_method(&data->sctx, data->notifyLine.c_str()) ? 1 : 0;
+    }
+    //-----------------------------------------------------------------------------
+    //! the same notify through jansson, the path of rare stratum methods.
+    void benchStratumNotifyJson(void* userdata, uint64_t iterations)
+    {
+        stratumData* data = (stratumData*)userdata;
+        for (uint64_t i = 0; i < iterations; ++i)
+            g_sink += stratumHandleMethodJson(&data->sctx, data->notifyLine.c_str()) ? 1 : 0;
+    }
+    //-----------------------------------------------------------------------------
+#ifndef _WIN32
+    //! receive and framing of a mining.notify line from a local socket, including the send.
+    void benchRecvLine(void* userdata, uint64_t iterations)
+    {
+        stratumData* data = (stratumData*)userdata;
+        const std::string line = data->notifyLine + "\n";
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            if (send(data->sockets[1], line.data(), line.size(), 0) != (ssize_t)line.size())
+                break;
+            const char* s = stratum_recv_line(&data->sctx);
+            g_sink += s ? (uint32_t)s[0] : 0;
+        }
+    }
+#endif
+    //-----------------------------------------------------------------------------
+    void benchJsonLoads(void* userdata, uint64_t iterations)
+    {
+        stratumData* data = (stratumData*)userdata;
+        json_error_t err;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            json_t* val = json_loads(data->notifyLine.c_str(), 0, &err);
+            g_sink += val ? 1 : 0;
+            json_decref(val);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    void benchBlake256Compress(void* userdata, uint64_t iterations)
+    {
+        (void)userdata;
+        uint32_t h[8] = { 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+                          0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 };
+        uint32_t block[16];
+        for (int i = 0; i < 16; ++i)
+            block[i] = 0x01010101u * (uint32_t)i;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            block[3] = (uint32_t)i;
+            blake256_compress(h, block);
+        }
+        g_sink += h[0];
+    }
+    //-----------------------------------------------------------------------------
+    struct hexData
+    {
+        std::string hex;
+        std::vector<unsigned char> bin;
+        std::vector<char> out;
+    };
+    //-----------------------------------------------------------------------------
+    void benchHex2bin(void* userdata, uint64_t iterations)
+    {
+        hexData* data = (hexData*)userdata;
+        for (uint64_t i = 0; i < iterations; ++i)
+            g_sink += hex2bin(data->bin.data(), data->hex.c_str(), data->bin.size()) ? 1 : 0;
+    }
+    //-----------------------------------------------------------------------------
+    void benchBin2hex(void* userdata, uint64_t iterations)
+    {
+        hexData* data = (hexData*)userdata;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            data->bin[0] = (unsigned char)i;
+            bin2hex(data->out.data(), data->bin.data(), data->bin.size());
+        }
+        g_sink += (uint32_t)data->out[0];
+    }
+    //-----------------------------------------------------------------------------
+    //! share ratio as computed for every found share(hash_target_ratio in main.cpp).
+    void benchHashTargetRatio(void* userdata, uint64_t iterations)
+    {
+        (void)userdata;
+        uint32_t hash[8] = { 0x11111111, 0x22222222, 0x33333333, 0x44444444,
+                             0x55555555, 0x66666666, 0x00007777, 0x00000000 };
+        uint32_t target[8] = { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF,
+                               0xFFFFFFFF, 0xFFFFFFFF, 0x0000FFFF, 0x00000000 };
+        double sum = 0.0;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            hash[0] = (uint32_t)i;
+            uint256 h, t;
+            memcpy(&t, (void*)target, 32);
+            memcpy(&h, (void*)hash, 32);
+            const double dhash = h.getdouble();
+            sum += (dhash > 0.) ? t.getdouble() / dhash : dhash;
+        }
+        g_sink += (uint32_t)sum;
+    }
+    //-----------------------------------------------------------------------------
+    void benchLogPrint(void* userdata, uint64_t iterations)
+    {
+        (void)userdata;
+        for (uint64_t i = 0; i < iterations; ++i)
+            Log::print(Log::LT_Notice, "accepted: %u/%u (diff %.3f), %.2f kH/s", (uint32_t)i, (uint32_t)i, 0.125, 812.5);
+    }
+    //-----------------------------------------------------------------------------
+    //! Log::print writes to stdout, which is redirected to the null device while it is measured.
+    benchResult runLogBench(double min_time)
+    {
+        fflush(stdout);
+#ifdef _WIN32
+        const int savedFd = _dup(_fileno(stdout));
+        FILE* nullFile = freopen("NUL", "w", stdout);
+#else
+        const int savedFd = dup(fileno(stdout));
+        FILE* nullFile = freopen("/dev/null", "w", stdout);
+#endif
+        benchResult result = runBench("log_print", benchLogPrint, nullptr, min_time);
+
+        fflush(stdout);
+        if (nullFile && savedFd >= 0)
+        {
+#ifdef _WIN32
+            _dup2(savedFd, _fileno(stdout));
+            _close(savedFd);
+#else
+            dup2(savedFd, fileno(stdout));
+            close(savedFd);
+#endif
+        }
+        return result;
+    }
+    //-----------------------------------------------------------------------------
+    bool writeJson(const char* file_name, const std::vector<benchResult>& results, double min_time)
+    {
+        json_t* root = json_object();
+        json_object_set_new(root, "version", json_string(PACKAGE_VERSION));
+        json_object_set_new(root, "minTime", json_real(min_time));
+        json_t* arr = json_array();
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            json_t* r = json_object();
+            json_object_set_new(r, "name", json_string(results[i].name.c_str()));
+            json_object_set_new(r, "nsPerOp", json_real(results[i].nsPerOp));
+            json_object_set_new(r, "opsPerSec", json_real(results[i].opsPerSec));
+            json_object_set_new(r, "iterations", json_integer((json_int_t)results[i].iterations));
+            json_array_append_new(arr, r);
+        }
+        json_object_set_new(root, "results", arr);
+
+        const bool ok = json_dump_file(root, file_name, JSON_INDENT(2)) == 0;
+        json_decref(root);
+        return ok;
+    }
+}
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    double minTime = 1.0;
+    const char* jsonFileName = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--min-time") && (i + 1 < argc))
+            minTime = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--json") && (i + 1 < argc))
+            jsonFileName = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--min-time seconds] [--json file]" << std::endl;
+            return 1;
+        }
+    }
+    if (minTime <= 0.0)
+        minTime = 1.0;
+
+    pthread_mutex_init(&Log::applog_lock, NULL);
+    global::use_colors = false;
+
+    // stratum context with a parsed job, as the stratum thread keeps it.
+    stratumData sdata{};
+    memset(&sdata.workInfo, 0, sizeof(sdata.workInfo));
+    pthread_mutex_init(&sdata.sctx.work_lock, NULL);
+    pthread_mutex_init(&sdata.sctx.sock_lock, NULL);
+    static unsigned char xnonce1[4] = { 0xf8, 0x00, 0x2c, 0x90 };
+    sdata.sctx.xnonce1 = xnonce1;
+    sdata.sctx.xnonce1_size = sizeof(xnonce1);
+    sdata.sctx.xnonce2_size = 4;
+    sdata.sctx.next_diff = 0.125;
+    sdata.notifyLine = genNotifyLine();
+    if (!stratum_handle_method(&sdata.sctx, sdata.notifyLine.c_str()))
+    {
+        std::cerr << "Failed to parse the synthetic mining.notify" << std::endl;
+        return 1;
+    }
+
+    // hex conversion of a whole coinbase.
+    hexData hdata;
+    hdata.hex = genHex(c_coinb1Size + c_coinb2Size, 7);
+    hdata.bin.resize(hdata.hex.size() / 2);
+    hdata.out.resize(hdata.hex.size() + 1);
+
+    std::vector<benchResult> results;
+    results.push_back(runBench("sha256d_coinbase", benchSha256d, &sdata, minTime));
+    results.push_back(runBench("sha256d_coinbase_midstate", benchSha256dMidstate, &sdata, minTime));
+    results.push_back(runBench("sha256d_64", benchSha256dMerkle, nullptr, minTime));
+    results.push_back(runBench("sha256d_64_batch", benchSha256dMerkleBatch, nullptr, minTime));
+    results.push_back(runBench("build_extra_header", benchBuildExtraHeader, &sdata, minTime));
+    results.push_back(runBench("blake256_compress", benchBlake256Compress, nullptr, minTime));
+    results.push_back(runBench("hex2bin_coinbase", benchHex2bin, &hdata, minTime));
+    results.push_back(runBench("bin2hex_coinbase", benchBin2hex, &hdata, minTime));
+    results.push_back(runBench("json_loads_notify", benchJsonLoads, &sdata, minTime));
+    results.push_back(runBench("stratum_notify", benchStratumNotify, &sdata, minTime));
+    results.push_back(runBench("stratum_notify_json", benchStratumNotifyJson, &sdata, minTime));
+#ifndef _WIN32
+    if (!socketpair(AF_UNIX, SOCK_STREAM, 0, sdata.sockets) && sdata.sctx.io.open(sdata.sockets[0]))
+    {
+        sdata.sctx.sock = sdata.sockets[0];
+        results.push_back(runBench("stratum_recv_line", benchRecvLine, &sdata, minTime));
+        sdata.sctx.io.close();
+        close(sdata.sockets[0]);
+        close(sdata.sockets[1]);
+    }
+#endif
+    results.push_back(runBench("hash_target_ratio", benchHashTargetRatio, nullptr, minTime));
+    results.push_back(runLogBench(minTime));
+
+    printf("# lyclHostBench %s, merkle branches: %d, coinbase: %u bytes, sha256 %s, batch %s\n", PACKAGE_VERSION,
+           c_numMerkleBranches, (uint32_t)sdata.sctx.job.coinbase_size, sha256_use_shani() ? "sha-ni" : "scalar",
+           lycl::sha256GetBatchImplName(lycl::sha256GetBatchImpl()));
+    printf("%-24s %14s %16s\n", "# name", "ns/op", "ops/s");
+    for (size_t i = 0; i < results.size(); ++i)
+        printf("%-24s %14.1f %16.0f\n", results[i].name.c_str(), results[i].nsPerOp, results[i].opsPerSec);
+    fflush(stdout);
+
+    if (jsonFileName && !writeJson(jsonFileName, results, minTime))
+    {
+        std::cerr << "Failed to write " << jsonFileName << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
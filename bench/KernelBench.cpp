@@ -0,0 +1,426 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+// Per-stage kernel benchmark.
+// Loads every kernels/*/*.cl stage on its own, fills the hash storage with random 32-byte inputs
+// and times the stage over many launches and local work sizes.
+// Runs on any OpenCL 1.2+ device, including CPU runtimes. No pool connection or full pipeline is needed.
+//
+// Usage: lyclKernelBench [--list] [--platform index] [--device index] [--stage name]
+//                        [--work-size hashes] [--launches count] [--local-sizes 64,128,256]
+// Must be started from the directory containing the kernels folder.
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <lyclCore/CLUtils.hpp>
+
+namespace
+{
+    //! kernel arguments layout of a stage.
+    typedef enum
+    {
+        SA_Hashes,         // (hashes)
+        SA_HashesStates,   // (hashes, lyraStates)
+        SA_States,         // (lyraStates)
+        SA_Htarg32,        // (hashes, output, uint target)
+        SA_Htarg64,        // (hashes, output, ulong target)
+        SA_Blake           // (hashes, uint...) block header words, precalc and first nonce
+    } EStageArgs;
+
+    struct stageDesc
+    {
+        const char* name;
+        const char* fileName;
+        const char* kernelName;
+        EStageArgs args;
+        //! number of uint arguments following hashes(SA_Blake only).
+        cl_uint numUintArgs;
+        //! work items per hash.
+        size_t threadsPerHash;
+        //! global memory traffic per hash in bytes(reads + writes), used for effective bandwidth.
+        size_t bytesPerHash;
+    };
+
+    //! lyra441 state size per hash in bytes.
+    const size_t c_lyraStateSize = 128;
+
+    const stageDesc c_stages[] =
+    {
+        { "blake32",                   "kernels/blake32/blake32.cl",                          "blake32",     SA_Blake,        12, 1, 32 },
+        { "blake32_precalc",           "kernels/blake32/blake32_precalc.cl",                  "blake32",     SA_Blake,        29, 1, 32 },
+        { "keccakF1600",               "kernels/keccakF1600/keccakF1600.cl",                  "keccakF1600", SA_Hashes,        0, 1, 64 },
+        { "lyra2",                     "kernels/lyra2/lyra2.cl",                              "lyra2",       SA_Hashes,        0, 1, 64 },
+        { "cubeHash256",               "kernels/cubeHash256/cubeHash256.cl",                  "cubeHash256", SA_Hashes,        0, 1, 64 },
+        { "skein",                     "kernels/skein/skein.cl",                              "skein",       SA_Hashes,        0, 1, 64 },
+        { "bmw",                       "kernels/bmw/bmw.cl",                                  "bmw",         SA_Hashes,        0, 1, 64 },
+        { "bmw_htarg",                 "kernels/bmw/bmw_htarg.cl",                            "bmw",         SA_Htarg32,       0, 1, 32 },
+        { "groestl256_htarg",          "kernels/groestl256/groestl256_htarg.cl",              "groestl256",  SA_Htarg64,       0, 1, 32 },
+        { "groestl256_htarg_lds",      "kernels/groestl256/groestl256_htarg_lds.cl",          "groestl256",  SA_Htarg64,       0, 1, 32 },
+        { "groestl256_htarg_bitsliced", "kernels/groestl256/groestl256_htarg_bitsliced.cl",   "groestl256",  SA_Htarg64,       0, 1, 32 },
+        { "lyra441p1",                 "kernels/lyra441p1/lyra441p1.cl",                      "lyra441p1",   SA_HashesStates,  0, 1, 32 + c_lyraStateSize },
+        { "lyra441p2",                 "kernels/lyra441p2/lyra441p2.cl",                      "lyra441p2",   SA_States,        0, 4, 2 * c_lyraStateSize },
+        { "lyra441p3",                 "kernels/lyra441p3/lyra441p3.cl",                      "lyra441p3",   SA_HashesStates,  0, 1, c_lyraStateSize + 32 },
+    };
+    const size_t c_numStages = sizeof(c_stages) / sizeof(c_stages[0]);
+
+    struct benchOptions
+    {
+        int platformIndex;
+        int deviceIndex;
+        std::string stage;
+        size_t workSize;
+        int numLaunches;
+        std::vector<size_t> localSizes;
+    };
+
+    struct benchContext
+    {
+        cl_device_id clDevice;
+        cl_context clContext;
+        cl_command_queue clQueue;
+        cl_mem clMemHashStorage;
+        cl_mem clMemLyraStates;
+        cl_mem clMemHtArgResult;
+        std::string buildOptions;
+    };
+    //-----------------------------------------------------------------------------
+    //! deterministic pseudo random bytes(xorshift32).
+    void genBytes(std::vector<uint8_t>& out, size_t num_bytes, uint32_t seed)
+    {
+        out.resize(num_bytes);
+        uint32_t x = seed ? seed : 0x9E3779B9;
+        for (size_t i = 0; i < num_bytes; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            out[i] = (uint8_t)(x >> 24);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    bool parseLocalSizes(const char* str, std::vector<size_t>& out_sizes)
+    {
+        out_sizes.clear();
+        std::string s(str);
+        size_t pos = 0;
+        while (pos <= s.size())
+        {
+            size_t next = s.find(',', pos);
+            if (next == std::string::npos)
+                next = s.size();
+            const long value = atol(s.substr(pos, next - pos).c_str());
+            if (value <= 0)
+                return false;
+            out_sizes.push_back((size_t)value);
+            pos = next + 1;
+        }
+        return !out_sizes.empty();
+    }
+    //-----------------------------------------------------------------------------
+    void listDevices(const std::vector<cl_platform_id>& platforms)
+    {
+        for (size_t i = 0; i < platforms.size(); ++i)
+        {
+            std::string platformName;
+            lycl::cluGetPlatformInfoString(platforms[i], CL_PLATFORM_NAME, platformName);
+            printf("platform %u: %s\n", (uint32_t)i, platformName.c_str());
+
+            cl_uint numDevices = 0;
+            if (clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_ALL, 0, nullptr, &numDevices) != CL_SUCCESS)
+                continue;
+            std::vector<cl_device_id> devices(numDevices);
+            clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_ALL, numDevices, devices.data(), nullptr);
+            for (size_t j = 0; j < devices.size(); ++j)
+            {
+                std::string version;
+                lycl::cluGetDeviceInfoString(devices[j], CL_DEVICE_VERSION, version);
+                printf("  device %u: %s (%s)\n", (uint32_t)j, lycl::cluGetDeviceBoardName(devices[j]).c_str(), version.c_str());
+            }
+        }
+    }
+    //-----------------------------------------------------------------------------
+    //! Sets all kernel arguments of a stage.
+    bool setStageArgs(const stageDesc& stage, const benchContext& ctx, cl_kernel kernel)
+    {
+        cl_int errorCode = CL_SUCCESS;
+        switch (stage.args)
+        {
+            case SA_Hashes:
+                errorCode = clSetKernelArg(kernel, 0, sizeof(cl_mem), &ctx.clMemHashStorage);
+                break;
+            case SA_HashesStates:
+                errorCode = clSetKernelArg(kernel, 0, sizeof(cl_mem), &ctx.clMemHashStorage);
+                errorCode |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &ctx.clMemLyraStates);
+                break;
+            case SA_States:
+                errorCode = clSetKernelArg(kernel, 0, sizeof(cl_mem), &ctx.clMemLyraStates);
+                break;
+            case SA_Htarg32:
+            {
+                // zero target: almost nothing is reported, as on a real pool difficulty.
+                const cl_uint target = 0;
+                errorCode = clSetKernelArg(kernel, 0, sizeof(cl_mem), &ctx.clMemHashStorage);
+                errorCode |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &ctx.clMemHtArgResult);
+                errorCode |= clSetKernelArg(kernel, 2, sizeof(cl_uint), &target);
+                break;
+            }
+            case SA_Htarg64:
+            {
+                const cl_ulong target = 0;
+                errorCode = clSetKernelArg(kernel, 0, sizeof(cl_mem), &ctx.clMemHashStorage);
+                errorCode |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &ctx.clMemHtArgResult);
+                errorCode |= clSetKernelArg(kernel, 2, sizeof(cl_ulong), &target);
+                break;
+            }
+            case SA_Blake:
+            {
+                // header words and precalc are random, first nonce(last argument) is 0.
+                std::vector<uint8_t> bytes;
+                genBytes(bytes, stage.numUintArgs * sizeof(cl_uint), 0x1234567);
+                std::vector<cl_uint> values(stage.numUintArgs);
+                memcpy(values.data(), bytes.data(), bytes.size());
+                values.back() = 0;
+
+                errorCode = clSetKernelArg(kernel, 0, sizeof(cl_mem), &ctx.clMemHashStorage);
+                for (cl_uint i = 0; i < stage.numUintArgs; ++i)
+                    errorCode |= clSetKernelArg(kernel, 1 + i, sizeof(cl_uint), &values[i]);
+                break;
+            }
+        }
+
+        return errorCode == CL_SUCCESS;
+    }
+    //-----------------------------------------------------------------------------
+    //! Times (num_launches) launches of a stage. Returns seconds, negative on error.
+    double timeStage(const benchContext& ctx, cl_kernel kernel, size_t global_work_size, size_t local_work_size, int num_launches)
+    {
+        typedef std::chrono::steady_clock clock;
+
+        // warm-up(lazy compilation, memory residency)
+        cl_int errorCode = clEnqueueNDRangeKernel(ctx.clQueue, kernel, 1, nullptr, &global_work_size, &local_work_size, 0, nullptr, nullptr);
+        if (errorCode != CL_SUCCESS || clFinish(ctx.clQueue) != CL_SUCCESS)
+            return -1.0;
+
+        clock::time_point start = clock::now();
+        for (int i = 0; i < num_launches; ++i)
+        {
+            errorCode = clEnqueueNDRangeKernel(ctx.clQueue, kernel, 1, nullptr, &global_work_size, &local_work_size, 0, nullptr, nullptr);
+            if (errorCode != CL_SUCCESS)
+                return -1.0;
+        }
+        if (clFinish(ctx.clQueue) != CL_SUCCESS)
+            return -1.0;
+
+        return std::chrono::duration<double>(clock::now() - start).count();
+    }
+    //-----------------------------------------------------------------------------
+    //! Builds and benchmarks a single stage for all requested local work sizes.
+    void runStage(const stageDesc& stage, const benchContext& ctx, const benchOptions& options)
+    {
+        cl_program program = lycl::cluCreateProgramFromFile(ctx.clContext, ctx.clDevice, stage.fileName, ctx.buildOptions.c_str());
+        if (!program)
+        {
+            printf("%-28s build failed\n", stage.name);
+            return;
+        }
+
+        cl_int errorCode = CL_SUCCESS;
+        cl_kernel kernel = clCreateKernel(program, stage.kernelName, &errorCode);
+        if (errorCode != CL_SUCCESS || !setStageArgs(stage, ctx, kernel))
+        {
+            printf("%-28s failed to create kernel\n", stage.name);
+            if (errorCode == CL_SUCCESS)
+                clReleaseKernel(kernel);
+            clReleaseProgram(program);
+            return;
+        }
+
+        // stage inputs: random 32-byte hashes, lyra states derived from them.
+        std::vector<uint8_t> input;
+        genBytes(input, options.workSize * 32, 0xC0FFEE);
+        errorCode = clEnqueueWriteBuffer(ctx.clQueue, ctx.clMemHashStorage, CL_TRUE, 0, input.size(), input.data(), 0, nullptr, nullptr);
+        genBytes(input, options.workSize * c_lyraStateSize, 0xBADC0DE);
+        errorCode |= clEnqueueWriteBuffer(ctx.clQueue, ctx.clMemLyraStates, CL_TRUE, 0, input.size(), input.data(), 0, nullptr, nullptr);
+
+        // kernels with reqd_work_group_size accept a single local size.
+        size_t reqdSize[3] = { 0, 0, 0 };
+        clGetKernelWorkGroupInfo(kernel, ctx.clDevice, CL_KERNEL_COMPILE_WORK_GROUP_SIZE, sizeof(reqdSize), reqdSize, nullptr);
+        size_t maxSize = 0;
+        clGetKernelWorkGroupInfo(kernel, ctx.clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(maxSize), &maxSize, nullptr);
+
+        std::vector<size_t> localSizes = options.localSizes;
+        if (reqdSize[0])
+            localSizes.assign(1, reqdSize[0]);
+
+        const size_t globalWorkSize = options.workSize * stage.threadsPerHash;
+        for (size_t i = 0; i < localSizes.size() && errorCode == CL_SUCCESS; ++i)
+        {
+            const size_t localSize = localSizes[i];
+            if ((maxSize && localSize > maxSize) || (globalWorkSize % localSize))
+            {
+                printf("%-28s %6u  unsupported local size\n", stage.name, (uint32_t)localSize);
+                continue;
+            }
+
+            const double seconds = timeStage(ctx, kernel, globalWorkSize, localSize, options.numLaunches);
+            if (seconds <= 0.0)
+            {
+                printf("%-28s %6u  launch failed\n", stage.name, (uint32_t)localSize);
+                continue;
+            }
+
+            const double hashesPerSec = (double)options.workSize * options.numLaunches / seconds;
+            const double bandwidth = hashesPerSec * (double)stage.bytesPerHash / 1e9;
+            const double msPerLaunch = seconds * 1000.0 / options.numLaunches;
+            printf("%-28s %6u %14.3f %12.2f %12.3f\n", stage.name, (uint32_t)localSize, hashesPerSec / 1e6, bandwidth, msPerLaunch);
+        }
+        if (errorCode != CL_SUCCESS)
+            printf("%-28s failed to upload inputs\n", stage.name);
+
+        clReleaseKernel(kernel);
+        clReleaseProgram(program);
+    }
+}
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    benchOptions options;
+    options.platformIndex = 0;
+    options.deviceIndex = 0;
+    options.workSize = 65536;
+    options.numLaunches = 16;
+    options.localSizes.push_back(64);
+    options.localSizes.push_back(128);
+    options.localSizes.push_back(256);
+    bool listOnly = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = (i + 1 < argc);
+        if (!strcmp(argv[i], "--list"))
+            listOnly = true;
+        else if (!strcmp(argv[i], "--platform") && hasValue)
+            options.platformIndex = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--device") && hasValue)
+            options.deviceIndex = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--stage") && hasValue)
+            options.stage = argv[++i];
+        else if (!strcmp(argv[i], "--work-size") && hasValue)
+            options.workSize = (size_t)atol(argv[++i]);
+        else if (!strcmp(argv[i], "--launches") && hasValue)
+            options.numLaunches = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--local-sizes") && hasValue && parseLocalSizes(argv[i + 1], options.localSizes))
+            ++i;
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--list] [--platform index] [--device index] [--stage name]" << std::endl
+                      << "       [--work-size hashes] [--launches count] [--local-sizes 64,128,256]" << std::endl;
+            return 1;
+        }
+    }
+
+    // work size must be a multiple of 256(required local size of most kernels)
+    options.workSize = ((options.workSize + 255) / 256) * 256;
+    if (!options.workSize)
+        options.workSize = 256;
+    if (options.numLaunches <= 0)
+        options.numLaunches = 16;
+
+    cl_uint numPlatforms = 0;
+    if (clGetPlatformIDs(0, nullptr, &numPlatforms) != CL_SUCCESS || !numPlatforms)
+    {
+        std::cerr << "Failed to find any OpenCL platforms." << std::endl;
+        return 1;
+    }
+    std::vector<cl_platform_id> platforms(numPlatforms);
+    clGetPlatformIDs(numPlatforms, platforms.data(), nullptr);
+
+    if (listOnly)
+    {
+        listDevices(platforms);
+        return 0;
+    }
+
+    if (options.platformIndex < 0 || (size_t)options.platformIndex >= platforms.size())
+    {
+        std::cerr << "Invalid platform index: " << options.platformIndex << std::endl;
+        return 1;
+    }
+    cl_platform_id platform = platforms[(size_t)options.platformIndex];
+    cl_uint numDevices = 0;
+    clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 0, nullptr, &numDevices);
+    if (options.deviceIndex < 0 || (cl_uint)options.deviceIndex >= numDevices)
+    {
+        std::cerr << "Invalid device index: " << options.deviceIndex << std::endl;
+        return 1;
+    }
+    std::vector<cl_device_id> devices(numDevices);
+    clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, numDevices, devices.data(), nullptr);
+
+    benchContext ctx;
+    ctx.clDevice = devices[(size_t)options.deviceIndex];
+    ctx.buildOptions = lycl::cluGetBuildOptions(ctx.clDevice);
+
+    cl_int errorCode = CL_SUCCESS;
+    cl_context_properties contextProperties[] = { CL_CONTEXT_PLATFORM, (cl_context_properties)platform, 0 };
+    ctx.clContext = clCreateContext(contextProperties, 1, &ctx.clDevice, nullptr, nullptr, &errorCode);
+    if (errorCode != CL_SUCCESS)
+    {
+        std::cerr << "Failed to create an OpenCL context." << std::endl;
+        return 1;
+    }
+    ctx.clQueue = lycl::cluCreateCommandQueue(ctx.clContext, ctx.clDevice, &errorCode);
+    if (errorCode != CL_SUCCESS)
+    {
+        std::cerr << "Failed to create an OpenCL command queue." << std::endl;
+        clReleaseContext(ctx.clContext);
+        return 1;
+    }
+
+    ctx.clMemHashStorage = clCreateBuffer(ctx.clContext, CL_MEM_READ_WRITE, options.workSize * 32, nullptr, &errorCode);
+    cl_int errorCode2 = CL_SUCCESS;
+    ctx.clMemLyraStates = clCreateBuffer(ctx.clContext, CL_MEM_READ_WRITE, options.workSize * c_lyraStateSize, nullptr, &errorCode2);
+    errorCode |= errorCode2;
+    ctx.clMemHtArgResult = clCreateBuffer(ctx.clContext, CL_MEM_READ_WRITE, sizeof(cl_uint) * (options.workSize + 1), nullptr, &errorCode2);
+    errorCode |= errorCode2;
+    if (errorCode != CL_SUCCESS)
+    {
+        std::cerr << "Failed to allocate device buffers for work size " << options.workSize << std::endl;
+        return 1;
+    }
+    std::vector<cl_uint> zeros(options.workSize + 1, 0);
+    clEnqueueWriteBuffer(ctx.clQueue, ctx.clMemHtArgResult, CL_TRUE, 0, zeros.size() * sizeof(cl_uint), zeros.data(), 0, nullptr, nullptr);
+
+    printf("# device: %s, work size: %u, launches: %d\n", lycl::cluGetDeviceBoardName(ctx.clDevice).c_str(),
+           (uint32_t)options.workSize, options.numLaunches);
+    printf("%-28s %6s %14s %12s %12s\n", "# stage", "local", "MH/s", "GB/s", "ms/launch");
+
+    bool found = false;
+    for (size_t i = 0; i < c_numStages; ++i)
+    {
+        if (!options.stage.empty() && options.stage != c_stages[i].name)
+            continue;
+        found = true;
+        runStage(c_stages[i], ctx, options);
+    }
+    if (!found)
+        std::cerr << "Unknown stage: " << options.stage << std::endl;
+
+    clReleaseMemObject(ctx.clMemHtArgResult);
+    clReleaseMemObject(ctx.clMemLyraStates);
+    clReleaseMemObject(ctx.clMemHashStorage);
+    clReleaseCommandQueue(ctx.clQueue);
+    clReleaseContext(ctx.clContext);
+
+    return found ? 0 : 1;
+}
@@ -10,11 +10,20 @@
 // 2. implement as rotr32.
 //#define ROTL32_x2(x,bits) ((x << bits) | (x >> ((uint2)(32,32) - bits)))
 
+// LYCL_AMD_MEDIA_OPS is defined by the host if cl_amd_media_ops is supported.
+#ifdef LYCL_AMD_MEDIA_OPS
+#pragma OPENCL EXTENSION cl_amd_media_ops : enable
 #define ROTL32_x2(r,v,bits) \
 { \
     r.x = amd_bitalign(v.x, v.x, (uint)(32 - bits)); \
     r.y = amd_bitalign(v.y, v.y, (uint)(32 - bits)); \
 }
+#else
+#define ROTL32_x2(r,v,bits) \
+{ \
+    r = rotate(v, (uint2)(bits)); \
+}
+#endif
 
 #define roundsX2(x) do \
 { \
@@ -0,0 +1,344 @@
+// groestl256 htarg kernel (table-free).
+//
+// No data-dependent memory accesses. The state is kept row-major: row r is an ulong
+// where byte c holds column c, so that
+//  - ShiftBytes is a rotation of each row,
+//  - MixBytes is a linear combination of rows using packed xtime,
+//  - SubBytes is evaluated for all 64 bytes at once on bit planes, using
+//    the Boyar-Peralta AES S-box circuit.
+// Output and htarg test are identical to groestl256_htarg.cl.
+
+#define SWAPMOVE(a, b, m, n) \
+{ \
+    ulong tmp = (((a) >> (n)) ^ (b)) & (m); \
+    (b) ^= tmp; \
+    (a) ^= (tmp << (n)); \
+}
+
+// multiply each byte by 2 in GF(2^8)
+#define XTIME8(x) ((((x) & 0x7f7f7f7f7f7f7f7fUL) << 1) ^ ((((x) >> 7) & 0x0101010101010101UL) * 0x1bUL))
+
+// rotate right by (n) bytes
+#define ROTR8B(x, n) rotate((x), (ulong)(64 - 8*(n)))
+
+typedef union {
+    uint h[8];
+    ulong h2[4];
+    uint4 h4[2];
+    ulong4 h8;
+} hash_t;
+
+//-----------------------------------------------------------------------------
+// 8x8 byte matrix transpose. Converts between column-major and row-major state.
+inline void groestlTranspose(ulong* a)
+{
+    SWAPMOVE(a[0], a[1], 0x00FF00FF00FF00FFUL, 8);
+    SWAPMOVE(a[2], a[3], 0x00FF00FF00FF00FFUL, 8);
+    SWAPMOVE(a[4], a[5], 0x00FF00FF00FF00FFUL, 8);
+    SWAPMOVE(a[6], a[7], 0x00FF00FF00FF00FFUL, 8);
+
+    SWAPMOVE(a[0], a[2], 0x0000FFFF0000FFFFUL, 16);
+    SWAPMOVE(a[1], a[3], 0x0000FFFF0000FFFFUL, 16);
+    SWAPMOVE(a[4], a[6], 0x0000FFFF0000FFFFUL, 16);
+    SWAPMOVE(a[5], a[7], 0x0000FFFF0000FFFFUL, 16);
+
+    SWAPMOVE(a[0], a[4], 0x00000000FFFFFFFFUL, 32);
+    SWAPMOVE(a[1], a[5], 0x00000000FFFFFFFFUL, 32);
+    SWAPMOVE(a[2], a[6], 0x00000000FFFFFFFFUL, 32);
+    SWAPMOVE(a[3], a[7], 0x00000000FFFFFFFFUL, 32);
+}
+//-----------------------------------------------------------------------------
+// Transpose bits within bytes across 8 words.
+// After the call a[k] holds bit k of every byte (a bit plane). Self-inverse.
+inline void groestlOrtho(ulong* a)
+{
+    SWAPMOVE(a[0], a[1], 0x5555555555555555UL, 1);
+    SWAPMOVE(a[2], a[3], 0x5555555555555555UL, 1);
+    SWAPMOVE(a[4], a[5], 0x5555555555555555UL, 1);
+    SWAPMOVE(a[6], a[7], 0x5555555555555555UL, 1);
+
+    SWAPMOVE(a[0], a[2], 0x3333333333333333UL, 2);
+    SWAPMOVE(a[1], a[3], 0x3333333333333333UL, 2);
+    SWAPMOVE(a[4], a[6], 0x3333333333333333UL, 2);
+    SWAPMOVE(a[5], a[7], 0x3333333333333333UL, 2);
+
+    SWAPMOVE(a[0], a[4], 0x0F0F0F0F0F0F0F0FUL, 4);
+    SWAPMOVE(a[1], a[5], 0x0F0F0F0F0F0F0F0FUL, 4);
+    SWAPMOVE(a[2], a[6], 0x0F0F0F0F0F0F0F0FUL, 4);
+    SWAPMOVE(a[3], a[7], 0x0F0F0F0F0F0F0F0FUL, 4);
+}
+//-----------------------------------------------------------------------------
+// AES S-box on 64 bytes in bit plane form. q[7] is the most significant bit.
+inline void groestlSbox(ulong* q)
+{
+    ulong x0, x1, x2, x3, x4, x5, x6, x7;
+    ulong y1, y2, y3, y4, y5, y6, y7, y8, y9;
+    ulong y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+    ulong y20, y21;
+    ulong z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+    ulong z10, z11, z12, z13, z14, z15, z16, z17;
+    ulong t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+    ulong t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+    ulong t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+    ulong t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+    ulong t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+    ulong t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+    ulong t60, t61, t62, t63, t64, t65, t66, t67;
+    ulong s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+
+    // top linear transformation
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9 = x0 ^ x3;
+    y8 = x0 ^ x5;
+    t0 = x1 ^ x2;
+    y1 = t0 ^ x7;
+    y4 = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2 = y1 ^ x0;
+    y5 = y1 ^ x6;
+    y3 = y5 ^ y8;
+    t1 = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6 = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7 = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    // non-linear section
+    t2 = y12 & y15;
+    t3 = y3 & y6;
+    t4 = t3 ^ t2;
+    t5 = y4 & x7;
+    t6 = t5 ^ t2;
+    t7 = y13 & y16;
+    t8 = y5 & y1;
+    t9 = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0 = t44 & y15;
+    z1 = t37 & y6;
+    z2 = t33 & x7;
+    z3 = t43 & y16;
+    z4 = t40 & y1;
+    z5 = t29 & y7;
+    z6 = t42 & y11;
+    z7 = t45 & y17;
+    z8 = t41 & y10;
+    z9 = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    // bottom linear transformation
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0 = t59 ^ t63;
+    s6 = t56 ^ ~t62;
+    s7 = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3 = t53 ^ t66;
+    s4 = t51 ^ t66;
+    s5 = t47 ^ t65;
+    s1 = t64 ^ ~s3;
+    s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+//-----------------------------------------------------------------------------
+// MixBytes on a row-major state.
+// Circulant (02,02,03,04,05,03,05,07) split into its x1, x2 and x4 parts.
+inline void groestlMixBytes(ulong* x)
+{
+    ulong y[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        ulong a1 = x[(i+2)&7] ^ x[(i+4)&7] ^ x[(i+5)&7] ^ x[(i+6)&7] ^ x[(i+7)&7];
+        ulong a2 = x[i] ^ x[(i+1)&7] ^ x[(i+2)&7] ^ x[(i+5)&7] ^ x[(i+7)&7];
+        ulong a4 = x[(i+3)&7] ^ x[(i+4)&7] ^ x[(i+6)&7] ^ x[(i+7)&7];
+        y[i] = a1 ^ XTIME8(a2 ^ XTIME8(a4));
+    }
+
+    for (int i = 0; i < 8; ++i)
+        x[i] = y[i];
+}
+//-----------------------------------------------------------------------------
+inline void groestlSubBytes(ulong* x)
+{
+    groestlOrtho(x);
+    groestlSbox(x);
+    groestlOrtho(x);
+}
+//-----------------------------------------------------------------------------
+inline void groestlRoundP(ulong* x, ulong r)
+{
+    // AddRoundConstant: row 0, column c ^= (c << 4) ^ r
+    x[0] ^= 0x7060504030201000UL ^ (r * 0x0101010101010101UL);
+    groestlSubBytes(x);
+    // ShiftBytes: row i is shifted by i
+    x[1] = ROTR8B(x[1], 1);
+    x[2] = ROTR8B(x[2], 2);
+    x[3] = ROTR8B(x[3], 3);
+    x[4] = ROTR8B(x[4], 4);
+    x[5] = ROTR8B(x[5], 5);
+    x[6] = ROTR8B(x[6], 6);
+    x[7] = ROTR8B(x[7], 7);
+    groestlMixBytes(x);
+}
+//-----------------------------------------------------------------------------
+inline void groestlRoundQ(ulong* x, ulong r)
+{
+    // AddRoundConstant: rows 0..6 ^= 0xff, row 7, column c ^= ~(c << 4) ^ r
+    x[0] = ~x[0];
+    x[1] = ~x[1];
+    x[2] = ~x[2];
+    x[3] = ~x[3];
+    x[4] = ~x[4];
+    x[5] = ~x[5];
+    x[6] = ~x[6];
+    x[7] ^= 0x8F9FAFBFCFDFEFFFUL ^ (r * 0x0101010101010101UL);
+    groestlSubBytes(x);
+    // ShiftBytes: rows are shifted by (1, 3, 5, 7, 0, 2, 4, 6)
+    x[0] = ROTR8B(x[0], 1);
+    x[1] = ROTR8B(x[1], 3);
+    x[2] = ROTR8B(x[2], 5);
+    x[3] = ROTR8B(x[3], 7);
+    x[5] = ROTR8B(x[5], 2);
+    x[6] = ROTR8B(x[6], 4);
+    x[7] = ROTR8B(x[7], 6);
+    groestlMixBytes(x);
+}
+//-----------------------------------------------------------------------------
+// column 7 of a row-major state
+inline ulong groestlColumn7(const ulong* x)
+{
+    ulong c = 0;
+    for (int i = 0; i < 8; ++i)
+        c |= (x[i] >> 56) << (8*i);
+    return c;
+}
+//-----------------------------------------------------------------------------
+__attribute__((reqd_work_group_size(256, 1, 1)))
+__kernel void groestl256(__global uint* hashes, __global uint* output, const ulong target)
+{
+    uint gid = get_global_id(0);
+
+    __global hash_t *hash = (__global hash_t *)(hashes + (8* (get_global_id(0))));
+
+    ulong message[8], state[8];
+
+    for (int u = 0; u < 4; u++) {message[u] = hash->h2[u];}
+
+    message[4] = 0x80UL;
+    message[5] = 0UL;
+    message[6] = 0UL;
+    message[7] = 0x0100000000000000UL;
+
+    for (int u = 0; u < 8; u++) {state[u] = message[u];}
+    state[7] ^= 0x0001000000000000UL;
+
+    groestlTranspose(state);
+    groestlTranspose(message);
+
+    for (ulong r = 0; r < 10; r++) {groestlRoundP(state, r);}
+
+    // IV: row 6, column 7
+    state[6] ^= 0x0100000000000000UL;
+
+    for (ulong r = 0; r < 10; r++) {groestlRoundQ(message, r);}
+
+    for (int u = 0; u < 8; u++) {state[u] ^= message[u];}
+    // output transformation, only column 7 is required for the htarg test
+    const ulong h7 = groestlColumn7(state);
+
+    for (ulong r = 0; r < 10; r++) {groestlRoundP(state, r);}
+
+    const ulong result7 = groestlColumn7(state) ^ h7;
+
+    if (result7 <= target) {
+        uint ai = atomic_inc(output);
+        output[ai+1] = gid;
+    }
+}
@@ -1,7 +1,13 @@
 // lyra441p1 kernel.
 // Author: CryptoGraphics ( CrGraphics@protonmail.com )
 
+// LYCL_AMD_MEDIA_OPS is defined by the host if cl_amd_media_ops is supported.
+#ifdef LYCL_AMD_MEDIA_OPS
+#pragma OPENCL EXTENSION cl_amd_media_ops : enable
 #define rotr64(x, n) ((n) < 32 ? (amd_bitalign((uint)((x) >> 32), (uint)(x), (uint)(n)) | ((ulong)amd_bitalign((uint)(x), (uint)((x) >> 32), (uint)(n)) << 32)) : (amd_bitalign((uint)(x), (uint)((x) >> 32), (uint)(n) - 32) | ((ulong)amd_bitalign((uint)((x) >> 32), (uint)(x), (uint)(n) - 32) << 32)))
+#else
+#define rotr64(x, n) rotate((ulong)(x), (ulong)(64 - (n)))
+#endif
 
 #define Gfunc(a,b,c,d) \
 { \
@@ -2,7 +2,13 @@
 // Based on cuda implementation from the ccminer project(Provos Alexis, Tanguy Pruvot and others).
 // OpenCL port and AMDGCN specific optimizations were done by CryptoGraphics ( CrGraphics@protonmail.com ).
 
+// LYCL_AMD_MEDIA_OPS is defined by the host if cl_amd_media_ops is supported.
+#ifdef LYCL_AMD_MEDIA_OPS
+#pragma OPENCL EXTENSION cl_amd_media_ops : enable
 #define ROTR64(x, n) ((n) < 32 ? (amd_bitalign((uint)((x) >> 32), (uint)(x), (uint)(n)) | ((ulong)amd_bitalign((uint)(x), (uint)((x) >> 32), (uint)(n)) << 32)) : (amd_bitalign((uint)(x), (uint)((x) >> 32), (uint)(n) - 32) | ((ulong)amd_bitalign((uint)((x) >> 32), (uint)(x), (uint)(n) - 32) << 32)))
+#else
+#define ROTR64(x, n) rotate((ulong)(x), (ulong)(64 - (n)))
+#endif
 
 #define TFBIGMIX8e(){\
         p0+=p1;p2+=p3;p4+=p5;p6+=p7;p1=ROTR64(p1,18) ^ p0;p3=ROTR64(p3,28) ^ p2;p5=ROTR64(p5,45) ^ p4;p7=ROTR64(p7,27) ^ p6;\
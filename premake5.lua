@@ -74,3 +74,71 @@ workspace "lyclMinerWorkspace"
                 "src/lyclHostValidators/*.hpp",
                 "src/lyclHostValidators/*.cpp",
                 "src/main.cpp" }
+
+    -- host-side microbenchmarks of CPU hot paths(stratum parsing, merkle root, logging...)
+    project "lyclHostBench"
+        kind "ConsoleApp"
+        language "C++"
+        location "build/lyclHostBench"
+        
+        targetdir "bin"
+        
+        cppdialect "C++11"
+        
+        includedirs { "src", "." }
+
+        filter { "system:Windows" }
+            system "windows"
+            -- mingw-w64
+            links { "Ws2_32" }
+        filter { "system:Linux" }
+            system "linux"
+            -- linux gcc
+            links { "crypto", "pthread" }
+        filter { }
+
+        files { "src/lyclCore/*.hpp",
+                "src/lyclCore/*.cpp",
+                "bench/HostBench.cpp" }
+
+    -- standalone benchmark of single kernel stages on any OpenCL device
+    project "lyclKernelBench"
+        kind "ConsoleApp"
+        language "C++"
+        location "build/lyclKernelBench"
+        
+        targetdir "bin"
+        
+        cppdialect "C++11"
+        
+        includedirs { "src", "." }
+
+        files { "src/lyclCore/CLUtils.hpp",
+                "bench/KernelBench.cpp" }
+
+    -- local mock stratum pool for end-to-end latency and load testing
+    project "lyclMockPool"
+        kind "ConsoleApp"
+        language "C++"
+        location "build/lyclMockPool"
+        
+        targetdir "bin"
+        
+        cppdialect "C++11"
+        
+        includedirs { "src", "." }
+
+        filter { "system:Windows" }
+            system "windows"
+            -- mingw-w64
+            links { "Ws2_32" }
+        filter { "system:Linux" }
+            system "linux"
+            -- linux gcc
+            links { "crypto", "pthread" }
+        filter { }
+
+        files { "src/lyclCore/*.hpp",
+                "src/lyclCore/*.cpp",
+                "src/lyclHostValidators/*.hpp",
+                "tools/MockPool.cpp" }
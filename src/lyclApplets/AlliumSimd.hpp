@@ -0,0 +1,731 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef AlliumSimd_INCLUDE_ONCE
+#define AlliumSimd_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cstring> // memcpy
+#include <lyclCore/Blake256.hpp>
+
+// Multi-lane Allium implementation for the CPU backend.
+// N hashes(lanes) are computed at once using GCC vector extensions, one hash per vector element.
+// Lane group width is selected at runtime: 16(AVX-512), 8(AVX2) or 4(SSE2/NEON).
+// Every stage follows the OpenCL kernels from the kernels/ directory.
+
+#define LYCL_SIMD_INLINE inline __attribute__((always_inline))
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LYCL_SIMD_X86 1
+#define LYCL_SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define LYCL_SIMD_TARGET(isa)
+#endif
+
+#define SIMD_ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define SIMD_ROTL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+#define SIMD_ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+namespace lycl
+{
+namespace simd
+{
+    //! Vector types of a lane group.
+    template <int N> struct lanes
+    {
+        typedef uint32_t u32 __attribute__((vector_size(4 * N)));
+        typedef uint64_t u64 __attribute__((vector_size(8 * N)));
+    };
+
+    //! Size of the lyra2 matrix for a lane group in bytes. (8 rows x 8 columns x 12 words per lane)
+    inline size_t lyra2MatrixSize(int num_lanes)
+    {
+        return 8 * 96 * sizeof(uint64_t) * (size_t)num_lanes;
+    }
+    //-----------------------------------------------------------------------------
+    // blake32
+    //-----------------------------------------------------------------------------
+    #define SIMD_BLAKE_GS(a, b, c, d, x) \
+    { \
+        const uint8_t idx1 = c_sigma[r][x]; \
+        const uint8_t idx2 = c_sigma[r][x + 1]; \
+        v[a] += (m[idx1] ^ c_u256[idx2]) + v[b]; \
+        v[d] ^= v[a]; \
+        v[d] = (v[d] >> 16) | (v[d] << 16); \
+        v[c] += v[d]; \
+        v[b] ^= v[c]; \
+        v[b] = (v[b] >> 12) | (v[b] << 20); \
+        v[a] += (m[idx2] ^ c_u256[idx1]) + v[b]; \
+        v[d] ^= v[a]; \
+        v[d] = (v[d] >> 8) | (v[d] << 24); \
+        v[c] += v[d]; \
+        v[b] ^= v[c]; \
+        v[b] = (v[b] >> 7) | (v[b] << 25); \
+    }
+
+    //! Second block of blake256(80-byte header) for N consecutive nonces.
+    //! (midstate) is the state after the first block, (data) is header words 16..18.
+    template <int N>
+    LYCL_SIMD_INLINE void blake32(typename lanes<N>::u64* out, const uint32_t* midstate, const uint32_t* data, uint32_t first_nonce)
+    {
+        typedef typename lanes<N>::u32 u32v;
+        typedef typename lanes<N>::u64 u64v;
+        const u32v zero = {};
+
+        u32v m[16];
+        for (int i = 0; i < 16; ++i)
+            m[i] = zero;
+        m[0] = zero + data[0];
+        m[1] = zero + data[1];
+        m[2] = zero + data[2];
+        for (int l = 0; l < N; ++l)
+            m[3][l] = first_nonce + (uint32_t)l;
+        m[4] = zero + 0x80000000U;
+        m[13] = zero + 1U;
+        m[15] = zero + 640U;
+
+        u32v v[16];
+        for (int i = 0; i < 8; ++i)
+        {
+            v[i] = zero + midstate[i];
+            v[i + 8] = zero + c_u256[i];
+        }
+        v[12] ^= 640U;
+        v[13] ^= 640U;
+
+        for (int r = 0; r < 14; ++r)
+        {
+            // column step
+            SIMD_BLAKE_GS(0, 4, 0x8, 0xC, 0x0);
+            SIMD_BLAKE_GS(1, 5, 0x9, 0xD, 0x2);
+            SIMD_BLAKE_GS(2, 6, 0xA, 0xE, 0x4);
+            SIMD_BLAKE_GS(3, 7, 0xB, 0xF, 0x6);
+            // diagonal step
+            SIMD_BLAKE_GS(0, 5, 0xA, 0xF, 0x8);
+            SIMD_BLAKE_GS(1, 6, 0xB, 0xC, 0xA);
+            SIMD_BLAKE_GS(2, 7, 0x8, 0xD, 0xC);
+            SIMD_BLAKE_GS(3, 4, 0x9, 0xE, 0xE);
+        }
+
+        u32v h[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            h[i] = midstate[i] ^ v[i] ^ v[i + 8];
+            // byte swap
+            h[i] = ((h[i] << 8) & 0xFF00FF00U) | ((h[i] >> 8) & 0x00FF00FFU);
+            h[i] = (h[i] << 16) | (h[i] >> 16);
+        }
+
+        for (int i = 0; i < 4; ++i)
+            out[i] = __builtin_convertvector(h[2 * i], u64v) | (__builtin_convertvector(h[2 * i + 1], u64v) << 32);
+    }
+
+    #undef SIMD_BLAKE_GS
+    //-----------------------------------------------------------------------------
+    // keccak256 (keccak-f1600, 32-byte message)
+    //-----------------------------------------------------------------------------
+    const uint64_t c_keccakRC[24] =
+    {
+        0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808AULL, 0x8000000080008000ULL,
+        0x000000000000808BULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+        0x000000000000008AULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000AULL,
+        0x000000008000808BULL, 0x800000000000008BULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+        0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800AULL, 0x800000008000000AULL,
+        0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+    };
+
+    const int c_keccakRotc[24] = { 1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44 };
+    const int c_keccakPiln[24] = { 10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1 };
+
+    template <int N>
+    LYCL_SIMD_INLINE void keccak256(typename lanes<N>::u64* hash)
+    {
+        typedef typename lanes<N>::u64 u64v;
+        const u64v zero = {};
+
+        u64v s[25];
+        for (int i = 0; i < 25; ++i)
+            s[i] = zero;
+        for (int i = 0; i < 4; ++i)
+            s[i] = hash[i];
+        // padding (rate is 136 bytes)
+        s[4] = zero + 0x0000000000000001ULL;
+        s[16] = zero + 0x8000000000000000ULL;
+
+        u64v bc[5];
+        u64v t;
+        for (int r = 0; r < 24; ++r)
+        {
+            // theta
+            for (int i = 0; i < 5; ++i)
+                bc[i] = s[i] ^ s[i + 5] ^ s[i + 10] ^ s[i + 15] ^ s[i + 20];
+            for (int i = 0; i < 5; ++i)
+            {
+                t = bc[(i + 4) % 5] ^ SIMD_ROTL64(bc[(i + 1) % 5], 1);
+                for (int j = 0; j < 25; j += 5)
+                    s[j + i] ^= t;
+            }
+            // rho, pi
+            t = s[1];
+            for (int i = 0; i < 24; ++i)
+            {
+                const int j = c_keccakPiln[i];
+                bc[0] = s[j];
+                s[j] = SIMD_ROTL64(t, c_keccakRotc[i]);
+                t = bc[0];
+            }
+            // chi
+            for (int j = 0; j < 25; j += 5)
+            {
+                for (int i = 0; i < 5; ++i)
+                    bc[i] = s[j + i];
+                for (int i = 0; i < 5; ++i)
+                    s[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];
+            }
+            // iota
+            s[0] ^= c_keccakRC[r];
+        }
+
+        for (int i = 0; i < 4; ++i)
+            hash[i] = s[i];
+    }
+    //-----------------------------------------------------------------------------
+    // lyra2 (timeCost = 1, nRows = 8, nCols = 8)
+    //-----------------------------------------------------------------------------
+    #define SIMD_LYRA_G(a, b, c, d) \
+    { \
+        a += b; d = SIMD_ROTR64(d ^ a, 32); \
+        c += d; b = SIMD_ROTR64(b ^ c, 24); \
+        a += b; d = SIMD_ROTR64(d ^ a, 16); \
+        c += d; b = SIMD_ROTR64(b ^ c, 63); \
+    }
+
+    #define SIMD_LYRA_ROUND(s) \
+    { \
+        SIMD_LYRA_G(s[0], s[4], s[ 8], s[12]); \
+        SIMD_LYRA_G(s[1], s[5], s[ 9], s[13]); \
+        SIMD_LYRA_G(s[2], s[6], s[10], s[14]); \
+        SIMD_LYRA_G(s[3], s[7], s[11], s[15]); \
+        SIMD_LYRA_G(s[0], s[5], s[10], s[15]); \
+        SIMD_LYRA_G(s[1], s[6], s[11], s[12]); \
+        SIMD_LYRA_G(s[2], s[7], s[ 8], s[13]); \
+        SIMD_LYRA_G(s[3], s[4], s[ 9], s[14]); \
+    }
+
+    const uint64_t c_blake2bIV[8] =
+    {
+        0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+        0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+        0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+        0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+    };
+
+    //! Matrix layout: M[row * 96 + column * 12 + word], each element holds N lanes.
+    //! (rowInOut) differs per lane in the wandering phase, so it is accessed lane by lane.
+    template <int N>
+    LYCL_SIMD_INLINE void lyra2(typename lanes<N>::u64* hash, typename lanes<N>::u64* M)
+    {
+        typedef typename lanes<N>::u64 u64v;
+        const u64v zero = {};
+
+        u64v state[16];
+        for (int i = 0; i < 4; ++i)
+        {
+            state[i] = hash[i];     // password
+            state[i + 4] = hash[i]; // salt
+        }
+        for (int i = 0; i < 8; ++i)
+            state[i + 8] = zero + c_blake2bIV[i];
+
+        // absorb password, salt and basil. The basil block is not applied(Lyra2RE v1 behaviour)
+        for (int i = 0; i < 24; ++i)
+            SIMD_LYRA_ROUND(state);
+
+        // reducedSqueezeRow0
+        for (int i = 0; i < 8; ++i)
+        {
+            u64v* rowOut = M + 84 - 12 * i;
+            for (int j = 0; j < 12; ++j)
+                rowOut[j] = state[j];
+            SIMD_LYRA_ROUND(state);
+        }
+
+        // reducedSqueezeRow1
+        for (int i = 0; i < 8; ++i)
+        {
+            const u64v* rowIn = M + 12 * i;
+            u64v* rowOut = M + 96 + 84 - 12 * i;
+            for (int j = 0; j < 12; ++j)
+                state[j] ^= rowIn[j];
+            SIMD_LYRA_ROUND(state);
+            for (int j = 0; j < 12; ++j)
+                rowOut[j] = rowIn[j] ^ state[j];
+        }
+
+        // reducedDuplexRowSetup
+        static const int c_setupRows[6][3] = { {1, 0, 2}, {2, 1, 3}, {3, 0, 4}, {4, 3, 5}, {5, 2, 6}, {6, 1, 7} };
+        for (int k = 0; k < 6; ++k)
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                const u64v* rowIn = M + 96 * c_setupRows[k][0] + 12 * i;
+                u64v* rowInOut = M + 96 * c_setupRows[k][1] + 12 * i;
+                u64v* rowOut = M + 96 * c_setupRows[k][2] + 84 - 12 * i;
+                for (int j = 0; j < 12; ++j)
+                    state[j] ^= rowIn[j] + rowInOut[j];
+                SIMD_LYRA_ROUND(state);
+                for (int j = 0; j < 12; ++j)
+                    rowOut[j] = rowIn[j] ^ state[j];
+                for (int j = 0; j < 12; ++j)
+                    rowInOut[j] ^= state[(j + 11) % 12];
+            }
+        }
+
+        // reducedDuplexRow (wandering phase)
+        static const int c_wanderRows[8][2] = { {7, 0}, {0, 3}, {3, 6}, {6, 1}, {1, 4}, {4, 7}, {7, 2}, {2, 5} };
+        uint32_t rowa[N];
+        for (int k = 0; k < 8; ++k)
+        {
+            for (int l = 0; l < N; ++l)
+                rowa[l] = (uint32_t)state[0][l] & 7;
+
+            for (int i = 0; i < 8; ++i)
+            {
+                const u64v* rowIn = M + 96 * c_wanderRows[k][0] + 12 * i;
+                u64v* rowOut = M + 96 * c_wanderRows[k][1] + 12 * i;
+                u64v* rowInOut = M + 12 * i;
+                u64v inOut[12];
+                for (int j = 0; j < 12; ++j)
+                    for (int l = 0; l < N; ++l)
+                        inOut[j][l] = rowInOut[96 * rowa[l] + j][l];
+
+                for (int j = 0; j < 12; ++j)
+                    state[j] ^= rowIn[j] + inOut[j];
+                SIMD_LYRA_ROUND(state);
+                for (int j = 0; j < 12; ++j)
+                    rowOut[j] ^= state[j];
+                // rowInOut may be equal to rowOut, reload after the store.
+                for (int j = 0; j < 12; ++j)
+                    for (int l = 0; l < N; ++l)
+                        rowInOut[96 * rowa[l] + j][l] ^= state[(j + 11) % 12][l];
+            }
+        }
+
+        // absorb the first column of the last rowInOut(rowa is not updated)
+        for (int j = 0; j < 12; ++j)
+            for (int l = 0; l < N; ++l)
+                state[j][l] ^= M[96 * rowa[l] + j][l];
+        for (int i = 0; i < 12; ++i)
+            SIMD_LYRA_ROUND(state);
+
+        for (int i = 0; i < 4; ++i)
+            hash[i] = state[i];
+    }
+
+    #undef SIMD_LYRA_ROUND
+    #undef SIMD_LYRA_G
+    //-----------------------------------------------------------------------------
+    // cubeHash256 (CubeHash16/32-256, 32-byte message)
+    //-----------------------------------------------------------------------------
+    const uint32_t c_cubeHash256IV[32] =
+    {
+        0xEA2BD4B4, 0xCCD6F29F, 0x63117E71, 0x35481EAE, 0x22512D5B, 0xE5D94E63, 0x7E624131, 0xF4CC12BE,
+        0xC2D0B696, 0x42AF2070, 0xD0720C35, 0x3361DA8C, 0x28CCECA4, 0x8EF8AD83, 0x4680AC00, 0x40E5FBAB,
+        0xD89041C3, 0x6107FBD5, 0x6C859D41, 0xF0B26679, 0x09392549, 0x5FA25603, 0x65C892FD, 0x93CB6285,
+        0x2AF2B5AE, 0x9E4B4E60, 0x774ABFDD, 0x85254725, 0x15815AEB, 0x4AB6AAD6, 0x9CDAF8AF, 0xD6032C0A
+    };
+
+    template <int N>
+    LYCL_SIMD_INLINE void cubeHashRounds(typename lanes<N>::u32* x, int num_rounds)
+    {
+        typedef typename lanes<N>::u32 u32v;
+        u32v t;
+        for (int r = 0; r < num_rounds; ++r)
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                x[i + 16] += x[i];
+                x[i] = SIMD_ROTL32(x[i], 7);
+            }
+            for (int i = 0; i < 8; ++i)
+            {
+                t = x[i]; x[i] = x[i + 8]; x[i + 8] = t;
+            }
+            for (int i = 0; i < 16; ++i)
+                x[i] ^= x[i + 16];
+            for (int i = 16; i < 32; i += 4)
+            {
+                t = x[i]; x[i] = x[i + 2]; x[i + 2] = t;
+                t = x[i + 1]; x[i + 1] = x[i + 3]; x[i + 3] = t;
+            }
+            for (int i = 0; i < 16; ++i)
+            {
+                x[i + 16] += x[i];
+                x[i] = SIMD_ROTL32(x[i], 11);
+            }
+            for (int i = 0; i < 16; i += 8)
+            {
+                for (int j = 0; j < 4; ++j)
+                {
+                    t = x[i + j]; x[i + j] = x[i + j + 4]; x[i + j + 4] = t;
+                }
+            }
+            for (int i = 0; i < 16; ++i)
+                x[i] ^= x[i + 16];
+            for (int i = 16; i < 32; i += 2)
+            {
+                t = x[i]; x[i] = x[i + 1]; x[i + 1] = t;
+            }
+        }
+    }
+
+    template <int N>
+    LYCL_SIMD_INLINE void cubeHash256(typename lanes<N>::u64* hash)
+    {
+        typedef typename lanes<N>::u32 u32v;
+        typedef typename lanes<N>::u64 u64v;
+        const u32v zero = {};
+
+        u32v x[32];
+        for (int i = 0; i < 32; ++i)
+            x[i] = zero + c_cubeHash256IV[i];
+        for (int i = 0; i < 4; ++i)
+        {
+            x[2 * i] ^= __builtin_convertvector(hash[i], u32v);
+            x[2 * i + 1] ^= __builtin_convertvector(hash[i] >> 32, u32v);
+        }
+
+        cubeHashRounds<N>(x, 16);
+        // padding block
+        x[0] ^= 0x80U;
+        cubeHashRounds<N>(x, 16);
+        // finalization
+        x[31] ^= 1U;
+        cubeHashRounds<N>(x, 160);
+
+        for (int i = 0; i < 4; ++i)
+            hash[i] = __builtin_convertvector(x[2 * i], u64v) | (__builtin_convertvector(x[2 * i + 1], u64v) << 32);
+    }
+    //-----------------------------------------------------------------------------
+    // skein256 (Skein-512-256, 32-byte message)
+    //-----------------------------------------------------------------------------
+    const uint64_t c_skein512_256IV[8] =
+    {
+        0xCCD044A12FDB3E13ULL, 0xE83590301A79A9EBULL, 0x55AEA0614F816E6FULL, 0x2A2767A4AE9B94DBULL,
+        0xEC06025E74DD7683ULL, 0xE7A436CDC4746251ULL, 0xC36FBAF9393AD185ULL, 0x3EEDBA1833EDFC13ULL
+    };
+
+    #define SIMD_TFBIG_MIX8(r0, r1, r2, r3, r4, r5, r6, r7, r8, r9, r10, r11, r12, r13, r14, r15) \
+    { \
+        p0 += p1; p2 += p3; p4 += p5; p6 += p7; \
+        p1 = SIMD_ROTL64(p1, r0) ^ p0; p3 = SIMD_ROTL64(p3, r1) ^ p2; p5 = SIMD_ROTL64(p5, r2) ^ p4; p7 = SIMD_ROTL64(p7, r3) ^ p6; \
+        p2 += p1; p4 += p7; p6 += p5; p0 += p3; \
+        p1 = SIMD_ROTL64(p1, r4) ^ p2; p7 = SIMD_ROTL64(p7, r5) ^ p4; p5 = SIMD_ROTL64(p5, r6) ^ p6; p3 = SIMD_ROTL64(p3, r7) ^ p0; \
+        p4 += p1; p6 += p3; p0 += p5; p2 += p7; \
+        p1 = SIMD_ROTL64(p1, r8) ^ p4; p3 = SIMD_ROTL64(p3, r9) ^ p6; p5 = SIMD_ROTL64(p5, r10) ^ p0; p7 = SIMD_ROTL64(p7, r11) ^ p2; \
+        p6 += p1; p0 += p7; p2 += p5; p4 += p3; \
+        p1 = SIMD_ROTL64(p1, r12) ^ p6; p7 = SIMD_ROTL64(p7, r13) ^ p0; p5 = SIMD_ROTL64(p5, r14) ^ p2; p3 = SIMD_ROTL64(p3, r15) ^ p4; \
+    }
+
+    #define SIMD_TFBIG_ADDKEY(s) \
+    { \
+        p0 += k[((s) + 0) % 9]; p1 += k[((s) + 1) % 9]; \
+        p2 += k[((s) + 2) % 9]; p3 += k[((s) + 3) % 9]; \
+        p4 += k[((s) + 4) % 9]; p5 += k[((s) + 5) % 9] + t[(s) % 3]; \
+        p6 += k[((s) + 6) % 9] + t[((s) + 1) % 3]; p7 += k[((s) + 7) % 9] + (uint64_t)(s); \
+    }
+
+    //! Threefish-512 based UBI block. (h) is updated in place.
+    template <int N>
+    LYCL_SIMD_INLINE void skeinUbi512(typename lanes<N>::u64* h, const typename lanes<N>::u64* m, uint64_t t0, uint64_t t1)
+    {
+        typedef typename lanes<N>::u64 u64v;
+        u64v k[9];
+        const uint64_t t[3] = { t0, t1, t0 ^ t1 };
+
+        k[8] = h[0] ^ h[1] ^ h[2] ^ h[3] ^ h[4] ^ h[5] ^ h[6] ^ h[7] ^ 0x1BD11BDAA9FC1A22ULL;
+        for (int i = 0; i < 8; ++i)
+            k[i] = h[i];
+
+        u64v p0 = m[0], p1 = m[1], p2 = m[2], p3 = m[3];
+        u64v p4 = m[4], p5 = m[5], p6 = m[6], p7 = m[7];
+
+        SIMD_TFBIG_ADDKEY(0);
+        for (int s = 1; s <= 18; s += 2)
+        {
+            SIMD_TFBIG_MIX8(46, 36, 19, 37, 33, 27, 14, 42, 17, 49, 36, 39, 44, 9, 54, 56);
+            SIMD_TFBIG_ADDKEY(s);
+            SIMD_TFBIG_MIX8(39, 30, 34, 24, 13, 50, 10, 17, 25, 29, 39, 43, 8, 35, 56, 22);
+            SIMD_TFBIG_ADDKEY(s + 1);
+        }
+
+        h[0] = p0 ^ m[0]; h[1] = p1 ^ m[1];
+        h[2] = p2 ^ m[2]; h[3] = p3 ^ m[3];
+        h[4] = p4 ^ m[4]; h[5] = p5 ^ m[5];
+        h[6] = p6 ^ m[6]; h[7] = p7 ^ m[7];
+    }
+
+    #undef SIMD_TFBIG_ADDKEY
+    #undef SIMD_TFBIG_MIX8
+
+    template <int N>
+    LYCL_SIMD_INLINE void skein256(typename lanes<N>::u64* hash)
+    {
+        typedef typename lanes<N>::u64 u64v;
+        const u64v zero = {};
+
+        u64v h[8];
+        u64v m[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            h[i] = zero + c_skein512_256IV[i];
+            m[i] = zero;
+        }
+        for (int i = 0; i < 4; ++i)
+            m[i] = hash[i];
+
+        // message block: first | final | type(msg), 32 bytes
+        skeinUbi512<N>(h, m, 32, 0xF000000000000000ULL);
+        // output block: first | final | type(out), 8 byte counter(0)
+        for (int i = 0; i < 4; ++i)
+            m[i] = zero;
+        skeinUbi512<N>(h, m, 8, 0xFF00000000000000ULL);
+
+        for (int i = 0; i < 4; ++i)
+            hash[i] = h[i];
+    }
+    //-----------------------------------------------------------------------------
+    // groestl256 (32-byte message)
+    // Table lookups do not map to vector instructions, so every lane is processed separately.
+    //-----------------------------------------------------------------------------
+    const uint64_t c_groestlT0[256] =
+    {
+        0xc6a597f4a5f432c6ULL, 0xf884eb9784976ff8ULL, 0xee99c7b099b05eeeULL, 0xf68df78c8d8c7af6ULL,
+        0xff0de5170d17e8ffULL, 0xd6bdb7dcbddc0ad6ULL, 0xdeb1a7c8b1c816deULL, 0x915439fc54fc6d91ULL,
+        0x6050c0f050f09060ULL, 0x0203040503050702ULL, 0xcea987e0a9e02eceULL, 0x567dac877d87d156ULL,
+        0xe719d52b192bcce7ULL, 0xb56271a662a613b5ULL, 0x4de69a31e6317c4dULL, 0xec9ac3b59ab559ecULL,
+        0x8f4505cf45cf408fULL, 0x1f9d3ebc9dbca31fULL, 0x894009c040c04989ULL, 0xfa87ef92879268faULL,
+        0xef15c53f153fd0efULL, 0xb2eb7f26eb2694b2ULL, 0x8ec90740c940ce8eULL, 0xfb0bed1d0b1de6fbULL,
+        0x41ec822fec2f6e41ULL, 0xb3677da967a91ab3ULL, 0x5ffdbe1cfd1c435fULL, 0x45ea8a25ea256045ULL,
+        0x23bf46dabfdaf923ULL, 0x53f7a602f7025153ULL, 0xe496d3a196a145e4ULL, 0x9b5b2ded5bed769bULL,
+        0x75c2ea5dc25d2875ULL, 0xe11cd9241c24c5e1ULL, 0x3dae7ae9aee9d43dULL, 0x4c6a98be6abef24cULL,
+        0x6c5ad8ee5aee826cULL, 0x7e41fcc341c3bd7eULL, 0xf502f1060206f3f5ULL, 0x834f1dd14fd15283ULL,
+        0x685cd0e45ce48c68ULL, 0x51f4a207f4075651ULL, 0xd134b95c345c8dd1ULL, 0xf908e9180818e1f9ULL,
+        0xe293dfae93ae4ce2ULL, 0xab734d9573953eabULL, 0x6253c4f553f59762ULL, 0x2a3f54413f416b2aULL,
+        0x080c10140c141c08ULL, 0x955231f652f66395ULL, 0x46658caf65afe946ULL, 0x9d5e21e25ee27f9dULL,
+        0x3028607828784830ULL, 0x37a16ef8a1f8cf37ULL, 0x0a0f14110f111b0aULL, 0x2fb55ec4b5c4eb2fULL,
+        0x0e091c1b091b150eULL, 0x2436485a365a7e24ULL, 0x1b9b36b69bb6ad1bULL, 0xdf3da5473d4798dfULL,
+        0xcd26816a266aa7cdULL, 0x4e699cbb69bbf54eULL, 0x7fcdfe4ccd4c337fULL, 0xea9fcfba9fba50eaULL,
+        0x121b242d1b2d3f12ULL, 0x1d9e3ab99eb9a41dULL, 0x5874b09c749cc458ULL, 0x342e68722e724634ULL,
+        0x362d6c772d774136ULL, 0xdcb2a3cdb2cd11dcULL, 0xb4ee7329ee299db4ULL, 0x5bfbb616fb164d5bULL,
+        0xa4f65301f601a5a4ULL, 0x764decd74dd7a176ULL, 0xb76175a361a314b7ULL, 0x7dcefa49ce49347dULL,
+        0x527ba48d7b8ddf52ULL, 0xdd3ea1423e429fddULL, 0x5e71bc937193cd5eULL, 0x139726a297a2b113ULL,
+        0xa6f55704f504a2a6ULL, 0xb96869b868b801b9ULL, 0x0000000000000000ULL, 0xc12c99742c74b5c1ULL,
+        0x406080a060a0e040ULL, 0xe31fdd211f21c2e3ULL, 0x79c8f243c8433a79ULL, 0xb6ed772ced2c9ab6ULL,
+        0xd4beb3d9bed90dd4ULL, 0x8d4601ca46ca478dULL, 0x67d9ce70d9701767ULL, 0x724be4dd4bddaf72ULL,
+        0x94de3379de79ed94ULL, 0x98d42b67d467ff98ULL, 0xb0e87b23e82393b0ULL, 0x854a11de4ade5b85ULL,
+        0xbb6b6dbd6bbd06bbULL, 0xc52a917e2a7ebbc5ULL, 0x4fe59e34e5347b4fULL, 0xed16c13a163ad7edULL,
+        0x86c51754c554d286ULL, 0x9ad72f62d762f89aULL, 0x6655ccff55ff9966ULL, 0x119422a794a7b611ULL,
+        0x8acf0f4acf4ac08aULL, 0xe910c9301030d9e9ULL, 0x0406080a060a0e04ULL, 0xfe81e798819866feULL,
+        0xa0f05b0bf00baba0ULL, 0x7844f0cc44ccb478ULL, 0x25ba4ad5bad5f025ULL, 0x4be3963ee33e754bULL,
+        0xa2f35f0ef30eaca2ULL, 0x5dfeba19fe19445dULL, 0x80c01b5bc05bdb80ULL, 0x058a0a858a858005ULL,
+        0x3fad7eecadecd33fULL, 0x21bc42dfbcdffe21ULL, 0x7048e0d848d8a870ULL, 0xf104f90c040cfdf1ULL,
+        0x63dfc67adf7a1963ULL, 0x77c1ee58c1582f77ULL, 0xaf75459f759f30afULL, 0x426384a563a5e742ULL,
+        0x2030405030507020ULL, 0xe51ad12e1a2ecbe5ULL, 0xfd0ee1120e12effdULL, 0xbf6d65b76db708bfULL,
+        0x814c19d44cd45581ULL, 0x1814303c143c2418ULL, 0x26354c5f355f7926ULL, 0xc32f9d712f71b2c3ULL,
+        0xbee16738e13886beULL, 0x35a26afda2fdc835ULL, 0x88cc0b4fcc4fc788ULL, 0x2e395c4b394b652eULL,
+        0x93573df957f96a93ULL, 0x55f2aa0df20d5855ULL, 0xfc82e39d829d61fcULL, 0x7a47f4c947c9b37aULL,
+        0xc8ac8befacef27c8ULL, 0xbae76f32e73288baULL, 0x322b647d2b7d4f32ULL, 0xe695d7a495a442e6ULL,
+        0xc0a09bfba0fb3bc0ULL, 0x199832b398b3aa19ULL, 0x9ed12768d168f69eULL, 0xa37f5d817f8122a3ULL,
+        0x446688aa66aaee44ULL, 0x547ea8827e82d654ULL, 0x3bab76e6abe6dd3bULL, 0x0b83169e839e950bULL,
+        0x8cca0345ca45c98cULL, 0xc729957b297bbcc7ULL, 0x6bd3d66ed36e056bULL, 0x283c50443c446c28ULL,
+        0xa779558b798b2ca7ULL, 0xbce2633de23d81bcULL, 0x161d2c271d273116ULL, 0xad76419a769a37adULL,
+        0xdb3bad4d3b4d96dbULL, 0x6456c8fa56fa9e64ULL, 0x744ee8d24ed2a674ULL, 0x141e28221e223614ULL,
+        0x92db3f76db76e492ULL, 0x0c0a181e0a1e120cULL, 0x486c90b46cb4fc48ULL, 0xb8e46b37e4378fb8ULL,
+        0x9f5d25e75de7789fULL, 0xbd6e61b26eb20fbdULL, 0x43ef862aef2a6943ULL, 0xc4a693f1a6f135c4ULL,
+        0x39a872e3a8e3da39ULL, 0x31a462f7a4f7c631ULL, 0xd337bd5937598ad3ULL, 0xf28bff868b8674f2ULL,
+        0xd532b156325683d5ULL, 0x8b430dc543c54e8bULL, 0x6e59dceb59eb856eULL, 0xdab7afc2b7c218daULL,
+        0x018c028f8c8f8e01ULL, 0xb16479ac64ac1db1ULL, 0x9cd2236dd26df19cULL, 0x49e0923be03b7249ULL,
+        0xd8b4abc7b4c71fd8ULL, 0xacfa4315fa15b9acULL, 0xf307fd090709faf3ULL, 0xcf25856f256fa0cfULL,
+        0xcaaf8feaafea20caULL, 0xf48ef3898e897df4ULL, 0x47e98e20e9206747ULL, 0x1018202818283810ULL,
+        0x6fd5de64d5640b6fULL, 0xf088fb83888373f0ULL, 0x4a6f94b16fb1fb4aULL, 0x5c72b8967296ca5cULL,
+        0x3824706c246c5438ULL, 0x57f1ae08f1085f57ULL, 0x73c7e652c7522173ULL, 0x975135f351f36497ULL,
+        0xcb238d652365aecbULL, 0xa17c59847c8425a1ULL, 0xe89ccbbf9cbf57e8ULL, 0x3e217c6321635d3eULL,
+        0x96dd377cdd7cea96ULL, 0x61dcc27fdc7f1e61ULL, 0x0d861a9186919c0dULL, 0x0f851e9485949b0fULL,
+        0xe090dbab90ab4be0ULL, 0x7c42f8c642c6ba7cULL, 0x71c4e257c4572671ULL, 0xccaa83e5aae529ccULL,
+        0x90d83b73d873e390ULL, 0x06050c0f050f0906ULL, 0xf701f5030103f4f7ULL, 0x1c12383612362a1cULL,
+        0xc2a39ffea3fe3cc2ULL, 0x6a5fd4e15fe18b6aULL, 0xaef94710f910beaeULL, 0x69d0d26bd06b0269ULL,
+        0x17912ea891a8bf17ULL, 0x995829e858e87199ULL, 0x3a2774692769533aULL, 0x27b94ed0b9d0f727ULL,
+        0xd938a948384891d9ULL, 0xeb13cd351335deebULL, 0x2bb356ceb3cee52bULL, 0x2233445533557722ULL,
+        0xd2bbbfd6bbd604d2ULL, 0xa9704990709039a9ULL, 0x07890e8089808707ULL, 0x33a766f2a7f2c133ULL,
+        0x2db65ac1b6c1ec2dULL, 0x3c22786622665a3cULL, 0x15922aad92adb815ULL, 0xc92089602060a9c9ULL,
+        0x874915db49db5c87ULL, 0xaaff4f1aff1ab0aaULL, 0x5078a0887888d850ULL, 0xa57a518e7a8e2ba5ULL,
+        0x038f068a8f8a8903ULL, 0x59f8b213f8134a59ULL, 0x0980129b809b9209ULL, 0x1a1734391739231aULL,
+        0x65daca75da751065ULL, 0xd731b553315384d7ULL, 0x84c61351c651d584ULL, 0xd0b8bbd3b8d303d0ULL,
+        0x82c31f5ec35edc82ULL, 0x29b052cbb0cbe229ULL, 0x5a77b4997799c35aULL, 0x1e113c3311332d1eULL,
+        0x7bcbf646cb463d7bULL, 0xa8fc4b1ffc1fb7a8ULL, 0x6dd6da61d6610c6dULL, 0x2c3a584e3a4e622cULL
+    };
+
+    #define SIMD_GROESTL_ROTL(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+    #define SIMD_GROESTL_RSTT(d, a, b0, b1, b2, b3, b4, b5, b6, b7) \
+    { \
+        t[d] = c_groestlT0[(a[b0]) & 0xFF] \
+             ^ SIMD_GROESTL_ROTL(c_groestlT0[(a[b1] >>  8) & 0xFF],  8) \
+             ^ SIMD_GROESTL_ROTL(c_groestlT0[(a[b2] >> 16) & 0xFF], 16) \
+             ^ SIMD_GROESTL_ROTL(c_groestlT0[(a[b3] >> 24) & 0xFF], 24) \
+             ^ SIMD_GROESTL_ROTL(c_groestlT0[(a[b4] >> 32) & 0xFF], 32) \
+             ^ SIMD_GROESTL_ROTL(c_groestlT0[(a[b5] >> 40) & 0xFF], 40) \
+             ^ SIMD_GROESTL_ROTL(c_groestlT0[(a[b6] >> 48) & 0xFF], 48) \
+             ^ SIMD_GROESTL_ROTL(c_groestlT0[(a[b7] >> 56)], 56); \
+    }
+
+    inline void groestlPermP(uint64_t* a)
+    {
+        uint64_t t[8];
+        for (uint64_t r = 0; r < 10; ++r)
+        {
+            for (uint64_t i = 0; i < 8; ++i)
+                a[i] ^= (i << 4) + r;
+            SIMD_GROESTL_RSTT(0, a, 0, 1, 2, 3, 4, 5, 6, 7);
+            SIMD_GROESTL_RSTT(1, a, 1, 2, 3, 4, 5, 6, 7, 0);
+            SIMD_GROESTL_RSTT(2, a, 2, 3, 4, 5, 6, 7, 0, 1);
+            SIMD_GROESTL_RSTT(3, a, 3, 4, 5, 6, 7, 0, 1, 2);
+            SIMD_GROESTL_RSTT(4, a, 4, 5, 6, 7, 0, 1, 2, 3);
+            SIMD_GROESTL_RSTT(5, a, 5, 6, 7, 0, 1, 2, 3, 4);
+            SIMD_GROESTL_RSTT(6, a, 6, 7, 0, 1, 2, 3, 4, 5);
+            SIMD_GROESTL_RSTT(7, a, 7, 0, 1, 2, 3, 4, 5, 6);
+            for (int i = 0; i < 8; ++i)
+                a[i] = t[i];
+        }
+    }
+
+    inline void groestlPermQ(uint64_t* a)
+    {
+        uint64_t t[8];
+        for (uint64_t r = 0; r < 10; ++r)
+        {
+            for (uint64_t i = 0; i < 8; ++i)
+                a[i] ^= (r << 56) ^ ~((i << 4) << 56);
+            SIMD_GROESTL_RSTT(0, a, 1, 3, 5, 7, 0, 2, 4, 6);
+            SIMD_GROESTL_RSTT(1, a, 2, 4, 6, 0, 1, 3, 5, 7);
+            SIMD_GROESTL_RSTT(2, a, 3, 5, 7, 1, 2, 4, 6, 0);
+            SIMD_GROESTL_RSTT(3, a, 4, 6, 0, 2, 3, 5, 7, 1);
+            SIMD_GROESTL_RSTT(4, a, 5, 7, 1, 3, 4, 6, 0, 2);
+            SIMD_GROESTL_RSTT(5, a, 6, 0, 2, 4, 5, 7, 1, 3);
+            SIMD_GROESTL_RSTT(6, a, 7, 1, 3, 5, 6, 0, 2, 4);
+            SIMD_GROESTL_RSTT(7, a, 0, 2, 4, 6, 7, 1, 3, 5);
+            for (int i = 0; i < 8; ++i)
+                a[i] = t[i];
+        }
+    }
+
+    #undef SIMD_GROESTL_RSTT
+    #undef SIMD_GROESTL_ROTL
+
+    //! single lane groestl256. (hash) holds 4 words.
+    inline void groestl256(uint64_t* hash)
+    {
+        uint64_t m[8], g[8];
+        for (int i = 0; i < 4; ++i)
+            m[i] = hash[i];
+        m[4] = 0x80ULL;
+        m[5] = 0;
+        m[6] = 0;
+        m[7] = 0x0100000000000000ULL;
+
+        for (int i = 0; i < 8; ++i)
+            g[i] = m[i];
+        g[7] ^= 0x0001000000000000ULL; // IV
+
+        groestlPermP(g);
+        groestlPermQ(m);
+        for (int i = 0; i < 8; ++i)
+            g[i] ^= m[i];
+        g[7] ^= 0x0001000000000000ULL;
+
+        // output transformation
+        for (int i = 0; i < 8; ++i)
+            m[i] = g[i];
+        groestlPermP(g);
+        for (int i = 0; i < 4; ++i)
+            hash[i] = g[i + 4] ^ m[i + 4];
+    }
+    //-----------------------------------------------------------------------------
+    // allium
+    //-----------------------------------------------------------------------------
+    //! Compute allium hashes of N consecutive nonces starting at (first_nonce).
+    //! (lyra_matrix) must be lyra2MatrixSize(N) bytes aligned to 64.
+    //! (out_hashes) receives N hashes, 8 words each.
+    template <int N>
+    LYCL_SIMD_INLINE void alliumLanes(const uint32_t* midstate, const uint32_t* data, uint32_t first_nonce,
+                                      void* lyra_matrix, uint32_t* out_hashes)
+    {
+        typedef typename lanes<N>::u64 u64v;
+        u64v* M = (u64v*)lyra_matrix;
+        u64v hash[4];
+
+        blake32<N>(hash, midstate, data, first_nonce);
+        keccak256<N>(hash);
+        lyra2<N>(hash, M);
+        cubeHash256<N>(hash);
+        lyra2<N>(hash, M);
+        skein256<N>(hash);
+
+        uint64_t laneHash[4];
+        for (int l = 0; l < N; ++l)
+        {
+            for (int i = 0; i < 4; ++i)
+                laneHash[i] = hash[i][l];
+            groestl256(laneHash);
+            memcpy(out_hashes + 8 * l, laneHash, 32);
+        }
+    }
+
+    //! Lane group entry points. Each one is compiled for its instruction set.
+    LYCL_SIMD_TARGET("avx512f")
+    inline void alliumLanes16(const uint32_t* midstate, const uint32_t* data, uint32_t first_nonce,
+                              void* lyra_matrix, uint32_t* out_hashes)
+    {
+        alliumLanes<16>(midstate, data, first_nonce, lyra_matrix, out_hashes);
+    }
+
+    LYCL_SIMD_TARGET("avx2")
+    inline void alliumLanes8(const uint32_t* midstate, const uint32_t* data, uint32_t first_nonce,
+                             void* lyra_matrix, uint32_t* out_hashes)
+    {
+        alliumLanes<8>(midstate, data, first_nonce, lyra_matrix, out_hashes);
+    }
+
+    inline void alliumLanes4(const uint32_t* midstate, const uint32_t* data, uint32_t first_nonce,
+                             void* lyra_matrix, uint32_t* out_hashes)
+    {
+        alliumLanes<4>(midstate, data, first_nonce, lyra_matrix, out_hashes);
+    }
+
+    typedef void (*alliumLanesFunc)(const uint32_t*, const uint32_t*, uint32_t, void*, uint32_t*);
+
+    //! returns the entry point for a lane group width(4, 8 or 16), NULL otherwise.
+    inline alliumLanesFunc getAlliumLanesFunc(int num_lanes)
+    {
+        switch (num_lanes)
+        {
+            case 4: return alliumLanes4;
+            case 8: return alliumLanes8;
+            case 16: return alliumLanes16;
+            default: return NULL;
+        }
+    }
+} // namespace simd
+} // namespace lycl
+
+#undef SIMD_ROTL32
+#undef SIMD_ROTL64
+#undef SIMD_ROTR64
+
+#endif // !AlliumSimd_INCLUDE_ONCE
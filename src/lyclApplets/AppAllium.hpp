@@ -13,6 +13,8 @@
 #include <vector>
 #include <string>
 #include <lyclCore/CLUtils.hpp>
+#include <lyclCore/Blake256.hpp>
+#include <lyclHostValidators/SelfTest.hpp>
 #include <cstring> // memset
 #include <chrono>
 
@@ -32,10 +34,46 @@ namespace lycl
         uint32_t in16;
         uint32_t in17;
         uint32_t in18;
+        // nonce-independent values of the second blake256 compression. See blake256_precalc().
+        uint32_t blakePrecalc[17];
 
         cl_ulong htArg;
     };
 
+    //! device-side job slots. A job is uploaded to a free slot ahead of time, switching to it only selects the slot.
+    static const uint32_t c_numJobSlots = 4;
+    //! words per job slot, must match JOB_SLOT_WORDS in blake32_precalc.cl.
+    static const uint32_t c_jobSlotWords = 32;
+
+    //-----------------------------------------------------------------------------
+    //! blake256 midstate and nonce-independent precalc of an 80 byte (header), with a 64-bit (htarg).
+    inline void alliumKernelData(const uint32_t* header, cl_ulong htarg, KernelData& out_data)
+    {
+        memset(&out_data, 0, sizeof(out_data));
+        uint32_t h[8] =
+        {
+            0x6A09E667, 0xBB67AE85,
+            0x3C6EF372, 0xA54FF53A,
+            0x510E527F, 0x9B05688C,
+            0x1F83D9AB, 0x5BE0CD19
+        };
+        out_data.in16 = header[16];
+        out_data.in17 = header[17];
+        out_data.in18 = header[18];
+        blake256_compress(h, header);
+        out_data.uH0 = h[0];
+        out_data.uH1 = h[1];
+        out_data.uH2 = h[2];
+        out_data.uH3 = h[3];
+        out_data.uH4 = h[4];
+        out_data.uH5 = h[5];
+        out_data.uH6 = h[6];
+        out_data.uH7 = h[7];
+        // nonce-independent part of the second block
+        blake256_precalc(out_data.blakePrecalc, h, header);
+        out_data.htArg = htarg;
+    }
+
     struct alliumHash { uint32_t h[8]; };
 
     //-----------------------------------------------------------------------------
@@ -51,10 +89,18 @@ namespace lycl
         //! compute (work_size) hashes, starting from the (first_nonce) and checks hTarg.
         //! NOTE: hash results are not saved from the latest pass. Only hTarg result.
         inline void onRun(uint32_t first_nonce, size_t work_size);
+        //! same as onRun(), but waits for every stage and returns its time in milliseconds. Used by benchmark.
+        inline void onRunProfiled(uint32_t first_nonce, size_t work_size, std::vector<double>& out_stage_ms);
+        //! stage names in onRunProfiled() order.
+        inline void getStageNames(std::vector<std::string>& out_names);
         //! destroy context and free resources.
         inline void onDestroy();
-        //! must be called at least once, before (onRun())
+        //! uploads (kernel_data) to job slot 0 and selects it.
         inline void setKernelData(const KernelData& kernel_data);
+        //! uploads (kernel_data) to (slot) without waiting. The slot must not be used by a queued run.
+        inline void uploadJob(uint32_t slot, const KernelData& kernel_data);
+        //! following runs use the job in (slot).
+        inline void setJobSlot(uint32_t slot);
         //! returns all hashes. Very slow. Used for validation
         inline void getHashes(std::vector<alliumHash>& lyra_hashes);
         //! get result based on Htarg test.
@@ -63,10 +109,15 @@ namespace lycl
         inline void getHtArgTestResults(std::vector<uint32_t>& out_htargs, size_t num_elements, size_t offset_elem);
         //! returns hash at specific index, useful for host side validation.
         inline void getLatestHashResultForIndex(uint32_t index, alliumHash& out_hash);
+        //! reads hashes(8 words each) at (indices) from the hash storage. Used for sampled validation.
+        inline bool getHashesForIndices(const std::vector<uint32_t>& indices, std::vector<uint32_t>& out_hashes);
         //! clear hTarg result buffer.
         inline void clearResult(size_t num_elements);
 
     private:
+        //! known-answer test of every stage used by onRun(). Returns false and a failed stage name on mismatch.
+        inline bool runSelfTest(std::string& out_stage, int& out_mismatches);
+
         size_t m_maxWorkSize;
         cl_context m_clContext;
         cl_command_queue m_clCommandQueue;
@@ -101,6 +152,11 @@ namespace lycl
         cl_mem m_clMemHashStorage;
         cl_mem m_clMemLyraStates;
         cl_mem m_clMemHtArgResult;
+        cl_mem m_clMemJobSlots;
+        // host copies of job slots, kept until non-blocking uploads complete
+        uint32_t m_jobSlots[c_numJobSlots][c_jobSlotWords];
+        //! targets of job slots, set as a groestl256 kernel argument when a slot is selected.
+        cl_ulong m_jobSlotHtArg[c_numJobSlots];
     };
     //-----------------------------------------------------------------------------
     // AppAllium class inline methods implementation.
@@ -140,15 +196,18 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL command queue
-        //clCreateCommandQueue() // deprecated in 2.0
-        //m_clCommandQueue = clCreateCommandQueue(m_clContext, in_device.clId, 0, &errorCode);
-        m_clCommandQueue = clCreateCommandQueueWithProperties(m_clContext, in_device.clId, nullptr, &errorCode);
+        // clCreateCommandQueueWithProperties on 2.0+, clCreateCommandQueue on 1.2 platforms.
+        m_clCommandQueue = cluCreateCommandQueue(m_clContext, in_device.clId, &errorCode);
         if (errorCode != CL_SUCCESS)
         {
             std::cerr << "Failed to create a command queue. Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
             return false;
         }
         
+        //-------------------------------------
+        // Kernel build options (vendor specific intrinsics)
+        const std::string buildOptions = cluGetBuildOptions(in_device.clId);
+
         //-------------------------------------
         // Create buffers
         m_clMemHashStorage = clCreateBuffer(m_clContext, CL_MEM_READ_WRITE, sizeof(alliumHash)*m_maxWorkSize, nullptr, &errorCode);
@@ -171,10 +230,18 @@ namespace lycl
         }
         // Result counter must be initialized to 0.
         clearResult(1);
+        memset(m_jobSlots, 0, sizeof(m_jobSlots));
+        memset(m_jobSlotHtArg, 0, sizeof(m_jobSlotHtArg));
+        m_clMemJobSlots = clCreateBuffer(m_clContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(m_jobSlots), m_jobSlots, &errorCode);
+        if (errorCode != CL_SUCCESS)
+        {
+            std::cerr << "Failed to create a job slot buffer. Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
+            return false;
+        }
 
         //-------------------------------------
         // Create an OpenCL blake32 kernel
-        m_clProgramBlake32 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/blake32/blake32.cl");
+        m_clProgramBlake32 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/blake32/blake32_precalc.cl", buildOptions.c_str());
         if (m_clProgramBlake32 == NULL)
         {
             std::cerr << "Failed to create CL program from source(blake32). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -193,10 +260,16 @@ namespace lycl
             std::cerr << "Error setting kernel argument(0) inside kernel(blake32). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
             return false;
         }
+        errorCode = clSetKernelArg(m_clKernelBlake32, 1, sizeof(cl_mem), &m_clMemJobSlots);
+        if (errorCode != CL_SUCCESS)
+        {
+            std::cerr << "Error setting kernel argument(1) inside kernel(blake32). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
+            return false;
+        }
 
         //-------------------------------------
         // Create an OpenCL keccak kernel
-        m_clProgramKeccakF1600 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/keccakF1600/keccakF1600.cl");
+        m_clProgramKeccakF1600 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/keccakF1600/keccakF1600.cl", buildOptions.c_str());
         if (m_clProgramKeccakF1600 == NULL)
         {
             std::cerr << "Failed to create CL program from source(keccakF1600). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -218,7 +291,7 @@ namespace lycl
 		
         //-------------------------------------
         // Create an OpenCL lyra2 kernel
-        m_clProgramLyra2 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra2/lyra2.cl");
+        m_clProgramLyra2 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra2/lyra2.cl", buildOptions.c_str());
         if (m_clProgramLyra2 == NULL)
         {
             std::cerr << "Failed to create CL program from source(lyra2). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -240,7 +313,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL cubeHash kernel
-        m_clProgramCubeHash256 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/cubeHash256/cubeHash256.cl");
+        m_clProgramCubeHash256 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/cubeHash256/cubeHash256.cl", buildOptions.c_str());
         if (m_clProgramCubeHash256 == NULL)
         {
             std::cerr << "Failed to create CL program from source(cubeHash256). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -262,7 +335,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL lyra441p1 kernel
-        m_clProgramLyra441p1 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p1/lyra441p1.cl");
+        m_clProgramLyra441p1 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p1/lyra441p1.cl", buildOptions.c_str());
         if (m_clProgramLyra441p1 == NULL)
         {
             std::cerr << "Failed to create CL program from source(lyra441p1). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -344,7 +417,7 @@ namespace lycl
         if (!asmSuccess)
         {
             // Fallback to the OpenCL kernel.
-            m_clProgramLyra441p2 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p2/lyra441p2.cl");
+            m_clProgramLyra441p2 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p2/lyra441p2.cl", buildOptions.c_str());
             if (m_clProgramLyra441p2 == NULL)
             {
                 std::cerr << "Failed to create CL program from source(lyra441p2). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -367,7 +440,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL lyra441p3 kernel
-        m_clProgramLyra441p3 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p3/lyra441p3.cl");
+        m_clProgramLyra441p3 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p3/lyra441p3.cl", buildOptions.c_str());
         if (m_clProgramLyra441p3 == NULL)
         {
             std::cerr << "Failed to create a CL program from source(lyra441p3). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -394,7 +467,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL skein kernel
-        m_clProgramSkein = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/skein/skein.cl");
+        m_clProgramSkein = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/skein/skein.cl", buildOptions.c_str());
         if (m_clProgramSkein == NULL)
         {
             std::cerr << "Failed to create CL program from source(skein). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -415,7 +488,7 @@ namespace lycl
         
         //-------------------------------------
         // Create an OpenCL groestl256(htarg) kernel
-        m_clProgramGroestl256Htarg = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/groestl256/groestl256_htarg.cl");
+        m_clProgramGroestl256Htarg = cluCreateProgramFromFile(m_clContext, in_device.clId, getGroestlKernelFileName(in_device.groestlKernel), buildOptions.c_str());
         if (m_clProgramGroestl256Htarg == NULL)
         {
             std::cerr << "Failed to create CL program from source(groestl256Htarg). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -439,7 +512,82 @@ namespace lycl
             std::cerr << "Error setting kernel argument(1) inside kernel(groestl256Htarg). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
             return false;
         }
-        
+
+        //-------------------------------------
+        // Known-answer self-test
+        std::string failedStage;
+        int numMismatches = 0;
+        if (!runSelfTest(failedStage, numMismatches))
+        {
+            if (numMismatches < 0)
+                std::cerr << "Self-test failed to run(" << failedStage << "). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
+            else
+                std::cerr << "Self-test failed(" << failedStage << "): " << numMismatches << " of " << c_selfTestNumHashes << " results differ from the host reference. Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline bool AppAllium::runSelfTest(std::string& out_stage, int& out_mismatches)
+    {
+        const size_t localWorkSize = 256;
+
+        //-------------------------------------
+        // blake32(midstate and precalc from a fixed header)
+        uint32_t header[20];
+        selfTestGenHeader(header, 0x616C6C31);
+
+        KernelData kernelData;
+        alliumKernelData(header, 0, kernelData);
+        setKernelData(kernelData);
+
+        const uint32_t firstNonce = 0xFFFFFF80; // wraps around
+        clSetKernelArg(m_clKernelBlake32, 3, sizeof(uint32_t), &firstNonce);
+
+        std::vector<uint8_t> expected;
+        selfTestBlakeExpected(header, firstNonce, expected);
+
+        const selfTestLaunch blakeLaunch = { m_clKernelBlake32, 1, localWorkSize };
+        out_stage = "blake32";
+        out_mismatches = cluSelfTestRun(m_clCommandQueue, &blakeLaunch, 1) ? cluSelfTestCompare(m_clCommandQueue, m_clMemHashStorage, expected) : -1;
+        if (out_mismatches)
+            return false;
+
+        //-------------------------------------
+        // hash to hash stages
+        const selfTestLaunch keccakLaunch = { m_clKernelKeccakF1600, 1, localWorkSize };
+        out_stage = "keccakF1600";
+        out_mismatches = cluSelfTestStage(m_clCommandQueue, m_clMemHashStorage, &keccakLaunch, 1, ref::keccak256, 0x6B656331);
+        if (out_mismatches)
+            return false;
+
+        const selfTestLaunch lyra2Launch = { m_clKernelLyra2, 1, localWorkSize };
+        out_stage = "lyra2";
+        out_mismatches = cluSelfTestStage(m_clCommandQueue, m_clMemHashStorage, &lyra2Launch, 1, ref::lyra2, 0x6C797231);
+        if (out_mismatches)
+            return false;
+
+        const selfTestLaunch cubeHashLaunch = { m_clKernelCubeHash256, 1, localWorkSize };
+        out_stage = "cubeHash256";
+        out_mismatches = cluSelfTestStage(m_clCommandQueue, m_clMemHashStorage, &cubeHashLaunch, 1, ref::cubeHash256, 0x63756231);
+        if (out_mismatches)
+            return false;
+
+        const selfTestLaunch skeinLaunch = { m_clKernelSkein, 1, localWorkSize };
+        out_stage = "skein";
+        out_mismatches = cluSelfTestStage(m_clCommandQueue, m_clMemHashStorage, &skeinLaunch, 1, ref::skein256, 0x736B6E31);
+        if (out_mismatches)
+            return false;
+
+        //-------------------------------------
+        // groestl256(htarg), 64-bit target
+        out_stage = "groestl256Htarg";
+        out_mismatches = cluSelfTestHtarg(m_clCommandQueue, m_clMemHashStorage, m_clMemHtArgResult, m_clKernelGroestl256Htarg,
+                                          2, 2, ref::groestl256, 0x67726F31);
+        if (out_mismatches)
+            return false;
+
         return true;
     }
     //-----------------------------------------------------------------------------
@@ -452,7 +600,7 @@ namespace lycl
         }
 
         cl_int errorCode = CL_SUCCESS;
-        clSetKernelArg(m_clKernelBlake32, 12, sizeof(uint32_t), &first_nonce);
+        clSetKernelArg(m_clKernelBlake32, 3, sizeof(uint32_t), &first_nonce);
 
         const size_t globalWorkSize = num_hashes;
         const size_t globalWorkSize4x = num_hashes*4;
@@ -509,6 +657,45 @@ namespace lycl
         clFinish(m_clCommandQueue);
     }
     //-----------------------------------------------------------------------------
+    inline void AppAllium::onRunProfiled(uint32_t first_nonce, size_t num_hashes, std::vector<double>& out_stage_ms)
+    {
+        if (num_hashes > m_maxWorkSize)
+            num_hashes = m_maxWorkSize;
+
+        clSetKernelArg(m_clKernelBlake32, 3, sizeof(uint32_t), &first_nonce);
+
+        const size_t globalWorkSize = num_hashes;
+        const size_t localWorkSize = 256;
+        // same order as onRun()
+        const cl_kernel stages[] =
+        {
+            m_clKernelBlake32,
+            m_clKernelKeccakF1600,
+            m_clKernelLyra2,
+            m_clKernelCubeHash256,
+            m_clKernelLyra2,
+            m_clKernelSkein,
+            m_clKernelGroestl256Htarg
+        };
+        const size_t numStages = sizeof(stages) / sizeof(stages[0]);
+
+        out_stage_ms.resize(numStages);
+        for (size_t i = 0; i < numStages; ++i)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            clEnqueueNDRangeKernel(m_clCommandQueue, stages[i], 1, nullptr,
+                                   &globalWorkSize, &localWorkSize, 0, nullptr, nullptr);
+            clFinish(m_clCommandQueue);
+            out_stage_ms[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAllium::getStageNames(std::vector<std::string>& out_names)
+    {
+        static const char* names[] = { "blake32", "keccakF1600", "lyra2(1)", "cubeHash256", "lyra2(2)", "skein", "groestl256Htarg" };
+        out_names.assign(names, names + sizeof(names) / sizeof(names[0]));
+    }
+    //-----------------------------------------------------------------------------
     inline void AppAllium::getHashes(std::vector<alliumHash>& lyra_hashes)
     {
         if(lyra_hashes.size() < m_maxWorkSize)
@@ -524,7 +711,7 @@ namespace lycl
         cl_uint zero = 0;
         //int errorCode = clEnqueueFillBuffer(m_clCommandQueue, m_clMemHtArgResult, &zero, sizeof(uint32_t), 0, sizeof(uint32_t)*2, 0, nullptr, nullptr);
         // clear numElements+Elements...
-        int errorCode = clEnqueueFillBuffer(m_clCommandQueue, m_clMemHtArgResult, &zero, sizeof(uint32_t), 0, (sizeof(uint32_t)*num_elements) + 1, 0, nullptr, nullptr);
+        int errorCode = clEnqueueFillBuffer(m_clCommandQueue, m_clMemHtArgResult, &zero, sizeof(uint32_t), 0, sizeof(uint32_t)*(num_elements + 1), 0, nullptr, nullptr);
         if(errorCode != CL_SUCCESS)
             std::cerr << "Failed to clear a hTarg buffer object!" << std::endl;
 
@@ -535,19 +722,41 @@ namespace lycl
     //-----------------------------------------------------------------------------
     inline void AppAllium::setKernelData(const KernelData& kernel_data)
     {
-        clSetKernelArg(m_clKernelBlake32, 1, sizeof(uint32_t), &kernel_data.uH0);
-        clSetKernelArg(m_clKernelBlake32, 2, sizeof(uint32_t), &kernel_data.uH1);
-        clSetKernelArg(m_clKernelBlake32, 3, sizeof(uint32_t), &kernel_data.uH2);
-        clSetKernelArg(m_clKernelBlake32, 4, sizeof(uint32_t), &kernel_data.uH3);
-        clSetKernelArg(m_clKernelBlake32, 5, sizeof(uint32_t), &kernel_data.uH4);
-        clSetKernelArg(m_clKernelBlake32, 6, sizeof(uint32_t), &kernel_data.uH5);
-        clSetKernelArg(m_clKernelBlake32, 7, sizeof(uint32_t), &kernel_data.uH6);
-        clSetKernelArg(m_clKernelBlake32, 8, sizeof(uint32_t), &kernel_data.uH7);
-        clSetKernelArg(m_clKernelBlake32, 9, sizeof(uint32_t), &kernel_data.in16);
-        clSetKernelArg(m_clKernelBlake32, 10, sizeof(uint32_t), &kernel_data.in17);
-        clSetKernelArg(m_clKernelBlake32, 11, sizeof(uint32_t), &kernel_data.in18);
-        // set htarg for groestl256HTarg kernel
-        clSetKernelArg(m_clKernelGroestl256Htarg, 2, sizeof(cl_ulong), &kernel_data.htArg);
+        uploadJob(0, kernel_data);
+        setJobSlot(0);
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAllium::uploadJob(uint32_t slot, const KernelData& kernel_data)
+    {
+        uint32_t* words = m_jobSlots[slot];
+        words[0] = kernel_data.uH0;
+        words[1] = kernel_data.uH1;
+        words[2] = kernel_data.uH2;
+        words[3] = kernel_data.uH3;
+        words[4] = kernel_data.uH4;
+        words[5] = kernel_data.uH5;
+        words[6] = kernel_data.uH6;
+        words[7] = kernel_data.uH7;
+        words[8] = kernel_data.in16;
+        words[9] = kernel_data.in17;
+        words[10] = kernel_data.in18;
+        for (uint32_t i = 0; i < 17; ++i)
+            words[11 + i] = kernel_data.blakePrecalc[i];
+        // groestl256 kernels take the target as an argument, see setJobSlot
+        m_jobSlotHtArg[slot] = kernel_data.htArg;
+
+        // in-order queue: the upload completes before the next run, the calling thread does not wait.
+        cl_int errorCode = clEnqueueWriteBuffer(m_clCommandQueue, m_clMemJobSlots, CL_FALSE, sizeof(m_jobSlots[0]) * slot,
+                                                sizeof(m_jobSlots[0]), words, 0, nullptr, nullptr);
+        if (errorCode != CL_SUCCESS)
+            std::cerr << "Failed to upload a job slot!" << std::endl;
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAllium::setJobSlot(uint32_t slot)
+    {
+        clSetKernelArg(m_clKernelBlake32, 2, sizeof(uint32_t), &slot);
+        // groestl256 variants and the self-test share a scalar target argument.
+        clSetKernelArg(m_clKernelGroestl256Htarg, 2, sizeof(cl_ulong), &m_jobSlotHtArg[slot]);
     }
     //-----------------------------------------------------------------------------
     inline void AppAllium::getHtArgTestResultAndSize(uint32_t &out_nonce, uint32_t &out_dbgCount)
@@ -572,12 +781,31 @@ namespace lycl
         clEnqueueReadBuffer(m_clCommandQueue, m_clMemHashStorage, CL_TRUE, (size_t)sizeof(alliumHash)*index, sizeof(alliumHash), &out_hash, 0, nullptr, nullptr);
     }
     //-----------------------------------------------------------------------------
+    inline bool AppAllium::getHashesForIndices(const std::vector<uint32_t>& indices, std::vector<uint32_t>& out_hashes)
+    {
+        out_hashes.resize(indices.size() * 8);
+        // queue all reads, wait once.
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            cl_int errorCode = clEnqueueReadBuffer(m_clCommandQueue, m_clMemHashStorage, CL_FALSE, (size_t)sizeof(alliumHash)*indices[i],
+                                                   sizeof(alliumHash), &out_hashes[8 * i], 0, nullptr, nullptr);
+            if (errorCode != CL_SUCCESS)
+            {
+                clFinish(m_clCommandQueue);
+                return false;
+            }
+        }
+
+        return clFinish(m_clCommandQueue) == CL_SUCCESS;
+    }
+    //-----------------------------------------------------------------------------
     inline void AppAllium::onDestroy()
     {
         // memory objects
         clReleaseMemObject(m_clMemHashStorage);
         clReleaseMemObject(m_clMemLyraStates);
         clReleaseMemObject(m_clMemHtArgResult);
+        clReleaseMemObject(m_clMemJobSlots);
 		// groestl256Htarg
         clReleaseKernel(m_clKernelGroestl256Htarg);
         clReleaseProgram(m_clProgramGroestl256Htarg);
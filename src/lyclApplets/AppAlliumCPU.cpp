@@ -0,0 +1,12 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#include <lyclApplets/AppAlliumCPU.hpp>
+
+using namespace lycl;
@@ -0,0 +1,258 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef AppAlliumCPU_INCLUDE_ONCE
+#define AppAlliumCPU_INCLUDE_ONCE
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <lyclCore/CpuUtils.hpp>
+#include <lyclApplets/AppAllium.hpp> // KernelData, alliumHash
+#include <lyclApplets/AlliumSimd.hpp>
+
+namespace lycl
+{
+    //-----------------------------------------------------------------------------
+    // AppAlliumCPU class declaration.
+    // Native CPU backend. Same interface as AppAllium, so it can be driven by the same worker loop.
+    //-----------------------------------------------------------------------------
+    class AppAlliumCPU
+    {
+    public:
+        inline AppAlliumCPU();
+
+        //! initalization is required before using all other functions.
+        inline bool onInit(const cpuDevice& in_device);
+        //! compute (work_size) hashes, starting from the (first_nonce) and checks hTarg.
+        inline void onRun(uint32_t first_nonce, size_t work_size);
+        //! same as onRun(). The whole chain runs per lane group, so there is only one stage.
+        inline void onRunProfiled(uint32_t first_nonce, size_t work_size, std::vector<double>& out_stage_ms);
+        //! stage names in onRunProfiled() order.
+        inline void getStageNames(std::vector<std::string>& out_names);
+        //! free resources.
+        inline void onDestroy();
+        //! stores (kernel_data) in job slot 0 and selects it.
+        inline void setKernelData(const KernelData& kernel_data);
+        //! stores (kernel_data) in (slot).
+        inline void uploadJob(uint32_t slot, const KernelData& kernel_data);
+        //! following runs use the job in (slot).
+        inline void setJobSlot(uint32_t slot);
+        //! get result based on Htarg test.
+        inline void getHtArgTestResultAndSize(uint32_t& out_nonce, uint32_t& out_dbgCount);
+        //! get Htarg test result buffer content
+        inline void getHtArgTestResults(std::vector<uint32_t>& out_htargs, size_t num_elements, size_t offset_elem);
+        //! returns hash at specific index. Only hashes which passed Htarg test are kept.
+        inline void getLatestHashResultForIndex(uint32_t index, alliumHash& out_hash);
+        //! not supported, only hashes which passed Htarg test are kept. Always returns false.
+        inline bool getHashesForIndices(const std::vector<uint32_t>& indices, std::vector<uint32_t>& out_hashes);
+        //! clear hTarg result buffer.
+        inline void clearResult(size_t num_elements);
+
+    private:
+        size_t m_maxWorkSize;
+        int32_t m_numLanes;
+        simd::alliumLanesFunc m_laneFunc;
+        HugePageArena m_arena;
+        void* m_lyraMatrix;
+        uint32_t* m_laneHashes;
+        // blake256 midstate and header words 16..18
+        uint32_t m_midstate[8];
+        uint32_t m_data[3];
+        uint64_t m_htArg;
+        KernelData m_jobSlots[c_numJobSlots];
+        // same layout as the device result buffer: [count, index0, index1...]
+        std::vector<uint32_t> m_htArgResult;
+        std::vector<alliumHash> m_htArgHashes;
+    };
+    //-----------------------------------------------------------------------------
+    // AppAlliumCPU class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline AppAlliumCPU::AppAlliumCPU()
+        : m_maxWorkSize(0)
+        , m_numLanes(0)
+        , m_laneFunc(NULL)
+        , m_lyraMatrix(NULL)
+        , m_laneHashes(NULL)
+        , m_htArg(0)
+    {
+        memset(m_midstate, 0, sizeof(m_midstate));
+        memset(m_data, 0, sizeof(m_data));
+    }
+    //-----------------------------------------------------------------------------
+    inline bool AppAlliumCPU::onInit(const cpuDevice& in_device)
+    {
+        m_numLanes = in_device.numLanes;
+        m_laneFunc = simd::getAlliumLanesFunc(m_numLanes);
+        if (!m_laneFunc)
+        {
+            std::cerr << "Unsupported number of SIMD lanes(" << m_numLanes << "). CPU worker(" << in_device.index << ")" << std::endl;
+            return false;
+        }
+
+        if (m_numLanes > cpuGetMaxSimdLanes())
+        {
+            std::cerr << "Host CPU doesn't support " << m_numLanes << " SIMD lanes. CPU worker(" << in_device.index << ")" << std::endl;
+            return false;
+        }
+
+        // round down to a multiple of the lane group size
+        m_maxWorkSize = in_device.workSize - (in_device.workSize % (size_t)m_numLanes);
+        if (!m_maxWorkSize)
+        {
+            std::cerr << "Work size must be at least " << m_numLanes << ". CPU worker(" << in_device.index << ")" << std::endl;
+            return false;
+        }
+
+        //-------------------------------------
+        // lyra2 matrix and lane hashes
+        const size_t matrixSize = simd::lyra2MatrixSize(m_numLanes);
+        const size_t laneHashesSize = sizeof(alliumHash) * (size_t)m_numLanes;
+        if (!m_arena.init(matrixSize + laneHashesSize + 128))
+        {
+            std::cerr << "Failed to allocate memory. CPU worker(" << in_device.index << ")" << std::endl;
+            return false;
+        }
+
+        m_lyraMatrix = m_arena.allocate(matrixSize, 64);
+        m_laneHashes = (uint32_t*)m_arena.allocate(laneHashesSize, 64);
+        if (!m_arena.usesHugePages())
+            std::cout << "CPU worker(" << in_device.index << "): huge pages are not available, using regular pages." << std::endl;
+
+        m_htArgResult.assign(1, 0);
+        m_htArgHashes.clear();
+
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAlliumCPU::onRun(uint32_t first_nonce, size_t num_hashes)
+    {
+        if (num_hashes > m_maxWorkSize)
+        {
+            std::cout << "Warning: numHashes > maxHashesPerRun!" << std::endl;
+            num_hashes = m_maxWorkSize;
+        }
+
+        for (size_t i = 0; i < num_hashes; i += (size_t)m_numLanes)
+        {
+            m_laneFunc(m_midstate, m_data, first_nonce + (uint32_t)i, m_lyraMatrix, m_laneHashes);
+
+            // Htarg test on the highest 64 bits
+            for (int32_t l = 0; l < m_numLanes; ++l)
+            {
+                const uint32_t* hash = m_laneHashes + 8 * l;
+                const uint64_t hashHigh = ((uint64_t)hash[7] << 32) | hash[6];
+                if (hashHigh <= m_htArg)
+                {
+                    alliumHash result;
+                    memcpy(result.h, hash, sizeof(result.h));
+                    m_htArgHashes.push_back(result);
+                    m_htArgResult.push_back((uint32_t)i + (uint32_t)l);
+                    ++m_htArgResult[0];
+                }
+            }
+        }
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAlliumCPU::onRunProfiled(uint32_t first_nonce, size_t num_hashes, std::vector<double>& out_stage_ms)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        onRun(first_nonce, num_hashes);
+        out_stage_ms.assign(1, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAlliumCPU::getStageNames(std::vector<std::string>& out_names)
+    {
+        out_names.assign(1, "allium");
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAlliumCPU::clearResult(size_t num_elements)
+    {
+        (void)num_elements;
+        m_htArgResult.assign(1, 0);
+        m_htArgHashes.clear();
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAlliumCPU::setKernelData(const KernelData& kernel_data)
+    {
+        uploadJob(0, kernel_data);
+        setJobSlot(0);
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAlliumCPU::uploadJob(uint32_t slot, const KernelData& kernel_data)
+    {
+        m_jobSlots[slot] = kernel_data;
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAlliumCPU::setJobSlot(uint32_t slot)
+    {
+        const KernelData& kernel_data = m_jobSlots[slot];
+        m_midstate[0] = kernel_data.uH0;
+        m_midstate[1] = kernel_data.uH1;
+        m_midstate[2] = kernel_data.uH2;
+        m_midstate[3] = kernel_data.uH3;
+        m_midstate[4] = kernel_data.uH4;
+        m_midstate[5] = kernel_data.uH5;
+        m_midstate[6] = kernel_data.uH6;
+        m_midstate[7] = kernel_data.uH7;
+        m_data[0] = kernel_data.in16;
+        m_data[1] = kernel_data.in17;
+        m_data[2] = kernel_data.in18;
+        m_htArg = kernel_data.htArg;
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAlliumCPU::getHtArgTestResultAndSize(uint32_t &out_nonce, uint32_t &out_dbgCount)
+    {
+        out_dbgCount = m_htArgResult[0];
+        out_nonce = (m_htArgResult.size() > 1) ? m_htArgResult[1] : 0;
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAlliumCPU::getHtArgTestResults(std::vector<uint32_t>& out_htargs, size_t num_elements, size_t offset_elem)
+    {
+        if(out_htargs.size() < num_elements)
+            out_htargs.resize(num_elements);
+        for (size_t i = 0; i < num_elements; ++i)
+            out_htargs[i] = ((offset_elem + i) < m_htArgResult.size()) ? m_htArgResult[offset_elem + i] : 0;
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAlliumCPU::getLatestHashResultForIndex(uint32_t index, alliumHash& out_hash)
+    {
+        for (size_t i = 1; i < m_htArgResult.size(); ++i)
+        {
+            if (m_htArgResult[i] == index)
+            {
+                out_hash = m_htArgHashes[i - 1];
+                return;
+            }
+        }
+
+        memset(out_hash.h, 0, sizeof(out_hash.h));
+    }
+    //-----------------------------------------------------------------------------
+    inline bool AppAlliumCPU::getHashesForIndices(const std::vector<uint32_t>& indices, std::vector<uint32_t>& out_hashes)
+    {
+        // intermediate hashes are not kept by the lane functions.
+        (void)indices;
+        out_hashes.clear();
+        return false;
+    }
+    //-----------------------------------------------------------------------------
+    inline void AppAlliumCPU::onDestroy()
+    {
+        m_arena.release();
+        m_lyraMatrix = NULL;
+        m_laneHashes = NULL;
+        m_htArgResult.clear();
+        m_htArgHashes.clear();
+    }
+    //-----------------------------------------------------------------------------
+}
+
+#endif // !AppAlliumCPU_INCLUDE_ONCE
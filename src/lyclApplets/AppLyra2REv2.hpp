@@ -13,6 +13,9 @@
 #include <vector>
 #include <string>
 #include <lyclCore/CLUtils.hpp>
+#include <lyclCore/Blake256.hpp>
+#include <lyclHostValidators/SelfTest.hpp>
+#include <lyclHostValidators/Lyra2REv2.hpp>
 #include <cstring> // memset
 #include <chrono>
 
@@ -67,6 +70,9 @@ namespace lycl
         inline void clearResult(size_t num_elements);
 
     private:
+        //! known-answer test of every stage used by onRun(). Returns false and a failed stage name on mismatch.
+        inline bool runSelfTest(std::string& out_stage, int& out_mismatches);
+
         size_t m_maxWorkSize;
         cl_context m_clContext;
         cl_command_queue m_clCommandQueue;
@@ -140,15 +146,18 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL command queue
-        //clCreateCommandQueue() // deprecated in 2.0
-        //m_clCommandQueue = clCreateCommandQueue(m_clContext, in_device.clId, 0, &errorCode);
-        m_clCommandQueue = clCreateCommandQueueWithProperties(m_clContext, in_device.clId, nullptr, &errorCode);
+        // clCreateCommandQueueWithProperties on 2.0+, clCreateCommandQueue on 1.2 platforms.
+        m_clCommandQueue = cluCreateCommandQueue(m_clContext, in_device.clId, &errorCode);
         if (errorCode != CL_SUCCESS)
         {
             std::cerr << "Failed to create a command queue. Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
             return false;
         }
         
+        //-------------------------------------
+        // Kernel build options (vendor specific intrinsics)
+        const std::string buildOptions = cluGetBuildOptions(in_device.clId);
+
         //-------------------------------------
         // Create buffers
         m_clMemHashStorage = clCreateBuffer(m_clContext, CL_MEM_READ_WRITE, sizeof(lyraHash)*m_maxWorkSize, nullptr, &errorCode);
@@ -174,7 +183,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL blake32 kernel
-        m_clProgramBlake32 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/blake32/blake32.cl");
+        m_clProgramBlake32 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/blake32/blake32.cl", buildOptions.c_str());
         if (m_clProgramBlake32 == NULL)
         {
             std::cerr << "Failed to create CL program from source(blake32). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -196,7 +205,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL keccak kernel
-        m_clProgramKeccakF1600 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/keccakF1600/keccakF1600.cl");
+        m_clProgramKeccakF1600 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/keccakF1600/keccakF1600.cl", buildOptions.c_str());
         if (m_clProgramKeccakF1600 == NULL)
         {
             std::cerr << "Failed to create CL program from source(keccakF1600). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -218,7 +227,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL cubeHash kernel
-        m_clProgramCubeHash256 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/cubeHash256/cubeHash256.cl");
+        m_clProgramCubeHash256 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/cubeHash256/cubeHash256.cl", buildOptions.c_str());
         if (m_clProgramCubeHash256 == NULL)
         {
             std::cerr << "Failed to create CL program from source(cubeHash256). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -240,7 +249,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL lyra441p1 kernel
-        m_clProgramLyra441p1 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p1/lyra441p1.cl");
+        m_clProgramLyra441p1 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p1/lyra441p1.cl", buildOptions.c_str());
         if (m_clProgramLyra441p1 == NULL)
         {
             std::cerr << "Failed to create CL program from source(lyra441p1). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -322,7 +331,7 @@ namespace lycl
         if (!asmSuccess)
         {
             // Fallback to the OpenCL kernel.
-            m_clProgramLyra441p2 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p2/lyra441p2.cl");
+            m_clProgramLyra441p2 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p2/lyra441p2.cl", buildOptions.c_str());
             if (m_clProgramLyra441p2 == NULL)
             {
                 std::cerr << "Failed to create CL program from source(lyra441p2). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -345,7 +354,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL lyra441p3 kernel
-        m_clProgramLyra441p3 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p3/lyra441p3.cl");
+        m_clProgramLyra441p3 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p3/lyra441p3.cl", buildOptions.c_str());
         if (m_clProgramLyra441p3 == NULL)
         {
             std::cerr << "Failed to create a CL program from source(lyra441p3). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -372,7 +381,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL skein kernel
-        m_clProgramSkein = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/skein/skein.cl");
+        m_clProgramSkein = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/skein/skein.cl", buildOptions.c_str());
         if (m_clProgramSkein == NULL)
         {
             std::cerr << "Failed to create CL program from source(skein). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -393,7 +402,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL bmw(htarg) kernel
-        m_clProgramBmwHtarg = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/bmw/bmw_htarg.cl");
+        m_clProgramBmwHtarg = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/bmw/bmw_htarg.cl", buildOptions.c_str());
         if (m_clProgramBmwHtarg == NULL)
         {
             std::cerr << "Failed to create CL program from source(bmwHtarg). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -420,7 +429,7 @@ namespace lycl
 
         //-------------------------------------
         // Create an OpenCL bmw(full) kernel. Used for validation.
-        m_clProgramBmw = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/bmw/bmw.cl");
+        m_clProgramBmw = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/bmw/bmw.cl", buildOptions.c_str());
         if (m_clProgramBmw == NULL)
         {
             std::cerr << "Failed to create CL program from source(bmw). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
@@ -438,7 +447,146 @@ namespace lycl
             std::cerr << "Error setting kernel argument(0) inside kernel(bmw). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
             return false;
         }
-        
+
+        //-------------------------------------
+        // Known-answer self-test
+        std::string failedStage;
+        int numMismatches = 0;
+        bool selfTestPassed = runSelfTest(failedStage, numMismatches);
+        if (!selfTestPassed && asmSuccess && !failedStage.compare("lyra441"))
+        {
+            // broken ASM program. Fallback to the OpenCL kernel and test again.
+            std::cerr << "Self-test failed(lyra441) with ASM program(lyra441p2), falling back to the OpenCL kernel. Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
+            clReleaseKernel(m_clKernelLyra441p2);
+            clReleaseProgram(m_clProgramLyra441p2);
+            asmSuccess = false;
+
+            m_clProgramLyra441p2 = cluCreateProgramFromFile(m_clContext, in_device.clId, "kernels/lyra441p2/lyra441p2.cl", buildOptions.c_str());
+            if (m_clProgramLyra441p2 == NULL)
+            {
+                std::cerr << "Failed to create CL program from source(lyra441p2). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
+                return false;
+            }
+            m_clKernelLyra441p2 = clCreateKernel(m_clProgramLyra441p2, "lyra441p2", &errorCode);
+            if (errorCode != CL_SUCCESS)
+            {
+                std::cerr << "Failed to create kernel(lyra441p2). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
+                return false;
+            }
+            errorCode = clSetKernelArg(m_clKernelLyra441p2, 0, sizeof(cl_mem), &m_clMemLyraStates);
+            if (errorCode != CL_SUCCESS)
+            {
+                std::cerr << "Error setting kernel argument(0) inside kernel(lyra441p2). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
+                return false;
+            }
+
+            selfTestPassed = runSelfTest(failedStage, numMismatches);
+        }
+
+        if (!selfTestPassed)
+        {
+            if (numMismatches < 0)
+                std::cerr << "Self-test failed to run(" << failedStage << "). Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
+            else
+                std::cerr << "Self-test failed(" << failedStage << "): " << numMismatches << " of " << c_selfTestNumHashes << " results differ from the host reference. Device(" << deviceName << ") Platform index(" << in_device.platformIndex << ")" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline bool AppLyra2REv2::runSelfTest(std::string& out_stage, int& out_mismatches)
+    {
+        const size_t localWorkSize = 256;
+        const size_t lyraLocalWorkSize = 64;
+
+        //-------------------------------------
+        // blake32(midstate from a fixed header)
+        uint32_t header[20];
+        selfTestGenHeader(header, 0x6C726532);
+
+        KernelData kernelData;
+        memset(&kernelData, 0, sizeof(kernelData));
+        uint32_t h[8] =
+        {
+            0x6A09E667, 0xBB67AE85,
+            0x3C6EF372, 0xA54FF53A,
+            0x510E527F, 0x9B05688C,
+            0x1F83D9AB, 0x5BE0CD19
+        };
+        blake256_compress(h, header);
+        kernelData.uH0 = h[0];
+        kernelData.uH1 = h[1];
+        kernelData.uH2 = h[2];
+        kernelData.uH3 = h[3];
+        kernelData.uH4 = h[4];
+        kernelData.uH5 = h[5];
+        kernelData.uH6 = h[6];
+        kernelData.uH7 = h[7];
+        kernelData.in16 = header[16];
+        kernelData.in17 = header[17];
+        kernelData.in18 = header[18];
+        setKernelData(kernelData);
+
+        const uint32_t firstNonce = 0xFFFFFF80; // wraps around
+        clSetKernelArg(m_clKernelBlake32, 12, sizeof(uint32_t), &firstNonce);
+
+        std::vector<uint8_t> expected;
+        selfTestBlakeExpected(header, firstNonce, expected);
+
+        const selfTestLaunch blakeLaunch = { m_clKernelBlake32, 1, localWorkSize };
+        out_stage = "blake32";
+        out_mismatches = cluSelfTestRun(m_clCommandQueue, &blakeLaunch, 1) ? cluSelfTestCompare(m_clCommandQueue, m_clMemHashStorage, expected) : -1;
+        if (out_mismatches)
+            return false;
+
+        //-------------------------------------
+        // hash to hash stages
+        const selfTestLaunch keccakLaunch = { m_clKernelKeccakF1600, 1, localWorkSize };
+        out_stage = "keccakF1600";
+        out_mismatches = cluSelfTestStage(m_clCommandQueue, m_clMemHashStorage, &keccakLaunch, 1, ref::keccak256, 0x6B656332);
+        if (out_mismatches)
+            return false;
+
+        const selfTestLaunch cubeHashLaunch = { m_clKernelCubeHash256, 1, localWorkSize };
+        out_stage = "cubeHash256";
+        out_mismatches = cluSelfTestStage(m_clCommandQueue, m_clMemHashStorage, &cubeHashLaunch, 1, ref::cubeHash256, 0x63756232);
+        if (out_mismatches)
+            return false;
+
+        // lyra441p1-p3 are tested as one stage, intermediate states are kernel specific.
+        const selfTestLaunch lyra441Launches[3] =
+        {
+            { m_clKernelLyra441p1, 1, localWorkSize },
+            { m_clKernelLyra441p2, 4, lyraLocalWorkSize },
+            { m_clKernelLyra441p3, 1, localWorkSize }
+        };
+        out_stage = "lyra441";
+        out_mismatches = cluSelfTestStage(m_clCommandQueue, m_clMemHashStorage, lyra441Launches, 3, ref::lyra2v2, 0x6C797232);
+        if (out_mismatches)
+            return false;
+
+        const selfTestLaunch skeinLaunch = { m_clKernelSkein, 1, localWorkSize };
+        out_stage = "skein";
+        out_mismatches = cluSelfTestStage(m_clCommandQueue, m_clMemHashStorage, &skeinLaunch, 1, ref::skein256, 0x736B6E32);
+        if (out_mismatches)
+            return false;
+
+        // full bmw is used for host side validation of found nonces.
+        const selfTestLaunch bmwLaunch = { m_clKernelBmw, 1, localWorkSize };
+        out_stage = "bmw";
+        out_mismatches = cluSelfTestStage(m_clCommandQueue, m_clMemHashStorage, &bmwLaunch, 1, ref::bmw256, 0x626D7732);
+        if (out_mismatches)
+            return false;
+
+        //-------------------------------------
+        // bmw(htarg), 32-bit target
+        out_stage = "bmwHtarg";
+        out_mismatches = cluSelfTestHtarg(m_clCommandQueue, m_clMemHashStorage, m_clMemHtArgResult, m_clKernelBmwHtarg,
+                                          2, 1, ref::bmw256, 0x626D7733);
+        if (out_mismatches)
+            return false;
+
         return true;
     }
     //-----------------------------------------------------------------------------
@@ -503,7 +651,7 @@ namespace lycl
         cl_uint zero = 0;
         //int errorCode = clEnqueueFillBuffer(m_clCommandQueue, m_clMemHtArgResult, &zero, sizeof(uint32_t), 0, sizeof(uint32_t)*2, 0, nullptr, nullptr);
         // clear numElements+Elements...
-        int errorCode = clEnqueueFillBuffer(m_clCommandQueue, m_clMemHtArgResult, &zero, sizeof(uint32_t), 0, (sizeof(uint32_t)*num_elements) + 1, 0, nullptr, nullptr);
+        int errorCode = clEnqueueFillBuffer(m_clCommandQueue, m_clMemHtArgResult, &zero, sizeof(uint32_t), 0, sizeof(uint32_t)*(num_elements + 1), 0, nullptr, nullptr);
         if(errorCode != CL_SUCCESS)
             std::cerr << "Failed to clear a hTarg buffer object!" << std::endl;
 
@@ -0,0 +1,513 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef Benchmark_INCLUDE_ONCE
+#define Benchmark_INCLUDE_ONCE
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm> // sort
+#include <pthread.h>
+#include <jansson.h>
+#include <lyclCore/Log.hpp>
+#include <lyclCore/Blake256.hpp>
+#include <lyclApplets/AppAllium.hpp>
+#include <lyclApplets/AppAlliumCPU.hpp>
+#include <lyclHostValidators/Allium.hpp>
+
+// Offline benchmark.
+// Every device mines a synthetic header and target, without a pool connection.
+// Results can be saved as JSON and compared against a saved baseline.
+
+namespace lycl
+{
+    struct benchmarkOptions
+    {
+        //! mining time per device in seconds. Profiled runs are not included.
+        double duration;
+        //! JSON output file, empty: disabled.
+        std::string jsonFileName;
+        //! JSON baseline file, empty: disabled.
+        std::string baselineFileName;
+        //! allowed hashrate drop against the baseline in percent.
+        double tolerance;
+    };
+
+    struct benchmarkStage
+    {
+        std::string name;
+        //! average time per run.
+        double timeMs;
+        double hashrate;
+    };
+
+    struct benchmarkResult
+    {
+        int32_t index;
+        std::string name;
+        //! "opencl" or "cpu"
+        std::string backend;
+        size_t workSize;
+        bool initialized;
+
+        uint64_t numHashes;
+        uint64_t numRuns;
+        double elapsedSec;
+        double hashrate;
+        //! run latency percentiles
+        double latencyP50Ms;
+        double latencyP90Ms;
+        double latencyP99Ms;
+        double latencyMaxMs;
+        //! candidates reported by Htarg test, verified or rejected by the host reference.
+        uint64_t numCandidates;
+        uint64_t numVerified;
+        uint64_t numRejected;
+
+        std::vector<benchmarkStage> stages;
+    };
+
+    //! number of profiled runs used for per stage timings.
+    const int c_benchmarkProfiledRuns = 8;
+    //! synthetic target, top 64 bits of the hash. About 1 candidate per 65536 hashes.
+    const uint64_t c_benchmarkHtArg = 0x0000FFFFFFFFFFFFULL;
+
+    //-----------------------------------------------------------------------------
+    inline std::string benchmarkDeviceName(const device& in_device)
+    {
+        std::string name;
+        cluGetDeviceInfoString(in_device.clId, CL_DEVICE_NAME, name);
+        return name;
+    }
+    //-----------------------------------------------------------------------------
+    inline std::string benchmarkDeviceName(const cpuDevice& in_device)
+    {
+        return "CPU worker " + std::to_string(in_device.index) + " (" + std::to_string(in_device.numLanes) + " lanes)";
+    }
+    //-----------------------------------------------------------------------------
+    inline const char* benchmarkBackendName(const device&) { return "opencl"; }
+    inline const char* benchmarkBackendName(const cpuDevice&) { return "cpu"; }
+    //-----------------------------------------------------------------------------
+    //! synthetic block header. Same on every run, so results are comparable.
+    inline void benchmarkHeader(uint32_t* header)
+    {
+        uint32_t x = 0x62656E63;
+        for (int i = 0; i < 19; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            header[i] = x;
+        }
+        header[19] = 0;
+    }
+    //-----------------------------------------------------------------------------
+    inline double benchmarkPercentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+        size_t i = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+        return sorted[std::min(i, sorted.size() - 1)];
+    }
+    //-----------------------------------------------------------------------------
+    //! mines the synthetic job on a single device.
+    template <class TApp, class TDevice>
+    void benchmarkDevice(const TDevice& in_device, int32_t index, const benchmarkOptions& options, benchmarkResult& out_result)
+    {
+        out_result.index = index;
+        out_result.name = benchmarkDeviceName(in_device);
+        out_result.backend = benchmarkBackendName(in_device);
+        out_result.workSize = in_device.workSize;
+        out_result.initialized = false;
+        out_result.numHashes = 0;
+        out_result.numRuns = 0;
+        out_result.elapsedSec = 0.0;
+        out_result.hashrate = 0.0;
+        out_result.latencyP50Ms = out_result.latencyP90Ms = out_result.latencyP99Ms = out_result.latencyMaxMs = 0.0;
+        out_result.numCandidates = out_result.numVerified = out_result.numRejected = 0;
+        out_result.stages.clear();
+
+        TApp deviceCtx;
+        if (!deviceCtx.onInit(in_device))
+        {
+            Log::print(Log::LT_Error, "Benchmark: failed to initialize device #%d(%s).", index, out_result.name.c_str());
+            return;
+        }
+        out_result.initialized = true;
+
+        //-------------------------------------
+        // synthetic job
+        uint32_t header[20];
+        benchmarkHeader(header);
+
+        KernelData kernelData;
+        alliumKernelData(header, c_benchmarkHtArg, kernelData);
+        deviceCtx.setKernelData(kernelData);
+        deviceCtx.clearResult(in_device.workSize);
+
+        // nonce ranges don't overlap between devices
+        uint32_t nonce = (uint32_t)index << 24;
+        std::vector<double> latencies;
+        std::vector<uint32_t> candidates;
+        uint32_t data[20];
+        memcpy(data, header, sizeof(data));
+
+        // warm-up run, not measured.
+        deviceCtx.onRun(nonce, in_device.workSize);
+        deviceCtx.clearResult(in_device.workSize);
+        nonce += (uint32_t)in_device.workSize;
+
+        //-------------------------------------
+        // mining
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        double elapsedSec = 0.0;
+        while (elapsedSec < options.duration)
+        {
+            std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+            deviceCtx.onRun(nonce, in_device.workSize);
+            uint32_t firstCandidate = 0;
+            uint32_t numCandidates = 0;
+            deviceCtx.getHtArgTestResultAndSize(firstCandidate, numCandidates);
+            std::chrono::steady_clock::time_point runEnd = std::chrono::steady_clock::now();
+            latencies.push_back(std::chrono::duration<double, std::milli>(runEnd - runStart).count());
+
+            // verify candidates on the host
+            if (numCandidates)
+            {
+                deviceCtx.getHtArgTestResults(candidates, numCandidates, 1);
+                for (uint32_t i = 0; i < numCandidates; ++i)
+                {
+                    data[19] = nonce + candidates[i];
+                    uint32_t hash[8];
+                    ref::alliumHash(data, hash);
+                    const uint64_t hashHigh = ((uint64_t)hash[7] << 32) | hash[6];
+                    if (hashHigh <= c_benchmarkHtArg)
+                        ++out_result.numVerified;
+                    else
+                        ++out_result.numRejected;
+                }
+                out_result.numCandidates += numCandidates;
+                deviceCtx.clearResult(numCandidates);
+            }
+
+            nonce += (uint32_t)in_device.workSize;
+            out_result.numHashes += in_device.workSize;
+            ++out_result.numRuns;
+            elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        out_result.elapsedSec = elapsedSec;
+        out_result.hashrate = elapsedSec ? ((double)out_result.numHashes / elapsedSec) : 0.0;
+
+        std::sort(latencies.begin(), latencies.end());
+        out_result.latencyP50Ms = benchmarkPercentile(latencies, 0.50);
+        out_result.latencyP90Ms = benchmarkPercentile(latencies, 0.90);
+        out_result.latencyP99Ms = benchmarkPercentile(latencies, 0.99);
+        out_result.latencyMaxMs = latencies.empty() ? 0.0 : latencies.back();
+
+        //-------------------------------------
+        // per stage timings
+        std::vector<std::string> stageNames;
+        deviceCtx.getStageNames(stageNames);
+        std::vector<double> stageMs;
+        std::vector<double> stageSumMs(stageNames.size(), 0.0);
+        for (int r = 0; r < c_benchmarkProfiledRuns; ++r)
+        {
+            deviceCtx.onRunProfiled(nonce, in_device.workSize, stageMs);
+            for (size_t i = 0; i < stageSumMs.size() && i < stageMs.size(); ++i)
+                stageSumMs[i] += stageMs[i];
+            deviceCtx.clearResult(in_device.workSize);
+            nonce += (uint32_t)in_device.workSize;
+        }
+
+        for (size_t i = 0; i < stageNames.size(); ++i)
+        {
+            benchmarkStage stage;
+            stage.name = stageNames[i];
+            stage.timeMs = stageSumMs[i] / (double)c_benchmarkProfiledRuns;
+            stage.hashrate = stage.timeMs ? ((double)in_device.workSize / (stage.timeMs * 0.001)) : 0.0;
+            out_result.stages.push_back(stage);
+        }
+
+        deviceCtx.onDestroy();
+    }
+    //-----------------------------------------------------------------------------
+    inline void benchmarkPrint(const benchmarkResult& result)
+    {
+        if (!result.initialized)
+        {
+            Log::print(Log::LT_Error, "Device #%d(%s): not initialized.", result.index, result.name.c_str());
+            return;
+        }
+
+        Log::print(Log::LT_Notice, "Device #%d(%s, %s): %.2f kH/s, %llu runs of %llu hashes in %.1fs",
+                   result.index, result.name.c_str(), result.backend.c_str(), result.hashrate * 0.001,
+                   (unsigned long long)result.numRuns, (unsigned long long)result.workSize, result.elapsedSec);
+        Log::print(Log::LT_Info, "    run latency: p50 %.2fms, p90 %.2fms, p99 %.2fms, max %.2fms",
+                   result.latencyP50Ms, result.latencyP90Ms, result.latencyP99Ms, result.latencyMaxMs);
+        Log::print(Log::LT_Info, "    candidates: %llu, verified: %llu, rejected: %llu",
+                   (unsigned long long)result.numCandidates, (unsigned long long)result.numVerified, (unsigned long long)result.numRejected);
+        for (size_t i = 0; i < result.stages.size(); ++i)
+        {
+            Log::print(Log::LT_Info, "    stage %-16s %8.3fms %12.2f kH/s",
+                       result.stages[i].name.c_str(), result.stages[i].timeMs, result.stages[i].hashrate * 0.001);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    //! writes results as JSON. Returns false on error.
+    inline bool benchmarkWriteJson(const std::vector<benchmarkResult>& results, const benchmarkOptions& options, const char* file_name)
+    {
+        json_t* root = json_object();
+        json_object_set_new(root, "version", json_string(PACKAGE_VERSION));
+        json_object_set_new(root, "algorithm", json_string("allium"));
+        json_object_set_new(root, "duration", json_real(options.duration));
+
+        json_t* devices = json_array();
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const benchmarkResult& r = results[i];
+            json_t* dv = json_object();
+            json_object_set_new(dv, "index", json_integer(r.index));
+            json_object_set_new(dv, "name", json_string(r.name.c_str()));
+            json_object_set_new(dv, "backend", json_string(r.backend.c_str()));
+            json_object_set_new(dv, "workSize", json_integer((json_int_t)r.workSize));
+            json_object_set_new(dv, "initialized", r.initialized ? json_true() : json_false());
+            json_object_set_new(dv, "hashes", json_integer((json_int_t)r.numHashes));
+            json_object_set_new(dv, "runs", json_integer((json_int_t)r.numRuns));
+            json_object_set_new(dv, "elapsed", json_real(r.elapsedSec));
+            json_object_set_new(dv, "hashrate", json_real(r.hashrate));
+
+            json_t* latency = json_object();
+            json_object_set_new(latency, "p50", json_real(r.latencyP50Ms));
+            json_object_set_new(latency, "p90", json_real(r.latencyP90Ms));
+            json_object_set_new(latency, "p99", json_real(r.latencyP99Ms));
+            json_object_set_new(latency, "max", json_real(r.latencyMaxMs));
+            json_object_set_new(dv, "latencyMs", latency);
+
+            json_object_set_new(dv, "candidates", json_integer((json_int_t)r.numCandidates));
+            json_object_set_new(dv, "verified", json_integer((json_int_t)r.numVerified));
+            json_object_set_new(dv, "rejected", json_integer((json_int_t)r.numRejected));
+
+            json_t* stages = json_array();
+            for (size_t s = 0; s < r.stages.size(); ++s)
+            {
+                json_t* st = json_object();
+                json_object_set_new(st, "name", json_string(r.stages[s].name.c_str()));
+                json_object_set_new(st, "timeMs", json_real(r.stages[s].timeMs));
+                json_object_set_new(st, "hashrate", json_real(r.stages[s].hashrate));
+                json_array_append_new(stages, st);
+            }
+            json_object_set_new(dv, "stages", stages);
+
+            json_array_append_new(devices, dv);
+        }
+        json_object_set_new(root, "devices", devices);
+
+        const int rc = json_dump_file(root, file_name, JSON_INDENT(2));
+        json_decref(root);
+        return rc == 0;
+    }
+    //-----------------------------------------------------------------------------
+    //! compares (results) against a baseline file. Returns number of regressions, -1 on error.
+    inline int benchmarkCompareBaseline(const std::vector<benchmarkResult>& results, const char* file_name, double tolerance)
+    {
+        json_error_t err;
+        json_t* root = json_load_file(file_name, 0, &err);
+        if (!root)
+        {
+            Log::print(Log::LT_Error, "Failed to load a baseline file(%s): %s (line %d)", file_name, err.text, err.line);
+            return -1;
+        }
+
+        json_t* devices = json_object_get(root, "devices");
+        if (!devices || !json_is_array(devices))
+        {
+            Log::print(Log::LT_Error, "Baseline file(%s) has no \"devices\" array.", file_name);
+            json_decref(root);
+            return -1;
+        }
+
+        const double minRatio = 1.0 - tolerance * 0.01;
+        int numRegressions = 0;
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const benchmarkResult& r = results[i];
+            if (!r.initialized)
+                continue;
+
+            // devices are matched by index and name
+            json_t* base = nullptr;
+            for (size_t j = 0; j < json_array_size(devices); ++j)
+            {
+                json_t* dv = json_array_get(devices, j);
+                json_t* index = json_object_get(dv, "index");
+                json_t* name = json_object_get(dv, "name");
+                if (index && name && (json_integer_value(index) == r.index) && json_string_value(name) && !r.name.compare(json_string_value(name)))
+                {
+                    base = dv;
+                    break;
+                }
+            }
+            if (!base)
+            {
+                Log::print(Log::LT_Warning, "Device #%d(%s): not found in the baseline.", r.index, r.name.c_str());
+                continue;
+            }
+
+            const double baseHashrate = json_number_value(json_object_get(base, "hashrate"));
+            if (baseHashrate > 0.0)
+            {
+                const double ratio = r.hashrate / baseHashrate;
+                if (ratio < minRatio)
+                {
+                    ++numRegressions;
+                    Log::print(Log::LT_Warning, "Device #%d(%s): REGRESSION hashrate %.2f kH/s, baseline %.2f kH/s(%+.2f%%)",
+                               r.index, r.name.c_str(), r.hashrate * 0.001, baseHashrate * 0.001, (ratio - 1.0) * 100.0);
+                }
+                else
+                {
+                    Log::print(Log::LT_Notice, "Device #%d(%s): hashrate %.2f kH/s, baseline %.2f kH/s(%+.2f%%)",
+                               r.index, r.name.c_str(), r.hashrate * 0.001, baseHashrate * 0.001, (ratio - 1.0) * 100.0);
+                }
+            }
+
+            // stages are matched by name
+            json_t* baseStages = json_object_get(base, "stages");
+            for (size_t s = 0; baseStages && s < r.stages.size(); ++s)
+            {
+                for (size_t j = 0; j < json_array_size(baseStages); ++j)
+                {
+                    json_t* st = json_array_get(baseStages, j);
+                    const char* stageName = json_string_value(json_object_get(st, "name"));
+                    if (!stageName || r.stages[s].name.compare(stageName))
+                        continue;
+
+                    const double baseStageHashrate = json_number_value(json_object_get(st, "hashrate"));
+                    if ((baseStageHashrate > 0.0) && (r.stages[s].hashrate / baseStageHashrate < minRatio))
+                    {
+                        ++numRegressions;
+                        Log::print(Log::LT_Warning, "Device #%d(%s): REGRESSION stage %s %.2f kH/s, baseline %.2f kH/s",
+                                   r.index, r.name.c_str(), stageName, r.stages[s].hashrate * 0.001, baseStageHashrate * 0.001);
+                    }
+                    break;
+                }
+            }
+
+            // a device which used to verify all candidates must still do so
+            json_t* baseRejected = json_object_get(base, "rejected");
+            if (r.numRejected && baseRejected && !json_integer_value(baseRejected))
+            {
+                ++numRegressions;
+                Log::print(Log::LT_Warning, "Device #%d(%s): REGRESSION %llu candidates rejected by the host, baseline had none.",
+                           r.index, r.name.c_str(), (unsigned long long)r.numRejected);
+            }
+        }
+
+        json_decref(root);
+        return numRegressions;
+    }
+    //-----------------------------------------------------------------------------
+    struct benchmarkThreadData
+    {
+        pthread_t thread;
+        bool isCpu;
+        device clDevice;
+        cpuDevice cpuDev;
+        int32_t index;
+        const benchmarkOptions* options;
+        benchmarkResult result;
+    };
+    //-----------------------------------------------------------------------------
+    inline void* benchmarkThread(void* userdata)
+    {
+        benchmarkThreadData* td = (benchmarkThreadData*)userdata;
+        if (td->isCpu)
+            benchmarkDevice<AppAlliumCPU>(td->cpuDev, td->index, *td->options, td->result);
+        else
+            benchmarkDevice<AppAllium>(td->clDevice, td->index, *td->options, td->result);
+        return NULL;
+    }
+    //-----------------------------------------------------------------------------
+    //! runs all devices at once(same thermal load as mining). Returns process exit code:
+    //! 0: success, 1: error, 2: regression against the baseline.
+    inline int runBenchmark(const std::vector<device>& cl_devices, const std::vector<cpuDevice>& cpu_devices, const benchmarkOptions& options)
+    {
+        const size_t numDevices = cl_devices.size() + cpu_devices.size();
+        Log::print(Log::LT_Notice, "Benchmark: %u device(s), %.0f seconds, synthetic allium job.", (uint32_t)numDevices, options.duration);
+
+        std::vector<benchmarkThreadData> threads(numDevices);
+        for (size_t i = 0; i < numDevices; ++i)
+        {
+            benchmarkThreadData& td = threads[i];
+            td.isCpu = (i >= cl_devices.size());
+            if (td.isCpu)
+                td.cpuDev = cpu_devices[i - cl_devices.size()];
+            else
+                td.clDevice = cl_devices[i];
+            td.index = (int32_t)i;
+            td.options = &options;
+        }
+
+        size_t numStarted = 0;
+        for (; numStarted < numDevices; ++numStarted)
+        {
+            if (pthread_create(&threads[numStarted].thread, NULL, benchmarkThread, &threads[numStarted]))
+            {
+                Log::print(Log::LT_Error, "Benchmark: thread %u create failed", (uint32_t)numStarted);
+                break;
+            }
+        }
+        for (size_t i = 0; i < numStarted; ++i)
+            pthread_join(threads[i].thread, NULL);
+        if (numStarted != numDevices)
+            return 1;
+
+        std::vector<benchmarkResult> results;
+        double totalHashrate = 0.0;
+        bool failed = false;
+        for (size_t i = 0; i < numDevices; ++i)
+        {
+            results.push_back(threads[i].result);
+            benchmarkPrint(results.back());
+            totalHashrate += results.back().hashrate;
+            failed |= !results.back().initialized || (results.back().numRejected != 0);
+        }
+        Log::print(Log::LT_Notice, "Benchmark: total %.2f kH/s", totalHashrate * 0.001);
+
+        if (!options.jsonFileName.empty())
+        {
+            if (benchmarkWriteJson(results, options, options.jsonFileName.c_str()))
+                Log::print(Log::LT_Notice, "Benchmark results have been saved to %s", options.jsonFileName.c_str());
+            else
+            {
+                Log::print(Log::LT_Error, "Failed to write benchmark results to %s", options.jsonFileName.c_str());
+                failed = true;
+            }
+        }
+
+        if (!options.baselineFileName.empty())
+        {
+            const int numRegressions = benchmarkCompareBaseline(results, options.baselineFileName.c_str(), options.tolerance);
+            if (numRegressions < 0)
+                return 1;
+            if (numRegressions)
+            {
+                Log::print(Log::LT_Warning, "Benchmark: %d regression(s) against %s(tolerance %.1f%%)",
+                           numRegressions, options.baselineFileName.c_str(), options.tolerance);
+                return 2;
+            }
+            Log::print(Log::LT_Notice, "Benchmark: no regressions against %s", options.baselineFileName.c_str());
+        }
+
+        return failed ? 1 : 0;
+    }
+}
+
+#endif // !Benchmark_INCLUDE_ONCE
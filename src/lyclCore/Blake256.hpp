@@ -43,7 +43,7 @@ const uint32_t c_u256[16] =
     0x3F84D5B5, 0xB5470917
 };
 
-uint32_t rotr32(uint32_t w, uint32_t c)
+inline uint32_t rotr32(uint32_t w, uint32_t c)
 {
     return (( w >> c ) | ( w << ( 32 - c ) ) );
 }
@@ -108,4 +108,77 @@ inline void blake256_compress(uint32_t* h, const uint32_t* block)
 }
 
 
+#define GS_HALF1(a,b,c,d,mx,cy) { \
+    v[a] += ((mx) ^ c_u256[cy]) + v[b]; \
+    v[d] = rotr32(v[d] ^ v[a], 16); \
+    v[c] += v[d]; \
+    v[b] = rotr32(v[b] ^ v[c], 12); \
+}
+
+#define GS_HALF2(a,b,c,d,my,cx) { \
+    v[a] += ((my) ^ c_u256[cx]) + v[b]; \
+    v[d] = rotr32(v[d] ^ v[a], 8); \
+    v[c] += v[d]; \
+    v[b] = rotr32(v[b] ^ v[c], 7); \
+}
+
+//! number of values produced by blake256_precalc.
+const int c_blake256PrecalcSize = 17;
+
+//! Precompute every nonce-independent value of the second (nonce) block compression
+//! of an 80-byte header. (h) is the midstate after the first block, (data) is the header (20 words).
+//! Output layout matches pre0..pre16 of a job slot in kernels/blake32/blake32_precalc.cl
+inline void blake256_precalc(uint32_t* out_pre, const uint32_t* h, const uint32_t* data)
+{
+    // second block: header words 16..19, padding and bit length (640).
+    // m[3] (nonce) is never used below.
+    uint32_t m[16] =
+    {
+        data[16], data[17], data[18], 0,
+        0x80000000, 0, 0, 0,
+        0, 0, 0, 0,
+        0, 1, 0, 640
+    };
+    uint32_t v[16] =
+    {
+        h[0], h[1], h[2], h[3],
+        h[4], h[5], h[6], h[7],
+        0x243F6A88, 0x85A308D3,
+        0x13198A2E, 0x03707344,
+        0xA4093822 ^ 640, 0x299F31D0 ^ 640,
+        0x082EFA98, 0xEC4E6C89
+    };
+
+    // round 0, column step. G1 is computed up to the nonce.
+    GS_HALF1(0, 4, 0x8, 0xC, m[0], 1);
+    GS_HALF2(0, 4, 0x8, 0xC, m[1], 0);
+    GS_HALF1(1, 5, 0x9, 0xD, m[2], 3);
+    GS_HALF1(2, 6, 0xA, 0xE, m[4], 5);
+    GS_HALF2(2, 6, 0xA, 0xE, m[5], 4);
+    GS_HALF1(3, 7, 0xB, 0xF, m[6], 7);
+    GS_HALF2(3, 7, 0xB, 0xF, m[7], 6);
+
+    out_pre[0] = v[1] + v[5];
+    out_pre[1] = v[5];
+    out_pre[2] = v[9];
+    out_pre[3] = v[13];
+    // round 0, diagonal step. Partial sums up to the first nonce-dependent input.
+    out_pre[4] = v[0] + (m[8] ^ c_u256[9]);
+    out_pre[5] = v[10];
+    out_pre[6] = v[15];
+    out_pre[7] = v[6] + (m[10] ^ c_u256[11]);
+    out_pre[8] = v[6];
+    out_pre[9] = v[11];
+    out_pre[10] = v[12];
+    out_pre[11] = v[2] + (m[12] ^ c_u256[13]) + v[7];
+    out_pre[12] = v[7];
+    out_pre[13] = v[8];
+    out_pre[14] = v[3] + (m[14] ^ c_u256[15]) + v[4];
+    out_pre[15] = rotr32(v[14] ^ out_pre[14], 16);
+    out_pre[16] = v[4];
+}
+
+#undef GS_HALF1
+#undef GS_HALF2
+
 #endif // !Blake256_INCLUDE_ONCE
@@ -14,6 +14,23 @@
 #include <iostream> // cerr
 #include <fstream> // ifstream
 #include <sstream> // ostringstream
+#include <cstdio> // sscanf
+
+// Vendor extension queries used for device identification.
+// Values are taken from the Khronos cl_ext.h and may be missing in older headers.
+#ifndef CL_DEVICE_PCI_BUS_INFO_KHR
+#define CL_DEVICE_PCI_BUS_INFO_KHR 0x410F
+typedef struct _cl_device_pci_bus_info_khr
+{
+    cl_uint pci_domain;
+    cl_uint pci_bus;
+    cl_uint pci_device;
+    cl_uint pci_function;
+} cl_device_pci_bus_info_khr;
+#endif
+#ifndef CL_DEVICE_PCI_BUS_ID_NV
+#define CL_DEVICE_PCI_BUS_ID_NV 0x4008
+#endif
 
 namespace lycl
 {
@@ -34,6 +51,13 @@ namespace lycl
         BF_ROCm    = 2
     } EBinaryFormat;
     //-----------------------------------------------------------------------------
+    typedef enum
+    {
+        GK_Table     = 0, // T0/T4 tables in constant memory
+        GK_LDS       = 1, // tables copied to local memory
+        GK_Bitsliced = 2  // table-free
+    } EGroestlKernel;
+    //-----------------------------------------------------------------------------
     //! OpenCL logical device
     struct device
     {
@@ -44,6 +68,8 @@ namespace lycl
         size_t workSize;
         EAsmProgram asmProgram;
         EBinaryFormat binaryFormat;
+        EGroestlKernel groestlKernel;
+        cl_device_type type;
     };
     //-----------------------------------------------------------------------------
     //! Compare cl devices by PCIe bus id.
@@ -152,8 +178,171 @@ namespace lycl
         return result;
     }
     //-----------------------------------------------------------------------------
+    inline EGroestlKernel getGroestlKernelFromName(const std::string& groestl_kernel_name)
+    {
+        EGroestlKernel result;
+        if (groestl_kernel_name.find("lds") != std::string::npos)
+            result = GK_LDS;
+        else if (groestl_kernel_name.find("bitsliced") != std::string::npos)
+            result = GK_Bitsliced;
+        else
+            result = GK_Table;
+
+        return result;
+    }
+    //-----------------------------------------------------------------------------
+    inline const char* getGroestlKernelFileName(EGroestlKernel groestl_kernel)
+    {
+        switch (groestl_kernel)
+        {
+        case GK_LDS:
+            return "kernels/groestl256/groestl256_htarg_lds.cl";
+        case GK_Bitsliced:
+            return "kernels/groestl256/groestl256_htarg_bitsliced.cl";
+        default:
+            return "kernels/groestl256/groestl256_htarg.cl";
+        }
+    }
+    //-----------------------------------------------------------------------------
+    //! Get a string parameter from clGetDeviceInfo. Returns false if the query is not supported.
+    inline bool cluGetDeviceInfoString(cl_device_id cldevice, cl_device_info param_name, std::string& out_info)
+    {
+        size_t infoSize = 0;
+        out_info.clear();
+        if ((clGetDeviceInfo(cldevice, param_name, 0, NULL, &infoSize) != CL_SUCCESS) || !infoSize)
+            return false;
+
+        out_info.resize(infoSize);
+        if (clGetDeviceInfo(cldevice, param_name, infoSize, (void *)out_info.data(), NULL) != CL_SUCCESS)
+        {
+            out_info.clear();
+            return false;
+        }
+        // remove null terminator
+        out_info.pop_back();
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    //! Get a string parameter from clGetPlatformInfo. Returns false if the query failed.
+    inline bool cluGetPlatformInfoString(cl_platform_id clplatform, cl_platform_info param_name, std::string& out_info)
+    {
+        size_t infoSize = 0;
+        out_info.clear();
+        if ((clGetPlatformInfo(clplatform, param_name, 0, NULL, &infoSize) != CL_SUCCESS) || !infoSize)
+            return false;
+
+        out_info.resize(infoSize);
+        if (clGetPlatformInfo(clplatform, param_name, infoSize, (void *)out_info.data(), NULL) != CL_SUCCESS)
+        {
+            out_info.clear();
+            return false;
+        }
+        out_info.pop_back();
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    //! Parse an OpenCL version string: "OpenCL <major>.<minor> <vendor-specific information>"
+    inline bool cluParseVersion(const std::string& version_string, int& out_major, int& out_minor)
+    {
+        out_major = 0;
+        out_minor = 0;
+        return sscanf(version_string.c_str(), "OpenCL %d.%d", &out_major, &out_minor) == 2;
+    }
+    //-----------------------------------------------------------------------------
+    //! Returns true if the version string is OpenCL 1.2 or later.
+    inline bool cluIsVersionSupported(const std::string& version_string)
+    {
+        int major, minor;
+        if (!cluParseVersion(version_string, major, minor))
+            return false;
+
+        return (major > 1) || ((major == 1) && (minor >= 2));
+    }
+    //-----------------------------------------------------------------------------
+    //! Get a PCIe bus id without relying on a single vendor extension.
+    //! Tries cl_khr_pci_bus_info, cl_amd_device_attribute_query and cl_nv_device_attribute_query.
+    //! Returns -1 if the bus id is not available (e.g. CPU devices).
+    inline int32_t cluGetPCIeBusId(cl_device_id cldevice)
+    {
+        std::string extensions;
+        cluGetDeviceInfoString(cldevice, CL_DEVICE_EXTENSIONS, extensions);
+
+        if (extensions.find("cl_khr_pci_bus_info") != std::string::npos)
+        {
+            cl_device_pci_bus_info_khr busInfo;
+            if (clGetDeviceInfo(cldevice, CL_DEVICE_PCI_BUS_INFO_KHR, sizeof(busInfo), &busInfo, NULL) == CL_SUCCESS)
+                return (int32_t)busInfo.pci_bus;
+        }
+
+        if (extensions.find("cl_amd_device_attribute_query") != std::string::npos)
+        {
+            cl_device_topology_amd topology;
+            if ((clGetDeviceInfo(cldevice, CL_DEVICE_TOPOLOGY_AMD, sizeof(cl_device_topology_amd), &topology, NULL) == CL_SUCCESS) &&
+                (topology.raw.type == CL_DEVICE_TOPOLOGY_TYPE_PCIE_AMD))
+                return (int32_t)topology.pcie.bus;
+        }
+
+        if (extensions.find("cl_nv_device_attribute_query") != std::string::npos)
+        {
+            cl_uint busId = 0;
+            if (clGetDeviceInfo(cldevice, CL_DEVICE_PCI_BUS_ID_NV, sizeof(cl_uint), &busId, NULL) == CL_SUCCESS)
+                return (int32_t)busId;
+        }
+
+        return -1;
+    }
+    //-----------------------------------------------------------------------------
+    //! Board name for logs and config files. Falls back to "vendor name" without AMD extensions.
+    inline std::string cluGetDeviceBoardName(cl_device_id cldevice)
+    {
+        std::string boardName;
+        if (cluGetDeviceInfoString(cldevice, CL_DEVICE_BOARD_NAME_AMD, boardName) && !boardName.empty())
+            return boardName;
+
+        std::string vendorName;
+        std::string deviceName;
+        cluGetDeviceInfoString(cldevice, CL_DEVICE_VENDOR, vendorName);
+        cluGetDeviceInfoString(cldevice, CL_DEVICE_NAME, deviceName);
+        return vendorName + " " + deviceName;
+    }
+    //-----------------------------------------------------------------------------
+    //! Returns true if the device is driven by an AMD platform. (asm programs are available)
+    inline bool cluIsAMDDevice(cl_device_id cldevice)
+    {
+        std::string vendorName;
+        cluGetDeviceInfoString(cldevice, CL_DEVICE_VENDOR, vendorName);
+        return (vendorName.find("Advanced Micro Devices") != std::string::npos);
+    }
+    //-----------------------------------------------------------------------------
+    //! Kernel build options for a device. Vendor intrinsics are selected through -D defines,
+    //! kernels fall back to rotate() otherwise.
+    inline std::string cluGetBuildOptions(cl_device_id cldevice)
+    {
+        std::string options;
+        std::string extensions;
+        cluGetDeviceInfoString(cldevice, CL_DEVICE_EXTENSIONS, extensions);
+        if (extensions.find("cl_amd_media_ops") != std::string::npos)
+            options += "-D LYCL_AMD_MEDIA_OPS ";
+
+        return options;
+    }
+    //-----------------------------------------------------------------------------
+    //! Create a command queue. clCreateCommandQueueWithProperties is not available on OpenCL 1.2 platforms.
+    inline cl_command_queue cluCreateCommandQueue(cl_context context, cl_device_id cldevice, cl_int* out_error)
+    {
+        std::string version;
+        int major = 1, minor = 2;
+        cluGetDeviceInfoString(cldevice, CL_DEVICE_VERSION, version);
+        cluParseVersion(version, major, minor);
+
+        if (major >= 2)
+            return clCreateCommandQueueWithProperties(context, cldevice, nullptr, out_error);
+        else
+            return clCreateCommandQueue(context, cldevice, 0, out_error);
+    }
+    //-----------------------------------------------------------------------------
     //! Create an OpenCL program from file.
-    inline cl_program cluCreateProgramFromFile(cl_context context, cl_device_id cldevice, const char* file_name)
+    inline cl_program cluCreateProgramFromFile(cl_context context, cl_device_id cldevice, const char* file_name, const char* build_options = NULL)
     {
         cl_int errNum;
         cl_program program;
@@ -177,7 +366,7 @@ namespace lycl
             return NULL;
         }
 
-        errNum = clBuildProgram(program, 1, &cldevice, NULL, NULL, NULL);
+        errNum = clBuildProgram(program, 1, &cldevice, build_options, NULL, NULL);
         if (errNum != CL_SUCCESS)
         {
             // Determine the reason for the error
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef CpuUtils_INCLUDE_ONCE
+#define CpuUtils_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace lycl
+{
+    //! CPU worker description. One per CPU worker thread.
+    struct cpuDevice
+    {
+        int32_t index;
+        //! hashes per run. Multiple of numLanes.
+        size_t workSize;
+        //! hashes per SIMD lane group (4, 8 or 16).
+        int32_t numLanes;
+    };
+    //-----------------------------------------------------------------------------
+    //! Returns the widest lane group supported by the host CPU.
+    //! 16: AVX-512F, 8: AVX2, 4: SSE2 or other architectures.
+    inline int32_t cpuGetMaxSimdLanes()
+    {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return 16;
+        if (__builtin_cpu_supports("avx2"))
+            return 8;
+#endif
+        return 4;
+    }
+    //-----------------------------------------------------------------------------
+    //! Returns number of lanes from a config string("auto", "4", "8", "16"). 0 if invalid.
+    inline int32_t getSimdLanesFromName(const std::string& lanes_name)
+    {
+        if (lanes_name.empty() || !lanes_name.compare("auto"))
+            return cpuGetMaxSimdLanes();
+        else if (!lanes_name.compare("4"))
+            return 4;
+        else if (!lanes_name.compare("8"))
+            return 8;
+        else if (!lanes_name.compare("16"))
+            return 16;
+        else
+            return 0;
+    }
+    //-----------------------------------------------------------------------------
+    //! Linear allocator backed by huge pages when they are available.
+    //! Falls back to regular pages(with transparent huge page hint on Linux).
+    class HugePageArena
+    {
+    public:
+        HugePageArena() : m_memory(NULL), m_size(0), m_offset(0), m_hugePages(false) { }
+        ~HugePageArena() { release(); }
+
+        //! reserve (size) bytes. Rounded up to the huge page size(2MB).
+        inline bool init(size_t size);
+        //! returns (size) bytes aligned to (alignment), NULL if the arena is exhausted.
+        inline void* allocate(size_t size, size_t alignment = 64);
+        //! free all memory.
+        inline void release();
+        //! true if memory is backed by explicit huge pages.
+        bool usesHugePages() const { return m_hugePages; }
+
+    private:
+        HugePageArena(const HugePageArena&);
+        HugePageArena& operator=(const HugePageArena&);
+
+        uint8_t* m_memory;
+        size_t m_size;
+        size_t m_offset;
+        bool m_hugePages;
+    };
+    //-----------------------------------------------------------------------------
+    inline bool HugePageArena::init(size_t size)
+    {
+        release();
+
+        const size_t hugePageSize = 2 * 1024 * 1024;
+        size = (size + hugePageSize - 1) & ~(hugePageSize - 1);
+        void* memory = NULL;
+
+#ifdef _WIN32
+        // requires SeLockMemoryPrivilege("Lock pages in memory" policy).
+        const SIZE_T largePageMinimum = GetLargePageMinimum();
+        if (largePageMinimum && !(size % largePageMinimum))
+        {
+            memory = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            m_hugePages = (memory != NULL);
+        }
+        if (!memory)
+            memory = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    #ifdef MAP_HUGETLB
+        // requires preallocated pages(vm.nr_hugepages).
+        memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory == MAP_FAILED)
+            memory = NULL;
+        m_hugePages = (memory != NULL);
+    #endif
+        if (!memory)
+        {
+            memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED)
+                memory = NULL;
+    #ifdef MADV_HUGEPAGE
+            if (memory)
+                madvise(memory, size, MADV_HUGEPAGE);
+    #endif
+        }
+#endif
+        if (!memory)
+        {
+            m_hugePages = false;
+            return false;
+        }
+
+        m_memory = (uint8_t*)memory;
+        m_size = size;
+        m_offset = 0;
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void* HugePageArena::allocate(size_t size, size_t alignment)
+    {
+        const size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+        if (!m_memory || (offset + size > m_size))
+            return NULL;
+
+        m_offset = offset + size;
+        return m_memory + offset;
+    }
+    //-----------------------------------------------------------------------------
+    inline void HugePageArena::release()
+    {
+        if (m_memory)
+        {
+#ifdef _WIN32
+            VirtualFree(m_memory, 0, MEM_RELEASE);
+#else
+            munmap(m_memory, m_size);
+#endif
+        }
+
+        m_memory = NULL;
+        m_size = 0;
+        m_offset = 0;
+        m_hugePages = false;
+    }
+}
+
+#endif // !CpuUtils_INCLUDE_ONCE
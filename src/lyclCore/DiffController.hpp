@@ -0,0 +1,90 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef DiffController_INCLUDE_ONCE
+#define DiffController_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cmath>
+
+// Client side share difficulty of a pool connection.
+//
+// A low pool difficulty makes every device find many shares, each costing a readback, host validation,
+// a submit and a round trip. The controller asks the pool for the difficulty which gives a target share rate
+// at the measured hashrate(mining.suggest_difficulty, or the maximum target of a Stratum V2 channel).
+// Suggestions are rounded down to a power of 2 and only sent again when the wanted difficulty moves
+// by c_changeFactor, so hashrate noise does not make the pool retarget all the time.
+
+namespace lycl
+{
+    //-----------------------------------------------------------------------------
+    // DiffController class declaration.
+    //-----------------------------------------------------------------------------
+    class DiffController
+    {
+    public:
+        //! shortest time between two suggestions on a connection.
+        static const uint64_t c_minIntervalMs = 300000;
+        //! the pool difficulty or the last suggestion is kept within this factor of the wanted difficulty.
+        static constexpr double c_changeFactor = 2.0;
+
+        DiffController() { reset(); }
+
+        //! difficulty of (shares_per_minute) at (hashrate) H/s, rounded down to a power of 2. 0 if not known.
+        static inline double difficultyFor(double hashrate, double shares_per_minute);
+
+        //! new connection, the pool forgot earlier suggestions.
+        void reset() { m_suggested = 0.0; m_lastMs = 0; }
+        //! returns true with the difficulty to suggest if (pool_diff) is too far from the wanted one.
+        inline bool update(double hashrate, double shares_per_minute, double pool_diff, uint64_t now_ms, double& out_diff);
+        //! last suggested difficulty, 0 if none.
+        double suggested() const { return m_suggested; }
+
+    private:
+        static bool isClose(double a, double b) { return (a * c_changeFactor > b) && (b * c_changeFactor > a); }
+
+        double m_suggested;
+        uint64_t m_lastMs;
+    };
+    //-----------------------------------------------------------------------------
+    // DiffController class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline double DiffController::difficultyFor(double hashrate, double shares_per_minute)
+    {
+        if ((hashrate <= 0.0) || (shares_per_minute <= 0.0))
+            return 0.0;
+        // a share of pool difficulty 1 takes 2^24 allium hashes, see setTarget
+        const double diff = hashrate * 60.0 / (shares_per_minute * 16777216.0);
+        return std::pow(2.0, std::floor(std::log2(diff)));
+    }
+    //-----------------------------------------------------------------------------
+    inline bool DiffController::update(double hashrate, double shares_per_minute, double pool_diff, uint64_t now_ms,
+                                       double& out_diff)
+    {
+        const double wanted = difficultyFor(hashrate, shares_per_minute);
+        if (wanted <= 0.0)
+            return false;
+
+        if (m_suggested > 0.0)
+        {
+            // asked already: wait for the pool, unless the hashrate moved a lot
+            if (isClose(wanted, m_suggested) || (now_ms - m_lastMs < c_minIntervalMs))
+                return false;
+        }
+        else if ((pool_diff > 0.0) && isClose(wanted, pool_diff))
+            return false;
+
+        m_suggested = wanted;
+        m_lastMs = now_ms;
+        out_diff = wanted;
+        return true;
+    }
+}
+
+#endif // !DiffController_INCLUDE_ONCE
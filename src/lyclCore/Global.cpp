@@ -15,6 +15,8 @@ namespace global
     int numWorkerThreads = 0;
     //! stratum connection info
     ConnectionInfo connectionInfo;
+    //! backup pools in priority order
+    std::vector<ConnectionInfo> backupConnections;
     //! Report statistics to the pool.
     bool opt_stratumStats = false;
     //! enable terminal colors for logging
@@ -27,6 +29,8 @@ namespace global
 
     //! Enable extra nonce.
     bool opt_extranonce = true;
+    //! shares per minute the pool difficulty is suggested for, 0 disables suggestions.
+    double opt_shareRate = 0.0;
 }
 
 //! PROXY SETUP. Needs to be implemented
@@ -49,6 +53,7 @@ pthread_mutex_t g_work_lock;
 //! thread hashrates and thr hashcount
 double *thr_hashrates;
 double *thr_hashcount;
+uint32_t *thr_hwErrors;
 uint32_t accepted_count = 0;
 uint32_t rejected_count = 0;
 double global_hashcount = 0;
@@ -11,6 +11,7 @@
 #define Global_INCLUDE_ONCE
 
 #include <string>
+#include <vector>
 
 // Define to the full name of this package.
 #define PACKAGE_NAME "lyclMiner"
@@ -42,6 +43,8 @@ struct work
     char *job_id;
     size_t xnonce2_len;
     unsigned char *xnonce2;
+    //! index of the pool which sent the job.
+    int pool;
 };
 
 // TODO: sort these.
@@ -51,6 +54,13 @@ namespace global
     extern int numWorkerThreads;
     //! stratum connection info
     extern ConnectionInfo connectionInfo;
+    //! backup pools in priority order(<Connection1>...<ConnectionN> blocks).
+    extern std::vector<ConnectionInfo> backupConnections;
+    //! connection info of (pool). 0 is the primary pool.
+    inline const ConnectionInfo& poolConnection(int pool)
+    {
+        return pool ? backupConnections[pool - 1] : connectionInfo;
+    }
     //! Report statistics to the pool. Currently hardcoded. Needs to be properly implemented.
     extern bool opt_stratumStats;
     //! number of retries -1, infinite
@@ -63,6 +73,8 @@ namespace global
     const bool opt_reconnect = true;
     //! Default num hashes per run
     const int32_t defaultWorkSize = 1048576;
+    //! Default num hashes per run for CPU workers
+    const int32_t defaultCpuWorkSize = 4096;
     //! network difficulty
     extern double net_diff;
     //! enable terminal colors for logging
@@ -77,6 +89,8 @@ namespace global
     const int opt_timeout = 300;
     //! Enable extra nonce.
     extern bool opt_extranonce;
+    //! shares per minute the pool difficulty is suggested for, 0 disables suggestions.
+    extern double opt_shareRate;
 }
 
 
@@ -106,6 +120,8 @@ extern pthread_mutex_t g_work_lock;
 //! thread hashrates and thr hashcount
 extern double *thr_hashrates;
 extern double *thr_hashcount;
+//! per thread number of candidates rejected by host validation
+extern uint32_t *thr_hwErrors;
 extern uint32_t accepted_count;
 extern uint32_t rejected_count;
 extern double global_hashcount;
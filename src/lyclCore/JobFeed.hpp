@@ -0,0 +1,93 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef JobFeed_INCLUDE_ONCE
+#define JobFeed_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cstring>
+#include <pthread.h>
+
+#include <lyclCore/PoolFailover.hpp>
+
+// Latest job header of every pool, published by stratum threads as soon as a notify is parsed.
+//
+// Worker threads poll the sequence number between runs and upload a new job to a free device job slot
+// while still mining the current one. When threads are restarted for the job, the device only switches slots.
+
+namespace lycl
+{
+    //-----------------------------------------------------------------------------
+    // JobFeed class declaration.
+    //-----------------------------------------------------------------------------
+    class JobFeed
+    {
+    public:
+        inline JobFeed();
+        inline ~JobFeed();
+
+        //! publish header (data, 20 words) and (target, 8 words) of the latest job of (pool).
+        inline void publish(int pool, const uint32_t* data, const uint32_t* target);
+        //! sequence number of the latest job of (pool), 0 if none. Cheap, no lock.
+        uint32_t sequence(int pool) const { return m_entries[pool].sequence; }
+        //! copy the latest job of (pool). Returns its sequence number.
+        inline uint32_t get(int pool, uint32_t* out_data, uint32_t* out_target);
+
+    private:
+        JobFeed(const JobFeed&);
+        JobFeed& operator=(const JobFeed&);
+
+        struct entry
+        {
+            volatile uint32_t sequence;
+            uint32_t data[20];
+            uint32_t target[8];
+        };
+
+        pthread_mutex_t m_mutex;
+        entry m_entries[PoolFailover::c_maxPools];
+    };
+    //-----------------------------------------------------------------------------
+    // JobFeed class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline JobFeed::JobFeed()
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+        memset(m_entries, 0, sizeof(m_entries));
+    }
+    //-----------------------------------------------------------------------------
+    inline JobFeed::~JobFeed()
+    {
+        pthread_mutex_destroy(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void JobFeed::publish(int pool, const uint32_t* data, const uint32_t* target)
+    {
+        pthread_mutex_lock(&m_mutex);
+        entry& job = m_entries[pool];
+        memcpy(job.data, data, sizeof(job.data));
+        memcpy(job.target, target, sizeof(job.target));
+        // 0 means no job
+        job.sequence = (job.sequence + 1) ? (job.sequence + 1) : 1;
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline uint32_t JobFeed::get(int pool, uint32_t* out_data, uint32_t* out_target)
+    {
+        pthread_mutex_lock(&m_mutex);
+        const entry& job = m_entries[pool];
+        memcpy(out_data, job.data, sizeof(job.data));
+        memcpy(out_target, job.target, sizeof(job.target));
+        const uint32_t sequence = job.sequence;
+        pthread_mutex_unlock(&m_mutex);
+        return sequence;
+    }
+}
+
+#endif // !JobFeed_INCLUDE_ONCE
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef LineBuffer_INCLUDE_ONCE
+#define LineBuffer_INCLUDE_ONCE
+
+#include <cstdlib>
+#include <cstring>
+
+// Receive buffer which splits a byte stream into newline-terminated lines.
+//
+// Data is received directly into the free space after the write cursor and only new bytes are scanned for '\n'.
+// Lines are handed out as null-terminated views into the buffer, valid until the next write.
+// When the write cursor reaches the end, the unread bytes(an incomplete line) wrap around to the front,
+// so every received byte is moved at most once. Capacity doubles only when a single line does not fit.
+
+namespace lycl
+{
+    //-----------------------------------------------------------------------------
+    // LineBuffer class declaration.
+    //-----------------------------------------------------------------------------
+    class LineBuffer
+    {
+    public:
+        static const size_t c_initialCapacity = 16384;
+        //! minimal free space available to a single recv.
+        static const size_t c_minWriteSize = 4096;
+
+        inline LineBuffer();
+        inline ~LineBuffer();
+
+        //! returns a pointer to at least c_minWriteSize bytes of free space. Invalidates line views.
+        inline char* writePtr();
+        //! free space after writePtr().
+        size_t writeSize() const { return m_capacity - m_end - 1; }
+        //! marks (size) bytes written to writePtr() as received.
+        inline void commit(size_t size);
+        //! get the next complete line without '\n'. Empty lines are skipped.
+        inline bool nextLine(char*& out_line, size_t& out_length);
+        //! true if there are unread bytes(complete or incomplete lines).
+        bool hasData() const { return m_begin != m_end; }
+        //! true if a complete line is available.
+        bool hasLine() const { return m_lineEnd != m_end; }
+        inline void clear();
+
+    private:
+        LineBuffer(const LineBuffer&);
+        LineBuffer& operator=(const LineBuffer&);
+
+        //! find the first '\n' at or after (from).
+        inline void findLineEnd(size_t from);
+
+        char* m_data;
+        size_t m_capacity;
+        //! read cursor.
+        size_t m_begin;
+        //! write cursor.
+        size_t m_end;
+        //! position of the first '\n' after m_begin, m_end if not found(bytes before m_end are already scanned).
+        size_t m_lineEnd;
+    };
+    //-----------------------------------------------------------------------------
+    // LineBuffer class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline LineBuffer::LineBuffer()
+        : m_data((char*)malloc(c_initialCapacity))
+        , m_capacity(c_initialCapacity)
+        , m_begin(0)
+        , m_end(0)
+        , m_lineEnd(0)
+    {
+        m_data[0] = '\0';
+    }
+    //-----------------------------------------------------------------------------
+    inline LineBuffer::~LineBuffer()
+    {
+        free(m_data);
+    }
+    //-----------------------------------------------------------------------------
+    inline char* LineBuffer::writePtr()
+    {
+        if (writeSize() < c_minWriteSize)
+        {
+            // wrap around: move an incomplete line to the front.
+            const size_t pending = m_end - m_begin;
+            if (m_begin)
+            {
+                memmove(m_data, m_data + m_begin, pending);
+                m_lineEnd -= m_begin;
+                m_begin = 0;
+                m_end = pending;
+            }
+            // a single line is larger than the buffer.
+            while (writeSize() < c_minWriteSize)
+            {
+                m_capacity *= 2;
+                m_data = (char*)realloc(m_data, m_capacity);
+            }
+        }
+        return m_data + m_end;
+    }
+    //-----------------------------------------------------------------------------
+    inline void LineBuffer::commit(size_t size)
+    {
+        const size_t scanned = m_end;
+        m_end += size;
+        m_data[m_end] = '\0';
+        // only new bytes are scanned
+        if (m_lineEnd == scanned)
+            findLineEnd(scanned);
+    }
+    //-----------------------------------------------------------------------------
+    inline void LineBuffer::findLineEnd(size_t from)
+    {
+        const char* found = (const char*)memchr(m_data + from, '\n', m_end - from);
+        m_lineEnd = found ? (size_t)(found - m_data) : m_end;
+    }
+    //-----------------------------------------------------------------------------
+    inline bool LineBuffer::nextLine(char*& out_line, size_t& out_length)
+    {
+        while (m_lineEnd != m_end)
+        {
+            char* line = m_data + m_begin;
+            size_t length = m_lineEnd - m_begin;
+            m_data[m_lineEnd] = '\0';
+
+            m_begin = m_lineEnd + 1;
+            findLineEnd(m_begin);
+            if (m_begin == m_end)
+                clear();
+
+            if (length)
+            {
+                out_line = line;
+                out_length = length;
+                return true;
+            }
+        }
+        return false;
+    }
+    //-----------------------------------------------------------------------------
+    inline void LineBuffer::clear()
+    {
+        m_begin = m_end = m_lineEnd = 0;
+    }
+}
+
+#endif // !LineBuffer_INCLUDE_ONCE
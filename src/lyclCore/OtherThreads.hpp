@@ -23,25 +23,77 @@
 //-----------------------------------------------------------------------------
 // This file contains other threads. TODO: this need to be sorted
 //-----------------------------------------------------------------------------
+//! Merkle roots of (count) consecutive extranonce2 values, starting at the current one of (job).
+//! The coinbase prefix is hashed once per job in stratumApplyNotify, every level of the branch is hashed
+//! for all roots at once with sha256dBatch.
+//! (count) is at most c_merkleBatchSize, coinbase tails are built in the job's batch_tails.
+//! The first (xnonce2_fixed) bytes of extranonce2 are not incremented.
+inline void merkleRootBatch(stratum_job& job, size_t xnonce2_fixed, size_t xnonce2_size, int count, unsigned char* out_roots)
+{
+    const size_t prefixSize = job.coinbase_midstate_size;
+    const size_t tailSize = job.coinbase_size - prefixSize;
+    const size_t xnonce2Offset = (size_t)(job.xnonce2 - job.coinbase) - prefixSize;
+
+    // coinbase tails of all extranonce2 values
+    unsigned char* tails = job.batch_tails;
+    memcpy(tails, job.coinbase + prefixSize, tailSize);
+    for (int k = 1; k < count; k++)
+    {
+        unsigned char* tail = tails + tailSize * k;
+        memcpy(tail, tail - tailSize, tailSize);
+        for (size_t t = xnonce2_fixed; t < xnonce2_size && !(++tail[xnonce2Offset + t]); t++);
+    }
+    lycl::sha256dBatch(out_roots, job.coinbase_midstate, prefixSize, tails, tailSize, (int)tailSize, count);
+
+    // node = hash | branch
+    unsigned char nodes[64 * c_merkleBatchSize];
+    for (int i = 0; i < job.merkle_count; i++)
+    {
+        for (int k = 0; k < count; k++)
+        {
+            memcpy(nodes + 64 * k, out_roots + 32 * k, 32);
+            memcpy(nodes + 64 * k + 32, job.merkle[i], 32);
+        }
+        lycl::sha256dBatch(out_roots, sha256_h, 0, nodes, 64, 64, count);
+    }
+}
+//-----------------------------------------------------------------------------
 inline void buildExtraHeader(work* g_work, stratum_ctx* sctx)
 {
     unsigned char merkle_root[64] = { 0 };
     size_t t;
     int i;
 
-    // generate Merkle Root
-    sha256d(merkle_root, sctx->job.coinbase, (int) sctx->job.coinbase_size);
-    for ( int i = 0; i < sctx->job.merkle_count; i++ )
+    // generate Merkle Root. Roots of the next extranonce2 values are built together and used in order.
+    stratum_job& job = sctx->job;
+    uint32_t version = le32dec( sctx->job.version );
+    const uint32_t ntime = le32dec( sctx->job.ntime );
+    if (sctx->sv2)
     {
-        memcpy( merkle_root + 32, sctx->job.merkle[i], 32 );
-        sha256d( merkle_root, merkle_root, 64 );
+        // Stratum V2: the pool sends the root, work is made unique by BIP320 version bits, then by ntime
+        memcpy(merkle_root, job.merkle_root, 32);
+        const uint32_t v = swab32(version);
+        version = swab32((v & ~job.version_mask) | ((job.version_rolls << 13) & job.version_mask));
+        if (!job.version_mask || !(++job.version_rolls & 0xffff))
+        {
+            job.version_rolls = 0;
+            be32enc(job.ntime, be32dec(job.ntime) + 1);
+        }
+    }
+    else if (job.prepared_next >= job.prepared_count)
+    {
+        merkleRootBatch(job, sctx->xnonce2_fixed, sctx->xnonce2_size, c_merkleBatchSize, job.prepared_roots[0]);
+        job.prepared_count = c_merkleBatchSize;
+        job.prepared_next = 0;
     }
+    if (!sctx->sv2)
+        memcpy(merkle_root, job.prepared_roots[job.prepared_next++], 32);
 
-    // Increment extranonce2
-    for ( t = 0; t < sctx->xnonce2_size && !( ++sctx->job.xnonce2[t] ); t++ );
+    // Increment extranonce2, leading bytes reserved for proxied miners stay 0
+    for ( t = sctx->xnonce2_fixed; t < sctx->xnonce2_size && !( ++sctx->job.xnonce2[t] ); t++ );
     // Assemble block header
     memset( g_work->data, 0, sizeof(g_work->data) );
-    g_work->data[0] = le32dec( sctx->job.version );
+    g_work->data[0] = version;
     for ( i = 0; i < 8; i++ )
     {
         g_work->data[1 + i] = le32dec( (uint32_t *) sctx->job.prevhash + i );
@@ -51,7 +103,7 @@ inline void buildExtraHeader(work* g_work, stratum_ctx* sctx)
         g_work->data[9 + i] = be32dec( (uint32_t *) merkle_root + i );
     }
 
-    g_work->data[NTimeIndex] = le32dec(sctx->job.ntime);
+    g_work->data[NTimeIndex] = ntime;
     g_work->data[NBitsIndex] = le32dec(sctx->job.nbits);
     g_work->data[20] = 0x80000000;
     g_work->data[31] = 0x00000280;
@@ -85,13 +137,19 @@ inline double calcNetworkDiff(work* work_info)
 inline void stratumGenWork(stratum_ctx *sctx, work *g_work)
 {
     pthread_mutex_lock( &sctx->work_lock );
-    free( g_work->job_id );
-    g_work->job_id = strdup( sctx->job.job_id );
+    // new work of the same job reuses its buffers
+    if ( !g_work->job_id || strcmp( g_work->job_id, sctx->job.job_id ) )
+    {
+        free( g_work->job_id );
+        g_work->job_id = strdup( sctx->job.job_id );
+    }
+    if ( sctx->xnonce2_size && ( !g_work->xnonce2 || g_work->xnonce2_len != sctx->xnonce2_size ) )
+        g_work->xnonce2 = (unsigned char*) realloc( g_work->xnonce2, sctx->xnonce2_size );
     g_work->xnonce2_len = sctx->xnonce2_size;
-    g_work->xnonce2 = (unsigned char*) realloc( g_work->xnonce2, sctx->xnonce2_size );
     memcpy( g_work->xnonce2, sctx->job.xnonce2, sctx->xnonce2_size );
 
     buildExtraHeader( g_work, sctx );
+    g_work->pool = sctx->pool;
 
     global::net_diff = calcNetworkDiff( g_work );
     pthread_mutex_unlock( &sctx->work_lock );
@@ -106,6 +164,15 @@ inline void stratumGenWork(stratum_ctx *sctx, work *g_work)
 //-------------------------------------
 
     setTarget(g_work, sctx->job.diff);
+    if (sctx->sv2)
+    {
+        // the channel target is exact, the difficulty may round it up
+        int i = 7;
+        while ((i > 0) && (sctx->job.target[i] == g_work->target[i]))
+            --i;
+        if (sctx->job.target[i] < g_work->target[i])
+            memcpy(g_work->target, sctx->job.target, sizeof(g_work->target));
+    }
 
     if (stratum_diff != sctx->job.diff)
     {
@@ -120,47 +187,189 @@ inline void stratumGenWork(stratum_ctx *sctx, work *g_work)
     }
 }
 //-----------------------------------------------------------------------------
+//! split mode: reassign worker threads to pools by weight.
+inline void stratum_schedule_pools()
+{
+    bool healthy[lycl::PoolFailover::c_maxPools];
+    for (int i = 0; i < poolFailover.numPools(); ++i)
+        healthy[i] = poolFailover.isHealthy(i);
+
+    pthread_mutex_lock(&stats_lock);
+    std::vector<double> hashrates(thr_hashrates, thr_hashrates + global::numWorkerThreads);
+    pthread_mutex_unlock(&stats_lock);
+
+    std::vector<int> changed;
+    if (!poolScheduler.update(healthy, hashrates, changed))
+        return;
+    for (size_t i = 0; i < changed.size(); ++i)
+    {
+        Log::print(Log::LT_Debug, "Device: %d switched to pool %d", changed[i], poolScheduler.assigned(changed[i]));
+        gwork_restart[changed[i]].restart = 1;
+    }
+}
+//-----------------------------------------------------------------------------
+//! switch devices to the pool chosen by poolFailover, using the latest job the pool already sent.
+inline void stratum_select_pool()
+{
+    if (poolScheduler.isEnabled())
+    {
+        stratum_schedule_pools();
+        return;
+    }
+
+    int pool;
+    if (!poolFailover.select(pool))
+        return;
+    if (stratumProxy.isActive())
+        stratumProxy.setPool(pool);
+
+    pthread_mutex_lock(&g_work_lock);
+    // another thread may have switched again, use the current choice
+    stratum_ctx *sctx = stratum_active();
+    if (sctx->job.job_id[0])
+    {
+        stratumGenWork(sctx, &global::g_work);
+        jobFeed.publish(sctx->pool, global::g_work.data, global::g_work.target);
+        time(&g_work_time);
+    }
+    pthread_mutex_unlock(&g_work_lock);
+    restart_threads();
+
+    Log::print(Log::LT_Notice, "Switched to pool %d: %s", sctx->pool, sctx->url);
+}
+//-----------------------------------------------------------------------------
+//! measured hashrate for (pool): all threads, or the weighted part of them in split mode.
+inline double stratum_pool_hashrate(int pool)
+{
+    double hashrate = 0.0;
+    pthread_mutex_lock(&stats_lock);
+    for (int i = 0; i < global::numWorkerThreads; i++)
+        hashrate += thr_hashrates[i];
+    pthread_mutex_unlock(&stats_lock);
+
+    // threads move between pools every slice, the weight is stable
+    if (poolScheduler.isEnabled())
+    {
+        double actual, target;
+        poolScheduler.getShare(pool, actual, target);
+        hashrate *= target / 100.0;
+    }
+    return hashrate;
+}
+//-----------------------------------------------------------------------------
+//! ask the pool of (sctx) for the difficulty of the configured share rate, when its difficulty is far from it.
+inline void stratum_suggest_difficulty(stratum_ctx *sctx)
+{
+    if ((global::opt_shareRate <= 0.0) || !sctx->job.job_id[0])
+        return;
+
+    pthread_mutex_lock(&sctx->work_lock);
+    const double poolDiff = sctx->next_diff;
+    pthread_mutex_unlock(&sctx->work_lock);
+    const double hashrate = stratum_pool_hashrate(sctx->pool);
+    double diff;
+    if (!sctx->diffControl.update(hashrate, global::opt_shareRate, poolDiff, lycl::PoolFailover::nowMs(), diff))
+        return;
+
+    Log::print(Log::LT_Info, "Pool %d: suggesting difficulty %g for %g shares per minute(pool difficulty %g)",
+               sctx->pool, diff, global::opt_shareRate, poolDiff);
+    if (!stratumSuggestDifficulty(sctx, diff, hashrate))
+        Log::print(Log::LT_Warning, "Pool %d: failed to send the difficulty suggestion", sctx->pool);
+}
+//-----------------------------------------------------------------------------
+#ifndef _WIN32
+//! SIGINT or SIGTERM caught by signal_handler, 0 if none.
+static volatile sig_atomic_t stratum_exit_signal = 0;
+#endif
+//-----------------------------------------------------------------------------
+//! print the share report and exit once a signal asked for it. The handler only sets a flag,
+//! the report takes locks and allocates, so stratum threads run it within c_checkIntervalMs.
+inline void stratum_check_exit()
+{
+#ifndef _WIN32
+    if (!stratum_exit_signal)
+        return;
+    // the first stratum thread exits, the others wait here
+    static pthread_mutex_t exitLock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_lock(&exitLock);
+    Log::print(Log::LT_Info, "%s received, exiting", (stratum_exit_signal == SIGINT) ? "SIGINT" : "SIGTERM");
+    stratum_share_report(true);
+    exit(0);
+#endif
+}
+//-----------------------------------------------------------------------------
+//! one thread per pool. Keeps the pool connected, subscribed and authorized, with its latest job ready.
 static void *stratum_thread(void *userdata )
 {
     struct thr_info *mythr = (struct thr_info *) userdata;
+    stratum_ctx *sctx;
+    int pool;
     char *s;
+    uint64_t lastShareReportMs;
 
-    stratum.url = (char*) tq_pop(mythr->q, NULL);
-    if (!stratum.url)
+    sctx = (stratum_ctx*) tq_pop(mythr->q, NULL);
+    if (!sctx)
         goto out;
+    pool = sctx->pool;
+    sctx->url = strdup(global::poolConnection(pool).rpc_url.c_str());
+    lastShareReportMs = lycl::PoolFailover::nowMs();
 
-    Log::print(Log::LT_Info, "Starting Stratum on %s", stratum.url);
+    Log::print(Log::LT_Info, "Starting Stratum on %s", sctx->url);
 
     while (1)
     {
         int failures = 0;
 
-        if ( stratum_need_reset )
+        stratum_check_exit();
+        if ( stratum_need_reset && !pool )
         {
             stratum_need_reset = false;
-            stratum_disconnect( &stratum );
-            if (strcmp(stratum.url, global::connectionInfo.rpc_url.c_str())) 
+            stratum_disconnect( sctx );
+            if (strcmp(sctx->url, global::connectionInfo.rpc_url.c_str())) 
             {
-                free( stratum.url );
-                stratum.url = strdup(global::connectionInfo.rpc_url.c_str()); 
+                free( sctx->url );
+                sctx->url = strdup(global::connectionInfo.rpc_url.c_str()); 
                 Log::print(Log::LT_Blue, "Connection changed to %s", global::connectionInfo.short_url.c_str());
             }
             else
                 Log::print(Log::LT_Debug, "Stratum connection reset");
         }
 
-        while ( !stratum.curl )
+        while ( !sctx->curl )
         {
-            pthread_mutex_lock( &g_work_lock );
-            g_work_time = 0;
-            pthread_mutex_unlock( &g_work_lock );
-            restart_threads();
-            if ( !stratum_connect( &stratum, stratum.url )
-                 || !stratum_subscribe( &stratum )
-                 || !stratum_authorize(&stratum, global::connectionInfo.rpc_user.c_str(),
-                                       global::connectionInfo.rpc_pass.c_str())) 
+            stratum_check_exit();
+            // a backup pool takes over while this one reconnects
+            poolFailover.setHealthy(pool, false);
+            stratum_select_pool();
+            if (!poolScheduler.isEnabled() && (poolFailover.active() == pool))
+            {
+                pthread_mutex_lock( &g_work_lock );
+                g_work_time = 0;
+                pthread_mutex_unlock( &g_work_lock );
+                restart_threads();
+            }
+
+            bool connected = stratum_connect( sctx, sctx->url );
+            const uint64_t subscribeStart = lycl::PoolFailover::nowMs();
+            if (sctx->sv2)
             {
-                stratum_disconnect( &stratum );
+                // two round trips: setup and channel
+                connected = connected && stratumV2Setup(sctx, global::poolConnection(pool).rpc_user.c_str());
+                if (connected)
+                    poolFailover.setRtt(pool, (double)(lycl::PoolFailover::nowMs() - subscribeStart) / 2.0);
+            }
+            else
+            {
+                connected = connected && stratum_subscribe( sctx );
+                // subscribe is a single request/response, the first round trip time estimate
+                if (connected)
+                    poolFailover.setRtt(pool, (double)(lycl::PoolFailover::nowMs() - subscribeStart));
+                connected = connected && stratum_authorize(sctx, global::poolConnection(pool).rpc_user.c_str(),
+                                                           global::poolConnection(pool).rpc_pass.c_str());
+            }
+            if ( !connected )
+            {
+                stratum_disconnect( sctx );
                 if (global::opt_retries >= 0 && ++failures > global::opt_retries)
                 {
                     Log::print(Log::LT_Error, "...terminating workio thread");
@@ -172,53 +381,109 @@ static void *stratum_thread(void *userdata )
             }
         }
 
-        if ( stratum.job.job_id && ( !g_work_time || strcmp( stratum.job.job_id, global::g_work.job_id ) ) )
+        // ready for failover once the pool has sent a job
+        if ( sctx->job.job_id[0] && !poolFailover.isHealthy(pool) )
+            poolFailover.setHealthy(pool, true);
+        stratum_select_pool();
+
+        // split mode: every pool feeds its own work
+        work *poolWork = stratum_pool_work(pool);
+        if ( (poolScheduler.isEnabled() || (poolFailover.active() == pool)) && sctx->job.job_id[0]
+             && ( !g_work_time || !poolWork->job_id || (poolWork->pool != pool) || strcmp( sctx->job.job_id, poolWork->job_id ) ) )
         {
             pthread_mutex_lock(&g_work_lock);
-            stratumGenWork( &stratum, &global::g_work );
+            stratumGenWork( sctx, poolWork );
+            // devices upload the job before they are restarted for it
+            jobFeed.publish( pool, poolWork->data, poolWork->target );
             time(&g_work_time);
             pthread_mutex_unlock(&g_work_lock);
+            if (stratumRecorder.isActive() && (poolFailover.active() == pool))
+            {
+                std::string event = std::string("job ") + sctx->job.job_id + (sctx->job.clean ? " clean" : "");
+                stratumRecorder.record(lycl::SR_Event, event.c_str());
+            }
             //           restart_threads();
 
-            if (stratum.job.clean)
+            if (sctx->job.clean)
             {
                 static uint32_t last_block_height;
-                if ( last_block_height != stratum.block_height )
+                if (sctx->sv2)
+                {
+                    // no coinbase, the height is unknown
+                    if (global::net_diff > 0.)
+                        Log::print(Log::LT_Blue, "%s new allium block, diff %.3f", global::poolConnection(pool).short_url.c_str(), global::net_diff);
+                }
+                else if ( last_block_height != sctx->block_height )
                 {
-                    last_block_height = stratum.block_height;
+                    last_block_height = sctx->block_height;
                     if (global::net_diff > 0.)
-                        Log::print(Log::LT_Blue, "allium block %d, diff %.3f", stratum.block_height, global::net_diff);
+                        Log::print(Log::LT_Blue, "allium block %d, diff %.3f", sctx->block_height, global::net_diff);
                     else
-                        Log::print(Log::LT_Blue, "%s allium block %d", global::connectionInfo.short_url.c_str(), stratum.block_height);
+                        Log::print(Log::LT_Blue, "%s allium block %d", global::poolConnection(pool).short_url.c_str(), sctx->block_height);
                 }
-                restart_threads();
+                restart_pool_threads(pool);
             }
             else if (global::opt_debug)
             {
-                Log::print(Log::LT_Blue, "%s asks job %d for block %d", global::connectionInfo.short_url.c_str(),
-                           strtoul(stratum.job.job_id, NULL, 16), stratum.block_height);
+                Log::print(Log::LT_Blue, "%s asks job %d for block %d", global::poolConnection(pool).short_url.c_str(),
+                           strtoul(sctx->job.job_id, NULL, 16), sctx->block_height);
             }
-        }  // stratum.job.job_id
+        }  // sctx->job.job_id
 
-        if ( !stratum_socket_full( &stratum, global::opt_timeout ) )
+        stratum_suggest_difficulty(sctx);
+
+        // wait in short slices, so pool selection and failback run while this pool is quiet
+        lycl::EIOStatus status = lycl::IO_Readable;
+        // every iteration follows a received line or frame, or a new connection
+        poolFailover.setReceived(pool);
+        if (!stratum_has_data(sctx))
+        {
+            const uint64_t waitStart = lycl::PoolFailover::nowMs();
+            while (((status = sctx->io.wait(lycl::PoolFailover::c_checkIntervalMs)) == lycl::IO_Timeout)
+                   && (lycl::PoolFailover::nowMs() - waitStart < (uint64_t)global::opt_timeout * 1000))
+            {
+                const double rtt = sctx->io.rttMs();
+                if (rtt >= 0.0)
+                    poolFailover.setRtt(pool, rtt);
+                stratum_check_exit();
+                // a silent pool loses its devices long before opt_timeout drops the connection
+                if (poolFailover.checkSilence(pool))
+                    Log::print(Log::LT_Warning, "Pool %d sent nothing for %d seconds, marked unhealthy", pool,
+                               (int)(lycl::PoolFailover::c_silenceTimeoutMs / 1000));
+                stratum_select_pool();
+                stratum_expire_shares(sctx);
+                if (lycl::PoolFailover::nowMs() - lastShareReportMs >= lycl::ShareTracker::c_reportIntervalMs)
+                {
+                    lastShareReportMs = lycl::PoolFailover::nowMs();
+                    Log::print(Log::LT_Info, "Pool %d shares: %s, %u duplicates dropped", pool, sctx->shares.summary().c_str(),
+                               sctx->submitted.duplicates());
+                }
+            }
+        }
+
+        if ( status == lycl::IO_Timeout )
         {
             Log::print(Log::LT_Error, "Stratum connection timeout");
             s = NULL;
         }
+        else if ( sctx->sv2 )
+        {
+            lycl::sv2Frame frame;
+            s = NULL;
+            if ( stratumV2RecvFrame(sctx, frame) && stratumV2HandleFrame(sctx, frame) )
+                continue;
+        }
         else
-            s = stratum_recv_line(&stratum);
+            s = stratum_recv_line(sctx);
 
         if ( !s )
         {
-            stratum_disconnect(&stratum);
-            Log::print(Log::LT_Error, "Stratum connection interrupted");
+            stratum_disconnect(sctx);
+            Log::print(Log::LT_Error, "Stratum connection interrupted(%s)", sctx->url);
             continue;
         }
 
-        if (!stratum_handle_method(&stratum, s))
-            stratum_handle_response(s);
-
-        free(s);
+        stratum_handle_line(sctx, s);
     }  // loop
 out:
     return NULL;
@@ -267,13 +532,11 @@ static void signal_handler(int sig)
         Log::print(Log::LT_Info, "SIGHUP received");
         break;
     case SIGINT:
-        signal(sig, SIG_IGN);
-        Log::print(Log::LT_Info, "SIGINT received, exiting");
-        exit(0);
-        break;
     case SIGTERM:
-        Log::print(Log::LT_Info, "SIGTERM received, exiting");
-        exit(0);
+        // a second signal while a stratum thread is stuck in a connect or retry pause
+        if (stratum_exit_signal)
+            _exit(0);
+        stratum_exit_signal = sig;
         break;
     }
 }
@@ -284,10 +547,12 @@ BOOL WINAPI ConsoleHandler(DWORD dwType)
     {
     case CTRL_C_EVENT:
         Log::print(Log::LT_Info, "CTRL_C_EVENT received, exiting");
+        stratum_share_report(true);
         exit(0);
         break;
     case CTRL_BREAK_EVENT:
         Log::print(Log::LT_Info, "CTRL_BREAK_EVENT received, exiting");
+        stratum_share_report(true);
         exit(0);
         break;
     case CTRL_LOGOFF_EVENT:
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef PoolFailover_INCLUDE_ONCE
+#define PoolFailover_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <chrono>
+#include <pthread.h>
+
+// Pool selection for failover.
+//
+// Every configured pool has its own stratum thread which keeps the pool connected, subscribed, authorized
+// and its latest job ready. Threads report pool health and round trip time here and ask for the pool
+// which should provide work. Only that(active) pool feeds jobs to devices.
+//
+// A pool which becomes healthy takes over from another healthy pool only after c_failbackHoldMs,
+// so a flapping primary does not cause job switches. An unhealthy active pool is replaced immediately.
+// A connected pool which sends nothing for c_silenceTimeoutMs is unhealthy too, long before the
+// connection itself times out.
+
+namespace lycl
+{
+    typedef enum
+    {
+        //! lowest index(configuration order) wins.
+        PS_Priority = 0,
+        //! lowest measured round trip time wins.
+        PS_Latency
+    } EPoolSelect;
+
+    //-----------------------------------------------------------------------------
+    // PoolFailover class declaration.
+    //-----------------------------------------------------------------------------
+    class PoolFailover
+    {
+    public:
+        static const int c_maxPools = 8;
+        //! time a recovered pool must stay healthy before it replaces a healthy active pool.
+        static const uint64_t c_failbackHoldMs = 10000;
+        //! PS_Latency: a pool must be this much faster than the active pool to replace it.
+        static constexpr double c_latencyMargin = 0.8;
+        //! interval of health and selection checks while a pool is quiet.
+        static const int c_checkIntervalMs = 250;
+        //! time the primary pool has to connect at startup before a backup pool is used.
+        static const uint64_t c_startupGraceMs = 5000;
+        //! a pool which sends no line or frame for this long is unhealthy, pools send jobs more often.
+        static const uint64_t c_silenceTimeoutMs = 90000;
+
+        inline PoolFailover();
+        inline ~PoolFailover();
+
+        inline void init(int num_pools, EPoolSelect select);
+        int numPools() const { return m_numPools; }
+        //! pool which provides work.
+        int active() const { return m_active; }
+        //! set if (pool) is connected, authorized and has a job.
+        inline void setHealthy(int pool, bool healthy);
+        inline bool isHealthy(int pool);
+        //! last round trip time of (pool) in milliseconds, negative if unknown.
+        inline void setRtt(int pool, double rtt_ms);
+        inline double rtt(int pool);
+        //! (pool) sent a line or frame, or was connected.
+        inline void setReceived(int pool);
+        //! mark a healthy (pool) unhealthy after c_silenceTimeoutMs without data. Returns true if it did.
+        inline bool checkSilence(int pool);
+        //! choose a pool. Returns true and the new active pool in (out_pool) if it changed.
+        inline bool select(int& out_pool);
+        //! milliseconds on a monotonic clock.
+        static inline uint64_t nowMs();
+
+    private:
+        PoolFailover(const PoolFailover&);
+        PoolFailover& operator=(const PoolFailover&);
+
+        struct poolState
+        {
+            bool healthy;
+            uint64_t healthySinceMs;
+            uint64_t receivedMs;
+            double rttMs;
+        };
+
+        pthread_mutex_t m_mutex;
+        poolState m_pools[c_maxPools];
+        uint64_t m_startMs;
+        int m_numPools;
+        volatile int m_active;
+        EPoolSelect m_select;
+    };
+    //-----------------------------------------------------------------------------
+    // PoolFailover class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline PoolFailover::PoolFailover()
+        : m_startMs(nowMs())
+        , m_numPools(1)
+        , m_active(0)
+        , m_select(PS_Priority)
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+        for (int i = 0; i < c_maxPools; ++i)
+        {
+            m_pools[i].healthy = false;
+            m_pools[i].healthySinceMs = 0;
+            m_pools[i].receivedMs = 0;
+            m_pools[i].rttMs = -1.0;
+        }
+    }
+    //-----------------------------------------------------------------------------
+    inline PoolFailover::~PoolFailover()
+    {
+        pthread_mutex_destroy(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void PoolFailover::init(int num_pools, EPoolSelect select)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_numPools = (num_pools < 1) ? 1 : ((num_pools > c_maxPools) ? c_maxPools : num_pools);
+        m_select = select;
+        m_active = 0;
+        m_startMs = nowMs();
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void PoolFailover::setHealthy(int pool, bool healthy)
+    {
+        pthread_mutex_lock(&m_mutex);
+        poolState& state = m_pools[pool];
+        if (healthy && !state.healthy)
+            state.healthySinceMs = nowMs();
+        state.healthy = healthy;
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool PoolFailover::isHealthy(int pool)
+    {
+        pthread_mutex_lock(&m_mutex);
+        const bool healthy = m_pools[pool].healthy;
+        pthread_mutex_unlock(&m_mutex);
+        return healthy;
+    }
+    //-----------------------------------------------------------------------------
+    inline void PoolFailover::setRtt(int pool, double rtt_ms)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_pools[pool].rttMs = rtt_ms;
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline double PoolFailover::rtt(int pool)
+    {
+        pthread_mutex_lock(&m_mutex);
+        const double rttMs = m_pools[pool].rttMs;
+        pthread_mutex_unlock(&m_mutex);
+        return rttMs;
+    }
+    //-----------------------------------------------------------------------------
+    inline void PoolFailover::setReceived(int pool)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_pools[pool].receivedMs = nowMs();
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool PoolFailover::checkSilence(int pool)
+    {
+        pthread_mutex_lock(&m_mutex);
+        poolState& state = m_pools[pool];
+        const bool silent = state.healthy && (nowMs() - state.receivedMs >= c_silenceTimeoutMs);
+        if (silent)
+            state.healthy = false;
+        pthread_mutex_unlock(&m_mutex);
+        return silent;
+    }
+    //-----------------------------------------------------------------------------
+    inline bool PoolFailover::select(int& out_pool)
+    {
+        pthread_mutex_lock(&m_mutex);
+        const uint64_t now = nowMs();
+        const int active = m_active;
+        // a primary pool which is still connecting at startup counts as healthy
+        const bool activeHealthy = m_pools[active].healthy
+                                   || (!m_pools[active].healthySinceMs && (now - m_startMs < c_startupGraceMs));
+
+        int best = -1;
+        for (int i = 0; i < m_numPools; ++i)
+        {
+            const poolState& state = m_pools[i];
+            if (!state.healthy)
+                continue;
+            // hold-down before a recovered pool replaces a working one
+            if ((i != active) && activeHealthy && (now - state.healthySinceMs < c_failbackHoldMs))
+                continue;
+
+            if (best < 0)
+                best = i;
+            else if (m_select == PS_Latency)
+            {
+                const double bestRtt = m_pools[best].rttMs;
+                if ((state.rttMs >= 0.0) && ((bestRtt < 0.0) || (state.rttMs < bestRtt)))
+                    best = i;
+            }
+            // PS_Priority: the first healthy pool wins
+        }
+
+        // PS_Latency: keep the active pool unless the best one is clearly faster
+        if ((m_select == PS_Latency) && activeHealthy && (best >= 0) && (best != active))
+        {
+            const double activeRtt = m_pools[active].rttMs;
+            const double bestRtt = m_pools[best].rttMs;
+            if ((activeRtt >= 0.0) && (bestRtt >= activeRtt * c_latencyMargin))
+                best = active;
+        }
+
+        const bool changed = (best >= 0) && (best != active);
+        if (changed)
+            m_active = best;
+        pthread_mutex_unlock(&m_mutex);
+
+        out_pool = best;
+        return changed;
+    }
+    //-----------------------------------------------------------------------------
+    inline uint64_t PoolFailover::nowMs()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+#endif // !PoolFailover_INCLUDE_ONCE
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef PoolScheduler_INCLUDE_ONCE
+#define PoolScheduler_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <pthread.h>
+
+#include <lyclCore/PoolFailover.hpp>
+
+// Weighted hashrate split across several simultaneously active pools.
+//
+// Worker threads are assigned to pools in time slices. At every slice boundary the scheduler compares
+// the hashes each pool received with its weighted share and assigns the fastest threads first
+// to the pools with the largest deficit, using measured thread hashrates.
+// Several devices are split between pools, a single device is split over time.
+// Accounting restarts when a pool goes up or down, so a pool returning after an outage does not take all devices.
+
+namespace lycl
+{
+    //-----------------------------------------------------------------------------
+    // PoolScheduler class declaration.
+    //-----------------------------------------------------------------------------
+    class PoolScheduler
+    {
+    public:
+        //! length of a scheduling slice.
+        static const uint64_t c_sliceMs = 5000;
+        //! a thread stays on its pool while the pool's deficit covers this part of the thread's slice.
+        static constexpr double c_keepFactor = 0.5;
+
+        inline PoolScheduler();
+        inline ~PoolScheduler();
+
+        //! enable splitting over (num_pools) with (weights). Pools with weight 0 get no work.
+        inline void init(int num_pools, const double* weights, int num_threads);
+        bool isEnabled() const { return m_enabled; }
+        //! pool assigned to worker thread (thr_id).
+        int assigned(int thr_id) const { return m_assigned[thr_id]; }
+        //! credit (hashes) done by a worker to (pool).
+        inline void addHashes(int pool, uint64_t hashes);
+        //! reassign threads at slice boundaries, or at once if pool health changed.
+        //! (healthy): per pool, (hashrates): per thread. Threads which changed their pool are added to (out_changed).
+        inline bool update(const bool* healthy, const std::vector<double>& hashrates, std::vector<int>& out_changed);
+        //! fraction of all hashes done for (pool) and its target fraction, in percent.
+        inline void getShare(int pool, double& out_actual, double& out_target);
+
+    private:
+        PoolScheduler(const PoolScheduler&);
+        PoolScheduler& operator=(const PoolScheduler&);
+
+        pthread_mutex_t m_mutex;
+        bool m_enabled;
+        int m_numPools;
+        double m_weights[PoolFailover::c_maxPools];
+        double m_hashes[PoolFailover::c_maxPools];
+        bool m_healthy[PoolFailover::c_maxPools];
+        //! read by workers without the mutex, a single int per thread.
+        volatile int* m_assigned;
+        size_t m_numThreads;
+        uint64_t m_lastUpdateMs;
+    };
+    //-----------------------------------------------------------------------------
+    // PoolScheduler class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline PoolScheduler::PoolScheduler()
+        : m_enabled(false)
+        , m_numPools(0)
+        , m_assigned(NULL)
+        , m_numThreads(0)
+        , m_lastUpdateMs(0)
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+        for (int i = 0; i < PoolFailover::c_maxPools; ++i)
+        {
+            m_weights[i] = 0.0;
+            m_hashes[i] = 0.0;
+            m_healthy[i] = false;
+        }
+    }
+    //-----------------------------------------------------------------------------
+    inline PoolScheduler::~PoolScheduler()
+    {
+        delete[] m_assigned;
+        pthread_mutex_destroy(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void PoolScheduler::init(int num_pools, const double* weights, int num_threads)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_numPools = std::min(num_pools, (int)PoolFailover::c_maxPools);
+        for (int i = 0; i < m_numPools; ++i)
+            m_weights[i] = (weights[i] > 0.0) ? weights[i] : 0.0;
+        delete[] m_assigned;
+        m_numThreads = (size_t)num_threads;
+        m_assigned = new volatile int[m_numThreads]();
+        m_enabled = true;
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void PoolScheduler::addHashes(int pool, uint64_t hashes)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_hashes[pool] += (double)hashes;
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool PoolScheduler::update(const bool* healthy, const std::vector<double>& hashrates, std::vector<int>& out_changed)
+    {
+        pthread_mutex_lock(&m_mutex);
+        const uint64_t now = PoolFailover::nowMs();
+
+        bool healthChanged = false;
+        double weightSum = 0.0;
+        for (int i = 0; i < m_numPools; ++i)
+        {
+            healthChanged |= (healthy[i] != m_healthy[i]);
+            m_healthy[i] = healthy[i];
+            if (healthy[i])
+                weightSum += m_weights[i];
+        }
+        if (healthChanged)
+        {
+            for (int i = 0; i < m_numPools; ++i)
+                m_hashes[i] = 0.0;
+        }
+
+        if ((weightSum <= 0.0) || (!healthChanged && (now - m_lastUpdateMs < c_sliceMs)))
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return false;
+        }
+        m_lastUpdateMs = now;
+
+        // hashes expected during the next slice. Threads without a measured hashrate count as average.
+        const size_t numThreads = m_numThreads;
+        std::vector<double> rates(numThreads, 0.0);
+        double rateSum = 0.0;
+        size_t numMeasured = 0;
+        for (size_t t = 0; t < numThreads; ++t)
+        {
+            rates[t] = (t < hashrates.size()) ? hashrates[t] : 0.0;
+            if (rates[t] > 0.0)
+            {
+                rateSum += rates[t];
+                ++numMeasured;
+            }
+        }
+        const double defaultRate = numMeasured ? (rateSum / (double)numMeasured) : 1.0;
+        for (size_t t = 0; t < numThreads; ++t)
+        {
+            if (rates[t] <= 0.0)
+            {
+                rates[t] = defaultRate;
+                rateSum += defaultRate;
+            }
+        }
+        const double sliceSeconds = (double)c_sliceMs * 0.001;
+
+        // deficit of every pool at the end of the next slice
+        double totalHashes = rateSum * sliceSeconds;
+        for (int i = 0; i < m_numPools; ++i)
+            if (m_healthy[i] && (m_weights[i] > 0.0))
+                totalHashes += m_hashes[i];
+        double deficit[PoolFailover::c_maxPools];
+        for (int i = 0; i < m_numPools; ++i)
+        {
+            if (m_healthy[i] && (m_weights[i] > 0.0))
+                deficit[i] = totalHashes * (m_weights[i] / weightSum) - m_hashes[i];
+        }
+
+        // fastest threads first
+        std::vector<size_t> order(numThreads);
+        for (size_t t = 0; t < numThreads; ++t)
+            order[t] = t;
+        std::sort(order.begin(), order.end(), [&rates](size_t a, size_t b) { return rates[a] > rates[b]; });
+
+        for (size_t k = 0; k < numThreads; ++k)
+        {
+            const size_t t = order[k];
+            const double sliceHashes = rates[t] * sliceSeconds;
+            const int current = m_assigned[t];
+
+            int best = -1;
+            for (int i = 0; i < m_numPools; ++i)
+            {
+                if (!m_healthy[i] || (m_weights[i] <= 0.0))
+                    continue;
+                if ((best < 0) || (deficit[i] > deficit[best]))
+                    best = i;
+            }
+            // avoid needless switches
+            const bool currentUsable = (current < m_numPools) && m_healthy[current] && (m_weights[current] > 0.0);
+            if (currentUsable && (deficit[current] >= sliceHashes * c_keepFactor))
+                best = current;
+
+            deficit[best] -= sliceHashes;
+            if (best != current)
+            {
+                m_assigned[t] = best;
+                out_changed.push_back((int)t);
+            }
+        }
+        pthread_mutex_unlock(&m_mutex);
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void PoolScheduler::getShare(int pool, double& out_actual, double& out_target)
+    {
+        pthread_mutex_lock(&m_mutex);
+        double total = 0.0;
+        double weightSum = 0.0;
+        for (int i = 0; i < m_numPools; ++i)
+        {
+            total += m_hashes[i];
+            weightSum += m_weights[i];
+        }
+        out_actual = (total > 0.0) ? (100.0 * m_hashes[pool] / total) : 0.0;
+        out_target = (weightSum > 0.0) ? (100.0 * m_weights[pool] / weightSum) : 0.0;
+        pthread_mutex_unlock(&m_mutex);
+    }
+}
+
+#endif // !PoolScheduler_INCLUDE_ONCE
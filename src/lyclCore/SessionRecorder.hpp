@@ -0,0 +1,151 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef SessionRecorder_INCLUDE_ONCE
+#define SessionRecorder_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cstdio>
+#include <chrono>
+#include <pthread.h>
+
+// Stratum session recorder.
+// Records every stratum line and miner events(connect, job switch, thread restart) with microsecond timestamps.
+// Recordings are fed back into the stratum thread by SessionReplay.
+//
+// File format, one record per line: <microseconds since session start> <type> <text>
+// type '<': line received from the pool, '>': line sent to the pool, '!': miner event.
+
+namespace lycl
+{
+    typedef enum
+    {
+        SR_Recv  = '<',
+        SR_Send  = '>',
+        SR_Event = '!'
+    } ESessionRecord;
+
+    //! receives every record, used by the replay driver to time a live session.
+    typedef void (*sessionListener)(void* userdata, ESessionRecord type, const char* text, uint64_t time_us);
+
+    //-----------------------------------------------------------------------------
+    // SessionRecorder class declaration.
+    //-----------------------------------------------------------------------------
+    class SessionRecorder
+    {
+    public:
+        inline SessionRecorder();
+        inline ~SessionRecorder();
+
+        //! start recording to (file_name).
+        inline bool open(const char* file_name);
+        inline void close();
+        //! set (listener) which observes all records. NULL to remove.
+        inline void setListener(sessionListener listener, void* userdata);
+        //! true if records are written to a file or observed by a listener.
+        bool isActive() const { return m_active; }
+        //! add a record. Does nothing if the recorder is not active.
+        inline void record(ESessionRecord type, const char* text);
+        //! microseconds since the recorder was created.
+        inline uint64_t now() const;
+
+    private:
+        SessionRecorder(const SessionRecorder&);
+        SessionRecorder& operator=(const SessionRecorder&);
+
+        pthread_mutex_t m_mutex;
+        FILE* m_file;
+        sessionListener m_listener;
+        void* m_listenerUserdata;
+        volatile bool m_active;
+        std::chrono::steady_clock::time_point m_start;
+    };
+    //-----------------------------------------------------------------------------
+    // SessionRecorder class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline SessionRecorder::SessionRecorder()
+        : m_file(NULL)
+        , m_listener(NULL)
+        , m_listenerUserdata(NULL)
+        , m_active(false)
+        , m_start(std::chrono::steady_clock::now())
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+    }
+    //-----------------------------------------------------------------------------
+    inline SessionRecorder::~SessionRecorder()
+    {
+        close();
+        pthread_mutex_destroy(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool SessionRecorder::open(const char* file_name)
+    {
+        FILE* file = fopen(file_name, "wb");
+        if (!file)
+            return false;
+
+        pthread_mutex_lock(&m_mutex);
+        if (m_file)
+            fclose(m_file);
+        m_file = file;
+        m_active = true;
+        pthread_mutex_unlock(&m_mutex);
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void SessionRecorder::close()
+    {
+        pthread_mutex_lock(&m_mutex);
+        if (m_file)
+        {
+            fclose(m_file);
+            m_file = NULL;
+        }
+        m_active = (m_listener != NULL);
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void SessionRecorder::setListener(sessionListener listener, void* userdata)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_listener = listener;
+        m_listenerUserdata = userdata;
+        m_active = (m_file != NULL) || (m_listener != NULL);
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void SessionRecorder::record(ESessionRecord type, const char* text)
+    {
+        if (!m_active)
+            return;
+
+        const uint64_t timeUs = now();
+        pthread_mutex_lock(&m_mutex);
+        if (m_file)
+        {
+            fprintf(m_file, "%llu %c %s\n", (unsigned long long)timeUs, (char)type, text);
+            // a session is recorded to find rare problems, keep it complete if the miner dies.
+            fflush(m_file);
+        }
+        if (m_listener)
+            m_listener(m_listenerUserdata, type, text, timeUs);
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline uint64_t SessionRecorder::now() const
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+    }
+}
+
+//! stratum session recorder, defined in Stratum.cpp.
+extern lycl::SessionRecorder stratumRecorder;
+
+#endif // !SessionRecorder_INCLUDE_ONCE
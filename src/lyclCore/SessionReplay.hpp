@@ -0,0 +1,368 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef SessionReplay_INCLUDE_ONCE
+#define SessionReplay_INCLUDE_ONCE
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm> // sort
+#include <cstring>
+#include <cstdlib>
+#include <pthread.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+#include <lyclCore/Network.hpp>
+#include <lyclCore/Log.hpp>
+#include <lyclCore/SessionRecorder.hpp>
+
+// Deterministic replay of a recorded stratum session.
+// Serves the recorded pool lines on a local port with original or accelerated timing,
+// the stratum thread connects to it like to a real pool.
+// Timings of the live session(notify to job switch, restart_threads() and first submit) are taken
+// from stratumRecorder and reported during and after the replay.
+
+namespace lycl
+{
+    struct sessionRecord
+    {
+        uint64_t timeUs;
+        char type;
+        std::string text;
+    };
+
+    //-----------------------------------------------------------------------------
+    // SessionReplay class declaration.
+    //-----------------------------------------------------------------------------
+    class SessionReplay
+    {
+    public:
+        //! seconds to wait for a miner connection.
+        static const int c_acceptTimeout = 60;
+        //! milliseconds to wait for late submits after the last record.
+        static const int c_drainTime = 1000;
+
+        inline SessionReplay();
+        inline ~SessionReplay();
+
+        //! load a recording made by SessionRecorder.
+        inline bool load(const char* file_name);
+        //! serve the recording on 127.0.0.1:(out_port) and start observing stratumRecorder.
+        //! (speed): 1 original timing, 10 ten times faster, 0 without delays.
+        inline bool start(double speed, int& out_port);
+        //! true if all records were sent(or the miner never connected).
+        bool isFinished() const { return m_finished; }
+        //! print job switch, restart and submit timings.
+        inline void printReport();
+
+    private:
+        SessionReplay(const SessionReplay&);
+        SessionReplay& operator=(const SessionReplay&);
+
+        static inline void* threadFunc(void* userdata);
+        static inline void onRecord(void* userdata, ESessionRecord type, const char* text, uint64_t time_us);
+        static inline void closeSocket(curl_socket_t sock);
+        inline curl_socket_t acceptMiner();
+        //! wait until (due_us) of the replay clock, discarding everything the miner sends.
+        inline bool drainUntil(curl_socket_t sock, uint64_t due_us);
+        inline void serve();
+
+        std::vector<sessionRecord> m_records;
+        double m_speed;
+        curl_socket_t m_listenSocket;
+        pthread_t m_thread;
+        bool m_threadStarted;
+        volatile bool m_finished;
+
+        // live session timings
+        pthread_mutex_t m_statsMutex;
+        uint64_t m_lastNotifyUs;
+        bool m_jobPending;
+        bool m_restartPending;
+        bool m_submitPending;
+        uint32_t m_numNotifies;
+        uint32_t m_numSubmits;
+        std::vector<double> m_jobSwitchMs;
+        std::vector<double> m_restartMs;
+        std::vector<double> m_submitMs;
+    };
+    //-----------------------------------------------------------------------------
+    // SessionReplay class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline SessionReplay::SessionReplay()
+        : m_speed(1.0)
+        , m_listenSocket(CURL_SOCKET_BAD)
+        , m_threadStarted(false)
+        , m_finished(false)
+        , m_lastNotifyUs(0)
+        , m_jobPending(false)
+        , m_restartPending(false)
+        , m_submitPending(false)
+        , m_numNotifies(0)
+        , m_numSubmits(0)
+    {
+        pthread_mutex_init(&m_statsMutex, NULL);
+    }
+    //-----------------------------------------------------------------------------
+    inline SessionReplay::~SessionReplay()
+    {
+        stratumRecorder.setListener(NULL, NULL);
+        if (m_threadStarted)
+            pthread_join(m_thread, NULL);
+        if (m_listenSocket != CURL_SOCKET_BAD)
+            closeSocket(m_listenSocket);
+        pthread_mutex_destroy(&m_statsMutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool SessionReplay::load(const char* file_name)
+    {
+        std::ifstream file(file_name);
+        if (!file.is_open())
+            return false;
+
+        m_records.clear();
+        std::string line;
+        while (std::getline(file, line))
+        {
+            // <time_us> <type> <text>
+            const size_t typePos = line.find(' ');
+            if (typePos == std::string::npos || typePos + 2 >= line.size())
+                continue;
+
+            sessionRecord record;
+            record.timeUs = strtoull(line.c_str(), NULL, 10);
+            record.type = line[typePos + 1];
+            record.text = line.substr(std::min(typePos + 3, line.size()));
+            if (record.type == SR_Recv || record.type == SR_Send || record.type == SR_Event)
+                m_records.push_back(record);
+        }
+
+        return !m_records.empty();
+    }
+    //-----------------------------------------------------------------------------
+    inline bool SessionReplay::start(double speed, int& out_port)
+    {
+        m_speed = speed;
+        m_listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (m_listenSocket == CURL_SOCKET_BAD)
+            return false;
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = 0; // any free port
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addrSize = sizeof(addr);
+        if (bind(m_listenSocket, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(m_listenSocket, 1) != 0 ||
+            getsockname(m_listenSocket, (sockaddr*)&addr, &addrSize) != 0)
+            return false;
+        out_port = ntohs(addr.sin_port);
+
+        stratumRecorder.setListener(onRecord, this);
+        if (pthread_create(&m_thread, NULL, threadFunc, this))
+        {
+            stratumRecorder.setListener(NULL, NULL);
+            return false;
+        }
+        m_threadStarted = true;
+
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void* SessionReplay::threadFunc(void* userdata)
+    {
+        SessionReplay* replay = (SessionReplay*)userdata;
+        replay->serve();
+        replay->m_finished = true;
+        return NULL;
+    }
+    //-----------------------------------------------------------------------------
+    inline void SessionReplay::closeSocket(curl_socket_t sock)
+    {
+#ifdef _WIN32
+        closesocket(sock);
+#else
+        close(sock);
+#endif
+    }
+    //-----------------------------------------------------------------------------
+    inline curl_socket_t SessionReplay::acceptMiner()
+    {
+        struct timeval tv;
+        fd_set rd;
+        FD_ZERO(&rd);
+        FD_SET(m_listenSocket, &rd);
+        tv.tv_sec = c_acceptTimeout;
+        tv.tv_usec = 0;
+        if (select((int)(m_listenSocket + 1), &rd, NULL, NULL, &tv) <= 0)
+            return CURL_SOCKET_BAD;
+
+        return accept(m_listenSocket, NULL, NULL);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool SessionReplay::drainUntil(curl_socket_t sock, uint64_t due_us)
+    {
+        for (;;)
+        {
+            const uint64_t now = stratumRecorder.now();
+            const uint64_t waitUs = (due_us > now) ? (due_us - now) : 0;
+
+            struct timeval tv;
+            fd_set rd;
+            FD_ZERO(&rd);
+            FD_SET(sock, &rd);
+            tv.tv_sec = (long)(waitUs / 1000000);
+            tv.tv_usec = (long)(waitUs % 1000000);
+            const int n = select((int)(sock + 1), &rd, NULL, NULL, &tv);
+            if (n < 0)
+                return false;
+            if (n == 0)
+                return true;
+
+            // submits and requests are observed through stratumRecorder
+            char buf[2048];
+            if (recv(sock, buf, sizeof(buf), 0) <= 0)
+                return false;
+            if (!waitUs)
+                return true;
+        }
+    }
+    //-----------------------------------------------------------------------------
+    inline void SessionReplay::serve()
+    {
+        curl_socket_t sock = acceptMiner();
+        if (sock == CURL_SOCKET_BAD)
+        {
+            Log::print(Log::LT_Error, "Replay: the miner did not connect.");
+            return;
+        }
+
+        // replay clock: recorded time(scaled) + base
+        int64_t baseUs = (int64_t)stratumRecorder.now();
+        bool firstConnect = true;
+        bool connected = true;
+        for (size_t i = 0; i < m_records.size(); ++i)
+        {
+            const sessionRecord& record = m_records[i];
+            const int64_t scaledUs = (m_speed > 0.0) ? (int64_t)((double)record.timeUs / m_speed) : 0;
+
+            if (record.type == SR_Event && !record.text.compare(0, 7, "connect"))
+            {
+                if (!firstConnect)
+                {
+                    // the original session reconnected here
+                    closeSocket(sock);
+                    sock = acceptMiner();
+                    connected = (sock != CURL_SOCKET_BAD);
+                    if (!connected)
+                        break;
+                }
+                // keep timing relative to the connect
+                baseUs = (int64_t)stratumRecorder.now() - scaledUs;
+                firstConnect = false;
+                continue;
+            }
+            if (record.type != SR_Recv)
+                continue;
+
+            const int64_t dueUs = std::max<int64_t>(0, baseUs + scaledUs);
+            if (!drainUntil(sock, (uint64_t)dueUs))
+            {
+                Log::print(Log::LT_Warning, "Replay: the miner disconnected at record %u.", (uint32_t)i);
+                connected = false;
+                break;
+            }
+
+            std::string line = record.text + "\n";
+            if (send(sock, line.c_str(), (int)line.size(), 0) != (int)line.size())
+            {
+                connected = false;
+                break;
+            }
+        }
+
+        if (connected)
+        {
+            drainUntil(sock, stratumRecorder.now() + c_drainTime * 1000);
+            closeSocket(sock);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    inline void SessionReplay::onRecord(void* userdata, ESessionRecord type, const char* text, uint64_t time_us)
+    {
+        SessionReplay* replay = (SessionReplay*)userdata;
+        pthread_mutex_lock(&replay->m_statsMutex);
+        const double sinceNotifyMs = (double)(time_us - replay->m_lastNotifyUs) / 1000.0;
+        if (type == SR_Recv && strstr(text, "\"mining.notify\""))
+        {
+            replay->m_lastNotifyUs = time_us;
+            replay->m_jobPending = true;
+            replay->m_restartPending = true;
+            replay->m_submitPending = true;
+            ++replay->m_numNotifies;
+        }
+        else if (type == SR_Event && !strncmp(text, "job", 3) && replay->m_jobPending)
+        {
+            replay->m_jobPending = false;
+            replay->m_jobSwitchMs.push_back(sinceNotifyMs);
+            Log::print(Log::LT_Info, "Replay: %s, switched %.3f ms after notify", text, sinceNotifyMs);
+        }
+        else if (type == SR_Event && !strcmp(text, "restart") && replay->m_restartPending)
+        {
+            replay->m_restartPending = false;
+            replay->m_restartMs.push_back(sinceNotifyMs);
+            Log::print(Log::LT_Info, "Replay: threads restarted %.3f ms after notify", sinceNotifyMs);
+        }
+        else if (type == SR_Send && strstr(text, "\"mining.submit\""))
+        {
+            ++replay->m_numSubmits;
+            if (replay->m_submitPending)
+            {
+                replay->m_submitPending = false;
+                replay->m_submitMs.push_back(sinceNotifyMs);
+                Log::print(Log::LT_Info, "Replay: first submit %.3f ms after notify", sinceNotifyMs);
+            }
+        }
+        pthread_mutex_unlock(&replay->m_statsMutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void SessionReplay::printReport()
+    {
+        pthread_mutex_lock(&m_statsMutex);
+        Log::print(Log::LT_Notice, "Replay finished: %u records, %u notifies, %u submits.",
+                   (uint32_t)m_records.size(), m_numNotifies, m_numSubmits);
+
+        const char* names[3] = { "notify to job switch", "notify to restart", "notify to first submit" };
+        std::vector<double>* samples[3] = { &m_jobSwitchMs, &m_restartMs, &m_submitMs };
+        for (int i = 0; i < 3; ++i)
+        {
+            std::vector<double> sorted(*samples[i]);
+            std::sort(sorted.begin(), sorted.end());
+            if (sorted.empty())
+            {
+                Log::print(Log::LT_Notice, "%s: no samples", names[i]);
+                continue;
+            }
+            const size_t n = sorted.size();
+            Log::print(Log::LT_Notice, "%s: n=%u, min %.3f, p50 %.3f, p90 %.3f, max %.3f ms", names[i], (uint32_t)n,
+                       sorted[0], sorted[n / 2], sorted[(n * 9) / 10 < n ? (n * 9) / 10 : n - 1], sorted[n - 1]);
+        }
+        pthread_mutex_unlock(&m_statsMutex);
+    }
+}
+
+#endif // !SessionReplay_INCLUDE_ONCE
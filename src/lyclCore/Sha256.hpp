@@ -14,6 +14,12 @@
 #include <stdint.h>
 #include <external/endian.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 const uint32_t sha256_h[8] = {
     0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
@@ -100,27 +106,23 @@ const uint32_t sha256d_hash1[16] = {
  * SHA256 block compression function.  The 256-bit state is transformed via
  * the 512-bit input block to produce a new state.
  */
-inline void sha256_transform(uint32_t *state, const uint32_t *block, int swap)
+inline void sha256_expand(uint32_t *W)
 {
-    uint32_t W[64];
-    uint32_t S[8];
-    uint32_t t0, t1;
-    int i;
-
-    // 1. Prepare message schedule W.
-    if (swap)
-    {
-        for (i = 0; i < 16; i++)
-            W[i] = swab32(block[i]);
-    }
-    else
-        memcpy(W, block, 64);
-
-    for (i = 16; i < 64; i += 2)
+    for (int i = 16; i < 64; i += 2)
     {
         W[i]   = s1(W[i - 2]) + W[i - 7] + s0(W[i - 15]) + W[i - 16];
         W[i+1] = s1(W[i - 1]) + W[i - 6] + s0(W[i - 14]) + W[i - 15];
     }
+}
+
+/*
+ * SHA256 rounds over an expanded message schedule W[64].
+ */
+inline void sha256_rounds(uint32_t *state, const uint32_t *W)
+{
+    uint32_t S[8];
+    uint32_t t0, t1;
+    int i;
 
     // 2. Initialize working variables.
     memcpy(S, state, 32);
@@ -196,12 +198,134 @@ inline void sha256_transform(uint32_t *state, const uint32_t *block, int swap)
         state[i] += S[i];
 }
 
-inline void sha256d(unsigned char *hash, const unsigned char *data, int len)
+#ifdef SHA256_X86
+/*
+ * Returns 1 if the CPU has SHA extensions(SHA-NI) and SSE4.1. Checked once.
+ */
+inline int sha256_use_shani()
+{
+    struct cpuCheck
+    {
+        int shani;
+        cpuCheck() : shani(0)
+        {
+            unsigned int a, b, c, d;
+            if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_SSE4_1))
+                return;
+            if (__get_cpuid_max(0, NULL) >= 7)
+            {
+                __cpuid_count(7, 0, a, b, c, d);
+                shani = (b >> 29) & 1;
+            }
+        }
+    };
+    static const cpuCheck check;
+    return check.shani;
+}
+
+/*
+ * SHA256 block compression with SHA extensions. (block) is 16 words in host order.
+ */
+__attribute__((target("sha,sse4.1")))
+inline void sha256_transform_shani(uint32_t *state, const uint32_t *block)
+{
+    __m128i STATE0, STATE1, MSG, TMP, ABEF_SAVE, CDGH_SAVE;
+    __m128i M[16];
+    int j;
+
+    // state words to the ABEF/CDGH layout of sha256rnds2
+    TMP = _mm_loadu_si128((const __m128i *)&state[0]);
+    STATE1 = _mm_loadu_si128((const __m128i *)&state[4]);
+    TMP = _mm_shuffle_epi32(TMP, 0xB1);
+    STATE1 = _mm_shuffle_epi32(STATE1, 0x1B);
+    STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);
+    STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0);
+    ABEF_SAVE = STATE0;
+    CDGH_SAVE = STATE1;
+
+    for (j = 0; j < 16; j++)
+    {
+        if (j < 4)
+            M[j] = _mm_loadu_si128((const __m128i *)(block + 4 * j));
+        else
+        {
+            TMP = _mm_sha256msg1_epu32(M[j - 4], M[j - 3]);
+            TMP = _mm_add_epi32(TMP, _mm_alignr_epi8(M[j - 1], M[j - 2], 4));
+            M[j] = _mm_sha256msg2_epu32(TMP, M[j - 1]);
+        }
+        MSG = _mm_add_epi32(M[j], _mm_loadu_si128((const __m128i *)(sha256_k + 4 * j)));
+        STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+        MSG = _mm_shuffle_epi32(MSG, 0x0E);
+        STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    }
+
+    STATE0 = _mm_add_epi32(STATE0, ABEF_SAVE);
+    STATE1 = _mm_add_epi32(STATE1, CDGH_SAVE);
+    TMP = _mm_shuffle_epi32(STATE0, 0x1B);
+    STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);
+    STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0);
+    STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);
+    _mm_storeu_si128((__m128i *)&state[0], STATE0);
+    _mm_storeu_si128((__m128i *)&state[4], STATE1);
+}
+#else
+inline int sha256_use_shani()
+{
+    return 0;
+}
+#endif
+
+inline void sha256_transform(uint32_t *state, const uint32_t *block, int swap)
+{
+    uint32_t W[64];
+    int i;
+
+    // 1. Prepare message schedule W.
+    if (swap)
+    {
+        for (i = 0; i < 16; i++)
+            W[i] = swab32(block[i]);
+    }
+    else
+        memcpy(W, block, 64);
+
+#ifdef SHA256_X86
+    if (sha256_use_shani())
+    {
+        sha256_transform_shani(state, W);
+        return;
+    }
+#endif
+    sha256_expand(W);
+    sha256_rounds(state, W);
+}
+
+/*
+ * State after (num_blocks) whole 64-byte blocks of (data), to be resumed by sha256d_resume.
+ */
+inline void sha256_midstate(uint32_t *midstate, const unsigned char *data, size_t num_blocks)
+{
+    uint32_t T[16];
+
+    sha256_init(midstate);
+    for (size_t b = 0; b < num_blocks; b++)
+    {
+        for (int i = 0; i < 16; i++)
+            T[i] = be32dec(data + 64 * b + 4 * i);
+        sha256_transform(midstate, T, 0);
+    }
+}
+
+/*
+ * sha256d of (prefix_len) bytes already hashed into (midstate) followed by (len) bytes of (data).
+ */
+inline void sha256d_resume(unsigned char *hash, const uint32_t *midstate, size_t prefix_len,
+                           const unsigned char *data, int len)
 {
     uint32_t S[16], T[16];
     int i, r;
 
-    sha256_init(S);
+    memcpy(S, midstate, 32);
     for (r = len; r > -9; r -= 64)
     {
         if (r < 64)
@@ -212,7 +336,7 @@ inline void sha256d(unsigned char *hash, const unsigned char *data, int len)
         for (i = 0; i < 16; i++)
             T[i] = be32dec(T + i);
         if (r < 56)
-            T[15] = 8 * len;
+            T[15] = (uint32_t)(8 * (prefix_len + len));
         sha256_transform(S, T, 0);
     }
     memcpy(S + 8, sha256d_hash1 + 8, 32);
@@ -222,4 +346,48 @@ inline void sha256d(unsigned char *hash, const unsigned char *data, int len)
         be32enc((uint32_t *)hash + i, T[i]);
 }
 
+inline void sha256d(unsigned char *hash, const unsigned char *data, int len)
+{
+    sha256d_resume(hash, sha256_h, 0, data, len);
+}
+
+/*
+ * sha256d of a 64-byte Merkle tree node. (hash) may overlap (data).
+ * The padding block of the first hash is the same for every node, its message schedule is expanded once.
+ */
+inline void sha256d_64(unsigned char *hash, const unsigned char *data)
+{
+    struct paddingSchedule
+    {
+        uint32_t W[64] = {};
+        paddingSchedule()
+        {
+            W[0] = 0x80000000;
+            W[15] = 512;
+            sha256_expand(W);
+        }
+    };
+    static const paddingSchedule padding;
+
+    uint32_t S[16], T[16];
+    int i;
+
+    for (i = 0; i < 16; i++)
+        T[i] = be32dec(data + 4 * i);
+    sha256_init(S);
+    sha256_transform(S, T, 0);
+#ifdef SHA256_X86
+    if (sha256_use_shani())
+        sha256_transform_shani(S, padding.W);
+    else
+#endif
+        sha256_rounds(S, padding.W);
+
+    memcpy(S + 8, sha256d_hash1 + 8, 32);
+    sha256_init(T);
+    sha256_transform(T, S, 0);
+    for (i = 0; i < 8; i++)
+        be32enc((uint32_t *)hash + i, T[i]);
+}
+
 #endif // !Sha256_INCLUDE_ONCE
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef Sha256Batch_INCLUDE_ONCE
+#define Sha256Batch_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cstring>
+#include <chrono>
+#include <lyclCore/Sha256.hpp>
+
+// sha256d of many equally long messages at once, used to build Merkle roots of several extranonce2 values.
+//
+// Messages are hashed in lane groups with GCC vector extensions, one message per vector element:
+// 8 lanes with AVX2, 4 lanes(SSE2/NEON) otherwise. With SHA extensions one message at a time may be faster,
+// depending on the throughput of sha256rnds2. The fastest supported implementation is measured once at runtime.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_BATCH_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SHA256_BATCH_TARGET(isa)
+#endif
+
+namespace lycl
+{
+    typedef enum
+    {
+        SHA256_Scalar = 0,
+        SHA256_Lanes4,
+        SHA256_Lanes8,
+        SHA256_ShaNi
+    } ESha256Batch;
+
+    namespace sha256lanes
+    {
+        template <int N> struct lanes
+        {
+            typedef uint32_t u32 __attribute__((vector_size(4 * N)));
+        };
+
+        #define SHA256_LANES_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+        //! compress one block in every lane. (W) is the block, expanded in place.
+        template <int N>
+        inline __attribute__((always_inline)) void transform(typename lanes<N>::u32* state, typename lanes<N>::u32* W)
+        {
+            typedef typename lanes<N>::u32 u32v;
+
+            for (int i = 16; i < 64; ++i)
+            {
+                const u32v x = W[i - 15];
+                const u32v y = W[i - 2];
+                const u32v ss0 = SHA256_LANES_ROTR(x, 7) ^ SHA256_LANES_ROTR(x, 18) ^ (x >> 3);
+                const u32v ss1 = SHA256_LANES_ROTR(y, 17) ^ SHA256_LANES_ROTR(y, 19) ^ (y >> 10);
+                W[i] = ss1 + W[i - 7] + ss0 + W[i - 16];
+            }
+
+            u32v a = state[0], b = state[1], c = state[2], d = state[3];
+            u32v e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; ++i)
+            {
+                const u32v t0 = h + (SHA256_LANES_ROTR(e, 6) ^ SHA256_LANES_ROTR(e, 11) ^ SHA256_LANES_ROTR(e, 25))
+                                + ((e & (f ^ g)) ^ g) + sha256_k[i] + W[i];
+                const u32v t1 = (SHA256_LANES_ROTR(a, 2) ^ SHA256_LANES_ROTR(a, 13) ^ SHA256_LANES_ROTR(a, 22))
+                                + ((a & (b | c)) | (b & c));
+                h = g; g = f; f = e;
+                e = d + t0;
+                d = c; c = b; b = a;
+                a = t0 + t1;
+            }
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+
+        #undef SHA256_LANES_ROTR
+
+        //! sha256d_resume of N messages. Message l starts at (data + l * stride).
+        template <int N>
+        inline __attribute__((always_inline)) void sha256dResume(unsigned char* out_hashes, const uint32_t* midstate, size_t prefix_len,
+                                                                 const unsigned char* data, size_t stride, int len)
+        {
+            typedef typename lanes<N>::u32 u32v;
+            const u32v zero = {};
+
+            u32v S[8];
+            u32v W[64];
+            for (int i = 0; i < 8; ++i)
+                S[i] = zero + midstate[i];
+
+            // every lane has the same length, so padding is the same in all lanes
+            unsigned char block[64];
+            for (int r = len; r > -9; r -= 64)
+            {
+                for (int l = 0; l < N; ++l)
+                {
+                    if (r < 64)
+                        memset(block, 0, 64);
+                    memcpy(block, data + l * stride + len - r, r > 64 ? 64 : (r < 0 ? 0 : r));
+                    if (r >= 0 && r < 64)
+                        block[r] = 0x80;
+                    for (int i = 0; i < 16; ++i)
+                        W[i][l] = be32dec(block + 4 * i);
+                    if (r < 56)
+                        W[15][l] = (uint32_t)(8 * (prefix_len + len));
+                }
+                transform<N>(S, W);
+            }
+
+            // second hash of the 32-byte digest
+            u32v T[8];
+            for (int i = 0; i < 8; ++i)
+            {
+                W[i] = S[i];
+                W[i + 8] = zero + sha256d_hash1[i + 8];
+                T[i] = zero + sha256_h[i];
+            }
+            transform<N>(T, W);
+
+            for (int l = 0; l < N; ++l)
+                for (int i = 0; i < 8; ++i)
+                    be32enc((uint32_t*)(out_hashes + 32 * l) + i, T[i][l]);
+        }
+
+        SHA256_BATCH_TARGET("avx2")
+        inline void sha256dResume8(unsigned char* out_hashes, const uint32_t* midstate, size_t prefix_len,
+                                   const unsigned char* data, size_t stride, int len)
+        {
+            sha256dResume<8>(out_hashes, midstate, prefix_len, data, stride, len);
+        }
+
+        inline void sha256dResume4(unsigned char* out_hashes, const uint32_t* midstate, size_t prefix_len,
+                                   const unsigned char* data, size_t stride, int len)
+        {
+            sha256dResume<4>(out_hashes, midstate, prefix_len, data, stride, len);
+        }
+    } // namespace sha256lanes
+    //-----------------------------------------------------------------------------
+    inline const char* sha256GetBatchImplName(ESha256Batch impl)
+    {
+        switch (impl)
+        {
+            case SHA256_ShaNi: return "sha-ni";
+            case SHA256_Lanes8: return "avx2 x8";
+            case SHA256_Lanes4: return "x4";
+            default: return "scalar";
+        }
+    }
+    //-----------------------------------------------------------------------------
+    //! declared here for the default argument of sha256dBatch.
+    inline ESha256Batch sha256GetBatchImpl();
+    //-----------------------------------------------------------------------------
+    //! sha256d of (count) messages of (len) bytes, message i at (data + i * stride), (out_hashes) receives 32 bytes per message.
+    //! All messages continue the same (midstate) of (prefix_len) bytes, use sha256_h and 0 for plain messages.
+    inline void sha256dBatch(unsigned char* out_hashes, const uint32_t* midstate, size_t prefix_len,
+                             const unsigned char* data, size_t stride, int len, size_t count,
+                             ESha256Batch impl = sha256GetBatchImpl())
+    {
+        size_t i = 0;
+        if (impl == SHA256_Lanes8)
+        {
+            for (; i + 8 <= count; i += 8)
+                sha256lanes::sha256dResume8(out_hashes + 32 * i, midstate, prefix_len, data + i * stride, stride, len);
+        }
+        if ((impl == SHA256_Lanes8) || (impl == SHA256_Lanes4))
+        {
+            for (; i + 4 <= count; i += 4)
+                sha256lanes::sha256dResume4(out_hashes + 32 * i, midstate, prefix_len, data + i * stride, stride, len);
+        }
+        // SHA-NI, scalar and the rest of a lane group
+        for (; i < count; ++i)
+            sha256d_resume(out_hashes + 32 * i, midstate, prefix_len, data + i * stride, len);
+    }
+    //-----------------------------------------------------------------------------
+    //! time of hashing a batch of Merkle nodes with (impl) in nanoseconds, best of a few runs.
+    inline double sha256MeasureBatchImpl(ESha256Batch impl)
+    {
+        const size_t numNodes = 32;
+        unsigned char nodes[64 * numNodes];
+        unsigned char hashes[32 * numNodes];
+        for (size_t i = 0; i < sizeof(nodes); ++i)
+            nodes[i] = (unsigned char)i;
+
+        double best = 0.0;
+        for (int run = 0; run < 5; ++run)
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (int k = 0; k < 8; ++k)
+                sha256dBatch(hashes, sha256_h, 0, nodes, 64, 64, numNodes, impl);
+            const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            if (!run || (ns < best))
+                best = ns;
+        }
+        return best;
+    }
+    //-----------------------------------------------------------------------------
+    //! Implementation used by sha256dBatch on this CPU, measured once(< 1ms).
+    inline ESha256Batch sha256GetBatchImpl()
+    {
+        struct selection
+        {
+            ESha256Batch impl;
+            selection() : impl(SHA256_Lanes4)
+            {
+                ESha256Batch candidates[3];
+                int numCandidates = 0;
+                candidates[numCandidates++] = SHA256_Lanes4;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2"))
+                    candidates[numCandidates++] = SHA256_Lanes8;
+#endif
+                if (sha256_use_shani())
+                    candidates[numCandidates++] = SHA256_ShaNi;
+
+                double best = 0.0;
+                for (int i = 0; i < numCandidates; ++i)
+                {
+                    const double ns = sha256MeasureBatchImpl(candidates[i]);
+                    if (!i || (ns < best))
+                    {
+                        best = ns;
+                        impl = candidates[i];
+                    }
+                }
+            }
+        };
+        static const selection selected;
+        return selected.impl;
+    }
+}
+
+#endif // !Sha256Batch_INCLUDE_ONCE
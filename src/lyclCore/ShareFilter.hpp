@@ -0,0 +1,143 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef ShareFilter_INCLUDE_ONCE
+#define ShareFilter_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <pthread.h>
+
+// Shares of a pool connection already handed to the work I/O thread.
+//
+// Restarts, overlapping nonce ranges and retries can find the same share twice, which the pool rejects
+// as a duplicate. Every share is reduced to a 64-bit key of job id, extranonce2, ntime, nonce and version,
+// kept in an open addressing hash set until the previous block hash changes: jobs of an older block
+// are stale anyway. A full set is cleared, duplicates are found close in time.
+
+namespace lycl
+{
+    //-----------------------------------------------------------------------------
+    // ShareFilter class declaration.
+    //-----------------------------------------------------------------------------
+    class ShareFilter
+    {
+    public:
+        //! slots of the hash set, a power of 2.
+        static const size_t c_tableSize = 8192;
+        //! shares kept for a block, at most half of the slots so probes stay short.
+        static const size_t c_maxShares = c_tableSize / 2;
+
+        inline ShareFilter();
+        inline ~ShareFilter();
+
+        //! key of a share. Keys are never 0.
+        static inline uint64_t shareKey(const char* job_id, const unsigned char* xnonce2, size_t xnonce2_len,
+                                        uint32_t ntime, uint32_t nonce, uint32_t version);
+        //! add a share of the block after (prevhash). Returns false if it was added before.
+        inline bool add(const uint32_t* prevhash, uint64_t key);
+        //! number of duplicates found.
+        inline uint32_t duplicates();
+
+    private:
+        ShareFilter(const ShareFilter&);
+        ShareFilter& operator=(const ShareFilter&);
+
+        static inline uint64_t hashBytes(uint64_t h, const void* data, size_t size);
+
+        pthread_mutex_t m_mutex;
+        uint32_t m_prevhash[8];
+        //! 0 marks an empty slot.
+        std::vector<uint64_t> m_table;
+        size_t m_numShares;
+        uint32_t m_numDuplicates;
+    };
+    //-----------------------------------------------------------------------------
+    // ShareFilter class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline ShareFilter::ShareFilter()
+        : m_numShares(0)
+        , m_numDuplicates(0)
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+        memset(m_prevhash, 0, sizeof(m_prevhash));
+    }
+    //-----------------------------------------------------------------------------
+    inline ShareFilter::~ShareFilter()
+    {
+        pthread_mutex_destroy(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline uint64_t ShareFilter::hashBytes(uint64_t h, const void* data, size_t size)
+    {
+        // FNV-1a
+        const unsigned char* p = (const unsigned char*)data;
+        for (size_t i = 0; i < size; ++i)
+            h = (h ^ p[i]) * 0x100000001b3ULL;
+        return h;
+    }
+    //-----------------------------------------------------------------------------
+    inline uint64_t ShareFilter::shareKey(const char* job_id, const unsigned char* xnonce2, size_t xnonce2_len,
+                                          uint32_t ntime, uint32_t nonce, uint32_t version)
+    {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        // the terminating zero separates the job id from extranonce2
+        if (job_id)
+            h = hashBytes(h, job_id, strlen(job_id) + 1);
+        if (xnonce2)
+            h = hashBytes(h, xnonce2, xnonce2_len);
+        const uint32_t words[3] = { ntime, nonce, version };
+        h = hashBytes(h, words, sizeof(words));
+        // spread the low bits, they select the slot
+        h ^= h >> 29;
+        return h ? h : 1;
+    }
+    //-----------------------------------------------------------------------------
+    inline bool ShareFilter::add(const uint32_t* prevhash, uint64_t key)
+    {
+        pthread_mutex_lock(&m_mutex);
+        if (m_table.empty())
+            m_table.resize(c_tableSize, 0);
+        // a new block: shares of older jobs can not be sent again
+        if (memcmp(m_prevhash, prevhash, sizeof(m_prevhash)) || (m_numShares >= c_maxShares))
+        {
+            memcpy(m_prevhash, prevhash, sizeof(m_prevhash));
+            std::fill(m_table.begin(), m_table.end(), 0);
+            m_numShares = 0;
+        }
+
+        size_t slot = (size_t)key & (c_tableSize - 1);
+        while (m_table[slot])
+        {
+            if (m_table[slot] == key)
+            {
+                ++m_numDuplicates;
+                pthread_mutex_unlock(&m_mutex);
+                return false;
+            }
+            slot = (slot + 1) & (c_tableSize - 1);
+        }
+        m_table[slot] = key;
+        ++m_numShares;
+        pthread_mutex_unlock(&m_mutex);
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline uint32_t ShareFilter::duplicates()
+    {
+        pthread_mutex_lock(&m_mutex);
+        const uint32_t count = m_numDuplicates;
+        pthread_mutex_unlock(&m_mutex);
+        return count;
+    }
+}
+
+#endif // !ShareFilter_INCLUDE_ONCE
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef ShareTracker_INCLUDE_ONCE
+#define ShareTracker_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <pthread.h>
+
+#include <lyclCore/PoolFailover.hpp>
+
+// In-flight share table of a pool connection.
+//
+// Every mining.submit gets a unique request id. The job, nonce, difficulty and send time of the share are kept
+// until the pool answers, so responses are matched to their shares and the round trip time of each share is known.
+// Round trip times are collected in a fixed log-scale histogram plus a window of recent samples for percentiles.
+// Shares without an answer after c_timeoutMs, or in flight when the connection drops, are counted and dropped.
+
+namespace lycl
+{
+    //-----------------------------------------------------------------------------
+    // ShareTracker class declaration.
+    //-----------------------------------------------------------------------------
+    class ShareTracker
+    {
+    public:
+        //! ids 1-4 are used by subscribe, authorize, extranonce subscribe and suggest difficulty.
+        static const uint32_t c_firstId = 5;
+        //! a share without a response after this time is counted as timed out.
+        static const uint64_t c_timeoutMs = 60000;
+        //! recent round trip times kept for percentiles.
+        static const size_t c_maxSamples = 1024;
+        //! interval of the summary logged by stratum threads.
+        static const uint64_t c_reportIntervalMs = 600000;
+        static const int c_numBuckets = 14;
+
+        struct share
+        {
+            uint32_t id;
+            std::string jobId;
+            uint32_t nonce;
+            double diff;
+            uint64_t sentMs;
+        };
+
+        inline ShareTracker();
+        inline ~ShareTracker();
+
+        //! register a share before it is sent. Returns its request id.
+        inline uint32_t add(const char* job_id, uint32_t nonce, double diff);
+        //! the share was not sent.
+        inline void cancel(uint32_t id);
+        //! match a response. Returns false if (id) is not in flight.
+        inline bool complete(uint32_t id, share& out_share, double& out_rtt_ms);
+        //! ids of in-flight shares up to (last_id), answered together by a Stratum V2 SubmitShares.Success.
+        inline void inFlightThrough(uint32_t last_id, std::vector<uint32_t>& out_ids);
+        //! drop shares older than c_timeoutMs, or all shares if (all) is set(connection lost).
+        inline void expire(bool all, std::vector<share>& out_expired);
+        //! a submit is sent again after a failure.
+        inline void addRetry();
+        //! a response id which is not in flight.
+        inline void addUnmatched();
+        //! one line summary: count, min/avg/percentiles/max rtt, timeouts, retries.
+        inline std::string summary();
+        //! round trip time histogram, one line per non-empty bucket.
+        inline std::string histogram();
+
+    private:
+        ShareTracker(const ShareTracker&);
+        ShareTracker& operator=(const ShareTracker&);
+
+        //! upper bounds of histogram buckets in milliseconds, the last bucket has no bound.
+        static inline double bucketBound(int bucket);
+        inline double percentile(std::vector<double>& sorted, double p);
+
+        pthread_mutex_t m_mutex;
+        uint32_t m_nextId;
+        //! ordered by id, so the oldest shares come first.
+        std::map<uint32_t, share> m_inFlight;
+        uint64_t m_buckets[c_numBuckets];
+        std::vector<double> m_samples;
+        size_t m_sampleIndex;
+        uint64_t m_numAnswered;
+        double m_rttSum;
+        double m_rttMin;
+        double m_rttMax;
+        uint32_t m_numTimeouts;
+        uint32_t m_numLost;
+        uint32_t m_numRetries;
+        uint32_t m_numUnmatched;
+    };
+    //-----------------------------------------------------------------------------
+    // ShareTracker class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline ShareTracker::ShareTracker()
+        : m_nextId(c_firstId)
+        , m_sampleIndex(0)
+        , m_numAnswered(0)
+        , m_rttSum(0.0)
+        , m_rttMin(0.0)
+        , m_rttMax(0.0)
+        , m_numTimeouts(0)
+        , m_numLost(0)
+        , m_numRetries(0)
+        , m_numUnmatched(0)
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+        for (int i = 0; i < c_numBuckets; ++i)
+            m_buckets[i] = 0;
+    }
+    //-----------------------------------------------------------------------------
+    inline ShareTracker::~ShareTracker()
+    {
+        pthread_mutex_destroy(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline double ShareTracker::bucketBound(int bucket)
+    {
+        // 1, 2, 5, 10, 20, 50... ms
+        static const double bounds[c_numBuckets - 1] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000 };
+        return bounds[bucket];
+    }
+    //-----------------------------------------------------------------------------
+    inline uint32_t ShareTracker::add(const char* job_id, uint32_t nonce, double diff)
+    {
+        pthread_mutex_lock(&m_mutex);
+        const uint32_t id = m_nextId++;
+        // wrapped around, keep clear of the reserved ids
+        if (m_nextId < c_firstId)
+            m_nextId = c_firstId;
+
+        share& entry = m_inFlight[id];
+        entry.id = id;
+        entry.jobId = job_id ? job_id : "";
+        entry.nonce = nonce;
+        entry.diff = diff;
+        entry.sentMs = PoolFailover::nowMs();
+        pthread_mutex_unlock(&m_mutex);
+        return id;
+    }
+    //-----------------------------------------------------------------------------
+    inline void ShareTracker::cancel(uint32_t id)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_inFlight.erase(id);
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool ShareTracker::complete(uint32_t id, share& out_share, double& out_rtt_ms)
+    {
+        pthread_mutex_lock(&m_mutex);
+        std::map<uint32_t, share>::iterator it = m_inFlight.find(id);
+        if (it == m_inFlight.end())
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return false;
+        }
+        out_share = it->second;
+        m_inFlight.erase(it);
+
+        const double rtt = (double)(PoolFailover::nowMs() - out_share.sentMs);
+        out_rtt_ms = rtt;
+
+        int bucket = 0;
+        while ((bucket < c_numBuckets - 1) && (rtt > bucketBound(bucket)))
+            ++bucket;
+        ++m_buckets[bucket];
+
+        if (m_samples.size() < c_maxSamples)
+            m_samples.push_back(rtt);
+        else
+            m_samples[m_sampleIndex] = rtt;
+        m_sampleIndex = (m_sampleIndex + 1) % c_maxSamples;
+
+        m_rttMin = m_numAnswered ? std::min(m_rttMin, rtt) : rtt;
+        m_rttMax = m_numAnswered ? std::max(m_rttMax, rtt) : rtt;
+        m_rttSum += rtt;
+        ++m_numAnswered;
+        pthread_mutex_unlock(&m_mutex);
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void ShareTracker::inFlightThrough(uint32_t last_id, std::vector<uint32_t>& out_ids)
+    {
+        pthread_mutex_lock(&m_mutex);
+        for (std::map<uint32_t, share>::iterator it = m_inFlight.begin(); (it != m_inFlight.end()) && (it->first <= last_id); ++it)
+            out_ids.push_back(it->first);
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void ShareTracker::expire(bool all, std::vector<share>& out_expired)
+    {
+        pthread_mutex_lock(&m_mutex);
+        const uint64_t now = PoolFailover::nowMs();
+        std::map<uint32_t, share>::iterator it = m_inFlight.begin();
+        while (it != m_inFlight.end())
+        {
+            if (all || (now - it->second.sentMs >= c_timeoutMs))
+            {
+                all ? ++m_numLost : ++m_numTimeouts;
+                out_expired.push_back(it->second);
+                m_inFlight.erase(it++);
+            }
+            else
+                ++it;
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void ShareTracker::addRetry()
+    {
+        pthread_mutex_lock(&m_mutex);
+        ++m_numRetries;
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void ShareTracker::addUnmatched()
+    {
+        pthread_mutex_lock(&m_mutex);
+        ++m_numUnmatched;
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline double ShareTracker::percentile(std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+        const size_t index = std::min(sorted.size() - 1, (size_t)(p * (double)sorted.size()));
+        return sorted[index];
+    }
+    //-----------------------------------------------------------------------------
+    inline std::string ShareTracker::summary()
+    {
+        pthread_mutex_lock(&m_mutex);
+        std::vector<double> sorted(m_samples);
+        std::sort(sorted.begin(), sorted.end());
+        char text[320];
+        snprintf(text, sizeof(text),
+                 "%u answered, rtt min %.0f avg %.0f p50 %.0f p90 %.0f p99 %.0f max %.0f ms, "
+                 "%u in flight, %u timed out, %u lost, %u retries, %u unmatched",
+                 (uint32_t)m_numAnswered, m_rttMin, m_numAnswered ? (m_rttSum / (double)m_numAnswered) : 0.0,
+                 percentile(sorted, 0.5), percentile(sorted, 0.9), percentile(sorted, 0.99), m_rttMax,
+                 (uint32_t)m_inFlight.size(), m_numTimeouts, m_numLost, m_numRetries, m_numUnmatched);
+        pthread_mutex_unlock(&m_mutex);
+        return text;
+    }
+    //-----------------------------------------------------------------------------
+    inline std::string ShareTracker::histogram()
+    {
+        pthread_mutex_lock(&m_mutex);
+        std::string text;
+        char line[96];
+        for (int i = 0; i < c_numBuckets; ++i)
+        {
+            if (!m_buckets[i])
+                continue;
+            const double percent = 100.0 * (double)m_buckets[i] / (double)m_numAnswered;
+            if (i < c_numBuckets - 1)
+                snprintf(line, sizeof(line), "  <= %5.0f ms: %8u (%5.1f%%)\n", bucketBound(i), (uint32_t)m_buckets[i], percent);
+            else
+                snprintf(line, sizeof(line), "   > %5.0f ms: %8u (%5.1f%%)\n", bucketBound(i - 1), (uint32_t)m_buckets[i], percent);
+            text += line;
+        }
+        pthread_mutex_unlock(&m_mutex);
+        if (!text.empty())
+            text.erase(text.size() - 1);
+        return text;
+    }
+}
+
+#endif // !ShareTracker_INCLUDE_ONCE
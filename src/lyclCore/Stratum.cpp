@@ -13,44 +13,12 @@
 #include <lyclCore/Stratum.hpp>
 
 //-----------------------------------------------------------------------------
-#ifdef _WIN32
-#define socket_blocks() (WSAGetLastError() == WSAEWOULDBLOCK)
-#else
-#define socket_blocks() (errno == EAGAIN || errno == EWOULDBLOCK)
-#endif
-//-----------------------------------------------------------------------------
-stratum_ctx stratum;
-//-----------------------------------------------------------------------------
-bool send_line(curl_socket_t sock, char *s)
-{
-    size_t sent = 0;
-    int len;
-
-    len = (int) strlen(s);
-    s[len++] = '\n';
-
-    while (len > 0)
-    {
-        struct timeval timeout = {0, 0};
-        int n;
-        fd_set wd;
-
-        FD_ZERO(&wd);
-        FD_SET(sock, &wd);
-        if (select((int) (sock + 1), NULL, &wd, NULL, &timeout) < 1)
-            return false;
-        n = send(sock, s + sent, len, 0);
-        if (n < 0) {
-            if (!socket_blocks())
-                return false;
-            n = 0;
-        }
-        sent += n;
-        len -= n;
-    }
-
-    return true;
-}
+stratum_ctx stratumPools[lycl::PoolFailover::c_maxPools];
+lycl::PoolFailover poolFailover;
+lycl::PoolScheduler poolScheduler;
+lycl::JobFeed jobFeed;
+lycl::SessionRecorder stratumRecorder;
+lycl::StratumProxy stratumProxy;
 //-----------------------------------------------------------------------------
 bool stratum_send_line(struct stratum_ctx *sctx, char *s)
 {
@@ -58,68 +26,50 @@ bool stratum_send_line(struct stratum_ctx *sctx, char *s)
 
     if (global::opt_protocol)
         Log::print(Log::LT_Debug, "> %s", s);
+    // a recording holds a single session, the active pool
+    if (sctx->pool == poolFailover.active())
+        stratumRecorder.record(lycl::SR_Send, s);
 
-    pthread_mutex_lock(&sctx->sock_lock);
-    ret = send_line(sctx->sock, s);
-    pthread_mutex_unlock(&sctx->sock_lock);
+    // sent by the stratum thread, without blocking the caller on a full socket buffer
+    ret = sctx->io.post(s);
 
     return ret;
 }
 //-----------------------------------------------------------------------------
-#define RBUFSIZE 2048
-#define RECVSIZE (RBUFSIZE - 4)
-void stratum_buffer_append(struct stratum_ctx *sctx, const char *s)
-{
-    size_t old, n;
-
-    old = strlen(sctx->sockbuf);
-    n = old + strlen(s) + 1;
-    if (n >= sctx->sockbuf_size) {
-        sctx->sockbuf_size = n + (RBUFSIZE - (n % RBUFSIZE));
-        sctx->sockbuf = (char*) realloc(sctx->sockbuf, sctx->sockbuf_size);
-    }
-    strcpy(sctx->sockbuf + old, s);
-}
-//-----------------------------------------------------------------------------
 char *stratum_recv_line(struct stratum_ctx *sctx)
 {
-    ssize_t len, buflen;
-    char *tok, *sret = NULL;
+    char *sret = NULL;
+    size_t len;
 
-    if (!strstr(sctx->sockbuf, "\n"))
+    if (!sctx->sockbuf.hasLine())
     {
         bool ret = true;
-        time_t rstart;
+        const uint64_t deadline = lycl::StratumIO::nowMs() + 60000;
 
-        time(&rstart);
-        if (!socket_full(sctx->sock, 60))
-        {
-            Log::print(Log::LT_Error, "stratum_recv_line timed out");
-            goto out;
-        }
         do
         {
-            char s[RBUFSIZE];
-            ssize_t n;
-
-            memset(s, 0, RBUFSIZE);
-            n = recv(sctx->sock, s, RECVSIZE, 0);
-            if (!n) {
+            const uint64_t now = lycl::StratumIO::nowMs();
+            const lycl::EIOStatus status = (now < deadline) ? sctx->io.wait((int)(deadline - now)) : lycl::IO_Timeout;
+            if (status == lycl::IO_Timeout)
+            {
+                Log::print(Log::LT_Error, "stratum_recv_line timed out");
+                goto out;
+            }
+            if (status == lycl::IO_Error)
+            {
                 ret = false;
                 break;
             }
+            // receive directly into the line buffer, until the socket is drained
+            ssize_t n;
+            while ((n = sctx->io.receive(sctx->sockbuf.writePtr(), sctx->sockbuf.writeSize())) > 0)
+                sctx->sockbuf.commit((size_t)n);
             if (n < 0)
             {
-                if (!socket_blocks() || !socket_full(sctx->sock, 1))
-                {
-                    ret = false;
-                    break;
-                }
+                ret = false;
+                break;
             }
-            else
-                stratum_buffer_append(sctx, s);
-
-        } while (time(NULL) - rstart < 60 && !strstr(sctx->sockbuf, "\n"));
+        } while (!sctx->sockbuf.hasLine());
 
         if (!ret)
         {
@@ -128,24 +78,21 @@ char *stratum_recv_line(struct stratum_ctx *sctx)
         }
     }
 
-    buflen = (ssize_t) strlen(sctx->sockbuf);
-    tok = strtok(sctx->sockbuf, "\n");
-    if (!tok)
+    if (!sctx->sockbuf.nextLine(sret, len))
     {
         Log::print(Log::LT_Error, "stratum_recv_line failed to parse a newline-terminated string");
+        sret = NULL;
         goto out;
     }
-    sret = strdup(tok);
-    len = (ssize_t) strlen(sret);
-
-    if (buflen > len + 1)
-        memmove(sctx->sockbuf, sctx->sockbuf + len + 1, buflen - len + 1);
-    else
-        sctx->sockbuf[0] = '\0';
 
 out:
-    if (sret && global::opt_protocol)
-        Log::print(Log::LT_Debug, "< %s", sret);
+    if (sret)
+    {
+        if (sctx->pool == poolFailover.active())
+            stratumRecorder.record(lycl::SR_Recv, sret);
+        if (global::opt_protocol)
+            Log::print(Log::LT_Debug, "< %s", sret);
+    }
     return sret;
 }
 //-----------------------------------------------------------------------------
@@ -154,6 +101,12 @@ bool stratum_connect(struct stratum_ctx *sctx, const char *url)
     CURL *curl;
     int rc;
 
+    if (stratumRecorder.isActive() && (sctx->pool == poolFailover.active()))
+    {
+        std::string event = std::string("connect ") + url;
+        stratumRecorder.record(lycl::SR_Event, event.c_str());
+    }
+
     pthread_mutex_lock(&sctx->sock_lock);
     if (sctx->curl)
         curl_easy_cleanup(sctx->curl);
@@ -165,12 +118,11 @@ bool stratum_connect(struct stratum_ctx *sctx, const char *url)
         return false;
     }
     curl = sctx->curl;
-    if (!sctx->sockbuf)
-    {
-        sctx->sockbuf = (char*) calloc(RBUFSIZE, 1);
-        sctx->sockbuf_size = RBUFSIZE;
-    }
-    sctx->sockbuf[0] = '\0';
+    sctx->sockbuf.clear();
+    sctx->sv2buf.clear();
+    sctx->sv2 = !strncasecmp(url, "stratum2+tcp://", 15);
+    sctx->sv2channel.reset();
+    sctx->diffControl.reset();
     pthread_mutex_unlock(&sctx->sock_lock);
     if (url != sctx->url)
     {
@@ -218,6 +170,14 @@ bool stratum_connect(struct stratum_ctx *sctx, const char *url)
     curl_easy_getinfo(curl, CURLINFO_LASTSOCKET, (long *)&sctx->sock);
 #endif
 
+    if (!sctx->io.open(sctx->sock))
+    {
+        Log::print(Log::LT_Error, "Stratum connection failed: unable to set up the socket");
+        curl_easy_cleanup(curl);
+        sctx->curl = NULL;
+        return false;
+    }
+
     return true;
 }
 //-----------------------------------------------------------------------------
@@ -282,8 +242,18 @@ bool stratum_parse_extranonce(struct stratum_ctx *sctx, json_t *params, int pndx
     }
     hex2bin(sctx->xnonce1, xnonce1, sctx->xnonce1_size);
     sctx->xnonce2_size = xn2_size;
+    // proxied miners get the nonzero leading bytes
+    sctx->xnonce2_fixed = stratumProxy.isActive() ? lycl::StratumProxy::prefixSize(xn2_size) : 0;
     pthread_mutex_unlock(&sctx->work_lock);
 
+    if (stratumProxy.isActive())
+    {
+        if (!sctx->xnonce2_fixed)
+            Log::print(Log::LT_Warning, "Pool %d: extranonce2 of %d bytes is too small to share, proxied miners are refused",
+                       sctx->pool, xn2_size);
+        stratumProxy.onExtranonce(sctx->pool, xnonce1, (size_t)xn2_size);
+    }
+
     if (pndx == 0 && global::opt_debug) // pool dynamic change
         Log::print(Log::LT_Debug, "Stratum set nonce %s with extranonce2 size=%d", xnonce1, xn2_size);
 
@@ -315,7 +285,7 @@ start:
         goto out;
     }
 
-    if (!socket_full(sctx->sock, 30))
+    if (!stratum_wait_readable(sctx, 30000))
     {
         Log::print(Log::LT_Error, "stratum_subscribe timed out");
         goto out;
@@ -326,8 +296,6 @@ start:
         goto out;
 
     val = json_loads(sret, 0, &err);
-
-    free(sret);
     if (!val)
     {
         Log::print(Log::LT_Error, "JSON decode failed(%d): %s", err.line, err.text);
@@ -389,3 +357,275 @@ out:
     return ret;
 }
 //-----------------------------------------------------------------------------
+// Stratum V2
+//-----------------------------------------------------------------------------
+//! host and port of a pool url.
+static void stratumV2Endpoint(const char *url, char *host, size_t host_size, int *port)
+{
+    const char *p = strstr(url, "://");
+    const char *colon;
+    size_t size;
+
+    p = p ? p + 3 : url;
+    colon = strrchr(p, ':');
+    size = colon ? (size_t)(colon - p) : strlen(p);
+    if (size >= host_size)
+        size = host_size - 1;
+    memcpy(host, p, size);
+    host[size] = 0;
+    *port = colon ? atoi(colon + 1) : 0;
+}
+//-----------------------------------------------------------------------------
+//! queues a frame for sending, the binary counterpart of stratum_send_line.
+static bool stratumV2Send(struct stratum_ctx *sctx, const lycl::Sv2Writer &frame)
+{
+    if (!frame.isValid())
+    {
+        Log::print(Log::LT_Error, "Stratum V2 message 0x%02x is too large", frame.data()[2]);
+        return false;
+    }
+    if (global::opt_protocol)
+        Log::print(Log::LT_Debug, "> sv2 message 0x%02x, %u bytes", frame.data()[2], (uint32_t)frame.size());
+
+    return sctx->io.postData(frame.data(), frame.size());
+}
+//-----------------------------------------------------------------------------
+bool stratumV2RecvFrame(struct stratum_ctx *sctx, lycl::sv2Frame &out_frame)
+{
+    const uint64_t deadline = lycl::StratumIO::nowMs() + 60000;
+
+    while (!sctx->sv2buf.nextFrame(out_frame))
+    {
+        if (sctx->sv2buf.isCorrupt())
+        {
+            Log::print(Log::LT_Error, "Stratum V2 frame is too large");
+            return false;
+        }
+
+        const uint64_t now = lycl::StratumIO::nowMs();
+        const lycl::EIOStatus status = (now < deadline) ? sctx->io.wait((int)(deadline - now)) : lycl::IO_Timeout;
+        if (status == lycl::IO_Timeout)
+        {
+            Log::print(Log::LT_Error, "stratumV2RecvFrame timed out");
+            return false;
+        }
+        // receive directly into the frame buffer, until the socket is drained
+        ssize_t n = -1;
+        if (status == lycl::IO_Readable)
+        {
+            while ((n = sctx->io.receive((char*)sctx->sv2buf.writePtr(), sctx->sv2buf.writeSize())) > 0)
+                sctx->sv2buf.commit((size_t)n);
+        }
+        if (n < 0)
+        {
+            Log::print(Log::LT_Error, "stratumV2RecvFrame failed");
+            return false;
+        }
+    }
+
+    if (global::opt_protocol)
+        Log::print(Log::LT_Debug, "< sv2 message 0x%02x, %u bytes", out_frame.type, out_frame.size);
+    return true;
+}
+//-----------------------------------------------------------------------------
+//! the channel target changed, it applies to the current job at once.
+static void stratumV2SetTarget(struct stratum_ctx *sctx)
+{
+    const double diff = lycl::StratumV2Channel::targetToDifficulty(sctx->sv2channel.target());
+    stratumSetDifficulty(sctx, diff);
+
+    pthread_mutex_lock(&sctx->work_lock);
+    memcpy(sctx->job.target, sctx->sv2channel.target(), sizeof(sctx->job.target));
+    sctx->job.diff = diff;
+    pthread_mutex_unlock(&sctx->work_lock);
+}
+//-----------------------------------------------------------------------------
+//! copy the active job of the channel into the job storage.
+static void stratumV2ApplyJob(struct stratum_ctx *sctx, bool clean)
+{
+    const lycl::StratumV2Channel &channel = sctx->sv2channel;
+    const lycl::sv2Job &job = channel.job();
+    int i;
+
+    pthread_mutex_lock(&sctx->work_lock);
+    snprintf(sctx->job.job_id, c_maxJobIdSize, "%x", job.id);
+    // byte layout of a mining.notify job, so work is assembled by the same code
+    for (i = 0; i < 8; i++)
+        le32enc(sctx->job.prevhash + 4 * i, be32dec(channel.prevhash() + 4 * i));
+    be32enc(sctx->job.version, job.version);
+    be32enc(sctx->job.nbits, channel.nbits());
+    be32enc(sctx->job.ntime, channel.ntime());
+    memcpy(sctx->job.merkle_root, job.merkleRoot, 32);
+    memcpy(sctx->job.target, channel.target(), sizeof(sctx->job.target));
+    sctx->job.version_mask = channel.versionMask();
+    sctx->job.version_rolls = 0;
+    sctx->job.merkle_count = 0;
+    sctx->job.clean = clean;
+    sctx->job.diff = sctx->next_diff;
+    // the coinbase stays with the pool
+    sctx->xnonce2_size = 0;
+    // no coinbase to read it from
+    sctx->block_height = 0;
+    pthread_mutex_unlock(&sctx->work_lock);
+}
+//-----------------------------------------------------------------------------
+static bool stratumV2HandleEvent(struct stratum_ctx *sctx, const lycl::sv2Event &event)
+{
+    switch (event.type)
+    {
+        case lycl::SV2E_ChannelOpened:
+        case lycl::SV2E_Target:
+            stratumV2SetTarget(sctx);
+            return true;
+        case lycl::SV2E_Job:
+            stratumV2ApplyJob(sctx, event.clean);
+            return true;
+        case lycl::SV2E_SharesAccepted:
+        {
+            // one response acknowledges all shares up to its sequence number
+            std::vector<uint32_t> ids;
+            sctx->shares.inFlightThrough(event.sequence, ids);
+            for (size_t i = 0; i < ids.size(); i++)
+                stratumHandleShareResponse(sctx, ids[i], true, NULL);
+            return true;
+        }
+        case lycl::SV2E_ShareRejected:
+            return stratumHandleShareResponse(sctx, event.sequence, false, event.text);
+        case lycl::SV2E_Reconnect:
+        {
+            // empty host or port: keep the current one
+            char host[256];
+            int port;
+            stratumV2Endpoint(sctx->url, host, sizeof(host), &port);
+            const char *newHost = event.text[0] ? event.text : host;
+            char *url = (char*) malloc(32 + strlen(newHost));
+            sprintf(url, "stratum2+tcp://%s:%d", newHost, event.port ? (int)event.port : port);
+            return stratum_reconnect_to(sctx, url);
+        }
+        case lycl::SV2E_SetupFailed:
+            Log::print(Log::LT_Error, "Stratum V2 setup failed: %s", event.text);
+            return false;
+        case lycl::SV2E_ChannelFailed:
+            Log::print(Log::LT_Error, "Stratum V2 channel rejected: %s", event.text);
+            return false;
+        case lycl::SV2E_ChannelClosed:
+            Log::print(Log::LT_Error, "Stratum V2 channel closed by the pool: %s", event.text);
+            return false;
+        default:
+            return true;
+    }
+}
+//-----------------------------------------------------------------------------
+bool stratumV2HandleFrame(struct stratum_ctx *sctx, const lycl::sv2Frame &frame)
+{
+    lycl::sv2Event event;
+    if (!sctx->sv2channel.handle(frame, event))
+    {
+        Log::print(Log::LT_Error, "Stratum V2 message 0x%02x is malformed", frame.type);
+        return false;
+    }
+    return stratumV2HandleEvent(sctx, event);
+}
+//-----------------------------------------------------------------------------
+bool stratumV2Setup(struct stratum_ctx *sctx, const char *user)
+{
+    char host[256];
+    int port;
+    stratumV2Endpoint(sctx->url, host, sizeof(host), &port);
+
+    lycl::Sv2Writer setup(lycl::SV2_SetupConnection, false);
+    lycl::StratumV2Channel::writeSetupConnection(setup, host, (uint16_t)port, PACKAGE_NAME, PACKAGE_VERSION);
+    if (!stratumV2Send(sctx, setup))
+        return false;
+
+    pthread_mutex_lock(&sctx->work_lock);
+    sctx->xnonce2_size = 0;
+    sctx->next_diff = 1.0;
+    pthread_mutex_unlock(&sctx->work_lock);
+
+    // jobs may follow the channel response in the same read, they stay buffered for the stratum thread
+    while (!sctx->sv2channel.isOpen())
+    {
+        lycl::sv2Frame frame;
+        lycl::sv2Event event;
+        if (!stratumV2RecvFrame(sctx, frame))
+            return false;
+        if (!sctx->sv2channel.handle(frame, event))
+        {
+            Log::print(Log::LT_Error, "Stratum V2 message 0x%02x is malformed", frame.type);
+            return false;
+        }
+
+        if (event.type == lycl::SV2E_SetupDone)
+        {
+            if (global::opt_debug)
+                Log::print(Log::LT_Debug, "Stratum V2 connection set up, version rolling %s",
+                           sctx->sv2channel.versionMask() ? "enabled" : "disabled");
+            lycl::Sv2Writer open(lycl::SV2_OpenStandardMiningChannel, false);
+            lycl::StratumV2Channel::writeOpenChannel(open, user, (float)global_hashrate);
+            if (!stratumV2Send(sctx, open))
+                return false;
+        }
+        else if (!stratumV2HandleEvent(sctx, event))
+            return false;
+    }
+
+    if (global::opt_debug)
+        Log::print(Log::LT_Debug, "Stratum V2 standard channel %u opened", sctx->sv2channel.channelId());
+    return true;
+}
+//-----------------------------------------------------------------------------
+bool stratumV2Submit(struct stratum_ctx *sctx, const work *work_info, uint32_t id)
+{
+    // header words hold nonce, ntime and version byte swapped, see buildExtraHeader.
+    // The channel id only changes when the connection is set up, before any work of it exists.
+    lycl::Sv2Writer submit(lycl::SV2_SubmitSharesStandard, true);
+    sctx->sv2channel.writeSubmit(submit, id, (uint32_t) strtoul(work_info->job_id, NULL, 16),
+                                 swab32(work_info->data[19]), swab32(work_info->data[17]), swab32(work_info->data[0]));
+    return stratumV2Send(sctx, submit);
+}
+//-----------------------------------------------------------------------------
+// Stratum proxy
+//-----------------------------------------------------------------------------
+bool stratumProxySubmit(int pool, const char *job_id, const char *xnonce2, const char *ntime, const char *nonce,
+                        double diff, uint32_t &out_id)
+{
+    // shares of V1 jobs only, job ids of Stratum V2 channels are not forwarded
+    stratum_ctx *sctx = &stratumPools[pool];
+    if (sctx->sv2 || !sctx->io.isOpen())
+        return false;
+
+    // tracked like local shares, the response is routed back by stratumHandleShareResponse
+    const uint32_t id = sctx->shares.add(job_id, swab32((uint32_t) strtoul(nonce, NULL, 16)), diff);
+    char req[JSON_BUF_LEN];
+    snprintf(req, sizeof(req),
+             "{\"method\": \"mining.submit\", \"params\": [\"%s\", \"%s\", \"%s\", \"%s\", \"%s\"], \"id\":%u}",
+             global::poolConnection(pool).rpc_user.c_str(), job_id, xnonce2, ntime, nonce, id);
+    if (!stratum_send_line(sctx, req))
+    {
+        sctx->shares.cancel(id);
+        return false;
+    }
+    out_id = id;
+    return true;
+}
+//-----------------------------------------------------------------------------
+// Difficulty suggestion
+//-----------------------------------------------------------------------------
+bool stratumSuggestDifficulty(struct stratum_ctx *sctx, double diff, double hashrate)
+{
+    if (sctx->sv2)
+    {
+        // no suggestion message, the channel's maximum target does the same
+        uint32_t target[8];
+        diff_to_target(target, diff / 256.0);
+        lycl::Sv2Writer update(lycl::SV2_UpdateChannel, true);
+        sctx->sv2channel.writeUpdateChannel(update, (float)hashrate, target);
+        return stratumV2Send(sctx, update);
+    }
+
+    char s[128];
+    snprintf(s, sizeof(s), "{\"id\": 4, \"method\": \"mining.suggest_difficulty\", \"params\": [%.17g]}", diff);
+    return stratum_send_line(sctx, s);
+}
+//-----------------------------------------------------------------------------
@@ -20,33 +20,77 @@
 #include <lyclCore/Threading.hpp>
 #include <lyclCore/Network.hpp>
 #include <lyclCore/Utils.hpp>
-
+#include <lyclCore/Sha256Batch.hpp>
+#include <lyclCore/SessionRecorder.hpp>
+#include <lyclCore/LineBuffer.hpp>
+#include <lyclCore/StratumIO.hpp>
+#include <lyclCore/PoolFailover.hpp>
+#include <lyclCore/PoolScheduler.hpp>
+#include <lyclCore/ShareTracker.hpp>
+#include <lyclCore/JobFeed.hpp>
+#include <lyclCore/StratumParser.hpp>
+#include <lyclCore/StratumV2.hpp>
+#include <lyclCore/StratumProxy.hpp>
+#include <lyclCore/DiffController.hpp>
+#include <lyclCore/ShareFilter.hpp>
+
+//! Merkle roots built in one pass by buildExtraHeader, one per lane of the widest sha256dBatch group.
+const int c_merkleBatchSize = 8;
+//! longest job id including the terminator.
+const size_t c_maxJobIdSize = 128;
+
+// Job storage is allocated with the context and reused, a notify does not allocate
+// unless its coinbase is larger than all before.
 struct stratum_job
 {
-    char *job_id;
+    //! empty until the first job.
+    char job_id[c_maxJobIdSize];
     unsigned char prevhash[32];
     size_t coinbase_size;
     unsigned char *coinbase;
+    //! allocated size of (coinbase).
+    size_t coinbase_capacity;
+    //! coinbase tails of a Merkle root batch, c_merkleBatchSize * coinbase_capacity bytes.
+    unsigned char *batch_tails;
     unsigned char *xnonce2;
+    //! SHA-256 state after the whole 64-byte blocks of the coinbase before extranonce2.
+    uint32_t coinbase_midstate[8];
+    size_t coinbase_midstate_size;
+    //! Merkle roots of the next extranonce2 values, [prepared_next, prepared_count) are unused.
+    unsigned char prepared_roots[c_merkleBatchSize][32];
+    int prepared_count;
+    int prepared_next;
     int merkle_count;
-    unsigned char **merkle;
+    unsigned char merkle[lycl::c_maxMerkleBranches][32];
     unsigned char version[4];
     unsigned char nbits[4];
     unsigned char ntime[4];
     bool clean;
     double diff;
+    //! Stratum V2: Merkle root sent with the job, share target and version bits rolled by new work.
+    unsigned char merkle_root[32];
+    uint32_t target[8];
+    uint32_t version_mask;
+    uint32_t version_rolls;
 };
 
 struct stratum_ctx
 {
+    //! index in stratumPools and poolFailover.
+    int pool;
     char *url;
 
     CURL *curl;
     char *curl_url;
     char curl_err_str[CURL_ERROR_SIZE];
     curl_socket_t sock;
-    size_t sockbuf_size;
-    char *sockbuf;
+    lycl::LineBuffer sockbuf;
+    //! Stratum V2 connection(stratum2+tcp://), binary frames on a standard channel instead of lines.
+    bool sv2;
+    lycl::Sv2FrameBuffer sv2buf;
+    lycl::StratumV2Channel sv2channel;
+    //! owned by the stratum thread, other threads only post lines.
+    lycl::StratumIO io;
     pthread_mutex_t sock_lock;
 
     double next_diff;
@@ -56,38 +100,118 @@ struct stratum_ctx
     size_t xnonce1_size;
     unsigned char *xnonce1;
     size_t xnonce2_size;
+    //! leading extranonce2 bytes which are not rolled by local work, reserved for proxied miners.
+    size_t xnonce2_fixed;
     struct stratum_job job;
     struct work work;
     pthread_mutex_t work_lock;
 
     int block_height;
+
+    //! share results of this pool.
+    uint32_t accepted_count;
+    uint32_t rejected_count;
+    //! submitted shares waiting for a response.
+    lycl::ShareTracker shares;
+    //! difficulty suggested to the pool.
+    lycl::DiffController diffControl;
+    //! shares queued for submission, duplicates are dropped.
+    lycl::ShareFilter submitted;
 };
 
-extern stratum_ctx stratum;
+//! one stratum context per configured pool, 0 is the primary pool.
+extern stratum_ctx stratumPools[lycl::PoolFailover::c_maxPools];
+extern lycl::PoolFailover poolFailover;
+//! enabled if hashrate is split across pools(PoolSelect = "split").
+extern lycl::PoolScheduler poolScheduler;
+//! latest job of every pool, staged on devices ahead of job switches.
+extern lycl::JobFeed jobFeed;
+
+//! stratum context of the pool which provides work.
+inline stratum_ctx* stratum_active()
+{
+    return &stratumPools[poolFailover.active()];
+}
+//-----------------------------------------------------------------------------
+//! pool which provides work to worker thread (thr_id).
+inline int stratum_thread_pool(int thr_id)
+{
+    return poolScheduler.isEnabled() ? poolScheduler.assigned(thr_id) : poolFailover.active();
+}
+//-----------------------------------------------------------------------------
+//! work generated from the jobs of (pool). Pools share global::g_work unless hashrate is split.
+inline work* stratum_pool_work(int pool)
+{
+    return poolScheduler.isEnabled() ? &stratumPools[pool].work : &global::g_work;
+}
 
+//-----------------------------------------------------------------------------
+// helper method
+//! result of share (id), (reason) is the pool's error message or NULL.
+inline bool stratumHandleShareResponse(struct stratum_ctx *sctx, uint32_t id, bool valid, const char *reason)
+{
+    // match the response to its share
+    lycl::ShareTracker::share share;
+    double rttMs;
+    if ( !sctx->shares.complete( id, share, rttMs ) )
+    {
+        sctx->shares.addUnmatched();
+        Log::print(Log::LT_Debug, "Pool %d: response to unknown request id %u", sctx->pool, id);
+        return true;
+    }
+    Log::print(Log::LT_Debug, "Share %u (job %s, nonce %08x, diff %g) answered in %.0f ms",
+               share.id, share.jobId.c_str(), share.nonce, share.diff, rttMs);
 
-#define RBUFSIZE 2048
+    // shares of proxied miners are answered downstream, not counted as ours
+    if (stratumProxy.onShareResult(sctx->pool, id, valid, reason))
+        return true;
 
+    share_result(valid, NULL, reason);
+    if (valid)
+        sctx->accepted_count++;
+    else
+        sctx->rejected_count++;
 
+    if (poolScheduler.isEnabled())
+    {
+        double actual, target;
+        poolScheduler.getShare(sctx->pool, actual, target);
+        Log::print(Log::LT_Info, "Pool %d: accepted: %u, rejected: %u, hashes: %.1f%% (weight %.1f%%)",
+                   sctx->pool, sctx->accepted_count, sctx->rejected_count, actual, target);
+    }
+    return true;
+}
 //-----------------------------------------------------------------------------
-// helper method
-inline bool stratumHandleResponse(json_t* val)
+inline bool stratumHandleResponse(struct stratum_ctx *sctx, json_t* val)
 {
-    bool valid = false;
     json_t *err_val, *res_val, *id_val;
     res_val = json_object_get( val, "result" );
     err_val = json_object_get( val, "error" );
     id_val  = json_object_get( val, "id" );
 
-    if ( !res_val || json_integer_value(id_val) < 4 )
+    if ( !res_val || json_integer_value(id_val) < lycl::ShareTracker::c_firstId )
          return false;
-    valid = json_is_true( res_val );
-    share_result(valid, NULL, err_val ?
-                 json_string_value( json_array_get(err_val, 1) ) : NULL );
-    return true;
+
+    return stratumHandleShareResponse( sctx, (uint32_t)json_integer_value(id_val), json_is_true( res_val ),
+                                       err_val ? json_string_value( json_array_get(err_val, 1) ) : NULL );
+}
+//-----------------------------------------------------------------------------
+//! share response parsed by lycl::StratumParser.
+inline bool stratumHandleResponse(struct stratum_ctx *sctx, const lycl::stratumResponse& response)
+{
+    char reason[128];
+    const char *reasonStr = NULL;
+    if (response.hasError && response.reason.size)
+    {
+        const size_t size = std::min(response.reason.size, sizeof(reason) - 1);
+        memcpy(reason, response.reason.str, size);
+        reason[size] = 0;
+        reasonStr = reason;
+    }
+    return stratumHandleShareResponse(sctx, response.id, response.accepted, reasonStr);
 }
 //-----------------------------------------------------------------------------
-inline bool stratum_handle_response( char *buf )
+inline bool stratum_handle_response( struct stratum_ctx *sctx, char *buf )
 {
     json_t *val, *id_val;
     json_error_t err;
@@ -105,7 +229,7 @@ inline bool stratum_handle_response( char *buf )
     if ( !id_val || json_is_null(id_val) )
         goto out;
 
-    if ( !stratumHandleResponse( val ) )
+    if ( !stratumHandleResponse( sctx, val ) )
         goto out;
 
     ret = true;
@@ -115,41 +239,98 @@ out:
     return ret;
 }
 //-----------------------------------------------------------------------------
+//! queues (s) for sending by the stratum thread. Can be called from any thread.
 bool stratum_send_line(struct stratum_ctx *sctx, char *s);
 //-----------------------------------------------------------------------------
-static bool socket_full(curl_socket_t sock, int timeout)
+//! true if received data is buffered and not handled yet.
+inline bool stratum_has_data(struct stratum_ctx *sctx)
 {
-    struct timeval tv;
-    fd_set rd;
-
-    FD_ZERO(&rd);
-    FD_SET(sock, &rd);
-    tv.tv_sec = timeout;
-    tv.tv_usec = 0;
-    if (select((int)(sock + 1), &rd, NULL, NULL, &tv) > 0)
-        return true;
-    return false;
+    return sctx->sv2 ? sctx->sv2buf.hasFrame() : sctx->sockbuf.hasData();
+}
+//-----------------------------------------------------------------------------
+//! sends queued lines and waits up to (timeout_ms) for received data. Stratum thread only.
+inline bool stratum_wait_readable(struct stratum_ctx *sctx, int timeout_ms)
+{
+    return stratum_has_data(sctx) || (sctx->io.wait(timeout_ms) == lycl::IO_Readable);
 }
 //-----------------------------------------------------------------------------
 inline bool stratum_socket_full(struct stratum_ctx *sctx, int timeout)
 {
-    return strlen(sctx->sockbuf) || socket_full(sctx->sock, timeout);
+    return stratum_wait_readable(sctx, timeout * 1000);
 }
 //-----------------------------------------------------------------------------
+//! returns a received line, valid until the next call. NULL on failure.
 char *stratum_recv_line(struct stratum_ctx *sctx);
 //-----------------------------------------------------------------------------
 bool stratum_connect(struct stratum_ctx *sctx, const char *url);
 //-----------------------------------------------------------------------------
+//! Stratum V2: set up the connection and open a standard channel for (user).
+bool stratumV2Setup(struct stratum_ctx *sctx, const char *user);
+//-----------------------------------------------------------------------------
+//! Stratum V2: returns a received frame in (out_frame), valid until the next call. false on failure.
+bool stratumV2RecvFrame(struct stratum_ctx *sctx, lycl::sv2Frame &out_frame);
+//-----------------------------------------------------------------------------
+//! Stratum V2: handle a frame received by the stratum thread. false if the connection must be dropped.
+bool stratumV2HandleFrame(struct stratum_ctx *sctx, const lycl::sv2Frame &frame);
+//-----------------------------------------------------------------------------
+//! Stratum V2: queue SubmitSharesStandard of (work_info) with sequence number (id). Can be called from any thread.
+bool stratumV2Submit(struct stratum_ctx *sctx, const work *work_info, uint32_t id);
+//-----------------------------------------------------------------------------
+//! send a share of a proxied miner to (pool), see lycl::StratumProxy.
+bool stratumProxySubmit(int pool, const char *job_id, const char *xnonce2, const char *ntime, const char *nonce,
+                        double diff, uint32_t &out_id);
+//-----------------------------------------------------------------------------
+//! ask the pool for share difficulty (diff) at (hashrate) H/s. Responses(id 4) are ignored, pools answer with set_difficulty.
+bool stratumSuggestDifficulty(struct stratum_ctx *sctx, double diff, double hashrate);
+//-----------------------------------------------------------------------------
 inline void stratum_disconnect(struct stratum_ctx *sctx)
 {
     pthread_mutex_lock(&sctx->sock_lock);
     if (sctx->curl)
     {
+        sctx->io.close();
         curl_easy_cleanup(sctx->curl);
         sctx->curl = NULL;
-        sctx->sockbuf[0] = '\0';
+        sctx->sockbuf.clear();
+        sctx->sv2buf.clear();
     }
     pthread_mutex_unlock(&sctx->sock_lock);
+
+    // responses to shares in flight will not arrive
+    std::vector<lycl::ShareTracker::share> lost;
+    sctx->shares.expire(true, lost);
+    if (!lost.empty())
+        Log::print(Log::LT_Warning, "Pool %d: %u shares lost with the connection", sctx->pool, (uint32_t)lost.size());
+}
+//-----------------------------------------------------------------------------
+//! drop shares without a response after lycl::ShareTracker::c_timeoutMs.
+inline void stratum_expire_shares(struct stratum_ctx *sctx)
+{
+    std::vector<lycl::ShareTracker::share> expired;
+    sctx->shares.expire(false, expired);
+    for (size_t i = 0; i < expired.size(); ++i)
+    {
+        const lycl::ShareTracker::share& share = expired[i];
+        Log::print(Log::LT_Warning, "Pool %d: share %u (job %s, nonce %08x) timed out",
+                   sctx->pool, share.id, share.jobId.c_str(), share.nonce);
+    }
+}
+//-----------------------------------------------------------------------------
+//! log share round trip times of all pools. (histogram) adds the full distribution.
+inline void stratum_share_report(bool histogram)
+{
+    for (int i = 0; i < poolFailover.numPools(); ++i)
+    {
+        stratum_ctx *sctx = &stratumPools[i];
+        Log::print(Log::LT_Info, "Pool %d shares: %s, %u duplicates dropped", i, sctx->shares.summary().c_str(),
+                   sctx->submitted.duplicates());
+        if (histogram)
+        {
+            const std::string text = sctx->shares.histogram();
+            if (!text.empty())
+                Log::print(Log::LT_Info, "Pool %d share rtt histogram:\n%s", i, text.c_str());
+        }
+    }
 }
 //-----------------------------------------------------------------------------
 bool stratum_parse_extranonce(struct stratum_ctx *sctx, json_t *params, int pndx);
@@ -188,101 +369,146 @@ static uint32_t getBlockHeight(struct stratum_ctx *sctx)
     return height;
 }
 //-----------------------------------------------------------------------------
-static bool stratum_notify(struct stratum_ctx *sctx, json_t *params)
+//! decode (notify) into the job storage. All fields are checked before the job is changed.
+static bool stratumApplyNotify(struct stratum_ctx *sctx, const lycl::stratumNotify &notify)
 {
-    const char *job_id, *prevhash, *coinb1, *coinb2, *version, *nbits, *stime;
-    size_t coinb1_size, coinb2_size;
-    bool clean, ret = false;
-    int merkle_count, i, p = 0;
-    json_t *merkle_arr;
-    unsigned char **merkle = NULL;
-
-
-    job_id = json_string_value(json_array_get(params, p++));
-    prevhash = json_string_value(json_array_get(params, p++));
-    coinb1 = json_string_value(json_array_get(params, p++));
-    coinb2 = json_string_value(json_array_get(params, p++));
-    merkle_arr = json_array_get(params, p++);
-    if (!merkle_arr || !json_is_array(merkle_arr))
-    goto out;
-    merkle_count = (int) json_array_size(merkle_arr);
-    version = json_string_value(json_array_get(params, p++));
-    nbits = json_string_value(json_array_get(params, p++));
-    stime = json_string_value(json_array_get(params, p++));
-    clean = json_is_true(json_array_get(params, p)); p++;
-
-    if (!job_id || !prevhash || !coinb1 || !coinb2 || !version || !nbits || !stime ||
-        strlen(prevhash) != 64 || strlen(version) != 8 ||
-        strlen(nbits) != 8 || strlen(stime) != 8)
+    size_t coinb1_size, coinb2_size, coinbase_size;
+    int i;
+
+    if (!notify.jobId.size || notify.jobId.size >= c_maxJobIdSize ||
+        !lycl::StratumParser::isHex(notify.prevhash, 64) || !lycl::StratumParser::isHex(notify.version, 8) ||
+        !lycl::StratumParser::isHex(notify.nbits, 8) || !lycl::StratumParser::isHex(notify.ntime, 8) ||
+        (notify.coinb1.size & 1) || !lycl::StratumParser::isHex(notify.coinb1, notify.coinb1.size) ||
+        (notify.coinb2.size & 1) || !lycl::StratumParser::isHex(notify.coinb2, notify.coinb2.size))
     {
         Log::print(Log::LT_Error, "Stratum notify: invalid parameters");
-        goto out;
+        return false;
     }
-
-    merkle = (unsigned char**) malloc(merkle_count * sizeof(char *));
-    for (i = 0; i < merkle_count; i++)
+    for (i = 0; i < notify.merkleCount; i++)
     {
-        const char *s = json_string_value(json_array_get(merkle_arr, i));
-        if (!s || strlen(s) != 64)
+        if (!lycl::StratumParser::isHex(notify.merkle[i], 64))
         {
-            while (i--)
-                free(merkle[i]);
-            free(merkle);
             Log::print(Log::LT_Error, "Stratum notify: invalid Merkle branch");
-            goto out;
+            return false;
         }
-        merkle[i] = (unsigned char*) malloc(32);
-        hex2bin(merkle[i], s, 32);
     }
 
     pthread_mutex_lock(&sctx->work_lock);
 
-    coinb1_size = strlen(coinb1) / 2;
-    coinb2_size = strlen(coinb2) / 2;
-    sctx->job.coinbase_size = coinb1_size + sctx->xnonce1_size +
-              sctx->xnonce2_size + coinb2_size;
-    sctx->job.coinbase = (unsigned char*) realloc(sctx->job.coinbase, sctx->job.coinbase_size);
+    coinb1_size = notify.coinb1.size / 2;
+    coinb2_size = notify.coinb2.size / 2;
+    coinbase_size = coinb1_size + sctx->xnonce1_size + sctx->xnonce2_size + coinb2_size;
+    // grow only, the same storage serves all later jobs
+    if (coinbase_size > sctx->job.coinbase_capacity)
+    {
+        unsigned char *coinbase = (unsigned char*) realloc(sctx->job.coinbase, coinbase_size);
+        if (coinbase)
+            sctx->job.coinbase = coinbase;
+        unsigned char *tails = (unsigned char*) realloc(sctx->job.batch_tails, coinbase_size * c_merkleBatchSize);
+        if (tails)
+            sctx->job.batch_tails = tails;
+        if (!coinbase || !tails)
+        {
+            pthread_mutex_unlock(&sctx->work_lock);
+            Log::print(Log::LT_Error, "Stratum notify: out of memory");
+            return false;
+        }
+        sctx->job.coinbase_capacity = coinbase_size;
+    }
+    sctx->job.coinbase_size = coinbase_size;
     sctx->job.xnonce2 = sctx->job.coinbase + coinb1_size + sctx->xnonce1_size;
-    hex2bin(sctx->job.coinbase, coinb1, coinb1_size);
+    hex2bin(sctx->job.coinbase, notify.coinb1.str, coinb1_size);
     memcpy(sctx->job.coinbase + coinb1_size, sctx->xnonce1, sctx->xnonce1_size);
+    // coinb1 and xnonce1 do not change within a job, only the blocks from extranonce2 on are hashed per work
+    sctx->job.coinbase_midstate_size = ((coinb1_size + sctx->xnonce1_size) / 64) * 64;
+    sha256_midstate(sctx->job.coinbase_midstate, sctx->job.coinbase, sctx->job.coinbase_midstate_size / 64);
+    sctx->job.prepared_count = 0;
+    sctx->job.prepared_next = 0;
 
-    if (!sctx->job.job_id || strcmp(sctx->job.job_id, job_id))
+    if (strlen(sctx->job.job_id) != notify.jobId.size || memcmp(sctx->job.job_id, notify.jobId.str, notify.jobId.size))
         memset(sctx->job.xnonce2, 0, sctx->xnonce2_size);
 
-    hex2bin(sctx->job.xnonce2 + sctx->xnonce2_size, coinb2, coinb2_size);
-    free(sctx->job.job_id);
-    sctx->job.job_id = strdup(job_id);
-    hex2bin(sctx->job.prevhash, prevhash, 32);
+    hex2bin(sctx->job.xnonce2 + sctx->xnonce2_size, notify.coinb2.str, coinb2_size);
+    memcpy(sctx->job.job_id, notify.jobId.str, notify.jobId.size);
+    sctx->job.job_id[notify.jobId.size] = 0;
+    hex2bin(sctx->job.prevhash, notify.prevhash.str, 32);
 
     sctx->block_height = getBlockHeight(sctx);
 
-    for (i = 0; i < sctx->job.merkle_count; i++)
-        free(sctx->job.merkle[i]);
-
-    free(sctx->job.merkle);
-    sctx->job.merkle = merkle;
-    sctx->job.merkle_count = merkle_count;
+    for (i = 0; i < notify.merkleCount; i++)
+        hex2bin(sctx->job.merkle[i], notify.merkle[i].str, 32);
+    sctx->job.merkle_count = notify.merkleCount;
 
-    hex2bin(sctx->job.version, version, 4);
-    hex2bin(sctx->job.nbits, nbits, 4);
-    hex2bin(sctx->job.ntime, stime, 4);
-    sctx->job.clean = clean;
+    hex2bin(sctx->job.version, notify.version.str, 4);
+    hex2bin(sctx->job.nbits, notify.nbits.str, 4);
+    hex2bin(sctx->job.ntime, notify.ntime.str, 4);
+    sctx->job.clean = notify.clean;
 
     sctx->job.diff = sctx->next_diff;
 
     pthread_mutex_unlock(&sctx->work_lock);
 
-    ret = true;
+    if (stratumProxy.isActive())
+        stratumProxy.onNotify(sctx->pool, notify);
 
-out:
-    return ret;
+    return true;
 }
 //-----------------------------------------------------------------------------
-static bool stratum_set_difficulty(struct stratum_ctx *sctx, json_t *params)
+//! span of a JSON string, false if (val) is not a string.
+static bool json_string_span(json_t *val, lycl::jsonSpan &out)
 {
-    double diff;
+    const char *s = json_string_value(val);
+    if (!s)
+        return false;
+    out.str = s;
+    out.size = strlen(s);
+    return true;
+}
+//-----------------------------------------------------------------------------
+//! jansson path of notify, used for messages lycl::StratumParser leaves out.
+static bool stratum_notify(struct stratum_ctx *sctx, json_t *params)
+{
+    lycl::stratumNotify notify;
+    json_t *merkle_arr;
+    int i, p = 0;
+
+    bool valid = json_string_span(json_array_get(params, p++), notify.jobId);
+    valid = json_string_span(json_array_get(params, p++), notify.prevhash) && valid;
+    valid = json_string_span(json_array_get(params, p++), notify.coinb1) && valid;
+    valid = json_string_span(json_array_get(params, p++), notify.coinb2) && valid;
+    merkle_arr = json_array_get(params, p++);
+    if (!merkle_arr || !json_is_array(merkle_arr))
+        return false;
+    valid = json_string_span(json_array_get(params, p++), notify.version) && valid;
+    valid = json_string_span(json_array_get(params, p++), notify.nbits) && valid;
+    valid = json_string_span(json_array_get(params, p++), notify.ntime) && valid;
+    notify.clean = json_is_true(json_array_get(params, p)); p++;
+    if (!valid)
+    {
+        Log::print(Log::LT_Error, "Stratum notify: invalid parameters");
+        return false;
+    }
 
-    diff = json_number_value(json_array_get(params, 0));
+    notify.merkleCount = (int) json_array_size(merkle_arr);
+    if (notify.merkleCount > lycl::c_maxMerkleBranches)
+    {
+        Log::print(Log::LT_Error, "Stratum notify: invalid Merkle branch");
+        return false;
+    }
+    for (i = 0; i < notify.merkleCount; i++)
+    {
+        if (!json_string_span(json_array_get(merkle_arr, i), notify.merkle[i]))
+        {
+            Log::print(Log::LT_Error, "Stratum notify: invalid Merkle branch");
+            return false;
+        }
+    }
+
+    return stratumApplyNotify(sctx, notify);
+}
+//-----------------------------------------------------------------------------
+static bool stratumSetDifficulty(struct stratum_ctx *sctx, double diff)
+{
     if (diff == 0)
         return false;
 
@@ -293,11 +519,38 @@ static bool stratum_set_difficulty(struct stratum_ctx *sctx, json_t *params)
     // store for api stats
     stratum_diff = diff;
 
+    if (stratumProxy.isActive())
+        stratumProxy.onDifficulty(sctx->pool, diff);
+
     Log::print(Log::LT_Warning, "Stratum difficulty set to %g", diff);
 
     return true;
 }
 //-----------------------------------------------------------------------------
+static bool stratum_set_difficulty(struct stratum_ctx *sctx, json_t *params)
+{
+    return stratumSetDifficulty(sctx, json_number_value(json_array_get(params, 0)));
+}
+//-----------------------------------------------------------------------------
+//! reconnect to (url) if the options allow it. Takes ownership of (url).
+inline bool stratum_reconnect_to(struct stratum_ctx *sctx, char *url)
+{
+    if (!global::opt_reconnect)
+    {
+        Log::print(Log::LT_Info, "Ignoring request to reconnect to %s", url);
+        free(url);
+        return true;
+    }
+
+    Log::print(Log::LT_Notice, "Server requested reconnection to %s", url);
+
+    free(sctx->url);
+    sctx->url = url;
+    stratum_disconnect(sctx);
+
+    return true;
+}
+//-----------------------------------------------------------------------------
 static bool stratum_reconnect(struct stratum_ctx *sctx, json_t *params)
 {
     json_t *port_val;
@@ -317,20 +570,7 @@ static bool stratum_reconnect(struct stratum_ctx *sctx, json_t *params)
     url = (char*) malloc(32 + strlen(host));
     sprintf(url, "stratum+tcp://%s:%d", host, port);
 
-    if (!global::opt_reconnect)
-    {
-        Log::print(Log::LT_Info, "Ignoring request to reconnect to %s", url);
-        free(url);
-        return true;
-    }
-
-    Log::print(Log::LT_Notice, "Server requested reconnection to %s", url);
-
-    free(sctx->url);
-    sctx->url = url;
-    stratum_disconnect(sctx);
-
-    return true;
+    return stratum_reconnect_to(sctx, url);
 }
 //-----------------------------------------------------------------------------
 static bool json_object_set_error(json_t *result, int code, const char *msg)
@@ -535,7 +775,8 @@ static bool stratum_show_message(struct stratum_ctx *sctx, json_t *id, json_t *p
     return ret;
 }
 //-----------------------------------------------------------------------------
-inline bool stratum_handle_method(struct stratum_ctx *sctx, const char *s)
+//! jansson path of stratum_handle_method.
+inline bool stratumHandleMethodJson(struct stratum_ctx *sctx, const char *s)
 {
     json_t *val, *id, *params;
     json_error_t err;
@@ -619,6 +860,43 @@ out:
     return ret;
 }
 //-----------------------------------------------------------------------------
+//! handle (s) if it is a method call from the pool. Returns false for responses.
+inline bool stratum_handle_method(struct stratum_ctx *sctx, const char *s)
+{
+    lycl::stratumMessage msg;
+    switch (lycl::StratumParser::parse(s, lycl::ShareTracker::c_firstId, msg))
+    {
+        case lycl::SM_Notify:
+            return stratumApplyNotify(sctx, msg.notify);
+        case lycl::SM_SetDifficulty:
+            return stratumSetDifficulty(sctx, msg.difficulty);
+        case lycl::SM_Response:
+            return false;
+        default:
+            return stratumHandleMethodJson(sctx, s);
+    }
+}
+//-----------------------------------------------------------------------------
+//! handle a line received by the stratum thread. Hot messages are parsed once and without jansson.
+inline bool stratum_handle_line(struct stratum_ctx *sctx, char *s)
+{
+    lycl::stratumMessage msg;
+    switch (lycl::StratumParser::parse(s, lycl::ShareTracker::c_firstId, msg))
+    {
+        case lycl::SM_Notify:
+            return stratumApplyNotify(sctx, msg.notify);
+        case lycl::SM_SetDifficulty:
+            return stratumSetDifficulty(sctx, msg.difficulty);
+        case lycl::SM_Response:
+            return stratumHandleResponse(sctx, msg.response);
+        default:
+            break;
+    }
+    if (stratumHandleMethodJson(sctx, s))
+        return true;
+    return stratum_handle_response(sctx, s);
+}
+//-----------------------------------------------------------------------------
 inline bool stratum_authorize(struct stratum_ctx *sctx, const char *user, const char *pass)
 {
     json_t *val = NULL, *res_val, *err_val;
@@ -639,12 +917,9 @@ inline bool stratum_authorize(struct stratum_ctx *sctx, const char *user, const
             goto out;
         if (!stratum_handle_method(sctx, sret))
             break;
-        free(sret);
     }
 
     val = json_loads(sret, 0, &err);
-
-    free(sret);
     if (!val)
     {
         Log::print(Log::LT_Error, "JSON decode failed(%d): %s", err.line, err.text);
@@ -671,7 +946,7 @@ inline bool stratum_authorize(struct stratum_ctx *sctx, const char *user, const
     if (!stratum_send_line(sctx, s))
         goto out;
 
-    if (!socket_full(sctx->sock, 3))
+    if (!stratum_wait_readable(sctx, 3000))
     {
         if (global::opt_debug)
             Log::print(Log::LT_Debug, "stratum extranonce subscribe timed out");
@@ -700,7 +975,6 @@ inline bool stratum_authorize(struct stratum_ctx *sctx, const char *user, const
 //              applog(LOG_DEBUG, "extranonce subscribe not supported");
             json_decref(extra);
         }
-        free(sret);
     }
 
 out:
@@ -0,0 +1,459 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef StratumIO_INCLUDE_ONCE
+#define StratumIO_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cerrno>
+#include <string>
+#include <deque>
+#include <chrono>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h> // TCP_NODELAY
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#include <curl/curl.h> // curl_socket_t
+
+// Stratum socket I/O loop.
+//
+// The stratum thread owns the socket: it is the only thread which sends, receives and waits on it.
+// Other threads(workio submits) only queue lines with post() and wake the stratum thread up.
+// Queued lines are written with non-blocking sends. When the kernel buffer is full, the rest stays
+// in the outbound queue and is sent when the socket becomes writable, instead of being dropped.
+//
+// Linux uses epoll with an eventfd for wake ups. Other POSIX systems use select with a wake up pipe.
+// Windows uses select in short slices, so queued lines wait at most c_pollSliceMs.
+
+namespace lycl
+{
+    typedef enum
+    {
+        IO_Readable,
+        IO_Timeout,
+        IO_Error
+    } EIOStatus;
+
+    //-----------------------------------------------------------------------------
+    // StratumIO class declaration.
+    //-----------------------------------------------------------------------------
+    class StratumIO
+    {
+    public:
+#ifdef _WIN32
+        //! longest wait between outbound queue checks, without a wake up signal.
+        static const int c_pollSliceMs = 5;
+#endif
+
+        inline StratumIO();
+        inline ~StratumIO();
+
+        //! take over a connected (sock). Enables TCP_NODELAY and non-blocking mode.
+        inline bool open(curl_socket_t sock);
+        //! stop using the socket and drop unsent lines. The socket itself is closed by curl.
+        inline void close();
+        bool isOpen() const { return m_open; }
+        //! queue a line(without '\n') for sending. Can be called from any thread.
+        inline bool post(const char* line);
+        //! queue raw bytes(a binary frame) for sending. Can be called from any thread.
+        inline bool postData(const void* data, size_t size);
+        //! send queued lines and wait up to (timeout_ms) for incoming data. Stratum thread only.
+        inline EIOStatus wait(int timeout_ms);
+        //! non-blocking receive. Returns the number of bytes received, 0 if nothing is available,
+        //! -1 on error or if the connection was closed. Stratum thread only.
+        inline ssize_t receive(char* buffer, size_t size);
+        //! smoothed round trip time measured by the kernel in milliseconds, negative if not available.
+        inline double rttMs() const;
+        //! milliseconds on a monotonic clock.
+        static inline uint64_t nowMs();
+
+    private:
+        StratumIO(const StratumIO&);
+        StratumIO& operator=(const StratumIO&);
+
+        //! send as much as possible without blocking. false on a socket error.
+        inline bool flush();
+        inline bool hasPending() const { return m_sent < m_sending.size(); }
+        //! wake up the stratum thread. Must be called under m_queueLock.
+        inline void wake();
+        inline void drainWake();
+        static inline bool socketBlocks();
+
+        pthread_mutex_t m_queueLock;
+        //! lines posted by other threads, guarded by m_queueLock.
+        std::deque<std::string> m_queue;
+        //! lines taken from the queue and not fully sent yet, stratum thread only.
+        std::string m_sending;
+        size_t m_sent;
+        curl_socket_t m_sock;
+        volatile bool m_open;
+#ifdef __linux__
+        int m_epoll;
+        int m_wakeFd;
+        bool m_writeInterest;
+#elif !defined(_WIN32)
+        int m_wakePipe[2];
+#endif
+    };
+    //-----------------------------------------------------------------------------
+    // StratumIO class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline StratumIO::StratumIO()
+        : m_sent(0)
+        , m_sock(CURL_SOCKET_BAD)
+        , m_open(false)
+#ifdef __linux__
+        , m_epoll(-1)
+        , m_wakeFd(-1)
+        , m_writeInterest(false)
+#endif
+    {
+        pthread_mutex_init(&m_queueLock, NULL);
+#if !defined(__linux__) && !defined(_WIN32)
+        m_wakePipe[0] = m_wakePipe[1] = -1;
+#endif
+    }
+    //-----------------------------------------------------------------------------
+    inline StratumIO::~StratumIO()
+    {
+        close();
+#ifdef __linux__
+        if (m_wakeFd >= 0)
+            ::close(m_wakeFd);
+#elif !defined(_WIN32)
+        if (m_wakePipe[0] >= 0)
+        {
+            ::close(m_wakePipe[0]);
+            ::close(m_wakePipe[1]);
+        }
+#endif
+        pthread_mutex_destroy(&m_queueLock);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool StratumIO::open(curl_socket_t sock)
+    {
+        close();
+
+        // submits must not wait for more data to fill a segment.
+        int nodelay = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(nodelay));
+#ifdef _WIN32
+        u_long nonBlocking = 1;
+        if (ioctlsocket(sock, FIONBIO, &nonBlocking))
+            return false;
+#else
+        const int flags = fcntl(sock, F_GETFL, 0);
+        if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0)
+            return false;
+#endif
+
+#ifdef __linux__
+        if (m_wakeFd < 0)
+        {
+            m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (m_wakeFd < 0)
+                return false;
+        }
+        m_epoll = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll < 0)
+            return false;
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = m_wakeFd;
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeFd, &ev);
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = sock;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, sock, &ev))
+        {
+            ::close(m_epoll);
+            m_epoll = -1;
+            return false;
+        }
+        m_writeInterest = false;
+#elif !defined(_WIN32)
+        if (m_wakePipe[0] < 0)
+        {
+            if (pipe(m_wakePipe))
+            {
+                m_wakePipe[0] = m_wakePipe[1] = -1;
+                return false;
+            }
+            fcntl(m_wakePipe[0], F_SETFL, fcntl(m_wakePipe[0], F_GETFL, 0) | O_NONBLOCK);
+            fcntl(m_wakePipe[1], F_SETFL, fcntl(m_wakePipe[1], F_GETFL, 0) | O_NONBLOCK);
+        }
+#endif
+        drainWake();
+
+        pthread_mutex_lock(&m_queueLock);
+        m_sock = sock;
+        m_open = true;
+        pthread_mutex_unlock(&m_queueLock);
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumIO::close()
+    {
+        pthread_mutex_lock(&m_queueLock);
+        m_open = false;
+        m_queue.clear();
+        m_sock = CURL_SOCKET_BAD;
+        pthread_mutex_unlock(&m_queueLock);
+
+        m_sending.clear();
+        m_sent = 0;
+#ifdef __linux__
+        if (m_epoll >= 0)
+        {
+            ::close(m_epoll);
+            m_epoll = -1;
+        }
+#endif
+    }
+    //-----------------------------------------------------------------------------
+    inline bool StratumIO::post(const char* line)
+    {
+        pthread_mutex_lock(&m_queueLock);
+        const bool open = m_open;
+        if (open)
+        {
+            m_queue.push_back(line);
+            m_queue.back() += '\n';
+            wake();
+        }
+        pthread_mutex_unlock(&m_queueLock);
+        return open;
+    }
+    //-----------------------------------------------------------------------------
+    inline bool StratumIO::postData(const void* data, size_t size)
+    {
+        pthread_mutex_lock(&m_queueLock);
+        const bool open = m_open;
+        if (open)
+        {
+            m_queue.push_back(std::string((const char*)data, size));
+            wake();
+        }
+        pthread_mutex_unlock(&m_queueLock);
+        return open;
+    }
+    //-----------------------------------------------------------------------------
+    inline EIOStatus StratumIO::wait(int timeout_ms)
+    {
+        if (!m_open)
+            return IO_Error;
+
+        const uint64_t deadline = nowMs() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0);
+        while (1)
+        {
+            if (!flush())
+                return IO_Error;
+
+            const uint64_t now = nowMs();
+            int remaining = (now < deadline) ? (int)(deadline - now) : 0;
+#ifdef __linux__
+            epoll_event events[2];
+            const int n = epoll_wait(m_epoll, events, 2, remaining);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return IO_Error;
+            }
+
+            bool readable = false;
+            for (int i = 0; i < n; ++i)
+            {
+                if (events[i].data.fd == m_wakeFd)
+                    drainWake();
+                else if (events[i].events & EPOLLERR)
+                    return IO_Error;
+                else if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))
+                    readable = true;
+                // EPOLLOUT: the rest of m_sending is sent by flush()
+            }
+#else
+#ifdef _WIN32
+            if (remaining > c_pollSliceMs)
+                remaining = c_pollSliceMs;
+#endif
+            fd_set rd, wr;
+            FD_ZERO(&rd);
+            FD_ZERO(&wr);
+            FD_SET(m_sock, &rd);
+            int maxFd = (int)m_sock;
+#ifndef _WIN32
+            FD_SET(m_wakePipe[0], &rd);
+            if (m_wakePipe[0] > maxFd)
+                maxFd = m_wakePipe[0];
+#endif
+            if (hasPending())
+                FD_SET(m_sock, &wr);
+            struct timeval tv;
+            tv.tv_sec = remaining / 1000;
+            tv.tv_usec = (remaining % 1000) * 1000;
+            const int n = select(maxFd + 1, &rd, &wr, NULL, &tv);
+            if (n < 0)
+            {
+#ifndef _WIN32
+                if (errno == EINTR)
+                    continue;
+#endif
+                return IO_Error;
+            }
+#ifndef _WIN32
+            if (FD_ISSET(m_wakePipe[0], &rd))
+                drainWake();
+#endif
+            const bool readable = (n > 0) && FD_ISSET(m_sock, &rd);
+#endif
+            if (readable)
+                return flush() ? IO_Readable : IO_Error;
+            if (nowMs() >= deadline)
+                return IO_Timeout;
+        }
+    }
+    //-----------------------------------------------------------------------------
+    inline ssize_t StratumIO::receive(char* buffer, size_t size)
+    {
+        const ssize_t n = recv(m_sock, buffer, (int)size, 0);
+        if (n > 0)
+            return n;
+        if (n < 0 && socketBlocks())
+            return 0;
+        // closed by the pool or failed
+        return -1;
+    }
+    //-----------------------------------------------------------------------------
+    inline double StratumIO::rttMs() const
+    {
+#ifdef __linux__
+        struct tcp_info info;
+        socklen_t size = sizeof(info);
+        if (m_open && !getsockopt(m_sock, IPPROTO_TCP, TCP_INFO, &info, &size) && info.tcpi_rtt)
+            return info.tcpi_rtt / 1000.0;
+#endif
+        return -1.0;
+    }
+    //-----------------------------------------------------------------------------
+    inline uint64_t StratumIO::nowMs()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    //-----------------------------------------------------------------------------
+    inline bool StratumIO::flush()
+    {
+        while (1)
+        {
+            if (!hasPending())
+            {
+                m_sending.clear();
+                m_sent = 0;
+                // take all queued lines at once, they go out in as few segments as possible.
+                pthread_mutex_lock(&m_queueLock);
+                while (!m_queue.empty())
+                {
+                    m_sending += m_queue.front();
+                    m_queue.pop_front();
+                }
+                pthread_mutex_unlock(&m_queueLock);
+
+                if (m_sending.empty())
+                    break;
+            }
+
+#ifdef MSG_NOSIGNAL
+            const int sendFlags = MSG_NOSIGNAL;
+#else
+            const int sendFlags = 0;
+#endif
+            const ssize_t n = send(m_sock, m_sending.data() + m_sent, (int)(m_sending.size() - m_sent), sendFlags);
+            if (n < 0)
+            {
+                if (!socketBlocks())
+                    return false;
+                // kernel buffer is full, continue when the socket is writable.
+                break;
+            }
+            m_sent += (size_t)n;
+        }
+
+#ifdef __linux__
+        const bool writeInterest = hasPending();
+        if (writeInterest != m_writeInterest)
+        {
+            epoll_event ev;
+            ev.events = EPOLLIN | EPOLLRDHUP | (writeInterest ? (uint32_t)EPOLLOUT : 0u);
+            ev.data.fd = m_sock;
+            if (epoll_ctl(m_epoll, EPOLL_CTL_MOD, m_sock, &ev))
+                return false;
+            m_writeInterest = writeInterest;
+        }
+#endif
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumIO::wake()
+    {
+#ifdef __linux__
+        const uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0)
+        {
+            // counter is already signaled
+        }
+#elif !defined(_WIN32)
+        const char one = 1;
+        if (write(m_wakePipe[1], &one, 1) < 0)
+        {
+            // pipe is full, already signaled
+        }
+#endif
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumIO::drainWake()
+    {
+#ifdef __linux__
+        uint64_t value;
+        if (read(m_wakeFd, &value, sizeof(value)) < 0)
+        {
+            // not signaled
+        }
+#elif !defined(_WIN32)
+        char buf[64];
+        while (read(m_wakePipe[0], buf, sizeof(buf)) > 0)
+        {
+        }
+#endif
+    }
+    //-----------------------------------------------------------------------------
+    inline bool StratumIO::socketBlocks()
+    {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+    }
+}
+
+#endif // !StratumIO_INCLUDE_ONCE
@@ -0,0 +1,395 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef StratumParser_INCLUDE_ONCE
+#define StratumParser_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+
+// In place parser of the stratum messages received most often: mining.notify, mining.set_difficulty
+// and responses to submitted shares.
+//
+// The line is scanned once and string values are returned as spans into the line, nothing is allocated
+// or copied. Only JSON which these messages use in practice is handled: strings with escapes, unexpected
+// types or a notify with more than c_maxMerkleBranches branches are left to jansson(SM_Other).
+
+namespace lycl
+{
+    //! Merkle branches of a job, 2^32 transactions.
+    const int c_maxMerkleBranches = 32;
+
+    //! string value inside a line, not terminated.
+    struct jsonSpan
+    {
+        const char* str;
+        size_t size;
+    };
+
+    typedef enum
+    {
+        //! not a hot message, or not handled by the parser.
+        SM_Other = 0,
+        SM_Notify,
+        SM_SetDifficulty,
+        //! response to a request with id >= (min_response_id).
+        SM_Response
+    } EStratumMessage;
+
+    struct stratumNotify
+    {
+        jsonSpan jobId;
+        jsonSpan prevhash;
+        jsonSpan coinb1;
+        jsonSpan coinb2;
+        jsonSpan merkle[c_maxMerkleBranches];
+        int merkleCount;
+        jsonSpan version;
+        jsonSpan nbits;
+        jsonSpan ntime;
+        bool clean;
+    };
+
+    struct stratumResponse
+    {
+        uint32_t id;
+        //! result is true.
+        bool accepted;
+        //! error is not null.
+        bool hasError;
+        //! second element of the error array, empty if missing.
+        jsonSpan reason;
+    };
+
+    struct stratumMessage
+    {
+        stratumNotify notify;
+        double difficulty;
+        stratumResponse response;
+    };
+
+    //-----------------------------------------------------------------------------
+    // StratumParser class declaration.
+    //-----------------------------------------------------------------------------
+    class StratumParser
+    {
+    public:
+        //! parse (line) into (out). Responses with an id below (min_response_id) are SM_Other.
+        static inline EStratumMessage parse(const char* line, uint32_t min_response_id, stratumMessage& out);
+        //! true if (span) holds exactly (size) hex digits.
+        static inline bool isHex(const jsonSpan& span, size_t size);
+
+    private:
+        static inline const char* skipSpace(const char* p);
+        //! string without escapes. Returns the position after the closing quote, NULL otherwise.
+        static inline const char* parseString(const char* p, jsonSpan& out);
+        //! any value. Returns the position after it, NULL on malformed input.
+        static inline const char* skipValue(const char* p);
+        static inline const char* skipString(const char* p);
+        static inline bool equals(const jsonSpan& span, const char* literal);
+        static inline const char* parseNotifyParams(const char* p, stratumNotify& out);
+        static inline const char* parseErrorReason(const char* p, jsonSpan& out);
+    };
+    //-----------------------------------------------------------------------------
+    // StratumParser class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline const char* StratumParser::skipSpace(const char* p)
+    {
+        while ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n'))
+            ++p;
+        return p;
+    }
+    //-----------------------------------------------------------------------------
+    inline const char* StratumParser::parseString(const char* p, jsonSpan& out)
+    {
+        if (*p != '"')
+            return NULL;
+        const char* begin = ++p;
+        while (*p && (*p != '"'))
+        {
+            if (*p == '\\')
+                return NULL;
+            ++p;
+        }
+        if (!*p)
+            return NULL;
+        out.str = begin;
+        out.size = (size_t)(p - begin);
+        return p + 1;
+    }
+    //-----------------------------------------------------------------------------
+    inline const char* StratumParser::skipString(const char* p)
+    {
+        // (p) is at the opening quote
+        for (++p; *p && (*p != '"'); ++p)
+        {
+            if ((*p == '\\') && !*(++p))
+                return NULL;
+        }
+        return *p ? (p + 1) : NULL;
+    }
+    //-----------------------------------------------------------------------------
+    inline const char* StratumParser::skipValue(const char* p)
+    {
+        p = skipSpace(p);
+        if (*p == '"')
+            return skipString(p);
+
+        if ((*p == '[') || (*p == '{'))
+        {
+            int depth = 0;
+            do
+            {
+                if (*p == '"')
+                {
+                    p = skipString(p);
+                    if (!p)
+                        return NULL;
+                    continue;
+                }
+                if ((*p == '[') || (*p == '{'))
+                    ++depth;
+                else if ((*p == ']') || (*p == '}'))
+                    --depth;
+                else if (!*p)
+                    return NULL;
+                ++p;
+            } while (depth > 0);
+            return p;
+        }
+
+        // number, true, false, null
+        const char* begin = p;
+        while (*p && (*p != ',') && (*p != ']') && (*p != '}') && (*p != ' ') && (*p != '\t') && (*p != '\r') && (*p != '\n'))
+            ++p;
+        return (p != begin) ? p : NULL;
+    }
+    //-----------------------------------------------------------------------------
+    inline bool StratumParser::equals(const jsonSpan& span, const char* literal)
+    {
+        const size_t size = strlen(literal);
+        return (span.size == size) && !memcmp(span.str, literal, size);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool StratumParser::isHex(const jsonSpan& span, size_t size)
+    {
+        if (span.size != size)
+            return false;
+        for (size_t i = 0; i < size; ++i)
+        {
+            const char c = span.str[i];
+            if (!(((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'f')) || ((c >= 'A') && (c <= 'F'))))
+                return false;
+        }
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline const char* StratumParser::parseNotifyParams(const char* p, stratumNotify& out)
+    {
+        // [job_id, prevhash, coinb1, coinb2, [merkle...], version, nbits, ntime, clean]
+        jsonSpan* before[4] = { &out.jobId, &out.prevhash, &out.coinb1, &out.coinb2 };
+        jsonSpan* after[3] = { &out.version, &out.nbits, &out.ntime };
+
+        p = skipSpace(p);
+        if (*p++ != '[')
+            return NULL;
+        for (int i = 0; i < 4; ++i)
+        {
+            p = parseString(skipSpace(p), *before[i]);
+            if (!p)
+                return NULL;
+            p = skipSpace(p);
+            if (*p++ != ',')
+                return NULL;
+        }
+
+        p = skipSpace(p);
+        if (*p++ != '[')
+            return NULL;
+        out.merkleCount = 0;
+        p = skipSpace(p);
+        if (*p == ']')
+            ++p;
+        else
+        {
+            for (;;)
+            {
+                if (out.merkleCount >= c_maxMerkleBranches)
+                    return NULL;
+                p = parseString(skipSpace(p), out.merkle[out.merkleCount++]);
+                if (!p)
+                    return NULL;
+                p = skipSpace(p);
+                if (*p == ']')
+                {
+                    ++p;
+                    break;
+                }
+                if (*p++ != ',')
+                    return NULL;
+            }
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            p = skipSpace(p);
+            if (*p++ != ',')
+                return NULL;
+            p = parseString(skipSpace(p), *after[i]);
+            if (!p)
+                return NULL;
+        }
+
+        p = skipSpace(p);
+        if (*p++ != ',')
+            return NULL;
+        p = skipSpace(p);
+        if (!strncmp(p, "true", 4))
+            out.clean = true;
+        else if (!strncmp(p, "false", 5))
+            out.clean = false;
+        else
+            return NULL;
+
+        // extra parameters are ignored, like jansson based parsing does
+        p = skipSpace(p + (out.clean ? 4 : 5));
+        while (*p == ',')
+        {
+            p = skipValue(p + 1);
+            if (!p)
+                return NULL;
+            p = skipSpace(p);
+        }
+        return (*p == ']') ? (p + 1) : NULL;
+    }
+    //-----------------------------------------------------------------------------
+    inline const char* StratumParser::parseErrorReason(const char* p, jsonSpan& out)
+    {
+        // [code, "reason", traceback]
+        out.str = p;
+        out.size = 0;
+        if (*p != '[')
+            return skipValue(p);
+
+        const char* end = skipValue(p);
+        if (!end)
+            return NULL;
+        p = skipValue(p + 1);
+        if (!p)
+            return NULL;
+        p = skipSpace(p);
+        if (*p == ',')
+        {
+            jsonSpan reason;
+            if (parseString(skipSpace(p + 1), reason))
+                out = reason;
+        }
+        return end;
+    }
+    //-----------------------------------------------------------------------------
+    inline EStratumMessage StratumParser::parse(const char* line, uint32_t min_response_id, stratumMessage& out)
+    {
+        jsonSpan method = { NULL, 0 };
+        const char* params = NULL;
+        bool hasId = false;
+        bool hasResult = false;
+        bool otherResult = false;
+        out.response.id = 0;
+        out.response.accepted = false;
+        out.response.hasError = false;
+        out.response.reason.str = line;
+        out.response.reason.size = 0;
+
+        const char* p = skipSpace(line);
+        if (*p++ != '{')
+            return SM_Other;
+        p = skipSpace(p);
+        if (*p == '}')
+            return SM_Other;
+
+        for (;;)
+        {
+            jsonSpan key;
+            p = parseString(skipSpace(p), key);
+            if (!p)
+                return SM_Other;
+            p = skipSpace(p);
+            if (*p++ != ':')
+                return SM_Other;
+            p = skipSpace(p);
+
+            if (equals(key, "method") && (*p == '"'))
+                p = parseString(p, method);
+            else if (equals(key, "params"))
+            {
+                params = p;
+                p = skipValue(p);
+            }
+            else if (equals(key, "id") && (*p >= '0') && (*p <= '9'))
+            {
+                char* end;
+                const unsigned long id = strtoul(p, &end, 10);
+                hasId = (id <= 0xFFFFFFFFUL) && (*end != '.') && (*end != 'e') && (*end != 'E');
+                out.response.id = (uint32_t)id;
+                p = end;
+            }
+            else if (equals(key, "result"))
+            {
+                hasResult = true;
+                out.response.accepted = !strncmp(p, "true", 4);
+                otherResult = !out.response.accepted && strncmp(p, "false", 5) && strncmp(p, "null", 4);
+                p = skipValue(p);
+            }
+            else if (equals(key, "error"))
+            {
+                out.response.hasError = strncmp(p, "null", 4) != 0;
+                p = parseErrorReason(p, out.response.reason);
+            }
+            else
+                p = skipValue(p);
+
+            if (!p)
+                return SM_Other;
+            p = skipSpace(p);
+            if (*p == '}')
+                break;
+            if (*p++ != ',')
+                return SM_Other;
+        }
+
+        if (method.str)
+        {
+            if (!params)
+                return SM_Other;
+            if (equals(method, "mining.notify"))
+                return parseNotifyParams(params, out.notify) ? SM_Notify : SM_Other;
+            if (equals(method, "mining.set_difficulty"))
+            {
+                p = skipSpace(params);
+                if (*p++ != '[')
+                    return SM_Other;
+                p = skipSpace(p);
+                char* end;
+                out.difficulty = strtod(p, &end);
+                if (end == p)
+                    return SM_Other;
+                p = skipSpace(end);
+                return (*p == ']') ? SM_SetDifficulty : SM_Other;
+            }
+            return SM_Other;
+        }
+
+        if (hasId && hasResult && !otherResult && (out.response.id >= min_response_id))
+            return SM_Response;
+        return SM_Other;
+    }
+}
+
+#endif // !StratumParser_INCLUDE_ONCE
@@ -0,0 +1,801 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef StratumProxy_INCLUDE_ONCE
+#define StratumProxy_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h> // socklen_t
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#include <curl/curl.h> // curl_socket_t
+#include <jansson.h>
+#include <lyclCore/Log.hpp>
+#include <lyclCore/PoolFailover.hpp>
+#include <lyclCore/StratumParser.hpp>
+
+// Stratum proxy: downstream stratum V1 miners(other rigs) share the upstream connection of this miner.
+//
+// The extranonce2 space of the upstream pool is split: every downstream miner gets a nonzero prefix of
+// 1 or 2 bytes, appended to its extranonce1, and mines the remaining extranonce2 bytes.
+// The local devices keep prefix 0. Jobs and difficulty of the upstream pool are forwarded as they arrive,
+// submits are checked for stale jobs and duplicates locally and sent upstream with the prefix restored.
+// Upstream calls come from stratum threads, downstream sockets are served by the proxy thread.
+
+namespace lycl
+{
+    //! sends a share upstream(mining.submit of (pool)) and returns its request id. false if the pool is not connected.
+    typedef bool (*proxySubmitFunc)(int pool, const char* job_id, const char* xnonce2, const char* ntime, const char* nonce,
+                                    double diff, uint32_t& out_id);
+
+    //-----------------------------------------------------------------------------
+    // StratumProxy class declaration.
+    //-----------------------------------------------------------------------------
+    class StratumProxy
+    {
+    public:
+        //! jobs of the current block accepted for submits.
+        static const size_t c_maxJobs = 16;
+        //! longest line accepted from a downstream miner.
+        static const size_t c_maxLineSize = 16384;
+        //! upstream responses are forgotten after this time, like timed out shares.
+        static const uint64_t c_pendingTimeoutMs = 60000;
+        //! interval of the summary log.
+        static const uint64_t c_reportIntervalMs = 600000;
+
+        inline StratumProxy();
+        inline ~StratumProxy();
+
+        //! listen on (port) of all interfaces and start the proxy thread.
+        inline bool start(int port, proxySubmitFunc submit);
+        bool isActive() const { return m_active; }
+
+        //! extranonce2 bytes reserved for downstream prefixes, for an upstream extranonce2 of (xnonce2_size) bytes.
+        //! 0 if it is too small to split: every miner, local devices included, needs at least one byte to roll.
+        static size_t prefixSize(size_t xnonce2_size) { return (xnonce2_size >= 4) ? 2 : ((xnonce2_size >= 2) ? 1 : 0); }
+
+        // upstream events, called by stratum threads
+        //! the pool sent a new extranonce(subscribe or mining.set_extranonce).
+        inline void onExtranonce(int pool, const char* xnonce1, size_t xnonce2_size);
+        inline void onNotify(int pool, const stratumNotify& notify);
+        inline void onDifficulty(int pool, double diff);
+        //! jobs of (pool) are forwarded from now on.
+        inline void setPool(int pool);
+        //! route the response to share (id) of (pool). Returns false if it is not a proxied share.
+        inline bool onShareResult(int pool, uint32_t id, bool accepted, const char* reason);
+
+        //! one line summary: miners, forwarded, accepted, rejected, stale and duplicate shares.
+        inline std::string summary();
+
+    private:
+        StratumProxy(const StratumProxy&);
+        StratumProxy& operator=(const StratumProxy&);
+
+        struct upstream
+        {
+            std::string xnonce1;
+            size_t xnonce2Size;
+            double diff;
+            //! mining.notify params of the latest job without the clean flag, empty if none.
+            std::string notifyParams;
+            //! job ids of the current block, oldest first.
+            std::deque<std::string> jobs;
+            //! job id -> extranonce2, ntime and nonce of its submitted shares.
+            std::map<std::string, std::set<std::string> > submitted;
+        };
+
+        struct client
+        {
+            uint32_t id;
+            curl_socket_t sock;
+            //! extranonce2 prefix, 0 until subscribed.
+            uint32_t prefix;
+            bool authorized;
+            bool closed;
+            std::string worker;
+            std::string recvBuffer;
+            std::string outbox;
+        };
+
+        //! share waiting for the upstream response.
+        struct pending
+        {
+            uint32_t clientId;
+            //! JSON array holding the downstream request id.
+            std::string requestId;
+            uint64_t sentMs;
+        };
+
+        //! request ids are unique per pool connection.
+        static uint64_t pendingKey(int pool, uint32_t id) { return ((uint64_t)pool << 32) | id; }
+        static inline void* threadFunc(void* userdata);
+        static inline void closeSocket(curl_socket_t sock);
+        inline void serve();
+        inline void wake();
+        inline void acceptClient();
+        inline void receive(client& c);
+        inline void flush(client& c);
+        inline void handleLine(client& c, const char* line);
+        inline void handleSubmit(client& c, json_t* id, json_t* params);
+        inline void queueLine(client& c, const std::string& line);
+        //! (result) is consumed.
+        inline void respond(client& c, json_t* id, json_t* result, int error_code, const char* error_msg);
+        inline std::string difficultyLine() const;
+        inline std::string notifyLine(bool clean) const;
+        //! send the difficulty and latest job to an authorized miner.
+        inline void sendWork(client& c);
+        //! drop all miners, their extranonce1 is no longer valid.
+        inline void dropClients(const char* reason);
+        inline client* findClient(uint32_t id);
+        inline uint32_t allocPrefix();
+
+        pthread_mutex_t m_mutex;
+        volatile bool m_active;
+        proxySubmitFunc m_submit;
+        curl_socket_t m_listenSocket;
+        pthread_t m_thread;
+        int m_wakePipe[2];
+
+        int m_pool;
+        upstream m_upstreams[PoolFailover::c_maxPools];
+        std::vector<client> m_clients;
+        uint32_t m_nextClientId;
+        std::map<uint64_t, pending> m_pending;
+
+        uint32_t m_numForwarded;
+        uint32_t m_numAccepted;
+        uint32_t m_numRejected;
+        uint32_t m_numStale;
+        uint32_t m_numDuplicates;
+    };
+    //-----------------------------------------------------------------------------
+    // StratumProxy class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline StratumProxy::StratumProxy()
+        : m_active(false)
+        , m_submit(NULL)
+        , m_listenSocket(CURL_SOCKET_BAD)
+        , m_pool(0)
+        , m_nextClientId(1)
+        , m_numForwarded(0)
+        , m_numAccepted(0)
+        , m_numRejected(0)
+        , m_numStale(0)
+        , m_numDuplicates(0)
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+        m_wakePipe[0] = m_wakePipe[1] = -1;
+        for (int i = 0; i < PoolFailover::c_maxPools; ++i)
+        {
+            m_upstreams[i].xnonce2Size = 0;
+            m_upstreams[i].diff = 0.0;
+        }
+    }
+    //-----------------------------------------------------------------------------
+    inline StratumProxy::~StratumProxy()
+    {
+        // the proxy thread runs until the process exits
+        pthread_mutex_destroy(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::closeSocket(curl_socket_t sock)
+    {
+#ifdef _WIN32
+        closesocket(sock);
+#else
+        close(sock);
+#endif
+    }
+    //-----------------------------------------------------------------------------
+    inline bool StratumProxy::start(int port, proxySubmitFunc submit)
+    {
+        m_submit = submit;
+        m_listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (m_listenSocket == CURL_SOCKET_BAD)
+            return false;
+
+        int reuse = 1;
+        setsockopt(m_listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(m_listenSocket, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(m_listenSocket, 64) != 0)
+        {
+            closeSocket(m_listenSocket);
+            m_listenSocket = CURL_SOCKET_BAD;
+            return false;
+        }
+
+#ifndef _WIN32
+        if (pipe(m_wakePipe))
+            m_wakePipe[0] = m_wakePipe[1] = -1;
+        else
+        {
+            fcntl(m_wakePipe[0], F_SETFL, fcntl(m_wakePipe[0], F_GETFL, 0) | O_NONBLOCK);
+            fcntl(m_wakePipe[1], F_SETFL, fcntl(m_wakePipe[1], F_GETFL, 0) | O_NONBLOCK);
+        }
+#endif
+
+        m_active = true;
+        if (pthread_create(&m_thread, NULL, threadFunc, this))
+        {
+            m_active = false;
+            return false;
+        }
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void* StratumProxy::threadFunc(void* userdata)
+    {
+        ((StratumProxy*)userdata)->serve();
+        return NULL;
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::wake()
+    {
+        // must be called under m_mutex
+#ifndef _WIN32
+        if (m_wakePipe[1] >= 0)
+        {
+            const char c = 1;
+            if (write(m_wakePipe[1], &c, 1) < 0) {} // full pipe: a wake up is pending anyway
+        }
+#endif
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::serve()
+    {
+        uint64_t lastReportMs = PoolFailover::nowMs();
+        while (m_active)
+        {
+            // poll has no FD_SETSIZE limit, a proxy may serve hundreds of rigs
+            std::vector<pollfd> fds;
+            fds.reserve(m_clients.size() + 2);
+            pollfd listenFd = { m_listenSocket, POLLIN, 0 };
+            fds.push_back(listenFd);
+#ifndef _WIN32
+            const size_t firstClient = (m_wakePipe[0] >= 0) ? 2 : 1;
+            if (m_wakePipe[0] >= 0)
+            {
+                pollfd wakeFd = { m_wakePipe[0], POLLIN, 0 };
+                fds.push_back(wakeFd);
+            }
+            const int timeoutMs = 1000;
+#else
+            const size_t firstClient = 1;
+            // no wake up pipe, jobs are forwarded within 50ms
+            const int timeoutMs = 50;
+#endif
+            // only this thread adds and removes clients, so m_clients[i] stays at fds[firstClient + i]
+            pthread_mutex_lock(&m_mutex);
+            const size_t numPolled = m_clients.size();
+            for (size_t i = 0; i < numPolled; ++i)
+            {
+                pollfd clientFd = { m_clients[i].sock, (short)(POLLIN | (m_clients[i].outbox.empty() ? 0 : POLLOUT)), 0 };
+                fds.push_back(clientFd);
+            }
+            pthread_mutex_unlock(&m_mutex);
+
+#ifdef _WIN32
+            const int n = WSAPoll(fds.data(), (ULONG)fds.size(), timeoutMs);
+#else
+            const int n = poll(fds.data(), (nfds_t)fds.size(), timeoutMs);
+#endif
+            if (n < 0)
+                continue;
+
+#ifndef _WIN32
+            if ((firstClient > 1) && (fds[1].revents & POLLIN))
+            {
+                char buf[64];
+                while (read(m_wakePipe[0], buf, sizeof(buf)) > 0) {}
+            }
+#endif
+            if (fds[0].revents & POLLIN)
+                acceptClient();
+
+            pthread_mutex_lock(&m_mutex);
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                // errors and hang ups are found by recv
+                if ((i < numPolled) && (fds[firstClient + i].revents & (POLLIN | POLLERR | POLLHUP)))
+                    receive(m_clients[i]);
+                flush(m_clients[i]);
+            }
+
+            // drop disconnected miners and forgotten responses
+            for (size_t i = 0; i < m_clients.size();)
+            {
+                if (m_clients[i].closed)
+                {
+                    Log::print(Log::LT_Info, "Proxy: miner %s disconnected", m_clients[i].worker.c_str());
+                    closeSocket(m_clients[i].sock);
+                    m_clients.erase(m_clients.begin() + i);
+                }
+                else
+                    ++i;
+            }
+            const uint64_t now = PoolFailover::nowMs();
+            for (std::map<uint64_t, pending>::iterator it = m_pending.begin(); it != m_pending.end();)
+            {
+                if (now - it->second.sentMs >= c_pendingTimeoutMs)
+                    m_pending.erase(it++);
+                else
+                    ++it;
+            }
+            pthread_mutex_unlock(&m_mutex);
+
+            if (now - lastReportMs >= c_reportIntervalMs)
+            {
+                lastReportMs = now;
+                Log::print(Log::LT_Info, "Proxy: %s", summary().c_str());
+            }
+        }
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::acceptClient()
+    {
+        sockaddr_in addr;
+        socklen_t addrSize = sizeof(addr);
+        curl_socket_t sock = accept(m_listenSocket, (sockaddr*)&addr, &addrSize);
+        if (sock == CURL_SOCKET_BAD)
+            return;
+
+        // a slow miner must not block the proxy thread
+#ifdef _WIN32
+        u_long nonBlocking = 1;
+        ioctlsocket(sock, FIONBIO, &nonBlocking);
+#else
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+        client c;
+        c.id = m_nextClientId++;
+        c.sock = sock;
+        c.prefix = 0;
+        c.authorized = false;
+        c.closed = false;
+        c.worker = inet_ntoa(addr.sin_addr);
+        pthread_mutex_lock(&m_mutex);
+        m_clients.push_back(c);
+        pthread_mutex_unlock(&m_mutex);
+        Log::print(Log::LT_Info, "Proxy: miner connected from %s", c.worker.c_str());
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::receive(client& c)
+    {
+        char buf[4096];
+        const int n = (int)recv(c.sock, buf, sizeof(buf), 0);
+        if (n <= 0)
+        {
+            c.closed = true;
+            return;
+        }
+        c.recvBuffer.append(buf, (size_t)n);
+
+        size_t pos;
+        while (!c.closed && (pos = c.recvBuffer.find('\n')) != std::string::npos)
+        {
+            std::string line = c.recvBuffer.substr(0, pos);
+            c.recvBuffer.erase(0, pos + 1);
+            if (!line.empty() && (line != "\r"))
+                handleLine(c, line.c_str());
+        }
+        if (c.recvBuffer.size() > c_maxLineSize)
+            c.closed = true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::flush(client& c)
+    {
+        while (!c.closed && !c.outbox.empty())
+        {
+#ifdef MSG_NOSIGNAL
+            const int n = (int)send(c.sock, c.outbox.data(), (int)c.outbox.size(), MSG_NOSIGNAL);
+#else
+            const int n = (int)send(c.sock, c.outbox.data(), (int)c.outbox.size(), 0);
+#endif
+            if (n > 0)
+                c.outbox.erase(0, (size_t)n);
+            else
+            {
+#ifdef _WIN32
+                c.closed = (WSAGetLastError() != WSAEWOULDBLOCK);
+#else
+                c.closed = (errno != EAGAIN) && (errno != EWOULDBLOCK);
+#endif
+                break;
+            }
+        }
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::queueLine(client& c, const std::string& line)
+    {
+        c.outbox += line;
+        c.outbox += '\n';
+        wake();
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::respond(client& c, json_t* id, json_t* result, int error_code, const char* error_msg)
+    {
+        json_t* response = json_object();
+        json_object_set(response, "id", id ? id : json_null());
+        json_object_set_new(response, "result", result);
+        if (error_code)
+        {
+            json_t* error = json_array();
+            json_array_append_new(error, json_integer(error_code));
+            json_array_append_new(error, json_string(error_msg));
+            json_array_append_new(error, json_null());
+            json_object_set_new(response, "error", error);
+        }
+        else
+            json_object_set_new(response, "error", json_null());
+
+        char* s = json_dumps(response, JSON_COMPACT);
+        if (s)
+        {
+            queueLine(c, s);
+            free(s);
+        }
+        json_decref(response);
+    }
+    //-----------------------------------------------------------------------------
+    inline std::string StratumProxy::difficultyLine() const
+    {
+        char line[128];
+        snprintf(line, sizeof(line), "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[%.17g]}", m_upstreams[m_pool].diff);
+        return line;
+    }
+    //-----------------------------------------------------------------------------
+    inline std::string StratumProxy::notifyLine(bool clean) const
+    {
+        return "{\"id\":null,\"method\":\"mining.notify\",\"params\":[" + m_upstreams[m_pool].notifyParams +
+               (clean ? ",true]}" : ",false]}");
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::sendWork(client& c)
+    {
+        const upstream& up = m_upstreams[m_pool];
+        if (up.diff > 0.0)
+            queueLine(c, difficultyLine());
+        if (!up.notifyParams.empty())
+            queueLine(c, notifyLine(true));
+    }
+    //-----------------------------------------------------------------------------
+    inline uint32_t StratumProxy::allocPrefix()
+    {
+        const size_t size = prefixSize(m_upstreams[m_pool].xnonce2Size);
+        const uint32_t maxPrefix = (1u << (8 * size)) - 1;
+        std::set<uint32_t> used;
+        for (size_t i = 0; i < m_clients.size(); ++i)
+            used.insert(m_clients[i].prefix);
+        // 0 is mined by the local devices
+        for (uint32_t prefix = 1; prefix <= maxPrefix; ++prefix)
+        {
+            if (!used.count(prefix))
+                return prefix;
+        }
+        return 0;
+    }
+    //-----------------------------------------------------------------------------
+    inline StratumProxy::client* StratumProxy::findClient(uint32_t id)
+    {
+        for (size_t i = 0; i < m_clients.size(); ++i)
+        {
+            if (m_clients[i].id == id)
+                return &m_clients[i];
+        }
+        return NULL;
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::handleLine(client& c, const char* line)
+    {
+        json_error_t err;
+        json_t* val = json_loads(line, 0, &err);
+        if (!val)
+        {
+            Log::print(Log::LT_Debug, "Proxy: JSON decode failed(%d): %s", err.line, err.text);
+            return;
+        }
+
+        json_t* id = json_object_get(val, "id");
+        json_t* params = json_object_get(val, "params");
+        const char* method = json_string_value(json_object_get(val, "method"));
+        const upstream& up = m_upstreams[m_pool];
+        if (!method)
+        {
+            // response to a proxy request, nothing to do
+        }
+        else if (!strcmp(method, "mining.subscribe"))
+        {
+            if (!c.prefix)
+                c.prefix = prefixSize(up.xnonce2Size) ? allocPrefix() : 0;
+            if (!c.prefix)
+            {
+                const char* reason = !up.xnonce2Size ? "Proxy has no upstream pool" :
+                                     (!prefixSize(up.xnonce2Size) ? "Upstream extranonce2 is too small" : "Proxy is full");
+                respond(c, id, json_null(), 20, reason);
+            }
+            else
+            {
+                const size_t size = prefixSize(up.xnonce2Size);
+                char xnonce1[64];
+                snprintf(xnonce1, sizeof(xnonce1), "%s%0*x", up.xnonce1.c_str(), (int)(2 * size), c.prefix);
+                char subscription[16];
+                snprintf(subscription, sizeof(subscription), "%x", c.id);
+
+                json_t* result = json_array();
+                json_t* subscriptions = json_array();
+                json_t* s0 = json_array();
+                json_array_append_new(s0, json_string("mining.set_difficulty"));
+                json_array_append_new(s0, json_string(subscription));
+                json_t* s1 = json_array();
+                json_array_append_new(s1, json_string("mining.notify"));
+                json_array_append_new(s1, json_string(subscription));
+                json_array_append_new(subscriptions, s0);
+                json_array_append_new(subscriptions, s1);
+                json_array_append_new(result, subscriptions);
+                json_array_append_new(result, json_string(xnonce1));
+                json_array_append_new(result, json_integer((json_int_t)(up.xnonce2Size - size)));
+                respond(c, id, result, 0, NULL);
+            }
+        }
+        else if (!strcmp(method, "mining.authorize"))
+        {
+            const char* worker = json_string_value(json_array_get(params, 0));
+            if (worker)
+                c.worker = c.worker + " (" + worker + ")";
+            respond(c, id, json_true(), 0, NULL);
+            if (!c.authorized)
+            {
+                c.authorized = true;
+                Log::print(Log::LT_Info, "Proxy: miner %s authorized", c.worker.c_str());
+                sendWork(c);
+            }
+        }
+        else if (!strcmp(method, "mining.extranonce.subscribe"))
+            respond(c, id, json_true(), 0, NULL);
+        else if (!strcmp(method, "mining.submit"))
+            handleSubmit(c, id, params);
+        else
+            respond(c, id, json_null(), 20, "Unsupported method");
+
+        json_decref(val);
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::handleSubmit(client& c, json_t* id, json_t* params)
+    {
+        upstream& up = m_upstreams[m_pool];
+        const char* jobId = json_string_value(json_array_get(params, 1));
+        const char* xnonce2 = json_string_value(json_array_get(params, 2));
+        const char* ntime = json_string_value(json_array_get(params, 3));
+        const char* nonce = json_string_value(json_array_get(params, 4));
+        const size_t size = prefixSize(up.xnonce2Size);
+        jsonSpan span;
+        if (!c.authorized || !c.prefix || !jobId || !xnonce2 || !ntime || !nonce ||
+            !(span.str = xnonce2, span.size = strlen(xnonce2), StratumParser::isHex(span, 2 * (up.xnonce2Size - size))) ||
+            !(span.str = ntime, span.size = strlen(ntime), StratumParser::isHex(span, 8)) ||
+            !(span.str = nonce, span.size = strlen(nonce), StratumParser::isHex(span, 8)))
+        {
+            respond(c, id, json_false(), 20, "Invalid parameters");
+            return;
+        }
+
+        // stale: not a job of the current block of the upstream pool
+        std::map<std::string, std::set<std::string> >::iterator job = up.submitted.find(jobId);
+        if (job == up.submitted.end())
+        {
+            ++m_numStale;
+            respond(c, id, json_false(), 21, "Job not found");
+            return;
+        }
+
+        char upstreamXnonce2[80];
+        snprintf(upstreamXnonce2, sizeof(upstreamXnonce2), "%0*x%s", (int)(2 * size), c.prefix, xnonce2);
+        if (!job->second.insert(std::string(upstreamXnonce2) + ntime + nonce).second)
+        {
+            ++m_numDuplicates;
+            respond(c, id, json_false(), 22, "Duplicate share");
+            return;
+        }
+
+        // the response may arrive before submit returns, m_mutex keeps it waiting for the pending entry
+        uint32_t upstreamId;
+        if (!m_submit || !m_submit(m_pool, jobId, upstreamXnonce2, ntime, nonce, up.diff, upstreamId))
+        {
+            job->second.erase(std::string(upstreamXnonce2) + ntime + nonce);
+            respond(c, id, json_false(), 20, "Upstream pool is not connected");
+            return;
+        }
+        ++m_numForwarded;
+
+        pending& share = m_pending[pendingKey(m_pool, upstreamId)];
+        share.clientId = c.id;
+        // wrapped in an array, older jansson only encodes arrays and objects
+        json_t* wrapped = json_array();
+        json_array_append(wrapped, id ? id : json_null());
+        char* requestId = json_dumps(wrapped, JSON_COMPACT);
+        share.requestId = requestId ? requestId : "[null]";
+        free(requestId);
+        json_decref(wrapped);
+        share.sentMs = PoolFailover::nowMs();
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::dropClients(const char* reason)
+    {
+        // must be called under m_mutex. Miners reconnect and subscribe with the new extranonce.
+        if (!m_clients.empty())
+            Log::print(Log::LT_Notice, "Proxy: %s, reconnecting %u miners", reason, (uint32_t)m_clients.size());
+        for (size_t i = 0; i < m_clients.size(); ++i)
+            m_clients[i].closed = true;
+        m_pending.clear();
+        wake();
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::onExtranonce(int pool, const char* xnonce1, size_t xnonce2_size)
+    {
+        pthread_mutex_lock(&m_mutex);
+        upstream& up = m_upstreams[pool];
+        const bool changed = (up.xnonce1 != xnonce1) || (up.xnonce2Size != xnonce2_size);
+        up.xnonce1 = xnonce1;
+        up.xnonce2Size = xnonce2_size;
+        if (changed && (pool == m_pool))
+            dropClients("upstream extranonce changed");
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::onNotify(int pool, const stratumNotify& notify)
+    {
+        // params without the clean flag, the spans were validated by the stratum thread
+        std::string params;
+        params.reserve(512 + 68 * notify.merkleCount);
+        const jsonSpan* before[4] = { &notify.jobId, &notify.prevhash, &notify.coinb1, &notify.coinb2 };
+        for (int i = 0; i < 4; ++i)
+        {
+            params += '"';
+            params.append(before[i]->str, before[i]->size);
+            params += "\",";
+        }
+        params += '[';
+        for (int i = 0; i < notify.merkleCount; ++i)
+        {
+            params += i ? ",\"" : "\"";
+            params.append(notify.merkle[i].str, notify.merkle[i].size);
+            params += '"';
+        }
+        params += ']';
+        const jsonSpan* after[3] = { &notify.version, &notify.nbits, &notify.ntime };
+        for (int i = 0; i < 3; ++i)
+        {
+            params += ",\"";
+            params.append(after[i]->str, after[i]->size);
+            params += '"';
+        }
+        const std::string jobId(notify.jobId.str, notify.jobId.size);
+
+        pthread_mutex_lock(&m_mutex);
+        upstream& up = m_upstreams[pool];
+        if (notify.clean)
+        {
+            up.jobs.clear();
+            up.submitted.clear();
+        }
+        up.notifyParams = params;
+        if (!up.submitted.count(jobId))
+        {
+            up.jobs.push_back(jobId);
+            up.submitted[jobId];
+        }
+        while (up.jobs.size() > c_maxJobs)
+        {
+            up.submitted.erase(up.jobs.front());
+            up.jobs.pop_front();
+        }
+
+        if (pool == m_pool)
+        {
+            const std::string line = notifyLine(notify.clean);
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                if (m_clients[i].authorized)
+                    queueLine(m_clients[i], line);
+            }
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::onDifficulty(int pool, double diff)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_upstreams[pool].diff = diff;
+        if (pool == m_pool)
+        {
+            const std::string line = difficultyLine();
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                if (m_clients[i].authorized)
+                    queueLine(m_clients[i], line);
+            }
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumProxy::setPool(int pool)
+    {
+        pthread_mutex_lock(&m_mutex);
+        if (pool != m_pool)
+        {
+            m_pool = pool;
+            dropClients("upstream pool switched");
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool StratumProxy::onShareResult(int pool, uint32_t id, bool accepted, const char* reason)
+    {
+        pthread_mutex_lock(&m_mutex);
+        std::map<uint64_t, pending>::iterator it = m_pending.find(pendingKey(pool, id));
+        if (it == m_pending.end())
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return false;
+        }
+        accepted ? ++m_numAccepted : ++m_numRejected;
+
+        client* c = findClient(it->second.clientId);
+        if (c && !c->closed)
+        {
+            json_t* requestId = json_loads(it->second.requestId.c_str(), 0, NULL);
+            respond(*c, json_array_get(requestId, 0), accepted ? json_true() : json_false(), accepted ? 0 : 20,
+                    reason ? reason : "Rejected");
+            json_decref(requestId);
+            Log::print(Log::LT_Debug, "Proxy: share of %s %s", c->worker.c_str(), accepted ? "accepted" : "rejected");
+        }
+        m_pending.erase(it);
+        pthread_mutex_unlock(&m_mutex);
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline std::string StratumProxy::summary()
+    {
+        pthread_mutex_lock(&m_mutex);
+        char text[256];
+        snprintf(text, sizeof(text), "%u miners, %u shares forwarded, %u accepted, %u rejected, %u stale, %u duplicates",
+                 (uint32_t)m_clients.size(), m_numForwarded, m_numAccepted, m_numRejected, m_numStale, m_numDuplicates);
+        pthread_mutex_unlock(&m_mutex);
+        return text;
+    }
+}
+
+extern lycl::StratumProxy stratumProxy;
+
+#endif // !StratumProxy_INCLUDE_ONCE
@@ -0,0 +1,764 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef StratumV2_INCLUDE_ONCE
+#define StratumV2_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+// Stratum V2 mining protocol: binary frames and the client side of a standard channel.
+//
+// A frame is a 6 byte header(extension type, message type, 24-bit payload length) followed by
+// a little-endian payload. Jobs of a standard channel carry a ready Merkle root, so the miner only builds
+// 80-byte headers and rolls the nonce, the BIP320 version bits and ntime. The coinbase is never sent.
+// Frames are not encrypted(no Noise handshake), as used by local proxies and plain text pool endpoints.
+
+namespace lycl
+{
+    typedef enum
+    {
+        SV2_SetupConnection = 0x00,
+        SV2_SetupConnectionSuccess = 0x01,
+        SV2_SetupConnectionError = 0x02,
+        SV2_OpenStandardMiningChannel = 0x10,
+        SV2_OpenStandardMiningChannelSuccess = 0x11,
+        SV2_OpenMiningChannelError = 0x12,
+        SV2_NewMiningJob = 0x15,
+        SV2_UpdateChannel = 0x16,
+        SV2_CloseChannel = 0x18,
+        SV2_SetExtranoncePrefix = 0x19,
+        SV2_SubmitSharesStandard = 0x1a,
+        SV2_SubmitSharesSuccess = 0x1c,
+        SV2_SubmitSharesError = 0x1d,
+        SV2_SetNewPrevHash = 0x20,
+        SV2_SetTarget = 0x21,
+        SV2_Reconnect = 0x25
+    } ESv2Message;
+
+    //! frame header size.
+    const size_t c_sv2HeaderSize = 6;
+    //! largest payload accepted, standard channel messages are much smaller.
+    const uint32_t c_sv2MaxPayload = 65536;
+    //! extension type bit of messages addressed to a channel.
+    const uint16_t c_sv2ChannelMsg = 0x8000;
+    //! SetupConnection protocol of mining connections.
+    const uint8_t c_sv2MiningProtocol = 0;
+    //! SetupConnection flag: the client only opens standard channels.
+    const uint32_t c_sv2RequiresStandardJobs = 0x1;
+    //! SetupConnection.Success flag: the pool does not accept changed version bits.
+    const uint32_t c_sv2RequiresFixedVersion = 0x1;
+    //! version bits a miner may change(BIP320).
+    const uint32_t c_sv2VersionRollingMask = 0x1fffe000;
+
+    struct sv2Frame
+    {
+        uint16_t extension;
+        uint8_t type;
+        const unsigned char* payload;
+        uint32_t size;
+    };
+
+    //-----------------------------------------------------------------------------
+    // Sv2Writer class declaration.
+    //-----------------------------------------------------------------------------
+    //! builds one frame in a fixed buffer.
+    class Sv2Writer
+    {
+    public:
+        static const size_t c_capacity = 2048;
+
+        inline Sv2Writer(uint8_t type, bool channel_msg);
+
+        inline void u8(uint8_t v);
+        inline void u16(uint16_t v);
+        inline void u24(uint32_t v);
+        inline void u32(uint32_t v);
+        inline void u64(uint64_t v);
+        inline void f32(float v);
+        //! 32 raw bytes.
+        inline void u256(const unsigned char* v);
+        //! STR0_255, longer strings are cut.
+        inline void str(const char* v);
+        //! B0_32, up to 32 bytes with a size prefix.
+        inline void b032(const unsigned char* v, size_t size);
+
+        //! false if the message did not fit.
+        bool isValid() const { return m_valid; }
+        const unsigned char* data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+    private:
+        inline void bytes(const void* v, size_t size);
+
+        unsigned char m_data[c_capacity];
+        size_t m_size;
+        bool m_valid;
+    };
+
+    //-----------------------------------------------------------------------------
+    // Sv2Reader class declaration.
+    //-----------------------------------------------------------------------------
+    //! reads a payload, reading past its end makes the reader invalid and returns zeros.
+    class Sv2Reader
+    {
+    public:
+        Sv2Reader(const sv2Frame& frame) : m_data(frame.payload), m_size(frame.size), m_pos(0), m_valid(true) {}
+
+        inline uint8_t u8();
+        inline uint16_t u16();
+        inline uint32_t u32();
+        inline uint64_t u64();
+        inline float f32();
+        inline void u256(unsigned char* out);
+        //! STR0_255 into (out), terminated and cut to (out_size).
+        inline void str(char* out, size_t out_size);
+        //! B0_32 into (out, 32 bytes). Returns its size.
+        inline size_t b032(unsigned char* out);
+
+        bool isValid() const { return m_valid; }
+
+    private:
+        inline const unsigned char* take(size_t size);
+
+        const unsigned char* m_data;
+        size_t m_size;
+        size_t m_pos;
+        bool m_valid;
+    };
+
+    //-----------------------------------------------------------------------------
+    // Sv2FrameBuffer class declaration.
+    //-----------------------------------------------------------------------------
+    //! receive buffer which splits a byte stream into frames, the binary counterpart of LineBuffer.
+    class Sv2FrameBuffer
+    {
+    public:
+        static const size_t c_initialCapacity = 16384;
+        //! minimal free space available to a single recv.
+        static const size_t c_minWriteSize = 4096;
+
+        inline Sv2FrameBuffer();
+        inline ~Sv2FrameBuffer();
+
+        //! returns a pointer to at least c_minWriteSize bytes of free space. Invalidates frame views.
+        inline unsigned char* writePtr();
+        size_t writeSize() const { return m_capacity - m_end; }
+        void commit(size_t size) { m_end += size; }
+        //! get the next complete frame, its payload is valid until the next writePtr().
+        inline bool nextFrame(sv2Frame& out_frame);
+        bool hasData() const { return m_begin != m_end; }
+        //! true if a complete frame is available.
+        inline bool hasFrame() const;
+        //! a frame announced a payload larger than c_sv2MaxPayload, the stream can not be resynchronized.
+        bool isCorrupt() const { return m_corrupt; }
+        inline void clear();
+
+    private:
+        Sv2FrameBuffer(const Sv2FrameBuffer&);
+        Sv2FrameBuffer& operator=(const Sv2FrameBuffer&);
+
+        inline uint32_t payloadSize() const;
+
+        unsigned char* m_data;
+        size_t m_capacity;
+        size_t m_begin;
+        size_t m_end;
+        bool m_corrupt;
+    };
+
+    typedef enum
+    {
+        SV2E_None = 0,
+        SV2E_SetupDone,
+        SV2E_SetupFailed,
+        SV2E_ChannelOpened,
+        SV2E_ChannelFailed,
+        //! the active job changed, (clean): new prevhash.
+        SV2E_Job,
+        SV2E_Target,
+        //! shares up to (sequence) are accepted.
+        SV2E_SharesAccepted,
+        //! share (sequence) is rejected with (text).
+        SV2E_ShareRejected,
+        //! the pool asks to connect to (text, port).
+        SV2E_Reconnect,
+        SV2E_ChannelClosed
+    } ESv2Event;
+
+    struct sv2Event
+    {
+        ESv2Event type;
+        bool clean;
+        uint32_t sequence;
+        uint32_t count;
+        uint16_t port;
+        char text[256];
+    };
+
+    struct sv2Job
+    {
+        uint32_t id;
+        uint32_t version;
+        unsigned char merkleRoot[32];
+    };
+
+    //-----------------------------------------------------------------------------
+    // StratumV2Channel class declaration.
+    //-----------------------------------------------------------------------------
+    //! client state of a connection with one standard channel. Writes requests and handles received frames.
+    class StratumV2Channel
+    {
+    public:
+        //! future jobs kept until their SetNewPrevHash.
+        static const int c_maxFutureJobs = 8;
+
+        StratumV2Channel() { reset(); }
+
+        //! forget the channel and all jobs(new connection).
+        inline void reset();
+
+        static inline void writeSetupConnection(Sv2Writer& out, const char* host, uint16_t port, const char* vendor, const char* firmware);
+        static inline void writeOpenChannel(Sv2Writer& out, const char* user, float hashrate);
+        inline void writeSubmit(Sv2Writer& out, uint32_t sequence, uint32_t job_id, uint32_t nonce, uint32_t ntime, uint32_t version) const;
+        //! UpdateChannel: the pool must not set a target above (max_target), little-endian words.
+        inline void writeUpdateChannel(Sv2Writer& out, float hashrate, const uint32_t* max_target) const;
+
+        //! update the state from (frame). Returns false on a malformed frame.
+        inline bool handle(const sv2Frame& frame, sv2Event& out_event);
+
+        bool isOpen() const { return m_open; }
+        uint32_t channelId() const { return m_channelId; }
+        //! share target, little-endian words.
+        const uint32_t* target() const { return m_target; }
+        //! version bits which may be rolled, 0 if the pool requires a fixed version.
+        uint32_t versionMask() const { return m_fixedVersion ? 0 : c_sv2VersionRollingMask; }
+        bool hasJob() const { return m_hasJob; }
+        const sv2Job& job() const { return m_job; }
+        //! previous block hash in header byte order.
+        const unsigned char* prevhash() const { return m_prevhash; }
+        uint32_t nbits() const { return m_nbits; }
+        //! ntime of the active job.
+        uint32_t ntime() const { return m_ntime; }
+
+        //! difficulty of (target) on the scale of mining.set_difficulty.
+        static inline double targetToDifficulty(const uint32_t* target);
+
+    private:
+        inline void readTarget(Sv2Reader& in);
+
+        bool m_open;
+        bool m_fixedVersion;
+        uint32_t m_channelId;
+        uint32_t m_target[8];
+        bool m_hasPrevHash;
+        unsigned char m_prevhash[32];
+        uint32_t m_nbits;
+        uint32_t m_prevHashNtime;
+        bool m_hasJob;
+        sv2Job m_job;
+        uint32_t m_ntime;
+        sv2Job m_futureJobs[c_maxFutureJobs];
+        int m_numFutureJobs;
+    };
+    //-----------------------------------------------------------------------------
+    // Sv2Writer class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline Sv2Writer::Sv2Writer(uint8_t type, bool channel_msg)
+        : m_size(c_sv2HeaderSize)
+        , m_valid(true)
+    {
+        const uint16_t extension = channel_msg ? c_sv2ChannelMsg : 0;
+        m_data[0] = (unsigned char)extension;
+        m_data[1] = (unsigned char)(extension >> 8);
+        m_data[2] = type;
+        m_data[3] = m_data[4] = m_data[5] = 0;
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Writer::bytes(const void* v, size_t size)
+    {
+        if (!m_valid || (m_size + size > c_capacity))
+        {
+            m_valid = false;
+            return;
+        }
+        memcpy(m_data + m_size, v, size);
+        m_size += size;
+
+        // payload length
+        const size_t length = m_size - c_sv2HeaderSize;
+        m_data[3] = (unsigned char)length;
+        m_data[4] = (unsigned char)(length >> 8);
+        m_data[5] = (unsigned char)(length >> 16);
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Writer::u8(uint8_t v)
+    {
+        bytes(&v, 1);
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Writer::u16(uint16_t v)
+    {
+        const unsigned char b[2] = { (unsigned char)v, (unsigned char)(v >> 8) };
+        bytes(b, 2);
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Writer::u24(uint32_t v)
+    {
+        const unsigned char b[3] = { (unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16) };
+        bytes(b, 3);
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Writer::u32(uint32_t v)
+    {
+        const unsigned char b[4] = { (unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16), (unsigned char)(v >> 24) };
+        bytes(b, 4);
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Writer::u64(uint64_t v)
+    {
+        u32((uint32_t)v);
+        u32((uint32_t)(v >> 32));
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Writer::f32(float v)
+    {
+        uint32_t bits;
+        memcpy(&bits, &v, 4);
+        u32(bits);
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Writer::u256(const unsigned char* v)
+    {
+        bytes(v, 32);
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Writer::str(const char* v)
+    {
+        size_t size = v ? strlen(v) : 0;
+        if (size > 255)
+            size = 255;
+        u8((uint8_t)size);
+        bytes(v, size);
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Writer::b032(const unsigned char* v, size_t size)
+    {
+        if (size > 32)
+        {
+            m_valid = false;
+            return;
+        }
+        u8((uint8_t)size);
+        bytes(v, size);
+    }
+    //-----------------------------------------------------------------------------
+    // Sv2Reader class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline const unsigned char* Sv2Reader::take(size_t size)
+    {
+        if (!m_valid || (m_pos + size > m_size))
+        {
+            m_valid = false;
+            return NULL;
+        }
+        const unsigned char* p = m_data + m_pos;
+        m_pos += size;
+        return p;
+    }
+    //-----------------------------------------------------------------------------
+    inline uint8_t Sv2Reader::u8()
+    {
+        const unsigned char* p = take(1);
+        return p ? p[0] : 0;
+    }
+    //-----------------------------------------------------------------------------
+    inline uint16_t Sv2Reader::u16()
+    {
+        const unsigned char* p = take(2);
+        return p ? (uint16_t)(p[0] | (p[1] << 8)) : 0;
+    }
+    //-----------------------------------------------------------------------------
+    inline uint32_t Sv2Reader::u32()
+    {
+        const unsigned char* p = take(4);
+        return p ? ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24)) : 0;
+    }
+    //-----------------------------------------------------------------------------
+    inline uint64_t Sv2Reader::u64()
+    {
+        const uint64_t low = u32();
+        return low | ((uint64_t)u32() << 32);
+    }
+    //-----------------------------------------------------------------------------
+    inline float Sv2Reader::f32()
+    {
+        const uint32_t bits = u32();
+        float v;
+        memcpy(&v, &bits, 4);
+        return v;
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Reader::u256(unsigned char* out)
+    {
+        const unsigned char* p = take(32);
+        if (p)
+            memcpy(out, p, 32);
+        else
+            memset(out, 0, 32);
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2Reader::str(char* out, size_t out_size)
+    {
+        const size_t size = u8();
+        const unsigned char* p = take(size);
+        const size_t copied = (p && size < out_size) ? size : (p ? out_size - 1 : 0);
+        if (copied)
+            memcpy(out, p, copied);
+        out[copied] = 0;
+    }
+    //-----------------------------------------------------------------------------
+    inline size_t Sv2Reader::b032(unsigned char* out)
+    {
+        const size_t size = u8();
+        if (size > 32)
+        {
+            m_valid = false;
+            return 0;
+        }
+        const unsigned char* p = take(size);
+        if (!p)
+            return 0;
+        memcpy(out, p, size);
+        return size;
+    }
+    //-----------------------------------------------------------------------------
+    // Sv2FrameBuffer class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline Sv2FrameBuffer::Sv2FrameBuffer()
+        : m_data((unsigned char*)malloc(c_initialCapacity))
+        , m_capacity(c_initialCapacity)
+        , m_begin(0)
+        , m_end(0)
+        , m_corrupt(false)
+    {
+    }
+    //-----------------------------------------------------------------------------
+    inline Sv2FrameBuffer::~Sv2FrameBuffer()
+    {
+        free(m_data);
+    }
+    //-----------------------------------------------------------------------------
+    inline unsigned char* Sv2FrameBuffer::writePtr()
+    {
+        if (m_capacity - m_end < c_minWriteSize)
+        {
+            // move the incomplete frame to the front, grow only if it is large
+            const size_t unread = m_end - m_begin;
+            memmove(m_data, m_data + m_begin, unread);
+            m_begin = 0;
+            m_end = unread;
+            if (m_capacity - m_end < c_minWriteSize)
+            {
+                unsigned char* data = (unsigned char*)realloc(m_data, m_capacity * 2);
+                if (data)
+                {
+                    m_data = data;
+                    m_capacity *= 2;
+                }
+            }
+        }
+        return m_data + m_end;
+    }
+    //-----------------------------------------------------------------------------
+    inline uint32_t Sv2FrameBuffer::payloadSize() const
+    {
+        const unsigned char* h = m_data + m_begin;
+        return (uint32_t)h[3] | ((uint32_t)h[4] << 8) | ((uint32_t)h[5] << 16);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool Sv2FrameBuffer::hasFrame() const
+    {
+        const size_t unread = m_end - m_begin;
+        return (unread >= c_sv2HeaderSize) && (unread - c_sv2HeaderSize >= payloadSize());
+    }
+    //-----------------------------------------------------------------------------
+    inline bool Sv2FrameBuffer::nextFrame(sv2Frame& out_frame)
+    {
+        if (m_end - m_begin < c_sv2HeaderSize)
+            return false;
+        const uint32_t size = payloadSize();
+        if (size > c_sv2MaxPayload)
+        {
+            m_corrupt = true;
+            return false;
+        }
+        if (!hasFrame())
+            return false;
+
+        const unsigned char* h = m_data + m_begin;
+        out_frame.extension = (uint16_t)(h[0] | (h[1] << 8));
+        out_frame.type = h[2];
+        out_frame.payload = h + c_sv2HeaderSize;
+        out_frame.size = size;
+        m_begin += c_sv2HeaderSize + size;
+        if (m_begin == m_end)
+            m_begin = m_end = 0;
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void Sv2FrameBuffer::clear()
+    {
+        m_begin = m_end = 0;
+        m_corrupt = false;
+    }
+    //-----------------------------------------------------------------------------
+    // StratumV2Channel class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline void StratumV2Channel::reset()
+    {
+        m_open = false;
+        m_fixedVersion = false;
+        m_channelId = 0;
+        memset(m_target, 0, sizeof(m_target));
+        m_hasPrevHash = false;
+        memset(m_prevhash, 0, sizeof(m_prevhash));
+        m_nbits = 0;
+        m_prevHashNtime = 0;
+        m_hasJob = false;
+        memset(&m_job, 0, sizeof(m_job));
+        m_ntime = 0;
+        m_numFutureJobs = 0;
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumV2Channel::writeSetupConnection(Sv2Writer& out, const char* host, uint16_t port, const char* vendor,
+                                                       const char* firmware)
+    {
+        out.u8(c_sv2MiningProtocol);
+        // min and max version
+        out.u16(2);
+        out.u16(2);
+        out.u32(c_sv2RequiresStandardJobs);
+        out.str(host);
+        out.u16(port);
+        out.str(vendor);
+        // hardware version, firmware, device id
+        out.str("");
+        out.str(firmware);
+        out.str("");
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumV2Channel::writeOpenChannel(Sv2Writer& out, const char* user, float hashrate)
+    {
+        // a single channel per connection, its request id is 1
+        out.u32(1);
+        out.str(user);
+        out.f32(hashrate);
+        // any target
+        unsigned char maxTarget[32];
+        memset(maxTarget, 0xff, sizeof(maxTarget));
+        out.u256(maxTarget);
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumV2Channel::writeSubmit(Sv2Writer& out, uint32_t sequence, uint32_t job_id, uint32_t nonce,
+                                              uint32_t ntime, uint32_t version) const
+    {
+        out.u32(m_channelId);
+        out.u32(sequence);
+        out.u32(job_id);
+        out.u32(nonce);
+        out.u32(ntime);
+        out.u32(version);
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumV2Channel::writeUpdateChannel(Sv2Writer& out, float hashrate, const uint32_t* max_target) const
+    {
+        out.u32(m_channelId);
+        out.f32(hashrate);
+        unsigned char target[32];
+        for (int i = 0; i < 8; ++i)
+        {
+            unsigned char* p = target + 4 * i;
+            p[0] = (unsigned char)max_target[i];
+            p[1] = (unsigned char)(max_target[i] >> 8);
+            p[2] = (unsigned char)(max_target[i] >> 16);
+            p[3] = (unsigned char)(max_target[i] >> 24);
+        }
+        out.u256(target);
+    }
+    //-----------------------------------------------------------------------------
+    inline void StratumV2Channel::readTarget(Sv2Reader& in)
+    {
+        unsigned char target[32];
+        in.u256(target);
+        for (int i = 0; i < 8; ++i)
+        {
+            const unsigned char* p = target + 4 * i;
+            m_target[i] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    inline double StratumV2Channel::targetToDifficulty(const uint32_t* target)
+    {
+        double t = 0.0;
+        for (int i = 7; i >= 0; --i)
+            t = t * 4294967296.0 + (double)target[i];
+        if (t <= 0.0)
+            return 0.0;
+        // inverse of diff_to_target(diff / 256): 0xffff * 2^216 / target
+        double scale = 65535.0;
+        for (int i = 0; i < 216; i += 24)
+            scale *= 16777216.0;
+        return scale / t;
+    }
+    //-----------------------------------------------------------------------------
+    inline bool StratumV2Channel::handle(const sv2Frame& frame, sv2Event& out_event)
+    {
+        Sv2Reader in(frame);
+        out_event.type = SV2E_None;
+        out_event.clean = false;
+        out_event.sequence = 0;
+        out_event.count = 0;
+        out_event.port = 0;
+        out_event.text[0] = 0;
+
+        switch (frame.type)
+        {
+            case SV2_SetupConnectionSuccess:
+            {
+                in.u16(); // used version
+                m_fixedVersion = (in.u32() & c_sv2RequiresFixedVersion) != 0;
+                out_event.type = SV2E_SetupDone;
+                break;
+            }
+            case SV2_SetupConnectionError:
+                in.u32(); // flags
+                in.str(out_event.text, sizeof(out_event.text));
+                out_event.type = SV2E_SetupFailed;
+                break;
+            case SV2_OpenStandardMiningChannelSuccess:
+            {
+                in.u32(); // request id
+                m_channelId = in.u32();
+                readTarget(in);
+                unsigned char prefix[32];
+                in.b032(prefix); // extranonce prefix, used by the pool only
+                in.u32(); // group channel id
+                m_open = true;
+                out_event.type = SV2E_ChannelOpened;
+                break;
+            }
+            case SV2_OpenMiningChannelError:
+                in.u32(); // request id
+                in.str(out_event.text, sizeof(out_event.text));
+                out_event.type = SV2E_ChannelFailed;
+                break;
+            case SV2_NewMiningJob:
+            {
+                if (in.u32() != m_channelId)
+                    break;
+                sv2Job job;
+                job.id = in.u32();
+                const bool future = !in.u8();
+                const uint32_t minNtime = future ? 0 : in.u32();
+                job.version = in.u32();
+                if (in.b032(job.merkleRoot) != 32)
+                    return false;
+                if (!in.isValid())
+                    return false;
+
+                if (future)
+                {
+                    // oldest future job is dropped
+                    if (m_numFutureJobs == c_maxFutureJobs)
+                    {
+                        memmove(m_futureJobs, m_futureJobs + 1, sizeof(sv2Job) * (c_maxFutureJobs - 1));
+                        --m_numFutureJobs;
+                    }
+                    m_futureJobs[m_numFutureJobs++] = job;
+                }
+                else if (m_hasPrevHash)
+                {
+                    m_job = job;
+                    m_ntime = minNtime;
+                    m_hasJob = true;
+                    out_event.type = SV2E_Job;
+                }
+                break;
+            }
+            case SV2_SetNewPrevHash:
+            {
+                if (in.u32() != m_channelId)
+                    break;
+                const uint32_t jobId = in.u32();
+                in.u256(m_prevhash);
+                m_prevHashNtime = in.u32();
+                m_nbits = in.u32();
+                if (!in.isValid())
+                    return false;
+                m_hasPrevHash = true;
+
+                // the future job for this block becomes active, all other jobs are stale
+                m_hasJob = false;
+                for (int i = 0; i < m_numFutureJobs; ++i)
+                {
+                    if (m_futureJobs[i].id == jobId)
+                    {
+                        m_job = m_futureJobs[i];
+                        m_ntime = m_prevHashNtime;
+                        m_hasJob = true;
+                    }
+                }
+                m_numFutureJobs = 0;
+                out_event.type = m_hasJob ? SV2E_Job : SV2E_None;
+                out_event.clean = true;
+                break;
+            }
+            case SV2_SetTarget:
+                if (in.u32() != m_channelId)
+                    break;
+                readTarget(in);
+                out_event.type = SV2E_Target;
+                break;
+            case SV2_SubmitSharesSuccess:
+                in.u32(); // channel id
+                out_event.sequence = in.u32();
+                out_event.count = in.u32();
+                in.u64(); // sum of share difficulties
+                out_event.type = SV2E_SharesAccepted;
+                break;
+            case SV2_SubmitSharesError:
+                in.u32(); // channel id
+                out_event.sequence = in.u32();
+                in.str(out_event.text, sizeof(out_event.text));
+                out_event.type = SV2E_ShareRejected;
+                break;
+            case SV2_Reconnect:
+                in.str(out_event.text, sizeof(out_event.text));
+                out_event.port = in.u16();
+                out_event.type = SV2E_Reconnect;
+                break;
+            case SV2_CloseChannel:
+                if (in.u32() != m_channelId)
+                    break;
+                in.str(out_event.text, sizeof(out_event.text));
+                m_open = false;
+                out_event.type = SV2E_ChannelClosed;
+                break;
+            default:
+                // UpdateChannel.Error, SetExtranoncePrefix(standard channels do not use it)...
+                break;
+        }
+        return in.isValid();
+    }
+}
+
+#endif // !StratumV2_INCLUDE_ONCE
@@ -16,6 +16,7 @@
 #include <stdint.h>
 #include <pthread.h> // pthread_mutex
 #include <lyclCore/CLUtils.hpp>
+#include <lyclCore/CpuUtils.hpp>
 #include <lyclCore/Elist.hpp>
 
 struct tq_ent
@@ -41,6 +42,7 @@ struct thr_info
     pthread_attr_t attr;
     thread_q *q;
     lycl::device clDevice; 
+    lycl::cpuDevice cpuDevice;
 };
 
 inline static int thread_create(struct thr_info *thr, void *(*func) (void *))
@@ -32,13 +32,20 @@ namespace lycl
     }
 }
 
+//! value of hex digit (c), -1 if it is not one.
+inline int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+//----------------------------------------------------------------------------
 inline bool hex2bin(unsigned char *p, const char *hexstr, size_t len)
 {
-    char hex_byte[3];
-    char *ep;
-
-    hex_byte[2] = '\0';
-
     while (*hexstr && len)
     {
         if (!hexstr[1])
@@ -46,14 +53,14 @@ inline bool hex2bin(unsigned char *p, const char *hexstr, size_t len)
             Log::print(Log::LT_Error, "hex2bin str truncated");
             return false;
         }
-        hex_byte[0] = hexstr[0];
-        hex_byte[1] = hexstr[1];
-        *p = (unsigned char) strtol(hex_byte, &ep, 16);
-        if (*ep)
+        const int hi = hex_nibble(hexstr[0]);
+        const int lo = hex_nibble(hexstr[1]);
+        if (hi < 0 || lo < 0)
         {
-            Log::print(Log::LT_Error, "hex2bin failed on '%s'", hex_byte);
+            Log::print(Log::LT_Error, "hex2bin failed on '%c%c'", hexstr[0], hexstr[1]);
             return false;
         }
+        *p = (unsigned char) ((hi << 4) | lo);
         p++;
         hexstr += 2;
         len--;
@@ -13,7 +13,7 @@
 #include <lyclCore/WorkIO.hpp>
 
 //-----------------------------------------------------------------------------
-void buildStratumRequest(char* req, work* work_info)
+void buildStratumRequest(char* req, work* work_info, uint32_t id)
 {
     // should be char* instead of unsigned char*
     char *xnonce2str;
@@ -25,8 +25,8 @@ void buildStratumRequest(char* req, work* work_info)
     bin2hex( noncestr, (unsigned char*)(&nonce), sizeof(uint32_t) );
     xnonce2str = abin2hex( work_info->xnonce2, work_info->xnonce2_len );
     snprintf(req, JSON_BUF_LEN,
-             "{\"method\": \"mining.submit\", \"params\": [\"%s\", \"%s\", \"%s\", \"%s\", \"%s\"], \"id\":4}",
-             global::connectionInfo.rpc_user.c_str(), work_info->job_id, xnonce2str, ntimestr, noncestr); 
+             "{\"method\": \"mining.submit\", \"params\": [\"%s\", \"%s\", \"%s\", \"%s\", \"%s\"], \"id\":%u}",
+             global::poolConnection(work_info->pool).rpc_user.c_str(), work_info->job_id, xnonce2str, ntimestr, noncestr, id); 
     free( xnonce2str );
 }
 //-----------------------------------------------------------------------------
@@ -37,16 +37,34 @@ bool submit_upstream_work( CURL *curl, work *work_info )
     int i;
 
     // pass if the previous hash is not the current previous hash
-    if ( memcmp( &work_info->data[1], &global::g_work.data[1], 32 ) )
+    if ( memcmp( &work_info->data[1], &stratum_pool_work(work_info->pool)->data[1], 32 ) )
     {
         if (global::opt_debug)
             Log::print(Log::LT_Debug, "DEBUG: stale work detected, discarding");
         return true;
     }
 
-    buildStratumRequest( req, work_info);
-    if ( !stratum_send_line( &stratum, req ) )
+    // shares go to the pool which sent the job
+    stratum_ctx *sctx = &stratumPools[work_info->pool];
+    if ( !sctx->io.isOpen() && (poolScheduler.isEnabled() || (work_info->pool != poolFailover.active())) )
     {
+        Log::print(Log::LT_Warning, "Share discarded, pool %d is disconnected", work_info->pool);
+        return true;
+    }
+
+    // unique id, the response is matched to this share
+    const uint32_t id = sctx->shares.add( work_info->job_id, work_info->data[NonceIndex], work_info->targetdiff );
+    bool sent;
+    if ( sctx->sv2 )
+        sent = stratumV2Submit( sctx, work_info, id );
+    else
+    {
+        buildStratumRequest( req, work_info, id );
+        sent = stratum_send_line( sctx, req );
+    }
+    if ( !sent )
+    {
+        sctx->shares.cancel( id );
         Log::print(Log::LT_Error, "submit_upstream_work stratum_send_line failed");
         return false;
     }
@@ -68,6 +86,7 @@ bool workio_submit_work(struct workio_cmd *wc, CURL *curl)
         // pause, then restart work-request loop
         Log::print(Log::LT_Error, "...retry after %d seconds", global::opt_failPause);
         sleep(global::opt_failPause);
+        stratumPools[wc->u.work->pool].shares.addRetry();
     }
     return true;
 }
@@ -33,6 +33,20 @@ inline void restart_threads()
 {
     for ( int i = 0; i < global::numWorkerThreads; i++)
         gwork_restart[i].restart = 1;
+    stratumRecorder.record(lycl::SR_Event, "restart");
+}
+//-----------------------------------------------------------------------------
+//! restart worker threads which get work from (pool).
+inline void restart_pool_threads(int pool)
+{
+    if (!poolScheduler.isEnabled())
+    {
+        restart_threads();
+        return;
+    }
+    for ( int i = 0; i < global::numWorkerThreads; i++)
+        if (stratum_thread_pool(i) == pool)
+            gwork_restart[i].restart = 1;
 }
 //-----------------------------------------------------------------------------
 // Work IO
@@ -120,6 +134,14 @@ inline void workio_cmd_free(struct workio_cmd *wc)
 inline bool submit_work(struct thr_info *thr, const work* work_info)
 {
     workio_cmd *wc;
+    // the same share found again(restart, overlapping ranges) would be rejected by the pool
+    const uint64_t key = lycl::ShareFilter::shareKey(work_info->job_id, work_info->xnonce2, work_info->xnonce2_len,
+                                                     work_info->data[NTimeIndex], work_info->data[NonceIndex], work_info->data[0]);
+    if (!stratumPools[work_info->pool].submitted.add(&work_info->data[1], key))
+    {
+        Log::print(Log::LT_Debug, "Duplicate share dropped (job %s, nonce %08x)", work_info->job_id, work_info->data[NonceIndex]);
+        return true;
+    }
     // fill out work request message
     wc = (workio_cmd *)calloc(1, sizeof(*wc));
     if (!wc)
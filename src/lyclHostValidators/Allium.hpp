@@ -0,0 +1,695 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef Allium_INCLUDE_ONCE
+#define Allium_INCLUDE_ONCE
+
+#include <stdint.h>
+#include <cstring> // memcpy
+
+// Host reference of the allium chain: blake256 -> keccak256 -> lyra2 -> cubehash256 -> lyra2 -> skein256 -> groestl256.
+// Written from the algorithm specifications and kept independent from the OpenCL kernels and the SIMD CPU backend,
+// so it can be used to validate their results. It is slow, only use it for found nonces.
+// Every stage works on byte strings, like the reference implementations.
+
+#define REF_ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define REF_ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define REF_ROTL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+#define REF_ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+namespace lycl
+{
+namespace ref
+{
+    inline uint64_t load64le(const uint8_t* p)
+    {
+        uint64_t r = 0;
+        for (int i = 7; i >= 0; --i)
+            r = (r << 8) | p[i];
+        return r;
+    }
+
+    inline void store64le(uint8_t* p, uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i)
+            p[i] = (uint8_t)(v >> (8 * i));
+    }
+    //-----------------------------------------------------------------------------
+    // BLAKE-256 (14 rounds), 80-byte message
+    //-----------------------------------------------------------------------------
+    inline void blake256Compress(uint32_t* h, const uint32_t* m, uint32_t t)
+    {
+        static const uint8_t sigma[10][16] =
+        {
+            {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+            { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+            { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+            {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+            {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+            {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+            { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+            { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+            {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+            { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+        };
+        // first digits of pi
+        static const uint32_t c[16] =
+        {
+            0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344, 0xA4093822, 0x299F31D0, 0x082EFA98, 0xEC4E6C89,
+            0x452821E6, 0x38D01377, 0xBE5466CF, 0x34E90C6C, 0xC0AC29B7, 0xC97C50DD, 0x3F84D5B5, 0xB5470917
+        };
+        // column and diagonal steps: a, b, c, d
+        static const int steps[8][4] =
+        {
+            { 0, 4,  8, 12 }, { 1, 5,  9, 13 }, { 2, 6, 10, 14 }, { 3, 7, 11, 15 },
+            { 0, 5, 10, 15 }, { 1, 6, 11, 12 }, { 2, 7,  8, 13 }, { 3, 4,  9, 14 }
+        };
+
+        uint32_t v[16];
+        for (int i = 0; i < 8; ++i)
+        {
+            v[i] = h[i];
+            v[i + 8] = c[i];
+        }
+        v[12] ^= t;
+        v[13] ^= t;
+
+        for (int r = 0; r < 14; ++r)
+        {
+            const uint8_t* s = sigma[r % 10];
+            for (int i = 0; i < 8; ++i)
+            {
+                uint32_t& a = v[steps[i][0]];
+                uint32_t& b = v[steps[i][1]];
+                uint32_t& cc = v[steps[i][2]];
+                uint32_t& d = v[steps[i][3]];
+                a += b + (m[s[2 * i]] ^ c[s[2 * i + 1]]);
+                d = REF_ROTR32(d ^ a, 16);
+                cc += d;
+                b = REF_ROTR32(b ^ cc, 12);
+                a += b + (m[s[2 * i + 1]] ^ c[s[2 * i]]);
+                d = REF_ROTR32(d ^ a, 8);
+                cc += d;
+                b = REF_ROTR32(b ^ cc, 7);
+            }
+        }
+
+        for (int i = 0; i < 8; ++i)
+            h[i] ^= v[i] ^ v[i + 8];
+    }
+
+    //! (header) is a block header as 20 big-endian words(same as work data).
+    inline void blake256(const uint32_t* header, uint8_t* out)
+    {
+        uint32_t h[8] =
+        {
+            0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+            0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+        };
+
+        uint32_t m[16];
+        for (int i = 0; i < 16; ++i)
+            m[i] = header[i];
+        blake256Compress(h, m, 512);
+
+        // last block: 16 bytes of data, padding and the message length in bits
+        memset(m, 0, sizeof(m));
+        for (int i = 0; i < 4; ++i)
+            m[i] = header[16 + i];
+        m[4] = 0x80000000;
+        m[13] = 1;
+        m[15] = 640;
+        blake256Compress(h, m, 640);
+
+        for (int i = 0; i < 8; ++i)
+        {
+            out[4 * i + 0] = (uint8_t)(h[i] >> 24);
+            out[4 * i + 1] = (uint8_t)(h[i] >> 16);
+            out[4 * i + 2] = (uint8_t)(h[i] >> 8);
+            out[4 * i + 3] = (uint8_t)(h[i]);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    // Keccak-256 (keccak-f[1600], original padding), 32-byte message
+    //-----------------------------------------------------------------------------
+    //! round constant bit from the LFSR defined in the specification.
+    inline bool keccakRcBit(int t)
+    {
+        uint32_t r = 1;
+        for (int i = 0; i < (t % 255); ++i)
+        {
+            r <<= 1;
+            if (r & 0x100)
+                r ^= 0x171;
+        }
+        return (r & 1) != 0;
+    }
+
+    inline void keccakF1600(uint64_t* a)
+    {
+        // rho offsets
+        int rho[25] = { 0 };
+        int x = 1, y = 0;
+        for (int t = 0; t < 24; ++t)
+        {
+            rho[x + 5 * y] = ((t + 1) * (t + 2) / 2) % 64;
+            const int ny = (2 * x + 3 * y) % 5;
+            x = y;
+            y = ny;
+        }
+
+        for (int round = 0; round < 24; ++round)
+        {
+            // theta
+            uint64_t c[5], d[5];
+            for (x = 0; x < 5; ++x)
+                c[x] = a[x] ^ a[x + 5] ^ a[x + 10] ^ a[x + 15] ^ a[x + 20];
+            for (x = 0; x < 5; ++x)
+            {
+                d[x] = c[(x + 4) % 5] ^ ((c[(x + 1) % 5] << 1) | (c[(x + 1) % 5] >> 63));
+                for (y = 0; y < 5; ++y)
+                    a[x + 5 * y] ^= d[x];
+            }
+            // rho and pi
+            uint64_t b[25];
+            for (x = 0; x < 5; ++x)
+            {
+                for (y = 0; y < 5; ++y)
+                {
+                    const uint64_t v = a[x + 5 * y];
+                    const int r = rho[x + 5 * y];
+                    b[y + 5 * ((2 * x + 3 * y) % 5)] = r ? REF_ROTL64(v, r) : v;
+                }
+            }
+            // chi
+            for (x = 0; x < 5; ++x)
+                for (y = 0; y < 5; ++y)
+                    a[x + 5 * y] = b[x + 5 * y] ^ (~b[(x + 1) % 5 + 5 * y] & b[(x + 2) % 5 + 5 * y]);
+            // iota
+            for (int j = 0; j < 7; ++j)
+            {
+                if (keccakRcBit(j + 7 * round))
+                    a[0] ^= 1ULL << ((1 << j) - 1);
+            }
+        }
+    }
+
+    inline void keccak256(const uint8_t* in, uint8_t* out)
+    {
+        // rate: 136 bytes
+        uint8_t block[136];
+        memset(block, 0, sizeof(block));
+        memcpy(block, in, 32);
+        block[32] = 0x01;
+        block[135] |= 0x80;
+
+        uint64_t a[25];
+        memset(a, 0, sizeof(a));
+        for (int i = 0; i < 17; ++i)
+            a[i] ^= load64le(block + 8 * i);
+        keccakF1600(a);
+
+        for (int i = 0; i < 4; ++i)
+            store64le(out + 8 * i, a[i]);
+    }
+    //-----------------------------------------------------------------------------
+    // Lyra2 (timeCost = 1, 32-byte password, salt and output)
+    //-----------------------------------------------------------------------------
+    //! largest supported matrix
+    const int c_lyraMaxRows = 8;
+    const int c_lyraMaxCols = 8;
+    //! words per column(block)
+    const int c_lyraBlockWords = 12;
+
+    inline void lyraG(uint64_t& a, uint64_t& b, uint64_t& c, uint64_t& d)
+    {
+        a += b; d = REF_ROTR64(d ^ a, 32);
+        c += d; b = REF_ROTR64(b ^ c, 24);
+        a += b; d = REF_ROTR64(d ^ a, 16);
+        c += d; b = REF_ROTR64(b ^ c, 63);
+    }
+
+    //! one round of the blake2b based sponge.
+    inline void lyraRound(uint64_t* v)
+    {
+        lyraG(v[0], v[4], v[ 8], v[12]);
+        lyraG(v[1], v[5], v[ 9], v[13]);
+        lyraG(v[2], v[6], v[10], v[14]);
+        lyraG(v[3], v[7], v[11], v[15]);
+        lyraG(v[0], v[5], v[10], v[15]);
+        lyraG(v[1], v[6], v[11], v[12]);
+        lyraG(v[2], v[7], v[ 8], v[13]);
+        lyraG(v[3], v[4], v[ 9], v[14]);
+    }
+
+    inline void reducedSqueezeRow0(uint64_t* state, uint64_t* row_out, int n_cols)
+    {
+        uint64_t* out = row_out + (n_cols - 1) * c_lyraBlockWords;
+        for (int i = 0; i < n_cols; ++i)
+        {
+            for (int j = 0; j < c_lyraBlockWords; ++j)
+                out[j] = state[j];
+            out -= c_lyraBlockWords;
+            lyraRound(state);
+        }
+    }
+
+    inline void reducedDuplexRow1(uint64_t* state, const uint64_t* row_in, uint64_t* row_out, int n_cols)
+    {
+        const uint64_t* in = row_in;
+        uint64_t* out = row_out + (n_cols - 1) * c_lyraBlockWords;
+        for (int i = 0; i < n_cols; ++i)
+        {
+            for (int j = 0; j < c_lyraBlockWords; ++j)
+                state[j] ^= in[j];
+            lyraRound(state);
+            for (int j = 0; j < c_lyraBlockWords; ++j)
+                out[j] = in[j] ^ state[j];
+            in += c_lyraBlockWords;
+            out -= c_lyraBlockWords;
+        }
+    }
+
+    inline void reducedDuplexRowSetup(uint64_t* state, const uint64_t* row_in, uint64_t* row_inout, uint64_t* row_out, int n_cols)
+    {
+        const uint64_t* in = row_in;
+        uint64_t* inOut = row_inout;
+        uint64_t* out = row_out + (n_cols - 1) * c_lyraBlockWords;
+        for (int i = 0; i < n_cols; ++i)
+        {
+            for (int j = 0; j < c_lyraBlockWords; ++j)
+                state[j] ^= in[j] + inOut[j];
+            lyraRound(state);
+            for (int j = 0; j < c_lyraBlockWords; ++j)
+                out[j] = in[j] ^ state[j];
+            // rotW
+            for (int j = 0; j < c_lyraBlockWords; ++j)
+                inOut[j] ^= state[(j + c_lyraBlockWords - 1) % c_lyraBlockWords];
+            in += c_lyraBlockWords;
+            inOut += c_lyraBlockWords;
+            out -= c_lyraBlockWords;
+        }
+    }
+
+    inline void reducedDuplexRow(uint64_t* state, const uint64_t* row_in, uint64_t* row_inout, uint64_t* row_out, int n_cols)
+    {
+        const uint64_t* in = row_in;
+        uint64_t* inOut = row_inout;
+        uint64_t* out = row_out;
+        for (int i = 0; i < n_cols; ++i)
+        {
+            for (int j = 0; j < c_lyraBlockWords; ++j)
+                state[j] ^= in[j] + inOut[j];
+            lyraRound(state);
+            for (int j = 0; j < c_lyraBlockWords; ++j)
+                out[j] ^= state[j];
+            // rowInOut may alias rowOut
+            for (int j = 0; j < c_lyraBlockWords; ++j)
+                inOut[j] ^= state[(j + c_lyraBlockWords - 1) % c_lyraBlockWords];
+            in += c_lyraBlockWords;
+            inOut += c_lyraBlockWords;
+            out += c_lyraBlockWords;
+        }
+    }
+
+    //! Lyra2 with password = salt = (in).
+    //! (absorb_basil): false for Lyra2RE(v1), which runs both absorb rounds without the basil block.
+    inline void lyra2Sponge(const uint8_t* in, uint8_t* out, int n_rows, int n_cols, bool absorb_basil)
+    {
+        static const uint64_t blake2bIV[8] =
+        {
+            0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+            0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+        };
+
+        const int rowWords = c_lyraBlockWords * n_cols;
+        uint64_t matrix[c_lyraMaxRows * c_lyraMaxCols * c_lyraBlockWords];
+        uint64_t state[16];
+
+        // absorb (password | salt)
+        for (int i = 0; i < 4; ++i)
+        {
+            state[i] = load64le(in + 8 * i);
+            state[i + 4] = state[i];
+        }
+        for (int i = 0; i < 8; ++i)
+            state[i + 8] = blake2bIV[i];
+        for (int i = 0; i < 12; ++i)
+            lyraRound(state);
+
+        // absorb basil: output, password and salt lengths, timeCost, nRows, nCols and padding
+        if (absorb_basil)
+        {
+            state[0] ^= 32;
+            state[1] ^= 32;
+            state[2] ^= 32;
+            state[3] ^= 1;
+            state[4] ^= (uint64_t)n_rows;
+            state[5] ^= (uint64_t)n_cols;
+            state[6] ^= 0x80;
+            state[7] ^= 0x0100000000000000ULL;
+        }
+        for (int i = 0; i < 12; ++i)
+            lyraRound(state);
+
+        // setup phase
+        reducedSqueezeRow0(state, matrix, n_cols);
+        reducedDuplexRow1(state, matrix, matrix + rowWords, n_cols);
+
+        int prev = 1;
+        int rowa = 0;
+        int step = 1;
+        int window = 2;
+        int gap = 1;
+        for (int row = 2; row < n_rows; ++row)
+        {
+            reducedDuplexRowSetup(state, matrix + prev * rowWords, matrix + rowa * rowWords, matrix + row * rowWords, n_cols);
+            rowa = (rowa + step) & (window - 1);
+            prev = row;
+            if (rowa == 0)
+            {
+                step = window + gap;
+                window *= 2;
+                gap = -gap;
+            }
+        }
+
+        // wandering phase (timeCost = 1)
+        int row = 0;
+        step = n_rows / 2 - 1;
+        do
+        {
+            rowa = (int)(state[0] % (uint64_t)n_rows);
+            reducedDuplexRow(state, matrix + prev * rowWords, matrix + rowa * rowWords, matrix + row * rowWords, n_cols);
+            prev = row;
+            row = (row + step) % n_rows;
+        } while (row != 0);
+
+        // wrap-up: absorb the first block of the last visited rowa
+        for (int j = 0; j < c_lyraBlockWords; ++j)
+            state[j] ^= matrix[rowa * rowWords + j];
+        for (int i = 0; i < 12; ++i)
+            lyraRound(state);
+
+        for (int i = 0; i < 4; ++i)
+            store64le(out + 8 * i, state[i]);
+    }
+
+    //! Lyra2RE variant used by allium: 8 rows, 8 columns.
+    inline void lyra2(const uint8_t* in, uint8_t* out)
+    {
+        lyra2Sponge(in, out, 8, 8, false);
+    }
+    //-----------------------------------------------------------------------------
+    // CubeHash16/32-256, 32-byte message
+    //-----------------------------------------------------------------------------
+    inline void cubeHashRounds(uint32_t* x, int num_rounds)
+    {
+        uint32_t y[16];
+        for (int r = 0; r < num_rounds; ++r)
+        {
+            for (int i = 0; i < 16; ++i) x[i + 16] += x[i];
+            for (int i = 0; i < 16; ++i) y[i ^ 8] = x[i];
+            for (int i = 0; i < 16; ++i) x[i] = REF_ROTL32(y[i], 7);
+            for (int i = 0; i < 16; ++i) x[i] ^= x[i + 16];
+            for (int i = 0; i < 16; ++i) y[i ^ 2] = x[i + 16];
+            for (int i = 0; i < 16; ++i) x[i + 16] = y[i];
+            for (int i = 0; i < 16; ++i) x[i + 16] += x[i];
+            for (int i = 0; i < 16; ++i) y[i ^ 4] = x[i];
+            for (int i = 0; i < 16; ++i) x[i] = REF_ROTL32(y[i], 11);
+            for (int i = 0; i < 16; ++i) x[i] ^= x[i + 16];
+            for (int i = 0; i < 16; ++i) y[i ^ 1] = x[i + 16];
+            for (int i = 0; i < 16; ++i) x[i + 16] = y[i];
+        }
+    }
+
+    inline void cubeHash256(const uint8_t* in, uint8_t* out)
+    {
+        // initial state: h/8, b, r followed by 10r rounds
+        uint32_t x[32];
+        memset(x, 0, sizeof(x));
+        x[0] = 32;
+        x[1] = 32;
+        x[2] = 16;
+        cubeHashRounds(x, 160);
+
+        // one 32-byte message block
+        for (int i = 0; i < 8; ++i)
+            x[i] ^= (uint32_t)in[4 * i] | ((uint32_t)in[4 * i + 1] << 8) | ((uint32_t)in[4 * i + 2] << 16) | ((uint32_t)in[4 * i + 3] << 24);
+        cubeHashRounds(x, 16);
+        // padding block
+        x[0] ^= 0x80;
+        cubeHashRounds(x, 16);
+        // finalization
+        x[31] ^= 1;
+        cubeHashRounds(x, 160);
+
+        for (int i = 0; i < 8; ++i)
+        {
+            out[4 * i + 0] = (uint8_t)(x[i]);
+            out[4 * i + 1] = (uint8_t)(x[i] >> 8);
+            out[4 * i + 2] = (uint8_t)(x[i] >> 16);
+            out[4 * i + 3] = (uint8_t)(x[i] >> 24);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    // Skein-512-256 (Skein 1.3), 32-byte message
+    //-----------------------------------------------------------------------------
+    //! UBI with Threefish-512. (h) is the chaining value, (m) a 64-byte block.
+    inline void skeinUbi512(uint64_t* h, const uint8_t* m, uint64_t t0, uint64_t t1)
+    {
+        static const int rot[8][4] =
+        {
+            { 46, 36, 19, 37 }, { 33, 27, 14, 42 }, { 17, 49, 36, 39 }, { 44,  9, 54, 56 },
+            { 39, 30, 34, 24 }, { 13, 50, 10, 17 }, { 25, 29, 39, 43 }, {  8, 35, 56, 22 }
+        };
+        static const int perm[8] = { 2, 1, 4, 7, 6, 5, 0, 3 };
+
+        uint64_t k[9], t[3], p[8], v[8];
+        k[8] = 0x1BD11BDAA9FC1A22ULL;
+        for (int i = 0; i < 8; ++i)
+        {
+            k[i] = h[i];
+            k[8] ^= h[i];
+            p[i] = load64le(m + 8 * i);
+            v[i] = p[i];
+        }
+        t[0] = t0;
+        t[1] = t1;
+        t[2] = t0 ^ t1;
+
+        for (int d = 0; d < 72; ++d)
+        {
+            // subkey injection every 4 rounds
+            if ((d % 4) == 0)
+            {
+                const int s = d / 4;
+                for (int i = 0; i < 8; ++i)
+                    v[i] += k[(s + i) % 9];
+                v[5] += t[s % 3];
+                v[6] += t[(s + 1) % 3];
+                v[7] += (uint64_t)s;
+            }
+
+            for (int j = 0; j < 4; ++j)
+            {
+                v[2 * j] += v[2 * j + 1];
+                v[2 * j + 1] = REF_ROTL64(v[2 * j + 1], rot[d % 8][j]) ^ v[2 * j];
+            }
+
+            uint64_t f[8];
+            for (int i = 0; i < 8; ++i)
+                f[i] = v[perm[i]];
+            memcpy(v, f, sizeof(v));
+        }
+
+        for (int i = 0; i < 8; ++i)
+            v[i] += k[(18 + i) % 9];
+        v[5] += t[18 % 3];
+        v[6] += t[19 % 3];
+        v[7] += 18;
+
+        for (int i = 0; i < 8; ++i)
+            h[i] = v[i] ^ p[i];
+    }
+
+    inline void skein256(const uint8_t* in, uint8_t* out)
+    {
+        // tweak flags
+        const uint64_t first = 1ULL << 62;
+        const uint64_t last = 1ULL << 63;
+        const uint64_t typeCfg = 4ULL << 56;
+        const uint64_t typeMsg = 48ULL << 56;
+        const uint64_t typeOut = 63ULL << 56;
+
+        uint64_t h[8];
+        uint8_t block[64];
+        memset(h, 0, sizeof(h));
+
+        // configuration block: schema "SHA3", version 1, output length 256 bits
+        memset(block, 0, sizeof(block));
+        store64le(block, 0x0000000133414853ULL);
+        store64le(block + 8, 256);
+        skeinUbi512(h, block, 32, first | last | typeCfg);
+
+        // message
+        memset(block, 0, sizeof(block));
+        memcpy(block, in, 32);
+        skeinUbi512(h, block, 32, first | last | typeMsg);
+
+        // output, counter 0
+        memset(block, 0, sizeof(block));
+        skeinUbi512(h, block, 8, first | last | typeOut);
+
+        for (int i = 0; i < 4; ++i)
+            store64le(out + 8 * i, h[i]);
+    }
+    //-----------------------------------------------------------------------------
+    // Groestl-256, 32-byte message
+    //-----------------------------------------------------------------------------
+    //! multiplication in GF(2^8) with the AES polynomial.
+    inline uint8_t gfMul(uint8_t a, uint8_t b)
+    {
+        uint8_t r = 0;
+        while (b)
+        {
+            if (b & 1)
+                r ^= a;
+            a = (uint8_t)((a << 1) ^ ((a & 0x80) ? 0x1B : 0x00));
+            b >>= 1;
+        }
+        return r;
+    }
+
+    //! (s) is a column-major 8x8 byte matrix, s[column * 8 + row].
+    inline void groestlPerm(uint8_t* s, bool perm_q)
+    {
+        static const uint8_t sbox[256] =
+        {
+            0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+            0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+            0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+            0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+            0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+            0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+            0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+            0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+            0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+            0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+            0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+            0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+            0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+            0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+            0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+            0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+        };
+        static const int shiftP[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+        static const int shiftQ[8] = { 1, 3, 5, 7, 0, 2, 4, 6 };
+        static const uint8_t mix[8] = { 2, 2, 3, 4, 5, 3, 5, 7 };
+        const int* shift = perm_q ? shiftQ : shiftP;
+
+        uint8_t t[64];
+        for (int r = 0; r < 10; ++r)
+        {
+            // AddRoundConstant
+            for (int col = 0; col < 8; ++col)
+            {
+                if (perm_q)
+                {
+                    for (int row = 0; row < 7; ++row)
+                        s[col * 8 + row] ^= 0xFF;
+                    s[col * 8 + 7] ^= (uint8_t)(0xFF ^ (col << 4) ^ r);
+                }
+                else
+                    s[col * 8] ^= (uint8_t)((col << 4) ^ r);
+            }
+            // SubBytes
+            for (int i = 0; i < 64; ++i)
+                s[i] = sbox[s[i]];
+            // ShiftBytes
+            for (int col = 0; col < 8; ++col)
+                for (int row = 0; row < 8; ++row)
+                    t[col * 8 + row] = s[((col + shift[row]) % 8) * 8 + row];
+            // MixBytes
+            for (int col = 0; col < 8; ++col)
+            {
+                for (int row = 0; row < 8; ++row)
+                {
+                    uint8_t v = 0;
+                    for (int k = 0; k < 8; ++k)
+                        v ^= gfMul(mix[(k - row + 8) % 8], t[col * 8 + k]);
+                    s[col * 8 + row] = v;
+                }
+            }
+        }
+    }
+
+    inline void groestl256(const uint8_t* in, uint8_t* out)
+    {
+        uint8_t h[64], m[64], p[64];
+        // IV: output length in bits
+        memset(h, 0, sizeof(h));
+        h[62] = 0x01;
+
+        // padded message: 0x80, block count(1) as a 64-bit big-endian number
+        memset(m, 0, sizeof(m));
+        memcpy(m, in, 32);
+        m[32] = 0x80;
+        m[63] = 0x01;
+
+        // f(h, m) = P(h ^ m) ^ Q(m) ^ h
+        for (int i = 0; i < 64; ++i)
+            p[i] = h[i] ^ m[i];
+        groestlPerm(p, false);
+        groestlPerm(m, true);
+        for (int i = 0; i < 64; ++i)
+            h[i] ^= p[i] ^ m[i];
+
+        // output transformation: trunc(P(h) ^ h)
+        memcpy(p, h, sizeof(p));
+        groestlPerm(p, false);
+        for (int i = 0; i < 32; ++i)
+            out[i] = p[32 + i] ^ h[32 + i];
+    }
+    //-----------------------------------------------------------------------------
+    // allium
+    //-----------------------------------------------------------------------------
+    //! Computes allium chain up to the final(groestl256) stage.
+    //! Same value as kept in the device hash storage after a run.
+    inline void alliumHashNoGroestl(const uint32_t* header, uint8_t* out)
+    {
+        uint8_t a[32], b[32];
+        blake256(header, a);
+        keccak256(a, b);
+        lyra2(b, a);
+        cubeHash256(a, b);
+        lyra2(b, a);
+        skein256(a, out);
+    }
+    //-----------------------------------------------------------------------------
+    //! Computes allium hash of a block header(20 words, nonce in header[19]).
+    //! (out_hash) receives 8 little-endian words, h[7] is the most significant.
+    inline void alliumHash(const uint32_t* header, uint32_t* out_hash)
+    {
+        uint8_t a[32], b[32];
+        alliumHashNoGroestl(header, b);
+        groestl256(b, a);
+
+        for (int i = 0; i < 8; ++i)
+            out_hash[i] = (uint32_t)a[4 * i] | ((uint32_t)a[4 * i + 1] << 8) | ((uint32_t)a[4 * i + 2] << 16) | ((uint32_t)a[4 * i + 3] << 24);
+    }
+} // namespace ref
+} // namespace lycl
+
+#undef REF_ROTL32
+#undef REF_ROTR32
+#undef REF_ROTL64
+#undef REF_ROTR64
+
+#endif // !Allium_INCLUDE_ONCE
@@ -10,7 +10,8 @@
 #ifndef BMW_INCLUDE_ONCE
 #define BMW_INCLUDE_ONCE
 
-#include <lyclApplets/AppLyra2REv2.hpp>
+#include <stdint.h>
+#include <stddef.h>
 
 namespace lycl
 {
@@ -34,7 +35,7 @@ namespace lycl
     #define rs7(x) SPH_ROTL32((x), 27)
     //-----------------------------------------------------------------------------
     // Message expansion function 1
-    uint32_t expand32_1(size_t i, uint32_t* M32, uint32_t* H, uint32_t* Q)
+    inline uint32_t expand32_1(size_t i, uint32_t* M32, uint32_t* H, uint32_t* Q)
     {
         return (ss1(Q[i - 16]) + ss2(Q[i - 15]) + ss3(Q[i - 14]) + ss0(Q[i - 13])
                 + ss1(Q[i - 12]) + ss2(Q[i - 11]) + ss3(Q[i - 10]) + ss0(Q[i - 9])
@@ -44,7 +45,7 @@ namespace lycl
     }
     //-----------------------------------------------------------------------------
     // Message expansion function 2
-    uint32_t expand32_2(size_t i, uint32_t* M32, uint32_t* H, uint32_t* Q)
+    inline uint32_t expand32_2(size_t i, uint32_t* M32, uint32_t* H, uint32_t* Q)
     {
         return (Q[i - 16] + rs1(Q[i - 15]) + Q[i - 14] + rs2(Q[i - 13])
                 + Q[i - 12] + rs3(Q[i - 11]) + Q[i - 10] + rs4(Q[i - 9])
@@ -53,7 +54,7 @@ namespace lycl
                 + ((i*(0x05555555ul) + SPH_ROTL32(M32[(i - 16) % 16], ((i - 16) % 16) + 1) + SPH_ROTL32(M32[(i - 13) % 16], ((i - 13) % 16) + 1) - SPH_ROTL32(M32[(i - 6) % 16], ((i - 6) % 16) + 1)) ^ H[(i - 16 + 7) % 16]));
     }
     //-----------------------------------------------------------------------------
-    void compression256(uint32_t* M32, uint32_t* H)
+    inline void compression256(uint32_t* M32, uint32_t* H)
     {
         uint32_t XL32, XH32, Q[32];
 
@@ -133,7 +134,8 @@ namespace lycl
         H[15] = SPH_ROTL32(H[3], 16) + (XH32 ^ Q[31] ^ M32[15]) + (shr(XL32, 2) ^ Q[22] ^ Q[15]);
     }
     //-----------------------------------------------------------------------------
-    void bmwHash(const lyraHash& hash_input, lyraHash& hash_output)
+    //! BMW-256 of a 32-byte message. (hash_input) and (hash_output) hold 8 words.
+    inline void bmwHash(const uint32_t* hash_input, uint32_t* hash_output)
     {
         uint32_t dh[16] = {
             0x40414243U, 0x44454647U,
@@ -156,28 +158,28 @@ namespace lycl
 
         uint32_t message[16] = { 0 };
 
-        message[ 0] = hash_input.h[0];
-        message[ 1] = hash_input.h[1];
-        message[ 2] = hash_input.h[2];
-        message[ 3] = hash_input.h[3];
-        message[ 4] = hash_input.h[4];
-        message[ 5] = hash_input.h[5];
-        message[ 6] = hash_input.h[6];
-        message[ 7] = hash_input.h[7];
+        message[ 0] = hash_input[0];
+        message[ 1] = hash_input[1];
+        message[ 2] = hash_input[2];
+        message[ 3] = hash_input[3];
+        message[ 4] = hash_input[4];
+        message[ 5] = hash_input[5];
+        message[ 6] = hash_input[6];
+        message[ 7] = hash_input[7];
         message[ 8] = 0x80;
         message[14] = 0x100;
 
         compression256(message, dh);
         compression256(dh, final_s);
         
-        hash_output.h[0] = final_s[8];
-        hash_output.h[1] = final_s[9];
-        hash_output.h[2] = final_s[10];
-        hash_output.h[3] = final_s[11];
-        hash_output.h[4] = final_s[12];
-        hash_output.h[5] = final_s[13];
-        hash_output.h[6] = final_s[14];
-        hash_output.h[7] = final_s[15];
+        hash_output[0] = final_s[8];
+        hash_output[1] = final_s[9];
+        hash_output[2] = final_s[10];
+        hash_output[3] = final_s[11];
+        hash_output[4] = final_s[12];
+        hash_output[5] = final_s[13];
+        hash_output[6] = final_s[14];
+        hash_output[7] = final_s[15];
     }
     //-----------------------------------------------------------------------------
 }
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef Lyra2REv2_INCLUDE_ONCE
+#define Lyra2REv2_INCLUDE_ONCE
+
+#include <lyclHostValidators/Allium.hpp>
+#include <lyclHostValidators/BMW.hpp>
+
+// Host reference of the Lyra2REv2 chain: blake256 -> keccak256 -> cubehash256 -> lyra2(v2) -> skein256 -> cubehash256 -> bmw256.
+// Shares primitives with the allium reference.
+
+namespace lycl
+{
+namespace ref
+{
+    //! Lyra2 v2 used by Lyra2REv2: 4 rows, 4 columns, basil is absorbed.
+    inline void lyra2v2(const uint8_t* in, uint8_t* out)
+    {
+        lyra2Sponge(in, out, 4, 4, true);
+    }
+    //-----------------------------------------------------------------------------
+    inline void bmw256(const uint8_t* in, uint8_t* out)
+    {
+        uint32_t words[8];
+        memcpy(words, in, 32);
+        bmwHash(words, words);
+        memcpy(out, words, 32);
+    }
+    //-----------------------------------------------------------------------------
+    //! Computes Lyra2REv2 hash of a block header(20 words, nonce in header[19]).
+    inline void lyra2REv2Hash(const uint32_t* header, uint32_t* out_hash)
+    {
+        uint8_t a[32], b[32];
+        blake256(header, a);
+        keccak256(a, b);
+        cubeHash256(b, a);
+        lyra2v2(a, b);
+        skein256(b, a);
+        cubeHash256(a, b);
+        bmw256(b, a);
+        memcpy(out_hash, a, 32);
+    }
+} // namespace ref
+} // namespace lycl
+
+#endif // !Lyra2REv2_INCLUDE_ONCE
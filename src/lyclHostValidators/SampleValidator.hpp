@@ -0,0 +1,287 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef SampleValidator_INCLUDE_ONCE
+#define SampleValidator_INCLUDE_ONCE
+
+#include <vector>
+#include <deque>
+#include <algorithm> // min
+#include <cstring> // memcpy, memcmp
+#include <pthread.h>
+#include <lyclHostValidators/Allium.hpp>
+
+// Sampled in-production validation.
+// Worker threads read back a few random hashes after each run, a pool of host threads recomputes them
+// with the reference allium and counts silent errors(wrong results which never become shares).
+// An unstable overclock shows up here within seconds instead of as a higher reject rate hours later.
+
+namespace lycl
+{
+    //! samples of a single device run.
+    struct sampleBatch
+    {
+        int32_t deviceIndex;
+        //! block header, nonce(header[19]) is set per sample.
+        uint32_t header[20];
+        uint32_t firstNonce;
+        //! run local indices(nonce = firstNonce + index).
+        std::vector<uint32_t> indices;
+        //! device hash storage content, 8 words per index.
+        std::vector<uint32_t> hashes;
+    };
+
+    //! per device counters.
+    struct sampleStats
+    {
+        uint64_t numChecked;
+        uint64_t numErrors;
+        //! batches dropped because the validator was busy.
+        uint64_t numDropped;
+        //! throttle level used for backoff, 0: disabled.
+        uint32_t backoffLevel;
+    };
+
+    //-----------------------------------------------------------------------------
+    // SampleValidator class declaration.
+    //-----------------------------------------------------------------------------
+    class SampleValidator
+    {
+    public:
+        //! samples in one backoff decision window.
+        static const uint64_t c_backoffWindow = 1024;
+        //! clean windows required to lower the backoff level.
+        static const uint32_t c_backoffRecoveryWindows = 4;
+        //! highest backoff level. Each level idles a device for 1/8 of its run time.
+        static const uint32_t c_maxBackoffLevel = 8;
+
+        inline SampleValidator();
+        inline ~SampleValidator();
+
+        //! start (num_threads) validation threads for (num_devices) devices.
+        inline bool start(int num_threads, int num_devices, bool enable_backoff);
+        //! stop all threads. Queued batches are discarded.
+        inline void stop();
+        //! true if threads are running.
+        bool isRunning() const { return !m_threads.empty(); }
+        //! queue (batch) for validation, its content is moved out. Dropped if the queue is full.
+        inline void push(sampleBatch& batch);
+        //! get counters of a device.
+        inline void getStats(int device_index, sampleStats& out_stats);
+        //! current backoff level of a device(0..c_maxBackoffLevel).
+        inline uint32_t getBackoffLevel(int device_index);
+
+    private:
+        SampleValidator(const SampleValidator&);
+        SampleValidator& operator=(const SampleValidator&);
+
+        static inline void* threadFunc(void* userdata);
+        inline void process(const sampleBatch& batch);
+
+        struct deviceState
+        {
+            sampleStats stats;
+            uint64_t windowChecked;
+            uint64_t windowErrors;
+            uint32_t cleanWindows;
+        };
+
+        pthread_mutex_t m_mutex;
+        pthread_cond_t m_cond;
+        std::deque<sampleBatch> m_queue;
+        size_t m_maxQueuedBatches;
+        std::vector<pthread_t> m_threads;
+        std::vector<deviceState> m_devices;
+        bool m_enableBackoff;
+        bool m_stopping;
+    };
+    //-----------------------------------------------------------------------------
+    // SampleValidator class inline methods implementation.
+    //-----------------------------------------------------------------------------
+    inline SampleValidator::SampleValidator()
+        : m_maxQueuedBatches(0)
+        , m_enableBackoff(false)
+        , m_stopping(false)
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+        pthread_cond_init(&m_cond, NULL);
+    }
+    //-----------------------------------------------------------------------------
+    inline SampleValidator::~SampleValidator()
+    {
+        stop();
+        pthread_cond_destroy(&m_cond);
+        pthread_mutex_destroy(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline bool SampleValidator::start(int num_threads, int num_devices, bool enable_backoff)
+    {
+        if (num_threads <= 0 || num_devices <= 0)
+            return false;
+
+        stop();
+
+        deviceState initState;
+        memset(&initState, 0, sizeof(initState));
+        m_devices.assign((size_t)num_devices, initState);
+        // keep latency low, a stale sample is as useful as a dropped one.
+        m_maxQueuedBatches = 2 * (size_t)num_devices;
+        m_enableBackoff = enable_backoff;
+        m_stopping = false;
+
+        for (int i = 0; i < num_threads; ++i)
+        {
+            pthread_t thread;
+            if (pthread_create(&thread, NULL, threadFunc, this))
+            {
+                stop();
+                return false;
+            }
+            m_threads.push_back(thread);
+        }
+
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    inline void SampleValidator::stop()
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_stopping = true;
+        pthread_cond_broadcast(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+
+        for (size_t i = 0; i < m_threads.size(); ++i)
+            pthread_join(m_threads[i], NULL);
+        m_threads.clear();
+        m_queue.clear();
+    }
+    //-----------------------------------------------------------------------------
+    inline void SampleValidator::push(sampleBatch& batch)
+    {
+        pthread_mutex_lock(&m_mutex);
+        if ((size_t)batch.deviceIndex >= m_devices.size())
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return;
+        }
+
+        if (m_threads.empty() || m_queue.size() >= m_maxQueuedBatches)
+            ++m_devices[(size_t)batch.deviceIndex].stats.numDropped;
+        else
+        {
+            m_queue.push_back(sampleBatch());
+            sampleBatch& queued = m_queue.back();
+            queued.deviceIndex = batch.deviceIndex;
+            memcpy(queued.header, batch.header, sizeof(queued.header));
+            queued.firstNonce = batch.firstNonce;
+            queued.indices.swap(batch.indices);
+            queued.hashes.swap(batch.hashes);
+            pthread_cond_signal(&m_cond);
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline void SampleValidator::getStats(int device_index, sampleStats& out_stats)
+    {
+        pthread_mutex_lock(&m_mutex);
+        if ((size_t)device_index < m_devices.size())
+            out_stats = m_devices[(size_t)device_index].stats;
+        else
+            memset(&out_stats, 0, sizeof(out_stats));
+        pthread_mutex_unlock(&m_mutex);
+    }
+    //-----------------------------------------------------------------------------
+    inline uint32_t SampleValidator::getBackoffLevel(int device_index)
+    {
+        uint32_t level = 0;
+        pthread_mutex_lock(&m_mutex);
+        if ((size_t)device_index < m_devices.size())
+            level = m_devices[(size_t)device_index].stats.backoffLevel;
+        pthread_mutex_unlock(&m_mutex);
+        return level;
+    }
+    //-----------------------------------------------------------------------------
+    inline void* SampleValidator::threadFunc(void* userdata)
+    {
+        SampleValidator* validator = (SampleValidator*)userdata;
+        sampleBatch batch;
+
+        for (;;)
+        {
+            pthread_mutex_lock(&validator->m_mutex);
+            while (!validator->m_stopping && validator->m_queue.empty())
+                pthread_cond_wait(&validator->m_cond, &validator->m_mutex);
+            if (validator->m_stopping)
+            {
+                pthread_mutex_unlock(&validator->m_mutex);
+                break;
+            }
+
+            sampleBatch& front = validator->m_queue.front();
+            batch.deviceIndex = front.deviceIndex;
+            memcpy(batch.header, front.header, sizeof(batch.header));
+            batch.firstNonce = front.firstNonce;
+            batch.indices.swap(front.indices);
+            batch.hashes.swap(front.hashes);
+            validator->m_queue.pop_front();
+            pthread_mutex_unlock(&validator->m_mutex);
+
+            validator->process(batch);
+        }
+
+        return NULL;
+    }
+    //-----------------------------------------------------------------------------
+    inline void SampleValidator::process(const sampleBatch& batch)
+    {
+        uint32_t data[20];
+        memcpy(data, batch.header, sizeof(data));
+
+        const size_t numSamples = std::min(batch.indices.size(), batch.hashes.size() / 8);
+        uint64_t numErrors = 0;
+        uint8_t expected[32];
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            data[19] = batch.firstNonce + batch.indices[i];
+            ref::alliumHashNoGroestl(data, expected);
+            if (memcmp(expected, &batch.hashes[8 * i], sizeof(expected)))
+                ++numErrors;
+        }
+
+        pthread_mutex_lock(&m_mutex);
+        deviceState& device = m_devices[(size_t)batch.deviceIndex];
+        device.stats.numChecked += numSamples;
+        device.stats.numErrors += numErrors;
+        device.windowChecked += numSamples;
+        device.windowErrors += numErrors;
+
+        // backoff: any silent error inside a window raises the level, several clean windows lower it.
+        if (device.windowChecked >= c_backoffWindow)
+        {
+            if (device.windowErrors)
+            {
+                device.cleanWindows = 0;
+                if (m_enableBackoff && device.stats.backoffLevel < c_maxBackoffLevel)
+                    ++device.stats.backoffLevel;
+            }
+            else if (++device.cleanWindows >= c_backoffRecoveryWindows)
+            {
+                device.cleanWindows = 0;
+                if (device.stats.backoffLevel)
+                    --device.stats.backoffLevel;
+            }
+
+            device.windowChecked = 0;
+            device.windowErrors = 0;
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+}
+
+#endif // !SampleValidator_INCLUDE_ONCE
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+#ifndef SelfTest_INCLUDE_ONCE
+#define SelfTest_INCLUDE_ONCE
+
+#include <vector>
+#include <algorithm> // nth_element
+#include <cstring> // memcmp
+#include <lyclCore/CLUtils.hpp>
+#include <lyclHostValidators/Allium.hpp>
+
+// Known-answer tests for kernel stages.
+// Every stage is run on fixed input vectors and its output is compared with a host reference implementation.
+// Used on device initialization to catch driver miscompiles and broken program binaries before mining starts.
+
+namespace lycl
+{
+    //! number of hashes per tested stage. (single work group)
+    const size_t c_selfTestNumHashes = 256;
+
+    //! host reference of a stage. 32-byte input and output.
+    typedef void (*refHashFunc)(const uint8_t* in, uint8_t* out);
+
+    //! kernel launch of a tested stage. Some stages consist of multiple kernels(e.g lyra441p1-p3).
+    struct selfTestLaunch
+    {
+        cl_kernel kernel;
+        size_t threadsPerHash;
+        size_t localWorkSize;
+    };
+    //-----------------------------------------------------------------------------
+    //! fills (out) with deterministic pseudo random bytes(xorshift32).
+    inline void selfTestGenBytes(std::vector<uint8_t>& out, size_t num_bytes, uint32_t seed)
+    {
+        out.resize(num_bytes);
+        uint32_t x = seed ? seed : 0x9E3779B9;
+        for (size_t i = 0; i < num_bytes; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            out[i] = (uint8_t)(x >> 24);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    //! fills a block header(20 words) for the blake stage. Nonce(header[19]) is set by the kernel.
+    inline void selfTestGenHeader(uint32_t* header, uint32_t seed)
+    {
+        std::vector<uint8_t> bytes;
+        selfTestGenBytes(bytes, 20 * sizeof(uint32_t), seed);
+        memcpy(header, bytes.data(), 20 * sizeof(uint32_t));
+        header[19] = 0;
+    }
+    //-----------------------------------------------------------------------------
+    //! expected blake stage output for nonces [first_nonce, first_nonce + c_selfTestNumHashes).
+    inline void selfTestBlakeExpected(const uint32_t* header, uint32_t first_nonce, std::vector<uint8_t>& out)
+    {
+        uint32_t data[20];
+        memcpy(data, header, sizeof(data));
+
+        out.resize(c_selfTestNumHashes * 32);
+        for (size_t i = 0; i < c_selfTestNumHashes; ++i)
+        {
+            data[19] = first_nonce + (uint32_t)i;
+            ref::blake256(data, out.data() + 32 * i);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    //! enqueues (launches) for c_selfTestNumHashes hashes and waits for completion.
+    inline bool cluSelfTestRun(cl_command_queue queue, const selfTestLaunch* launches, size_t num_launches)
+    {
+        for (size_t i = 0; i < num_launches; ++i)
+        {
+            const size_t globalWorkSize = c_selfTestNumHashes * launches[i].threadsPerHash;
+            cl_int errorCode = clEnqueueNDRangeKernel(queue, launches[i].kernel, 1, nullptr,
+                                                      &globalWorkSize, &launches[i].localWorkSize, 0, nullptr, nullptr);
+            if (errorCode != CL_SUCCESS)
+                return false;
+        }
+
+        return clFinish(queue) == CL_SUCCESS;
+    }
+    //-----------------------------------------------------------------------------
+    //! returns number of hashes in (hash_storage) which differ from (expected), -1 on error.
+    inline int cluSelfTestCompare(cl_command_queue queue, cl_mem hash_storage, const std::vector<uint8_t>& expected)
+    {
+        std::vector<uint8_t> result(c_selfTestNumHashes * 32);
+        cl_int errorCode = clEnqueueReadBuffer(queue, hash_storage, CL_TRUE, 0, result.size(), result.data(), 0, nullptr, nullptr);
+        if (errorCode != CL_SUCCESS)
+            return -1;
+
+        int numMismatches = 0;
+        for (size_t i = 0; i < c_selfTestNumHashes; ++i)
+        {
+            if (memcmp(result.data() + 32 * i, expected.data() + 32 * i, 32))
+                ++numMismatches;
+        }
+
+        return numMismatches;
+    }
+    //-----------------------------------------------------------------------------
+    //! Tests a stage which transforms hashes in place.
+    //! Returns number of hashes which differ from (ref_func), -1 on error.
+    inline int cluSelfTestStage(cl_command_queue queue, cl_mem hash_storage, const selfTestLaunch* launches, size_t num_launches,
+                                refHashFunc ref_func, uint32_t seed)
+    {
+        std::vector<uint8_t> input;
+        selfTestGenBytes(input, c_selfTestNumHashes * 32, seed);
+
+        std::vector<uint8_t> expected(input.size());
+        for (size_t i = 0; i < c_selfTestNumHashes; ++i)
+            ref_func(input.data() + 32 * i, expected.data() + 32 * i);
+
+        cl_int errorCode = clEnqueueWriteBuffer(queue, hash_storage, CL_TRUE, 0, input.size(), input.data(), 0, nullptr, nullptr);
+        if (errorCode != CL_SUCCESS)
+            return -1;
+
+        if (!cluSelfTestRun(queue, launches, num_launches))
+            return -1;
+
+        return cluSelfTestCompare(queue, hash_storage, expected);
+    }
+    //-----------------------------------------------------------------------------
+    //! Tests a final(Htarg) stage. These kernels only report indices of hashes which pass the target test.
+    //! Target is set to the median of the reference values, so about a half of the hashes must be reported.
+    //! (target_words): 2 for a 64-bit target(hash words 6,7), 1 for a 32-bit target(hash word 7).
+    //! Returns number of wrong indices(missing or unexpected), -1 on error.
+    inline int cluSelfTestHtarg(cl_command_queue queue, cl_mem hash_storage, cl_mem htarg_result, cl_kernel kernel,
+                                cl_uint target_arg_index, int target_words, refHashFunc ref_func, uint32_t seed)
+    {
+        std::vector<uint8_t> input;
+        selfTestGenBytes(input, c_selfTestNumHashes * 32, seed);
+
+        // reference values compared against the target
+        std::vector<uint64_t> values(c_selfTestNumHashes);
+        uint8_t hash[32];
+        uint32_t words[8];
+        for (size_t i = 0; i < c_selfTestNumHashes; ++i)
+        {
+            ref_func(input.data() + 32 * i, hash);
+            memcpy(words, hash, sizeof(words));
+            values[i] = (target_words == 2) ? (((uint64_t)words[7] << 32) | words[6]) : words[7];
+        }
+
+        std::vector<uint64_t> sorted(values);
+        std::nth_element(sorted.begin(), sorted.begin() + c_selfTestNumHashes / 2, sorted.end());
+        const uint64_t target = sorted[c_selfTestNumHashes / 2];
+
+        cl_int errorCode = CL_SUCCESS;
+        if (target_words == 2)
+        {
+            const cl_ulong target64 = target;
+            errorCode = clSetKernelArg(kernel, target_arg_index, sizeof(cl_ulong), &target64);
+        }
+        else
+        {
+            const cl_uint target32 = (cl_uint)target;
+            errorCode = clSetKernelArg(kernel, target_arg_index, sizeof(cl_uint), &target32);
+        }
+        if (errorCode != CL_SUCCESS)
+            return -1;
+
+        // result buffer: [count, index0, index1...]
+        std::vector<uint32_t> result(c_selfTestNumHashes + 1, 0);
+        const size_t resultSize = result.size() * sizeof(uint32_t);
+        errorCode = clEnqueueWriteBuffer(queue, htarg_result, CL_TRUE, 0, resultSize, result.data(), 0, nullptr, nullptr);
+        errorCode |= clEnqueueWriteBuffer(queue, hash_storage, CL_TRUE, 0, input.size(), input.data(), 0, nullptr, nullptr);
+        if (errorCode != CL_SUCCESS)
+            return -1;
+
+        const selfTestLaunch launch = { kernel, 1, c_selfTestNumHashes };
+        if (!cluSelfTestRun(queue, &launch, 1))
+            return -1;
+
+        errorCode = clEnqueueReadBuffer(queue, htarg_result, CL_TRUE, 0, resultSize, result.data(), 0, nullptr, nullptr);
+        if (errorCode != CL_SUCCESS)
+            return -1;
+
+        // compare reported indices with the expected set
+        std::vector<uint8_t> reported(c_selfTestNumHashes, 0);
+        int numMismatches = 0;
+        const size_t numReported = std::min((size_t)result[0], c_selfTestNumHashes);
+        for (size_t i = 0; i < numReported; ++i)
+        {
+            const uint32_t index = result[i + 1];
+            if ((index >= c_selfTestNumHashes) || reported[index])
+                ++numMismatches;
+            else
+                reported[index] = 1;
+        }
+        for (size_t i = 0; i < c_selfTestNumHashes; ++i)
+        {
+            if (reported[i] != (values[i] <= target ? 1 : 0))
+                ++numMismatches;
+        }
+
+        // leave a clean result buffer for mining
+        std::fill(result.begin(), result.end(), 0);
+        errorCode = clEnqueueWriteBuffer(queue, htarg_result, CL_TRUE, 0, resultSize, result.data(), 0, nullptr, nullptr);
+        if (errorCode != CL_SUCCESS)
+            return -1;
+
+        return numMismatches;
+    }
+}
+
+#endif // !SelfTest_INCLUDE_ONCE
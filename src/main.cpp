@@ -14,14 +14,23 @@
 #include <lyclCore/Blake256.hpp>
 #include <lyclCore/Uint256.hpp>
 #include <lyclCore/ConfigFile.hpp>
+#include <lyclCore/SessionReplay.hpp>
 #include <external/endian.h>
 
 #include <lyclApplets/AppAllium.hpp>
+#include <lyclApplets/AppAlliumCPU.hpp>
+#include <lyclApplets/Benchmark.hpp>
+#include <lyclHostValidators/Allium.hpp>
+#include <lyclHostValidators/SampleValidator.hpp>
 
 
 #include <chrono> // timing
 #include <algorithm> // sort
 
+// Sampled validation. Set up once in main() before worker threads are created.
+static lycl::SampleValidator* g_sampleValidator = nullptr;
+static int g_samplesPerRun = 0;
+
 //-----------------------------------------------------------------------------
 // compute the diff ratio between a found hash and the target
 inline double hash_target_ratio(const uint32_t* hash, uint32_t* target)
@@ -57,19 +66,19 @@ bool fulltestAllium(const lycl::alliumHash& hash, const uint32_t *target)
 {
     bool rc = true;
 
-    // for (int i = 7; i >= 0; i--)
-    // {
-        // if (hash.h[i] > target[i])
-        // {
-            // rc = false;
-            // break;
-        // }
-        // if (hash.h[i] < target[i])
-        // {
-            // rc = true;
-            // break;
-        // }
-    // }
+    for (int i = 7; i >= 0; i--)
+    {
+        if (hash.h[i] > target[i])
+        {
+            rc = false;
+            break;
+        }
+        if (hash.h[i] < target[i])
+        {
+            rc = true;
+            break;
+        }
+    }
 
     if (global::opt_debug)
     {
@@ -92,15 +101,100 @@ bool fulltestAllium(const lycl::alliumHash& hash, const uint32_t *target)
     return rc;
 }
 //-----------------------------------------------------------------------------
-void *worker_thread( void *userdata )
+// Recompute a device candidate on the host and test it against the full target.
+// A candidate which doesn't pass the Htarg test on the host is a hardware error(corrupt device output).
+bool validateAllium(int thr_id, const uint32_t* pdata, uint32_t nonce, const uint32_t* ptarget, lycl::alliumHash& out_hash)
+{
+    uint32_t data[20];
+    memcpy(data, pdata, sizeof(data));
+    data[19] = nonce;
+    lycl::ref::alliumHash(data, out_hash.h);
+
+    const uint64_t hashHigh = ((uint64_t)out_hash.h[7] << 32) | out_hash.h[6];
+    const uint64_t htArg = ((uint64_t)ptarget[7] << 32) | ptarget[6];
+    if (hashHigh > htArg)
+    {
+        pthread_mutex_lock( &stats_lock );
+        ++thr_hwErrors[thr_id];
+        pthread_mutex_unlock( &stats_lock );
+        Log::print(Log::LT_Warning, "Device #%d: hardware error, nonce %08x was rejected by host validation.", thr_id, nonce);
+        return false;
+    }
+
+    return fulltestAllium(out_hash, ptarget);
+}
+//-----------------------------------------------------------------------------
+// Read back random hashes of the latest run and queue them for host validation.
+// Returns false if the backend doesn't keep intermediate hashes.
+template <class TApp>
+bool sampleRun(TApp& device_ctx, int thr_id, const uint32_t* pdata, uint32_t first_nonce, size_t work_size, uint32_t& rng_state)
+{
+    lycl::sampleBatch batch;
+    batch.deviceIndex = thr_id;
+    memcpy(batch.header, pdata, sizeof(batch.header));
+    batch.firstNonce = first_nonce;
+    batch.indices.resize((size_t)g_samplesPerRun);
+    for (size_t i = 0; i < batch.indices.size(); ++i)
+    {
+        // xorshift32
+        rng_state ^= rng_state << 13;
+        rng_state ^= rng_state >> 17;
+        rng_state ^= rng_state << 5;
+        batch.indices[i] = (uint32_t)(rng_state % work_size);
+    }
+
+    if (!device_ctx.getHashesForIndices(batch.indices, batch.hashes))
+        return false;
+
+    g_sampleValidator->push(batch);
+    return true;
+}
+//-----------------------------------------------------------------------------
+// Jobs uploaded to the device job slots of a worker, identified by header words 0..18 and target.
+struct stagedJobs
+{
+    uint32_t data[lycl::c_numJobSlots][19];
+    cl_ulong htArg[lycl::c_numJobSlots];
+    bool valid[lycl::c_numJobSlots];
+    uint32_t next;
+};
+//-----------------------------------------------------------------------------
+// Returns the job slot which holds (pdata, htarg), uploads it to the next free slot if needed.
+// (active_slot) may be used by a queued run and is never overwritten.
+template <class TApp>
+uint32_t stageJob(TApp& device_ctx, stagedJobs& staged, const uint32_t* pdata, cl_ulong htarg, uint32_t active_slot)
+{
+    for (uint32_t i = 0; i < lycl::c_numJobSlots; ++i)
+    {
+        if (staged.valid[i] && (staged.htArg[i] == htarg) && !memcmp(staged.data[i], pdata, sizeof(staged.data[i])))
+            return i;
+    }
+
+    uint32_t slot = staged.next;
+    if (slot == active_slot)
+        slot = (slot + 1) % lycl::c_numJobSlots;
+    staged.next = (slot + 1) % lycl::c_numJobSlots;
+
+    lycl::KernelData kernelData;
+    lycl::alliumKernelData(pdata, htarg, kernelData);
+    device_ctx.uploadJob(slot, kernelData);
+
+    memcpy(staged.data[slot], pdata, sizeof(staged.data[slot]));
+    staged.htArg[slot] = htarg;
+    staged.valid[slot] = true;
+    return slot;
+}
+//-----------------------------------------------------------------------------
+// Mining loop shared by OpenCL and CPU workers.
+// TApp: AppAllium or AppAlliumCPU, TDevice: lycl::device or lycl::cpuDevice.
+template <class TApp, class TDevice>
+void *minerThreadLoop( thr_info *mythr, const TDevice& clDevice )
 {
-    thr_info *mythr = (thr_info *) userdata;
     int thr_id = mythr->id;
 
     // Init device context.
-    lycl::AppAllium deviceCtx;
-    lycl::device clDevice = mythr->clDevice;
-    if (!deviceCtx.onInit(mythr->clDevice))
+    TApp deviceCtx;
+    if (!deviceCtx.onInit(clDevice))
     {
         Log::print(Log::LT_Error, "Failed to initialize device(%d)! Skipping...", thr_id);
         // exit
@@ -134,6 +228,16 @@ void *worker_thread( void *userdata )
 
     uint32_t numRuns = 0;
 
+    // sampled validation
+    bool sampleEnabled = (g_sampleValidator != nullptr) && (g_samplesPerRun > 0);
+    uint32_t sampleRng = 0x9E3779B9 ^ ((uint32_t)thr_id * 0x85EBCA6B) ^ (uint32_t)time(NULL);
+    uint32_t backoffLevel = 0;
+    // device job slots
+    stagedJobs staged;
+    memset(&staged, 0, sizeof(staged));
+    uint32_t activeSlot = 0;
+    uint32_t feedSequence = 0;
+
     for (;;)
     {
         uint64_t hashes_done;
@@ -148,22 +252,27 @@ void *worker_thread( void *userdata )
         pthread_mutex_lock( &g_work_lock );
         //-------------------------------------
         // get new work from stratum.
-        if (numRuns >= maxRuns)
+        const int pool = stratum_thread_pool(thr_id);
+        stratum_ctx *sctx = &stratumPools[pool];
+        work *poolWork = stratum_pool_work(pool);
+        // a thread moved between split pools must not repeat nonce ranges of the pool's current work
+        const bool poolChanged = poolScheduler.isEnabled() && (workInfo.pool != pool);
+        if (((numRuns >= maxRuns) || poolChanged) && sctx->job.job_id[0])
         {
             // generate new work
-            stratumGenWork(&stratum, &global::g_work);
+            stratumGenWork(sctx, poolWork);
         }
         //-------------------------------------
         // setup a nonce range for each worker thread
         const int32_t workCmpSize = WorkCmpSize;
-        if ( memcmp( workInfo.data, global::g_work.data, workCmpSize)
-             && (stratum.job.clean || (numRuns >= maxRuns) || (workInfo.job_id != global::g_work.job_id)) )
+        if ( memcmp( workInfo.data, poolWork->data, workCmpSize)
+             && (sctx->job.clean || (numRuns >= maxRuns) || poolChanged || (workInfo.job_id != poolWork->job_id)) )
         {
             Log::print(Log::LT_Debug, "Device: %d has completed its nonce range", thr_id);
 
             // get new work
             workFree(&workInfo );
-            workCopy(&workInfo, &global::g_work);
+            workCopy(&workInfo, poolWork);
             // reset run counter
             numRuns = 0;
         }
@@ -209,44 +318,17 @@ void *worker_thread( void *userdata )
         uint32_t* pdata = workInfo.data;
         uint32_t* ptarget = workInfo.target;
         const cl_ulong Htarg = *(cl_ulong *)(ptarget + 6);
-        const uint32_t offsetN = (maxRuns * clDevice.workSize)*thr_id;
+        // ranges are based on numNonces, since OpenCL and CPU workers use different work sizes.
+        const uint32_t offsetN = (uint32_t)(numNonces * (uint64_t)thr_id);
         const uint32_t first_nonce = offsetN + (numRuns * clDevice.workSize);
         uint32_t nonce = first_nonce;
 
         //-------------------------------------
-        // compute a midstate
+        // select the job slot, a job published by the stratum thread is already on the device.
         if (!numRuns)
         {
-            lycl::KernelData kernelData;
-            memset(&kernelData, 0, sizeof(kernelData));
-            
-            uint32_t h[8] =
-            {
-                0x6A09E667, 0xBB67AE85,
-                0x3C6EF372, 0xA54FF53A,
-                0x510E527F, 0x9B05688C,
-                0x1F83D9AB, 0x5BE0CD19
-            };
-            
-            kernelData.in16 = pdata[16];
-            kernelData.in17 = pdata[17];
-            kernelData.in18 = pdata[18];
-
-            blake256_compress(h, pdata);
-
-            kernelData.uH0 = h[0];
-            kernelData.uH1 = h[1];
-            kernelData.uH2 = h[2];
-            kernelData.uH3 = h[3];
-            kernelData.uH4 = h[4];
-            kernelData.uH5 = h[5];
-            kernelData.uH6 = h[6];
-            kernelData.uH7 = h[7];
-            kernelData.htArg = Htarg;
-            //Log::print(Log::LT_Notice, "Device:%d block:%u,%u,%u,%u,%u,%u,%u,%u", thr_id, h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]);
-            //-------------------------------------
-            // upload data
-            deviceCtx.setKernelData(kernelData);
+            activeSlot = stageJob(deviceCtx, staged, pdata, Htarg, activeSlot);
+            deviceCtx.setJobSlot(activeSlot);
         }
 
         bool nonceFound = false;
@@ -256,7 +338,28 @@ void *worker_thread( void *userdata )
         uint32_t singleNonce;
         do
         {
+            const std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
             deviceCtx.onRun(nonce, clDevice.workSize);
+            const std::chrono::steady_clock::time_point runEnd = std::chrono::steady_clock::now();
+
+            if (sampleEnabled)
+            {
+                if (!sampleRun(deviceCtx, thr_id, pdata, nonce, clDevice.workSize, sampleRng))
+                    sampleEnabled = false;
+
+                // backoff: idle for (level/8) of the run time
+                const uint32_t level = g_sampleValidator->getBackoffLevel(thr_id);
+                if (level != backoffLevel)
+                {
+                    Log::print(Log::LT_Warning, "Device #%d: sampled validation backoff level %u -> %u.", thr_id, backoffLevel, level);
+                    backoffLevel = level;
+                }
+                if (backoffLevel)
+                {
+                    const int64_t runTimeUs = std::chrono::duration_cast<std::chrono::microseconds>(runEnd - runStart).count();
+                    usleep((useconds_t)(runTimeUs * backoffLevel / lycl::SampleValidator::c_maxBackoffLevel));
+                }
+            }
 
             // assume only 1 potential nonce was found.
             deviceCtx.getHtArgTestResultAndSize(singleNonce, numPotentialNonces);
@@ -266,8 +369,7 @@ void *worker_thread( void *userdata )
             {
                 //Log::print(Log::LT_Notice, "Num potential nonces found: %u", numPotentialNonces);
 				lycl::alliumHash clhash;
-                deviceCtx.getLatestHashResultForIndex(singleNonce, clhash);
-                if (fulltestAllium(clhash, ptarget))
+                if (validateAllium(thr_id, pdata, nonce + singleNonce, ptarget, clhash))
                 {
                     // add nonce local offset
                     singleNonce += nonce;
@@ -290,8 +392,7 @@ void *worker_thread( void *userdata )
                     
                     for (size_t g = 0; g < numRemainingNonces; ++g)
                     {
-                        deviceCtx.getLatestHashResultForIndex(m_potentialNonces[g], clhash);
-                        if (fulltestAllium(clhash, ptarget))
+                        if (validateAllium(thr_id, pdata, nonce + m_potentialNonces[g], ptarget, clhash))
                         {
                             isMultiNonce = true;
                             // add nonce local offset
@@ -317,6 +418,15 @@ void *worker_thread( void *userdata )
             nonce += clDevice.workSize;
             ++numRuns;
 
+            // upload a new job of this pool while the current one is mined
+            if (jobFeed.sequence(workInfo.pool) != feedSequence)
+            {
+                uint32_t feedData[20];
+                uint32_t feedTarget[8];
+                feedSequence = jobFeed.get(workInfo.pool, feedData, feedTarget);
+                stageJob(deviceCtx, staged, feedData, *(cl_ulong *)(feedTarget + 6), activeSlot);
+            }
+
         } while (numRuns < maxRuns && !gwork_restart[thr_id].restart);
 
         hashes_done = uint64_t(offsetN + (numRuns * clDevice.workSize)) - uint64_t(first_nonce);
@@ -334,6 +444,8 @@ void *worker_thread( void *userdata )
             thr_hashrates[thr_id] = hashes_done / (elapsedTimeMs * 0.001);
             pthread_mutex_unlock( &stats_lock );
         }
+        if (poolScheduler.isEnabled())
+            poolScheduler.addHashes(workInfo.pool, hashes_done);
 
         // if nonce(s) found submit work 
         if (nonceFound)
@@ -379,6 +491,7 @@ void *worker_thread( void *userdata )
         char hr_units[2] = {0,0};
         double hashcount = thr_hashcount[thr_id];
         double hashrate  = thr_hashrates[thr_id];
+        uint32_t hwErrors = thr_hwErrors[thr_id];
         if ( hashcount )
         {
             scale_hash_for_display( &hashcount, hc_units );
@@ -388,7 +501,17 @@ void *worker_thread( void *userdata )
             else // no fractions of a hash
                 sprintf( hc, "%.0f", hashcount );
             sprintf( hr, "%.2f", hashrate );
-            Log::print( Log::LT_Info, "Device #%d: %s %sH, %s %sH/s", thr_id, hc, hc_units, hr, hr_units );
+            if (sampleEnabled)
+            {
+                lycl::sampleStats stats;
+                g_sampleValidator->getStats(thr_id, stats);
+                const double errorRate = stats.numChecked ? (100.0 * (double)stats.numErrors / (double)stats.numChecked) : 0.0;
+                Log::print( Log::LT_Info, "Device #%d: %s %sH, %s %sH/s, HW errors: %u, silent errors: %llu/%llu(%.3f%%)",
+                            thr_id, hc, hc_units, hr, hr_units, hwErrors,
+                            (unsigned long long)stats.numErrors, (unsigned long long)stats.numChecked, errorRate );
+            }
+            else
+                Log::print( Log::LT_Info, "Device #%d: %s %sH, %s %sH/s, HW errors: %u", thr_id, hc, hc_units, hr, hr_units, hwErrors );
         }
     }  // worker_thread loop
 
@@ -397,6 +520,18 @@ void *worker_thread( void *userdata )
     tq_freeze(mythr->q);
     return NULL;
 }
+//-----------------------------------------------------------------------------
+void *worker_thread( void *userdata )
+{
+    thr_info *mythr = (thr_info *) userdata;
+    return minerThreadLoop<lycl::AppAllium>(mythr, mythr->clDevice);
+}
+//-----------------------------------------------------------------------------
+void *cpu_worker_thread( void *userdata )
+{
+    thr_info *mythr = (thr_info *) userdata;
+    return minerThreadLoop<lycl::AppAlliumCPU>(mythr, mythr->cpuDevice);
+}
 
 int main(int argc, char** argv)
 {
@@ -404,10 +539,77 @@ int main(int argc, char** argv)
     Log::print(Log::LT_Notice, "Developer: CryptoGraphics ( CrGraphics@protonmail.com ).");
 	Log::print(Log::LT_Notice, "Allium Conversion: Tuxcoin Team - https://tuxcoin.io/\n");
 
+    lycl::ConfigFile cf;
+
+    //-----------------------------------------------------------------------------
+    // Benchmark mode(no pool connection):
+    // lyclMiner --benchmark [seconds] [--json file] [--baseline file] [--tolerance percent] [config file]
+    bool benchmarkMode = false;
+    bool configLoaded = true;
+    lycl::benchmarkOptions benchmarkOptions;
+    benchmarkOptions.duration = 60.0;
+    benchmarkOptions.tolerance = 3.0;
+    if ((argc >= 2) && !strcmp(argv[1], "--benchmark"))
+    {
+        benchmarkMode = true;
+        std::string configFileName("lyclMiner.conf");
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string arg(argv[i]);
+            if (!arg.compare("--json") && (i + 1 < argc))
+                benchmarkOptions.jsonFileName = argv[++i];
+            else if (!arg.compare("--baseline") && (i + 1 < argc))
+                benchmarkOptions.baselineFileName = argv[++i];
+            else if (!arg.compare("--tolerance") && (i + 1 < argc))
+                benchmarkOptions.tolerance = atof(argv[++i]);
+            else if ((i == 2) && (atof(argv[i]) > 0.0))
+                benchmarkOptions.duration = atof(argv[i]);
+            else
+                configFileName = arg;
+        }
+
+        // a config file is optional, all devices are used with default settings without it.
+        configLoaded = cf.setSource(configFileName.c_str(), true);
+        if (!configLoaded)
+            Log::print(Log::LT_Warning, "Failed to load a config file. (%s) Using all devices with default settings.", configFileName.c_str());
+    }
+
+    //-----------------------------------------------------------------------------
+    // Replay mode(recorded stratum session instead of a pool):
+    // lyclMiner --replay session_file [--speed factor] [config file]
+    bool replayMode = false;
+    std::string replayFileName;
+    double replaySpeed = 1.0;
+    if ((argc >= 3) && !strcmp(argv[1], "--replay"))
+    {
+        replayMode = true;
+        replayFileName = argv[2];
+        std::string configFileName("lyclMiner.conf");
+        for (int i = 3; i < argc; ++i)
+        {
+            std::string arg(argv[i]);
+            if (!arg.compare("--speed") && (i + 1 < argc))
+                replaySpeed = atof(argv[++i]);
+            else
+                configFileName = arg;
+        }
+        if (replaySpeed < 0.0)
+            replaySpeed = 1.0;
+
+        if (!cf.setSource(configFileName.c_str(), true))
+        {
+            Log::print(Log::LT_Error, "Failed to load a config file. (%s)", configFileName.c_str());
+            return 1;
+        }
+    }
+
     //-----------------------------------------------------------------------------
     // Config file management
-    lycl::ConfigFile cf;
-    if (argc == 2)
+    if (benchmarkMode || replayMode)
+    {
+        // loaded above
+    }
+    else if (argc == 2)
     {
         if (!cf.setSource(argv[1], true))
         {
@@ -434,7 +636,81 @@ int main(int argc, char** argv)
     if (csetting) global::use_colors = csetting->AsBool;
     csetting = cf.getSetting("Global", "ExtraNonce");
     if (csetting) global::opt_extranonce = csetting->AsBool;
+    // CPU workers
+    int cpuThreads = 0;
+    int32_t cpuLanes = lycl::cpuGetMaxSimdLanes();
+    csetting = cf.getSetting("Global", "CpuThreads");
+    if (csetting) cpuThreads = csetting->AsInt;
+    if (cpuThreads < 0)
+    {
+        Log::print(Log::LT_Warning, "\"CpuThreads\" parameter is incorrect inside \"Global\" section. Using default(0).");
+        cpuThreads = 0;
+    }
+    csetting = cf.getSetting("Global", "CpuLanes");
+    if (csetting)
+    {
+        cpuLanes = lycl::getSimdLanesFromName(csetting->AsString);
+        if (!cpuLanes || (cpuLanes > lycl::cpuGetMaxSimdLanes()))
+        {
+            cpuLanes = lycl::cpuGetMaxSimdLanes();
+            Log::print(Log::LT_Warning, "\"CpuLanes\" parameter is incorrect or not supported by this CPU. Using %d.", cpuLanes);
+        }
+    }
 
+    // sampled validation
+    int sampleThreads = 1;
+    bool sampleBackoff = false;
+    g_samplesPerRun = 64;
+    csetting = cf.getSetting("Global", "SampleValidation");
+    if (csetting) g_samplesPerRun = csetting->AsInt;
+    if (g_samplesPerRun < 0)
+    {
+        Log::print(Log::LT_Warning, "\"SampleValidation\" parameter is incorrect inside \"Global\" section. Using default(64).");
+        g_samplesPerRun = 64;
+    }
+    csetting = cf.getSetting("Global", "SampleValidationThreads");
+    if (csetting) sampleThreads = csetting->AsInt;
+    if (sampleThreads <= 0)
+    {
+        Log::print(Log::LT_Warning, "\"SampleValidationThreads\" parameter is incorrect inside \"Global\" section. Using default(1).");
+        sampleThreads = 1;
+    }
+    csetting = cf.getSetting("Global", "SampleBackoff");
+    if (csetting) sampleBackoff = csetting->AsBool;
+    // stratum session recording
+    std::string sessionRecordFileName;
+    csetting = cf.getSetting("Global", "SessionRecord");
+    if (csetting) sessionRecordFileName = csetting->AsString;
+    // stratum proxy for other miners
+    int proxyPort = 0;
+    csetting = cf.getSetting("Global", "ProxyPort");
+    if (csetting) proxyPort = csetting->AsInt;
+    if ((proxyPort < 0) || (proxyPort > 65535))
+    {
+        Log::print(Log::LT_Warning, "\"ProxyPort\" parameter is incorrect inside \"Global\" section. Using default(0).");
+        proxyPort = 0;
+    }
+    // client side share difficulty
+    csetting = cf.getSetting("Global", "ShareRate");
+    if (csetting) global::opt_shareRate = csetting->AsFloat;
+    if (global::opt_shareRate < 0.0)
+    {
+        Log::print(Log::LT_Warning, "\"ShareRate\" parameter is incorrect inside \"Global\" section. Using default(0).");
+        global::opt_shareRate = 0.0;
+    }
+    // pool failover or hashrate split
+    lycl::EPoolSelect poolSelect = lycl::PS_Priority;
+    bool poolSplit = false;
+    csetting = cf.getSetting("Global", "PoolSelect");
+    if (csetting)
+    {
+        if (!csetting->AsString.compare("latency"))
+            poolSelect = lycl::PS_Latency;
+        else if (!csetting->AsString.compare("split"))
+            poolSplit = true;
+        else if (csetting->AsString.compare("priority"))
+            Log::print(Log::LT_Warning, "Unknown PoolSelect value: %s. Using priority.", csetting->AsString.c_str());
+    }
 
     cl_int errorCode = CL_SUCCESS;
     //-----------------------------------------------------------------------------
@@ -443,79 +719,90 @@ int main(int argc, char** argv)
     errorCode = clGetPlatformIDs(0, nullptr, &numPlatformIDs);
     if (errorCode != CL_SUCCESS || numPlatformIDs <= 0)
     {
-        Log::print(Log::LT_Error, "Failed to find any OpenCL platforms.");
-        return 1;
+        if (!cpuThreads)
+        {
+            Log::print(Log::LT_Error, "Failed to find any OpenCL platforms.");
+            return 1;
+        }
+        Log::print(Log::LT_Warning, "Failed to find any OpenCL platforms. Using CPU workers only.");
+        numPlatformIDs = 0;
     }
     std::vector<cl_platform_id> platformIds(numPlatformIDs);
-    clGetPlatformIDs(numPlatformIDs, platformIds.data(), nullptr);
+    if (numPlatformIDs)
+        clGetPlatformIDs(numPlatformIDs, platformIds.data(), nullptr);
     //-----------------------------------------------------------------------------
     // get logical device list
     // tested on AMDCL2(Windows) and ROCm.
-    const std::string platformVendorAMD("Advanced Micro Devices");
+    // Other OpenCL 1.2+ platforms (including CPU devices) use portable kernel code paths.
     // logical device list sorted by PCIe bus ID
     std::vector<lycl::device> logicalDevices;
+    // ids of devices without a PCIe bus, counted across all platforms
+    int32_t numSyntheticBusIds = 0;
     for (size_t i = 0; i < (size_t)numPlatformIDs; ++i)
     {
-        // check if platform is supported (currently AMD only)
-        size_t infoSize = 0;
-        clGetPlatformInfo(platformIds[i], CL_PLATFORM_VENDOR, 0, nullptr, &infoSize);
-        std::string infoString(infoSize, ' ');
-        clGetPlatformInfo(platformIds[i], CL_PLATFORM_VENDOR, infoSize, (void*)infoString.data(), nullptr);
-        if (infoString.find(platformVendorAMD) == std::string::npos)
+        // check if platform is supported (OpenCL 1.2 or later)
+        std::string infoString;
+        std::string vendorString;
+        lycl::cluGetPlatformInfoString(platformIds[i], CL_PLATFORM_VERSION, infoString);
+        lycl::cluGetPlatformInfoString(platformIds[i], CL_PLATFORM_VENDOR, vendorString);
+        if (!lycl::cluIsVersionSupported(infoString))
         {
-            Log::print(Log::LT_Warning, "Unsupported platform vendor: %s (id:%u)", infoString.c_str(), i);
+            Log::print(Log::LT_Warning, "Unsupported platform: %s, %s (id:%u)", vendorString.c_str(), infoString.c_str(), i);
             continue;
         }
         /*else
         {
             // print an extension list
-            clGetPlatformInfo(platformIds[i], CL_PLATFORM_EXTENSIONS, 0, nullptr, &infoSize);
-            infoString.resize(infoSize);
-            clGetPlatformInfo(platformIds[i], CL_PLATFORM_EXTENSIONS, infoSize, (void*)infoString.data(), nullptr);
+            lycl::cluGetPlatformInfoString(platformIds[i], CL_PLATFORM_EXTENSIONS, infoString);
             std::cout << "Platform extensions: " << infoString << std::endl;
         }*/
 
         // get devices available on this platform
         cl_uint numDeviceIDs = 0;
-        errorCode = clGetDeviceIDs(platformIds[i], CL_DEVICE_TYPE_GPU, 0, nullptr, &numDeviceIDs);
-        if (errorCode != CL_SUCCESS || numPlatformIDs <= 0)
+        errorCode = clGetDeviceIDs(platformIds[i], CL_DEVICE_TYPE_ALL, 0, nullptr, &numDeviceIDs);
+        if (errorCode != CL_SUCCESS || numDeviceIDs <= 0)
         {
             Log::print(Log::LT_Warning, "No devices available on platform id:%u", i);
             continue;
         }
 
         std::vector<cl_device_id> deviceIds(numDeviceIDs);
-        clGetDeviceIDs(platformIds[i], CL_DEVICE_TYPE_GPU, numDeviceIDs, deviceIds.data(), nullptr);
+        clGetDeviceIDs(platformIds[i], CL_DEVICE_TYPE_ALL, numDeviceIDs, deviceIds.data(), nullptr);
 
-        cl_device_topology_amd topology;
         for (size_t j = 0; j < deviceIds.size(); ++j)
         {
+            // a platform may expose devices with a lower OpenCL version
+            lycl::cluGetDeviceInfoString(deviceIds[j], CL_DEVICE_VERSION, infoString);
+            if (!lycl::cluIsVersionSupported(infoString))
+            {
+                Log::print(Log::LT_Warning, "Unsupported device: %s (platform id:%u)", infoString.c_str(), i);
+                continue;
+            }
+
             lycl::device clDevice;
             clDevice.clPlatformId = platformIds[i];
             clDevice.clId = deviceIds[j];
             clDevice.platformIndex = (int32_t)i;
             clDevice.binaryFormat = lycl::BF_None;
             clDevice.asmProgram = lycl::AP_None;
+            clDevice.groestlKernel = lycl::GK_Table;
             clDevice.workSize = global::defaultWorkSize;
-        
-            cl_int status = clGetDeviceInfo(deviceIds[j], CL_DEVICE_TOPOLOGY_AMD, 
-                                            sizeof(cl_device_topology_amd), &topology, nullptr);
-            if(status == CL_SUCCESS)
-            {
-                if (topology.raw.type == CL_DEVICE_TOPOLOGY_TYPE_PCIE_AMD)
-                    clDevice.pcieBusId = (int32_t)topology.pcie.bus;
-            }
-            else
+            clGetDeviceInfo(deviceIds[j], CL_DEVICE_TYPE, sizeof(cl_device_type), &clDevice.type, nullptr);
+
+            clDevice.pcieBusId = lycl::cluGetPCIeBusId(deviceIds[j]);
+            if (clDevice.pcieBusId < 0)
             {
-                Log::print(Log::LT_Warning, "Failed to get CL_DEVICE_TOPOLOGY_AMD info. Platform index: %u", i);
-                clDevice.pcieBusId = 0;
+                // Devices without a PCIe bus(CPU, integrated, unknown vendors) get an id outside of 0-255 range.
+                // It is unique across platforms and stable as long as platform and device order is not changed by drivers.
+                clDevice.pcieBusId = 256 + numSyntheticBusIds++;
+                Log::print(Log::LT_Debug, "PCIe bus id is not available. Using %d. Platform index: %u", clDevice.pcieBusId, i);
             }
                 
             logicalDevices.push_back(clDevice);
         }
     }
 
-    if (!logicalDevices.size())
+    if (!logicalDevices.size() && !cpuThreads)
     {
         Log::print(Log::LT_Error, "Failed to find any supported devices.");
         return 1;
@@ -586,13 +873,68 @@ int main(int argc, char** argv)
                                "#        Enable extranonce subscription.\n"
                                "#        Default: true\n"
                                "#\n"
+                               "#    CpuThreads\n"
+                               "#        Number of CPU worker threads. Can be used alongside or without OpenCL devices.\n"
+                               "#        Default: 0\n"
+                               "#\n"
+                               "#    CpuLanes\n"
+                               "#        Hashes computed at once per CPU thread: auto, 4(SSE2), 8(AVX2), 16(AVX-512).\n"
+                               "#        Default: auto\n"
+                               "#\n"
+                               "#    SampleValidation\n"
+                               "#        Number of random hashes per device run recomputed on the host to detect\n"
+                               "#        silent errors(e.g unstable overclock). 0 disables sampling.\n"
+                               "#        Default: 64\n"
+                               "#\n"
+                               "#    SampleValidationThreads\n"
+                               "#        Number of host threads used by sampled validation.\n"
+                               "#        Default: 1\n"
+                               "#\n"
+                               "#    SampleBackoff\n"
+                               "#        Lower device load when sampled validation finds silent errors.\n"
+                               "#        Default: false\n"
+                               "#\n"
+                               "#    SessionRecord\n"
+                               "#        Record the stratum session to a file, e.g SessionRecord = \"session.txt\".\n"
+                               "#        Recordings can be replayed with: lyclMiner --replay session.txt [--speed factor] [config file]\n"
+                               "#        Default: not set(disabled)\n"
+                               "#\n"
+                               "#    ProxyPort\n"
+                               "#        Serve other stratum miners(e.g other rigs) on this port, sharing the pool connection.\n"
+                               "#        Their shares are sent to the pool of this miner. 0 disables the proxy.\n"
+                               "#        Default: 0\n"
+                               "#\n"
+                               "#    ShareRate\n"
+                               "#        Shares per minute per pool. The pool is asked for the matching difficulty at the measured\n"
+                               "#        hashrate(mining.suggest_difficulty), which bounds share overhead on large rigs. 0 disables it.\n"
+                               "#        Default: 0\n"
+                               "#\n"
+                               "#    PoolSelect\n"
+                               "#        Which pool provides work when backup pools are configured:\n"
+                               "#        priority(first healthy pool in config order), latency(lowest round trip time),\n"
+                               "#        split(all pools mine at once, hashrate is split by connection Weight).\n"
+                               "#        Default: priority\n"
+                               "#\n"
                                "#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#\n"
                                "\n"
                                "<Global TerminalColors = \"false\"\n"
-                               "        ExtraNonce = \"true\">\n"
+                               "        ExtraNonce = \"true\"\n"
+                               "        CpuThreads = \"0\"\n"
+                               "        CpuLanes = \"auto\"\n"
+                               "        SampleValidation = \"64\"\n"
+                               "        SampleValidationThreads = \"1\"\n"
+                               "        SampleBackoff = \"false\">\n"
                                "\n"
                                "#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#\n"
                                "# Pool connection setup:\n"
+                               "#\n"
+                               "# Backup pools are added with <Connection1>, <Connection2>... blocks(up to 7).\n"
+                               "# They are kept connected with their latest job ready, devices switch to\n"
+                               "# a backup pool as soon as the active pool fails.\n"
+                               "# Username and Password default to the values of the <Connection> block.\n"
+                               "# With PoolSelect = \"split\", every connection gets a part of the hashrate\n"
+                               "# set by its Weight option(default 1), e.g. Weight = \"70\" and Weight = \"30\".\n"
+                               "# Stratum V2 pools and proxies(plain text, no encryption) use stratum2+tcp:// urls.\n"
                                "#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#-#\n"
                                "\n"
                                "<Connection Url = \"stratum+tcp://example.com:port\"\n"
@@ -664,12 +1006,7 @@ int main(int argc, char** argv)
 
                     deviceListText += deviceName;
                     // get device board name
-                    deviceBoardName.clear();
-                    clGetDeviceInfo(logicalDevices[i].clId, CL_DEVICE_BOARD_NAME_AMD, 0, NULL, &infoSize);
-                    //deviceBoardName.resize(infoSize - 1);
-                    deviceBoardName.resize(infoSize);
-                    clGetDeviceInfo(logicalDevices[i].clId, CL_DEVICE_BOARD_NAME_AMD, infoSize, (void *)deviceBoardName.data(), NULL);
-                    deviceBoardName.pop_back();
+                    deviceBoardName = lycl::cluGetDeviceBoardName(logicalDevices[i].clId);
                 
                     deviceListText += "\n#    Board name: ";
                     deviceListText += deviceBoardName;                
@@ -693,6 +1030,10 @@ int main(int argc, char** argv)
                     deviceConfText += platformIndexString;
                     deviceConfText += "\"";
                     deviceConfText += " BinaryFormat = \"";
+                    if (!lycl::cluIsAMDDevice(logicalDevices[i].clId))
+                        deviceConfText += "none"; // asm programs are AMD only
+                    else
+                    {
     #ifdef _WIN32
                         deviceConfText += "amdcl2";
     #elif defined __linux__
@@ -704,12 +1045,15 @@ int main(int argc, char** argv)
     #else
                         deviceConfText += "none";
     #endif
+                    }
                     deviceConfText += "\"";
 
                     deviceConfText += " AsmProgram = \"";
                     lycl::getAsmProgramNameFromDeviceName(deviceName, asmProgramName);
                     deviceConfText += asmProgramName;
                     deviceConfText += "\"";
+
+                    deviceConfText += " GroestlKernel = \"table\"";
                 
                     deviceConfText += " WorkSize = \"";
                     deviceConfText += defaultWorkSizeString;
@@ -742,12 +1086,7 @@ int main(int argc, char** argv)
 
                 deviceListText += deviceName;
                 // get device board name
-                deviceBoardName.clear();
-                clGetDeviceInfo(logicalDevices[i].clId, CL_DEVICE_BOARD_NAME_AMD, 0, NULL, &infoSize);
-                //deviceBoardName.resize(infoSize - 1);
-                deviceBoardName.resize(infoSize);
-                clGetDeviceInfo(logicalDevices[i].clId, CL_DEVICE_BOARD_NAME_AMD, infoSize, (void *)deviceBoardName.data(), NULL);
-                deviceBoardName.pop_back();
+                deviceBoardName = lycl::cluGetDeviceBoardName(logicalDevices[i].clId);
             
                 deviceListText += "\n#    Board name: ";
                 deviceListText += deviceBoardName;                
@@ -767,6 +1106,10 @@ int main(int argc, char** argv)
                 deviceConfText += "\"";
 
                 deviceConfText += " BinaryFormat = \"";
+                if (!lycl::cluIsAMDDevice(logicalDevices[i].clId))
+                    deviceConfText += "none"; // asm programs are AMD only
+                else
+                {
 #ifdef _WIN32
                     deviceConfText += "amdcl2";
 #elif defined __linux__
@@ -778,12 +1121,15 @@ int main(int argc, char** argv)
 #else
                     deviceConfText += "none";
 #endif
+                }
                 deviceConfText += "\"";
 
                 deviceConfText += " AsmProgram = \"";
                 lycl::getAsmProgramNameFromDeviceName(deviceName, asmProgramName);
                 deviceConfText += asmProgramName;
                 deviceConfText += "\"";
+
+                deviceConfText += " GroestlKernel = \"table\"";
                 
                 deviceConfText += " WorkSize = \"";
                 deviceConfText += defaultWorkSizeString;
@@ -816,19 +1162,51 @@ int main(int argc, char** argv)
     //-------------------------------------
     // setup a pool connection.
     // get url
+    // not required by benchmark and replay
+    const bool poolRequired = !benchmarkMode && !replayMode;
     csetting = cf.getSetting("Connection", "Url");
     if (csetting) global::connectionInfo.rpc_url = csetting->AsString;
-    else { Log::print(Log::LT_Error, "Failed to get an \"Url\" option inside \"Connection\" section"); return 1; }
+    else if (poolRequired) { Log::print(Log::LT_Error, "Failed to get an \"Url\" option inside \"Connection\" section"); return 1; }
     // get username
     csetting = cf.getSetting("Connection", "Username");
     if (csetting) global::connectionInfo.rpc_user = csetting->AsString;
-    else { Log::print(Log::LT_Error, "Failed to get a \"Username\" option inside \"Connection\" section"); return 1; }
+    else if (poolRequired) { Log::print(Log::LT_Error, "Failed to get a \"Username\" option inside \"Connection\" section"); return 1; }
     // get password
     csetting = cf.getSetting("Connection", "Password");
     if (csetting) global::connectionInfo.rpc_pass = csetting->AsString;
-    else { Log::print(Log::LT_Error, "Failed to get a \"Password\" option inside \"Connection\" section"); return 1; }
+    else if (poolRequired) { Log::print(Log::LT_Error, "Failed to get a \"Password\" option inside \"Connection\" section"); return 1; }
     // rpc user:pass
     global::connectionInfo.rpc_userpass = global::connectionInfo.rpc_user + ":" + global::connectionInfo.rpc_pass;
+    // hashrate split weights
+    std::vector<double> poolWeights;
+    csetting = cf.getSetting("Connection", "Weight");
+    poolWeights.push_back(csetting ? csetting->AsFloat : 1.0);
+
+    // backup pools: <Connection1>...<ConnectionN>, not used by benchmark and replay
+    if (poolRequired)
+    {
+        for (int i = 1; i < lycl::PoolFailover::c_maxPools; ++i)
+        {
+            const std::string connectionBlock = std::string("Connection") + std::to_string(i);
+            csetting = cf.getSetting(connectionBlock.c_str(), "Url");
+            if (!csetting)
+                break;
+
+            ConnectionInfo backup = global::connectionInfo;
+            backup.rpc_url = csetting->AsString;
+            backup.short_url.clear();
+            csetting = cf.getSetting(connectionBlock.c_str(), "Username");
+            if (csetting) backup.rpc_user = csetting->AsString;
+            csetting = cf.getSetting(connectionBlock.c_str(), "Password");
+            if (csetting) backup.rpc_pass = csetting->AsString;
+            backup.rpc_userpass = backup.rpc_user + ":" + backup.rpc_pass;
+            global::backupConnections.push_back(backup);
+            csetting = cf.getSetting(connectionBlock.c_str(), "Weight");
+            poolWeights.push_back(csetting ? csetting->AsFloat : 1.0);
+        }
+    }
+    const int numPools = 1 + (int)global::backupConnections.size();
+    poolFailover.init(numPools, poolSelect);
 
     //-------------------------------------
     // setup devices
@@ -836,10 +1214,15 @@ int main(int argc, char** argv)
     std::string dBlockName("Device");
     std::string binaryFormatName;
     std::string asmProgramName;
+    std::string groestlKernelName;
     std::string deviceBlock = dBlockName + std::to_string(deviceBlockIndex);
     
     std::vector<lycl::device> configuredDevices;
 
+    // benchmark without a config file uses every device.
+    if (!configLoaded)
+        configuredDevices = logicalDevices;
+
     // check if configuration file is in "raw device list" format
     csetting = cf.getSetting(deviceBlock.c_str(), "PCIeBusId");
     if (!csetting)
@@ -855,6 +1238,7 @@ int main(int argc, char** argv)
             int workSize = 0;
             lycl::EBinaryFormat binaryFormat = lycl::BF_None;
             lycl::EAsmProgram asmProgram = lycl::AP_None; 
+            lycl::EGroestlKernel groestlKernel = lycl::GK_Table;
 
             // get platform index
             csetting = cf.getSetting(deviceBlock.c_str(), "PlatformIndex"); 
@@ -880,6 +1264,14 @@ int main(int argc, char** argv)
             csetting = cf.getSetting(deviceBlock.c_str(), "WorkSize"); 
             if (csetting) workSize = csetting->AsInt;
 
+            // get groestl kernel variant
+            csetting = cf.getSetting(deviceBlock.c_str(), "GroestlKernel"); 
+            if (csetting)
+            {
+                groestlKernelName = csetting->AsString;
+                groestlKernel = lycl::getGroestlKernelFromName(groestlKernelName);
+            }
+
             // check if pcieBusID and platfromIndex are correct
             ptrdiff_t foundPCIeBusId = -1;
             ptrdiff_t foundPlatformIndex = -1;
@@ -924,6 +1316,7 @@ int main(int argc, char** argv)
                 // AsmProgram will be detected on context init
                 configuredDevices[configuredDevices.size() - 1].binaryFormat = binaryFormat;
                 configuredDevices[configuredDevices.size() - 1].asmProgram = asmProgram;
+                configuredDevices[configuredDevices.size() - 1].groestlKernel = groestlKernel;
             }
             else
                 Log::print(Log::LT_Warning, "\"PCIeBusId\" is invalid inside \"%s\" section. Skipping device...", deviceBlock.c_str());
@@ -941,6 +1334,7 @@ int main(int argc, char** argv)
             int workSize = 0;
             lycl::EBinaryFormat binaryFormat = lycl::BF_None;
             lycl::EAsmProgram asmProgram = lycl::AP_None; 
+            lycl::EGroestlKernel groestlKernel = lycl::GK_Table;
 
             // get program binary format
             csetting = cf.getSetting(deviceBlock.c_str(), "BinaryFormat"); 
@@ -962,6 +1356,14 @@ int main(int argc, char** argv)
             csetting = cf.getSetting(deviceBlock.c_str(), "WorkSize"); 
             if (csetting) workSize = csetting->AsInt;
 
+            // get groestl kernel variant
+            csetting = cf.getSetting(deviceBlock.c_str(), "GroestlKernel"); 
+            if (csetting)
+            {
+                groestlKernelName = csetting->AsString;
+                groestlKernel = lycl::getGroestlKernelFromName(groestlKernelName);
+            }
+
             // check if pcieBusID and platfromIndex are correct
             if ((deviceIndex < logicalDevices.size()) && (deviceIndex >= 0))
             {
@@ -980,6 +1382,7 @@ int main(int argc, char** argv)
                 // AsmProgram will be detected on context init
                 configuredDevices[configuredDevices.size()- 1].binaryFormat = binaryFormat;
                 configuredDevices[configuredDevices.size()- 1].asmProgram = asmProgram;
+                configuredDevices[configuredDevices.size()- 1].groestlKernel = groestlKernel;
             }
             else
                 Log::print(Log::LT_Warning, "\"DeviceIndex\" is invalid inside \"%s\" section. Skipping device...", deviceBlock.c_str());
@@ -989,22 +1392,63 @@ int main(int argc, char** argv)
         }
     }
 
+    // asm programs are only valid for AMD GCN devices
+    for (size_t i = 0; i < configuredDevices.size(); ++i)
+    {
+        if ((configuredDevices[i].binaryFormat != lycl::BF_None) && !lycl::cluIsAMDDevice(configuredDevices[i].clId))
+        {
+            Log::print(Log::LT_Warning, "\"BinaryFormat\" is not supported on non-AMD device (PCIeBusId:%d). Using \"none\".", configuredDevices[i].pcieBusId);
+            configuredDevices[i].binaryFormat = lycl::BF_None;
+            configuredDevices[i].asmProgram = lycl::AP_None;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+    // Benchmark
+    if (benchmarkMode)
+    {
+        pthread_mutex_init(&Log::applog_lock, NULL);
+
+        std::vector<lycl::cpuDevice> cpuDevices((size_t)cpuThreads);
+        for (int i = 0; i < cpuThreads; ++i)
+        {
+            cpuDevices[(size_t)i].index = i;
+            cpuDevices[(size_t)i].numLanes = cpuLanes;
+            cpuDevices[(size_t)i].workSize = global::defaultCpuWorkSize;
+        }
+
+        if (configuredDevices.empty() && cpuDevices.empty())
+        {
+            Log::print(Log::LT_Warning, "Found 0 configured devices. Exiting...");
+            return 0;
+        }
+
+        return lycl::runBenchmark(configuredDevices, cpuDevices, benchmarkOptions);
+    }
+
 //-----------------------------------------------------------------------------
     // Init miner
 
-    // 1 device per thread
-    global::numWorkerThreads = configuredDevices.size();
+    // 1 device per thread, CPU workers go after OpenCL devices
+    const int numDeviceThreads = (int)configuredDevices.size();
+    global::numWorkerThreads = numDeviceThreads + cpuThreads;
     if (!global::numWorkerThreads)
     {
         Log::print(Log::LT_Warning, "Found 0 configured devices. Exiting...");
         return 0;
     }
+    if (poolSplit && poolRequired)
+        poolScheduler.init(numPools, poolWeights.data(), global::numWorkerThreads);
 
     pthread_mutex_init(&Log::applog_lock, NULL);
     pthread_mutex_init(&stats_lock, NULL);
     pthread_mutex_init(&g_work_lock, NULL);
-    pthread_mutex_init(&stratum.sock_lock, NULL);
-    pthread_mutex_init(&stratum.work_lock, NULL);
+    for (int i = 0; i < numPools; ++i)
+    {
+        stratumPools[i].pool = i;
+        pthread_mutex_init(&stratumPools[i].sock_lock, NULL);
+        pthread_mutex_init(&stratumPools[i].work_lock, NULL);
+    }
 
     long flags = strncmp(global::connectionInfo.rpc_url.c_str(), "https:", 6) ? (CURL_GLOBAL_ALL & ~CURL_GLOBAL_SSL) : CURL_GLOBAL_ALL;
     if (curl_global_init(flags))
@@ -1015,6 +1459,7 @@ int main(int argc, char** argv)
 
 #ifndef _WIN32
     signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
 #else
     SetConsoleCtrlHandler((PHANDLER_ROUTINE)ConsoleHandler, TRUE);
 #endif
@@ -1023,7 +1468,7 @@ int main(int argc, char** argv)
     gwork_restart = (struct work_restart*) calloc(global::numWorkerThreads, sizeof(*gwork_restart));
     if (!gwork_restart)
         return 1;
-    gthr_info = (struct thr_info*) calloc(global::numWorkerThreads + 4, sizeof(*thr));
+    gthr_info = (struct thr_info*) calloc(global::numWorkerThreads + 3 + numPools, sizeof(*thr));
     if (!gthr_info)
         return 1;
     thr_hashrates = (double *) calloc(global::numWorkerThreads, sizeof(double));
@@ -1032,9 +1477,25 @@ int main(int argc, char** argv)
     thr_hashcount = (double *) calloc(global::numWorkerThreads, sizeof(double));
     if (!thr_hashcount)
         return 1;
+    thr_hwErrors = (uint32_t *) calloc(global::numWorkerThreads, sizeof(uint32_t));
+    if (!thr_hwErrors)
+        return 1;
+
+    //-----------------------------------------------------------------------------
+    // start sampled validation
+    if (g_samplesPerRun > 0)
+    {
+        g_sampleValidator = new lycl::SampleValidator();
+        if (!g_sampleValidator->start(sampleThreads, global::numWorkerThreads, sampleBackoff))
+        {
+            Log::print(Log::LT_Warning, "Failed to start sampled validation threads. Sampling is disabled.");
+            delete g_sampleValidator;
+            g_sampleValidator = nullptr;
+        }
+    }
 
     // Currect thread layout:
-    // [workIO,stratum,Device0...DeviceN]
+    // [Device0...DeviceN,Cpu0...CpuN,workIO,stratum0...stratumN(one per pool)]
 
     //-----------------------------------------------------------------------------
     // create work I/O thread
@@ -1052,21 +1513,62 @@ int main(int argc, char** argv)
     }
 
     //-----------------------------------------------------------------------------
-    // create stratum thread
-    stratum_thr_id = global::numWorkerThreads + 1;
-    thr = &gthr_info[stratum_thr_id];
-    thr->id = stratum_thr_id;
-    thr->q = tq_new();
-    if (!thr->q)
-        return 1;
+    // session recording and replay
+    if (!sessionRecordFileName.empty())
+    {
+        if (stratumRecorder.open(sessionRecordFileName.c_str()))
+            Log::print(Log::LT_Notice, "Recording stratum session to %s", sessionRecordFileName.c_str());
+        else
+            Log::print(Log::LT_Warning, "Failed to open %s for session recording.", sessionRecordFileName.c_str());
+    }
 
-    if (thread_create(thr, stratum_thread))
+    lycl::SessionReplay replay;
+    if (replayMode)
     {
-        Log::print(Log::LT_Error, "stratum thread create failed");
-        return 1;
+        int replayPort = 0;
+        if (!replay.load(replayFileName.c_str()) || !replay.start(replaySpeed, replayPort))
+        {
+            Log::print(Log::LT_Error, "Failed to replay a stratum session. (%s)", replayFileName.c_str());
+            return 1;
+        }
+        global::connectionInfo.rpc_url = "stratum+tcp://127.0.0.1:" + std::to_string(replayPort);
+        global::connectionInfo.short_url = "replay";
+        Log::print(Log::LT_Notice, "Replaying %s at %gx speed", replayFileName.c_str(), replaySpeed);
     }
 
-    tq_push(gthr_info[stratum_thr_id].q, strdup(global::connectionInfo.rpc_url.c_str()));
+    //-----------------------------------------------------------------------------
+    // stratum proxy, started before stratum threads receive the extranonce
+    if (proxyPort)
+    {
+        if (stratumProxy.start(proxyPort, stratumProxySubmit))
+            Log::print(Log::LT_Notice, "Stratum proxy listening on port %d", proxyPort);
+        else
+            Log::print(Log::LT_Warning, "Failed to start the stratum proxy on port %d.", proxyPort);
+    }
+
+    //-----------------------------------------------------------------------------
+    // create stratum threads, one per pool
+    stratum_thr_id = global::numWorkerThreads + 1;
+    for (int i = 0; i < numPools; ++i)
+    {
+        thr = &gthr_info[stratum_thr_id + i];
+        thr->id = stratum_thr_id + i;
+        thr->q = tq_new();
+        if (!thr->q)
+            return 1;
+
+        if (thread_create(thr, stratum_thread))
+        {
+            Log::print(Log::LT_Error, "stratum thread create failed");
+            return 1;
+        }
+
+        tq_push(thr->q, &stratumPools[i]);
+    }
+    if (poolScheduler.isEnabled())
+        Log::print(Log::LT_Info, "Hashrate is split across %d pools.", numPools);
+    else if (numPools > 1)
+        Log::print(Log::LT_Info, "%d backup pools configured.", numPools - 1);
 
     //-----------------------------------------------------------------------------
     // create worker threads
@@ -1075,10 +1577,21 @@ int main(int argc, char** argv)
         thr = &gthr_info[i];
         thr->id = i;
         thr->q = tq_new();
-        thr->clDevice = configuredDevices[(size_t)i];
         if (!thr->q)
             return 1;
-        if (thread_create(thr, worker_thread))
+
+        void *(*threadFunc)(void *) = worker_thread;
+        if (i < numDeviceThreads)
+            thr->clDevice = configuredDevices[(size_t)i];
+        else
+        {
+            thr->cpuDevice.index = i - numDeviceThreads;
+            thr->cpuDevice.numLanes = cpuLanes;
+            thr->cpuDevice.workSize = global::defaultCpuWorkSize;
+            threadFunc = cpu_worker_thread;
+        }
+
+        if (thread_create(thr, threadFunc))
         {
             Log::print(Log::LT_Error, "worker thread %d create failed", i);
             return 1;
@@ -1089,6 +1602,17 @@ int main(int argc, char** argv)
 
 //-----------------------------------------------------------------------------
 
+    if (replayMode)
+    {
+        while (!replay.isFinished())
+        {
+            stratum_check_exit();
+            sleep(1);
+        }
+        replay.printReport();
+        return 0;
+    }
+
     pthread_join(gthr_info[work_thr_id].pth, NULL);
 
     return 0;
@@ -0,0 +1,1276 @@
+/*
+ * Copyright 2018 CryptoGraphics ( CrGraphics@protonmail.com )
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version. See LICENSE for more details.
+ */
+
+// Local mock stratum pool.
+// Speaks the mining.subscribe/authorize/notify/set_difficulty/submit subset(suggest_difficulty is logged), follows a job script
+// (job cadence, difficulty changes, clean jobs, reconnect requests) and delays every outgoing line
+// by an injected latency. Submitted shares are verified with the host allium reference.
+// Records notify-to-first-share and submit-to-ack latencies, so network and job switch paths of the miner
+// can be benchmarked repeatably without a real pool.
+// With --sv2 it speaks the plain text Stratum V2 mining protocol instead(stratum2+tcp://): one standard channel
+// per connection, jobs with a Merkle root of the connection's coinbase, BIP320 version rolling.
+//
+// Usage: lyclMockPool [--port 3333] [--host 127.0.0.1] [--diff 0.01] [--job-interval ms] [--clean-every jobs]
+//                     [--latency ms] [--jitter ms] [--branches count] [--duration seconds] [--script file] [--json file]
+//                     [--sv2]
+//
+// Script file, one command per line('#' starts a comment):
+//   difficulty <value>  send mining.set_difficulty, used from the next job
+//   job [clean]         send mining.notify(clean: drop older jobs, new prevhash)
+//   wait <ms>           pause the script
+//   reconnect           send client.reconnect to the same host and port
+//   loop                restart the script
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <chrono>
+#include <algorithm> // sort
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits> // INT_MAX(Utils.hpp)
+#include <csignal>
+#include <ctime>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET poolSocket;
+#define closePoolSocket closesocket
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int poolSocket;
+#define INVALID_SOCKET (-1)
+#define closePoolSocket close
+#endif
+
+#include <jansson.h>
+#include <lyclCore/Global.hpp>
+#include <lyclCore/Utils.hpp>
+#include <lyclCore/Sha256.hpp>
+#include <external/endian.h>
+#include <lyclCore/StratumV2.hpp>
+#include <lyclHostValidators/Allium.hpp>
+
+namespace
+{
+    //! extranonce2 size announced to miners.
+    const int c_xnonce2Size = 4;
+    //! number of not clean jobs kept for share validation.
+    const size_t c_maxJobs = 16;
+
+    volatile sig_atomic_t g_running = 1;
+
+    typedef enum
+    {
+        SC_Difficulty,
+        SC_Job,
+        SC_Wait,
+        SC_Reconnect,
+        SC_Loop
+    } EScriptCommand;
+
+    struct scriptStep
+    {
+        EScriptCommand command;
+        double value;
+        bool clean;
+    };
+
+    struct poolOptions
+    {
+        int port;
+        std::string host;
+        double difficulty;
+        double jobInterval;   // ms
+        int cleanEvery;
+        double latency;       // ms
+        double jitter;        // ms
+        int numBranches;
+        double duration;      // seconds, 0: until interrupted
+        std::string scriptFileName;
+        std::string jsonFileName;
+        //! Stratum V2 instead of stratum.
+        bool sv2;
+    };
+
+    struct poolJob
+    {
+        std::string id;
+        std::string prevhash;
+        std::string coinb1;
+        std::string coinb2;
+        std::vector<std::string> merkle;
+        std::string version;
+        std::string nbits;
+        std::string ntime;
+        bool clean;
+    };
+
+    //! delayed outgoing line(or Stratum V2 frame).
+    struct pendingLine
+    {
+        double dueTime;
+        std::string line;
+        //! mining.notify(NewMiningJob, SetNewPrevHash): job id(send time is recorded).
+        std::string notifyJobId;
+        //! submit result: time the submit was received, negative otherwise.
+        double submitTime;
+    };
+
+    struct poolClient
+    {
+        poolSocket sock;
+        std::string recvBuffer;
+        std::deque<pendingLine> outbox;
+        std::string xnonce1;
+        bool authorized;
+        bool closed;
+        //! job id -> notify send time.
+        std::map<std::string, double> notifyTimes;
+        //! job id -> share difficulty in effect for the job.
+        std::map<std::string, double> jobDiffs;
+        std::set<std::string> jobsWithShare;
+        std::set<std::string> submitted;
+    };
+
+    struct poolStats
+    {
+        std::vector<double> notifyToShare; // ms
+        std::vector<double> submitToAck;   // ms
+        uint64_t accepted;
+        uint64_t rejectedStale;
+        uint64_t rejectedDuplicate;
+        uint64_t rejectedLowDiff;
+        uint64_t jobs;
+        uint64_t connections;
+        uint64_t reconnects;
+    };
+    //-----------------------------------------------------------------------------
+    double nowMs()
+    {
+        typedef std::chrono::steady_clock clock;
+        static const clock::time_point start = clock::now();
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    }
+    //-----------------------------------------------------------------------------
+    void onSignal(int)
+    {
+        g_running = 0;
+    }
+    //-----------------------------------------------------------------------------
+    //! deterministic hex string of (num_bytes) bytes.
+    std::string genHex(size_t num_bytes, uint32_t& state)
+    {
+        static const char* digits = "0123456789abcdef";
+        std::string s(num_bytes * 2, '0');
+        for (size_t i = 0; i < num_bytes; ++i)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            s[2 * i] = digits[(state >> 28) & 0xF];
+            s[2 * i + 1] = digits[(state >> 24) & 0xF];
+        }
+        return s;
+    }
+    //-----------------------------------------------------------------------------
+    bool parseScript(std::istream& in, std::vector<scriptStep>& out_steps)
+    {
+        out_steps.clear();
+        bool hasWait = false;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(in, line))
+        {
+            ++lineNumber;
+            const size_t comment = line.find('#');
+            if (comment != std::string::npos)
+                line.erase(comment);
+
+            std::istringstream iss(line);
+            std::string command;
+            if (!(iss >> command))
+                continue;
+
+            scriptStep step;
+            step.value = 0.0;
+            step.clean = false;
+            if (command == "difficulty" && (iss >> step.value) && step.value > 0.0)
+                step.command = SC_Difficulty;
+            else if (command == "job")
+            {
+                std::string flag;
+                step.command = SC_Job;
+                step.clean = (iss >> flag) && flag == "clean";
+            }
+            else if (command == "wait" && (iss >> step.value) && step.value >= 0.0)
+            {
+                step.command = SC_Wait;
+                hasWait |= step.value > 0.0;
+            }
+            else if (command == "reconnect")
+                step.command = SC_Reconnect;
+            else if (command == "loop")
+            {
+                step.command = SC_Loop;
+                if (!hasWait)
+                {
+                    std::cerr << "Script line " << lineNumber << ": loop without a wait" << std::endl;
+                    return false;
+                }
+            }
+            else
+            {
+                std::cerr << "Script line " << lineNumber << ": invalid command: " << line << std::endl;
+                return false;
+            }
+            out_steps.push_back(step);
+        }
+
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    //! default script: a clean job every (clean_every) jobs, one job every (job_interval) ms.
+    std::string defaultScript(const poolOptions& options)
+    {
+        std::ostringstream oss;
+        oss << "difficulty " << options.difficulty << "\n";
+        oss << "job clean\n";
+        for (int i = 1; i < options.cleanEvery; ++i)
+            oss << "wait " << options.jobInterval << "\njob\n";
+        oss << "wait " << options.jobInterval << "\nloop\n";
+        return oss.str();
+    }
+    //-----------------------------------------------------------------------------
+    // Mock pool
+    //-----------------------------------------------------------------------------
+    class MockPool
+    {
+    public:
+        MockPool(const poolOptions& options, const std::vector<scriptStep>& script)
+            : m_options(options)
+            , m_script(script)
+            , m_scriptPos(0)
+            , m_scriptWaitUntil(0.0)
+            , m_listenSocket(INVALID_SOCKET)
+            , m_difficulty(options.difficulty)
+            , m_nextJobId(1)
+            , m_nextXnonce1(1)
+            , m_blockHeight(1258472)
+            , m_rng(0x5EED1234)
+        {
+            m_stats.accepted = m_stats.rejectedStale = m_stats.rejectedDuplicate = m_stats.rejectedLowDiff = 0;
+            m_stats.jobs = m_stats.connections = m_stats.reconnects = 0;
+        }
+
+        bool listen();
+        void run();
+        void printStats();
+        bool writeJson(const char* file_name);
+
+    private:
+        void runScript(double now);
+        void newJob(bool clean);
+        void broadcast(const std::string& line);
+        void sendJob(poolClient& client, const poolJob& job, bool clean);
+        void queueLine(poolClient& client, const std::string& line, const std::string& notify_job_id, double submit_time);
+        void queueData(poolClient& client, const std::string& data, const std::string& notify_job_id, double submit_time);
+        void flush(poolClient& client, double now);
+        void receive(poolClient& client);
+        void handleLine(poolClient& client, const char* line);
+        void handleSubmit(poolClient& client, json_t* id, json_t* params);
+        void respond(poolClient& client, json_t* id, json_t* result, int error_code, const char* error_msg, double submit_time);
+        bool merkleRoot(const poolJob& job, const poolClient& client, const char* xnonce2, unsigned char* out_root);
+        bool shareHash(const poolJob& job, const poolClient& client, const char* xnonce2, const char* ntime,
+                       const char* nonce, uint32_t* out_hash);
+        const poolJob* findJob(const std::string& id) const;
+        bool validShare(const uint32_t* hash, double diff) const;
+
+        // Stratum V2
+        void queueFrame(poolClient& client, const lycl::Sv2Writer& frame, const std::string& notify_job_id, double submit_time);
+        void writeTarget(lycl::Sv2Writer& out) const;
+        void sendTargetV2(poolClient& client);
+        void sendJobV2(poolClient& client, const poolJob& job, bool clean);
+        void handleFrame(poolClient& client, const lycl::sv2Frame& frame);
+        void handleSubmitV2(poolClient& client, lycl::Sv2Reader& in);
+        void respondSubmitV2(poolClient& client, uint32_t sequence, const char* error, double submit_time);
+
+        poolOptions m_options;
+        std::vector<scriptStep> m_script;
+        size_t m_scriptPos;
+        double m_scriptWaitUntil;
+
+        poolSocket m_listenSocket;
+        std::vector<poolClient> m_clients;
+
+        double m_difficulty;
+        std::deque<poolJob> m_jobs;
+        uint32_t m_nextJobId;
+        uint32_t m_nextXnonce1;
+        uint32_t m_blockHeight;
+        std::string m_prevhash;
+        uint32_t m_rng;
+
+        poolStats m_stats;
+    };
+    //-----------------------------------------------------------------------------
+    bool MockPool::listen()
+    {
+        m_listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (m_listenSocket == INVALID_SOCKET)
+            return false;
+
+        int reuse = 1;
+        setsockopt(m_listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)m_options.port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(m_listenSocket, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(m_listenSocket, 16) != 0)
+        {
+            closePoolSocket(m_listenSocket);
+            m_listenSocket = INVALID_SOCKET;
+            return false;
+        }
+
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::run()
+    {
+        const double endTime = (m_options.duration > 0.0) ? nowMs() + m_options.duration * 1000.0 : 0.0;
+        while (g_running)
+        {
+            double now = nowMs();
+            if (endTime > 0.0 && now >= endTime)
+                break;
+
+            runScript(now);
+            for (size_t i = 0; i < m_clients.size(); ++i)
+                flush(m_clients[i], now);
+
+            // wake up for the next script step, the next delayed line or at least every 100ms
+            double wakeUp = now + 100.0;
+            if (m_scriptPos < m_script.size())
+                wakeUp = std::min(wakeUp, m_scriptWaitUntil);
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                if (!m_clients[i].outbox.empty())
+                    wakeUp = std::min(wakeUp, m_clients[i].outbox.front().dueTime);
+            }
+
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(m_listenSocket, &readSet);
+            poolSocket maxSocket = m_listenSocket;
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                FD_SET(m_clients[i].sock, &readSet);
+                maxSocket = std::max(maxSocket, m_clients[i].sock);
+            }
+
+            const double timeout = std::max(0.0, wakeUp - now);
+            timeval tv;
+            tv.tv_sec = (long)(timeout / 1000.0);
+            tv.tv_usec = (long)((timeout - tv.tv_sec * 1000.0) * 1000.0);
+            if (select((int)maxSocket + 1, &readSet, nullptr, nullptr, &tv) <= 0)
+                continue;
+
+            if (FD_ISSET(m_listenSocket, &readSet))
+            {
+                poolSocket sock = accept(m_listenSocket, nullptr, nullptr);
+                if (sock != INVALID_SOCKET)
+                {
+                    poolClient client;
+                    client.sock = sock;
+                    client.authorized = false;
+                    client.closed = false;
+                    char xnonce1[9];
+                    snprintf(xnonce1, sizeof(xnonce1), "%08x", m_nextXnonce1++);
+                    client.xnonce1 = xnonce1;
+                    m_clients.push_back(client);
+                    ++m_stats.connections;
+                    std::cout << "client connected, xnonce1: " << xnonce1 << std::endl;
+                }
+            }
+
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                if (FD_ISSET(m_clients[i].sock, &readSet))
+                    receive(m_clients[i]);
+            }
+
+            // drop disconnected clients
+            for (size_t i = 0; i < m_clients.size();)
+            {
+                if (m_clients[i].closed)
+                {
+                    closePoolSocket(m_clients[i].sock);
+                    std::cout << "client disconnected, xnonce1: " << m_clients[i].xnonce1 << std::endl;
+                    m_clients.erase(m_clients.begin() + i);
+                }
+                else
+                    ++i;
+            }
+        }
+
+        for (size_t i = 0; i < m_clients.size(); ++i)
+            closePoolSocket(m_clients[i].sock);
+        m_clients.clear();
+        closePoolSocket(m_listenSocket);
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::runScript(double now)
+    {
+        while (m_scriptPos < m_script.size() && now >= m_scriptWaitUntil)
+        {
+            const scriptStep& step = m_script[m_scriptPos++];
+            switch (step.command)
+            {
+                case SC_Difficulty:
+                    if (step.value != m_difficulty)
+                    {
+                        m_difficulty = step.value;
+                        if (m_options.sv2)
+                        {
+                            // SetTarget applies at once, the difficulty of jobs already sent is kept for their shares
+                            for (size_t i = 0; i < m_clients.size(); ++i)
+                            {
+                                if (m_clients[i].authorized)
+                                    sendTargetV2(m_clients[i]);
+                            }
+                            break;
+                        }
+                        char line[128];
+                        snprintf(line, sizeof(line), "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[%.8g]}", m_difficulty);
+                        broadcast(line);
+                    }
+                    break;
+                case SC_Job:
+                    newJob(step.clean);
+                    break;
+                case SC_Wait:
+                    m_scriptWaitUntil = now + step.value;
+                    break;
+                case SC_Reconnect:
+                {
+                    if (m_options.sv2)
+                    {
+                        lycl::Sv2Writer reconnect(lycl::SV2_Reconnect, false);
+                        reconnect.str(m_options.host.c_str());
+                        reconnect.u16((uint16_t)m_options.port);
+                        for (size_t i = 0; i < m_clients.size(); ++i)
+                        {
+                            if (m_clients[i].authorized)
+                                queueFrame(m_clients[i], reconnect, std::string(), -1.0);
+                        }
+                        m_stats.reconnects += m_clients.size();
+                        break;
+                    }
+                    char line[256];
+                    snprintf(line, sizeof(line), "{\"id\":null,\"method\":\"client.reconnect\",\"params\":[\"%s\",%d,0]}",
+                             m_options.host.c_str(), m_options.port);
+                    broadcast(line);
+                    m_stats.reconnects += m_clients.size();
+                    break;
+                }
+                case SC_Loop:
+                    m_scriptPos = 0;
+                    break;
+            }
+        }
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::newJob(bool clean)
+    {
+        if (clean || m_prevhash.empty())
+        {
+            clean = true;
+            m_prevhash = genHex(32, m_rng);
+            ++m_blockHeight;
+            m_jobs.clear();
+        }
+
+        poolJob job;
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%x", m_nextJobId++);
+        job.id = buf;
+        job.prevhash = m_prevhash;
+
+        // coinbase: BIP34 height after the 0xffff tag, pool tag and outputs are random
+        snprintf(buf, sizeof(buf), "03%02x%02x%02x", m_blockHeight & 0xFF, (m_blockHeight >> 8) & 0xFF, (m_blockHeight >> 16) & 0xFF);
+        job.coinb1 = "01000000010000000000000000000000000000000000000000000000000000000000000000ffffffff27";
+        job.coinb1 += buf;
+        job.coinb1 += genHex(24, m_rng);
+        job.coinb2 = genHex(120, m_rng);
+        for (int i = 0; i < m_options.numBranches; ++i)
+            job.merkle.push_back(genHex(32, m_rng));
+        job.version = "20000000";
+        job.nbits = "1c05ea29";
+        snprintf(buf, sizeof(buf), "%08x", (uint32_t)time(NULL));
+        job.ntime = buf;
+        job.clean = clean;
+
+        m_jobs.push_back(job);
+        while (m_jobs.size() > c_maxJobs)
+            m_jobs.pop_front();
+        ++m_stats.jobs;
+
+        for (size_t i = 0; i < m_clients.size(); ++i)
+        {
+            if (m_clients[i].authorized)
+                sendJob(m_clients[i], job, clean);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::broadcast(const std::string& line)
+    {
+        for (size_t i = 0; i < m_clients.size(); ++i)
+        {
+            if (m_clients[i].authorized)
+                queueLine(m_clients[i], line, std::string(), -1.0);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::sendJob(poolClient& client, const poolJob& job, bool clean)
+    {
+        if (m_options.sv2)
+        {
+            sendJobV2(client, job, clean);
+            return;
+        }
+        std::string line = "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"" + job.id + "\",\"" + job.prevhash + "\",\"" +
+                           job.coinb1 + "\",\"" + job.coinb2 + "\",[";
+        for (size_t i = 0; i < job.merkle.size(); ++i)
+        {
+            if (i)
+                line += ",";
+            line += "\"" + job.merkle[i] + "\"";
+        }
+        line += "],\"" + job.version + "\",\"" + job.nbits + "\",\"" + job.ntime + "\"," + (clean ? "true" : "false") + "]}";
+
+        if (clean)
+        {
+            client.notifyTimes.clear();
+            client.jobDiffs.clear();
+            client.jobsWithShare.clear();
+            client.submitted.clear();
+        }
+        client.jobDiffs[job.id] = m_difficulty;
+        queueLine(client, line, job.id, -1.0);
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::queueLine(poolClient& client, const std::string& line, const std::string& notify_job_id, double submit_time)
+    {
+        queueData(client, line + "\n", notify_job_id, submit_time);
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::queueData(poolClient& client, const std::string& data, const std::string& notify_job_id, double submit_time)
+    {
+        pendingLine pending;
+        pending.dueTime = nowMs() + m_options.latency;
+        if (m_options.jitter > 0.0)
+            pending.dueTime += m_options.jitter * (double)(rand() % 1001) / 1000.0;
+        // keep the order of lines
+        if (!client.outbox.empty())
+            pending.dueTime = std::max(pending.dueTime, client.outbox.back().dueTime);
+        pending.line = data;
+        pending.notifyJobId = notify_job_id;
+        pending.submitTime = submit_time;
+        client.outbox.push_back(pending);
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::flush(poolClient& client, double now)
+    {
+        while (!client.closed && !client.outbox.empty() && client.outbox.front().dueTime <= now)
+        {
+            const pendingLine& pending = client.outbox.front();
+            size_t sent = 0;
+            while (sent < pending.line.size())
+            {
+                const int n = (int)send(client.sock, pending.line.data() + sent, (int)(pending.line.size() - sent), 0);
+                if (n <= 0)
+                {
+                    client.closed = true;
+                    break;
+                }
+                sent += (size_t)n;
+            }
+
+            const double sentTime = nowMs();
+            if (!pending.notifyJobId.empty())
+                client.notifyTimes[pending.notifyJobId] = sentTime;
+            if (pending.submitTime >= 0.0)
+                m_stats.submitToAck.push_back(sentTime - pending.submitTime);
+            client.outbox.pop_front();
+        }
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::receive(poolClient& client)
+    {
+        char buf[4096];
+        const int n = (int)recv(client.sock, buf, sizeof(buf), 0);
+        if (n <= 0)
+        {
+            client.closed = true;
+            return;
+        }
+        client.recvBuffer.append(buf, (size_t)n);
+
+        if (m_options.sv2)
+        {
+            while (!client.closed && client.recvBuffer.size() >= lycl::c_sv2HeaderSize)
+            {
+                const unsigned char* h = (const unsigned char*)client.recvBuffer.data();
+                lycl::sv2Frame frame;
+                frame.extension = (uint16_t)(h[0] | (h[1] << 8));
+                frame.type = h[2];
+                frame.size = (uint32_t)h[3] | ((uint32_t)h[4] << 8) | ((uint32_t)h[5] << 16);
+                frame.payload = h + lycl::c_sv2HeaderSize;
+                if (frame.size > lycl::c_sv2MaxPayload)
+                {
+                    std::cerr << "Stratum V2 frame too large: " << frame.size << std::endl;
+                    client.closed = true;
+                    break;
+                }
+                if (client.recvBuffer.size() < lycl::c_sv2HeaderSize + frame.size)
+                    break;
+                handleFrame(client, frame);
+                client.recvBuffer.erase(0, lycl::c_sv2HeaderSize + frame.size);
+            }
+            return;
+        }
+
+        size_t pos;
+        while (!client.closed && (pos = client.recvBuffer.find('\n')) != std::string::npos)
+        {
+            std::string line = client.recvBuffer.substr(0, pos);
+            client.recvBuffer.erase(0, pos + 1);
+            if (!line.empty())
+                handleLine(client, line.c_str());
+        }
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::handleLine(poolClient& client, const char* line)
+    {
+        json_error_t err;
+        json_t* val = json_loads(line, 0, &err);
+        if (!val)
+        {
+            std::cerr << "JSON decode failed(" << err.line << "): " << err.text << std::endl;
+            return;
+        }
+
+        json_t* id = json_object_get(val, "id");
+        json_t* params = json_object_get(val, "params");
+        const char* method = json_string_value(json_object_get(val, "method"));
+        if (!method)
+        {
+            // response to a pool request, nothing to do
+            json_decref(val);
+            return;
+        }
+
+        if (!strcmp(method, "mining.subscribe"))
+        {
+            json_t* result = json_array();
+            json_t* subscriptions = json_array();
+            json_t* s0 = json_array();
+            json_array_append_new(s0, json_string("mining.set_difficulty"));
+            json_array_append_new(s0, json_string(client.xnonce1.c_str()));
+            json_t* s1 = json_array();
+            json_array_append_new(s1, json_string("mining.notify"));
+            json_array_append_new(s1, json_string(client.xnonce1.c_str()));
+            json_array_append_new(subscriptions, s0);
+            json_array_append_new(subscriptions, s1);
+            json_array_append_new(result, subscriptions);
+            json_array_append_new(result, json_string(client.xnonce1.c_str()));
+            json_array_append_new(result, json_integer(c_xnonce2Size));
+            respond(client, id, result, 0, nullptr, -1.0);
+        }
+        else if (!strcmp(method, "mining.authorize"))
+        {
+            respond(client, id, json_true(), 0, nullptr, -1.0);
+            client.authorized = true;
+
+            char diffLine[128];
+            snprintf(diffLine, sizeof(diffLine), "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[%.8g]}", m_difficulty);
+            queueLine(client, diffLine, std::string(), -1.0);
+            if (!m_jobs.empty())
+                sendJob(client, m_jobs.back(), true);
+        }
+        else if (!strcmp(method, "mining.extranonce.subscribe"))
+            respond(client, id, json_true(), 0, nullptr, -1.0);
+        else if (!strcmp(method, "mining.submit"))
+            handleSubmit(client, id, params);
+        else if (!strcmp(method, "mining.suggest_difficulty"))
+        {
+            // logged only, the script decides the difficulty
+            std::cout << "client " << client.xnonce1 << " suggested difficulty " << json_number_value(json_array_get(params, 0)) << std::endl;
+            respond(client, id, json_true(), 0, nullptr, -1.0);
+        }
+        else
+            respond(client, id, json_null(), 20, "unsupported method", -1.0);
+
+        json_decref(val);
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::handleSubmit(poolClient& client, json_t* id, json_t* params)
+    {
+        const double submitTime = nowMs();
+        const char* jobId = json_string_value(json_array_get(params, 1));
+        const char* xnonce2 = json_string_value(json_array_get(params, 2));
+        const char* ntime = json_string_value(json_array_get(params, 3));
+        const char* nonce = json_string_value(json_array_get(params, 4));
+        if (!jobId || !xnonce2 || !ntime || !nonce ||
+            strlen(xnonce2) != 2 * c_xnonce2Size || strlen(ntime) != 8 || strlen(nonce) != 8)
+        {
+            respond(client, id, json_false(), 20, "invalid parameters", submitTime);
+            return;
+        }
+
+        // notify-to-first-share, once per job and connection
+        std::map<std::string, double>::const_iterator notifyIt = client.notifyTimes.find(jobId);
+        if (notifyIt != client.notifyTimes.end() && client.jobsWithShare.insert(jobId).second)
+            m_stats.notifyToShare.push_back(submitTime - notifyIt->second);
+
+        const poolJob* job = findJob(jobId);
+        std::map<std::string, double>::const_iterator diffIt = client.jobDiffs.find(jobId);
+        if (!job || diffIt == client.jobDiffs.end())
+        {
+            ++m_stats.rejectedStale;
+            respond(client, id, json_false(), 21, "job not found", submitTime);
+            return;
+        }
+
+        if (!client.submitted.insert(std::string(jobId) + xnonce2 + ntime + nonce).second)
+        {
+            ++m_stats.rejectedDuplicate;
+            respond(client, id, json_false(), 22, "duplicate share", submitTime);
+            return;
+        }
+
+        uint32_t hash[8];
+        if (shareHash(*job, client, xnonce2, ntime, nonce, hash) && validShare(hash, diffIt->second))
+        {
+            ++m_stats.accepted;
+            respond(client, id, json_true(), 0, nullptr, submitTime);
+        }
+        else
+        {
+            ++m_stats.rejectedLowDiff;
+            respond(client, id, json_false(), 23, "low difficulty share", submitTime);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    const poolJob* MockPool::findJob(const std::string& id) const
+    {
+        const poolJob* job = nullptr;
+        for (size_t i = 0; i < m_jobs.size(); ++i)
+        {
+            if (m_jobs[i].id == id)
+                job = &m_jobs[i];
+        }
+        return job;
+    }
+    //-----------------------------------------------------------------------------
+    //! true if (hash) meets the share target of (diff).
+    bool MockPool::validShare(const uint32_t* hash, double diff) const
+    {
+        uint32_t target[8];
+        diff_to_target(target, diff / 256.0);
+        for (int i = 7; i >= 0; --i)
+        {
+            if (hash[i] > target[i])
+                return false;
+            if (hash[i] < target[i])
+                break;
+        }
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    //! Merkle root of the connection's coinbase with (xnonce2), in header byte order.
+    bool MockPool::merkleRoot(const poolJob& job, const poolClient& client, const char* xnonce2, unsigned char* out_root)
+    {
+        const std::string coinbaseHex = job.coinb1 + client.xnonce1 + xnonce2 + job.coinb2;
+        std::vector<unsigned char> coinbase(coinbaseHex.size() / 2);
+        if (!hex2bin(coinbase.data(), coinbaseHex.c_str(), coinbase.size()))
+            return false;
+
+        unsigned char nodes[64];
+        sha256d(nodes, coinbase.data(), (int)coinbase.size());
+        for (size_t i = 0; i < job.merkle.size(); ++i)
+        {
+            hex2bin(nodes + 32, job.merkle[i].c_str(), 32);
+            sha256d(nodes, nodes, 64);
+        }
+        memcpy(out_root, nodes, 32);
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    //! Rebuilds the block header the way the miner does(buildExtraHeader) and hashes it.
+    bool MockPool::shareHash(const poolJob& job, const poolClient& client, const char* xnonce2, const char* ntime,
+                             const char* nonce, uint32_t* out_hash)
+    {
+        unsigned char merkleRoot[32];
+        if (!this->merkleRoot(job, client, xnonce2, merkleRoot))
+            return false;
+
+        unsigned char version[4], prevhash[32], ntimeBin[4], nbits[4], nonceBin[4];
+        if (!hex2bin(version, job.version.c_str(), 4) || !hex2bin(prevhash, job.prevhash.c_str(), 32) ||
+            !hex2bin(nbits, job.nbits.c_str(), 4) || !hex2bin(ntimeBin, ntime, 4) || !hex2bin(nonceBin, nonce, 4))
+            return false;
+
+        uint32_t data[20];
+        data[0] = le32dec(version);
+        for (int i = 0; i < 8; ++i)
+            data[1 + i] = le32dec(prevhash + 4 * i);
+        for (int i = 0; i < 8; ++i)
+            data[9 + i] = be32dec(merkleRoot + 4 * i);
+        data[17] = le32dec(ntimeBin);
+        data[18] = le32dec(nbits);
+        data[19] = le32dec(nonceBin);
+
+        lycl::ref::alliumHash(data, out_hash);
+        return true;
+    }
+    //-----------------------------------------------------------------------------
+    //! Queues a response. (result) is consumed.
+    void MockPool::respond(poolClient& client, json_t* id, json_t* result, int error_code, const char* error_msg, double submit_time)
+    {
+        json_t* response = json_object();
+        json_object_set(response, "id", id ? id : json_null());
+        json_object_set_new(response, "result", result);
+        if (error_code)
+        {
+            json_t* error = json_array();
+            json_array_append_new(error, json_integer(error_code));
+            json_array_append_new(error, json_string(error_msg));
+            json_array_append_new(error, json_null());
+            json_object_set_new(response, "error", error);
+        }
+        else
+            json_object_set_new(response, "error", json_null());
+
+        char* s = json_dumps(response, JSON_COMPACT);
+        if (s)
+        {
+            queueLine(client, s, std::string(), submit_time);
+            free(s);
+        }
+        json_decref(response);
+    }
+    //-----------------------------------------------------------------------------
+    // Stratum V2
+    //-----------------------------------------------------------------------------
+    void MockPool::queueFrame(poolClient& client, const lycl::Sv2Writer& frame, const std::string& notify_job_id, double submit_time)
+    {
+        queueData(client, std::string((const char*)frame.data(), frame.size()), notify_job_id, submit_time);
+    }
+    //-----------------------------------------------------------------------------
+    //! share target of the current difficulty, little-endian.
+    void MockPool::writeTarget(lycl::Sv2Writer& out) const
+    {
+        uint32_t target[8];
+        unsigned char bytes[32];
+        diff_to_target(target, m_difficulty / 256.0);
+        for (int i = 0; i < 8; ++i)
+            le32enc(bytes + 4 * i, target[i]);
+        out.u256(bytes);
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::sendTargetV2(poolClient& client)
+    {
+        lycl::Sv2Writer setTarget(lycl::SV2_SetTarget, true);
+        setTarget.u32(1);
+        writeTarget(setTarget);
+        queueFrame(client, setTarget, std::string(), -1.0);
+    }
+    //-----------------------------------------------------------------------------
+    //! a clean job is sent as a future job and activated by SetNewPrevHash.
+    void MockPool::sendJobV2(poolClient& client, const poolJob& job, bool clean)
+    {
+        // the coinbase of a standard channel has an empty extranonce2
+        unsigned char root[32];
+        unsigned char version[4], ntime[4], nbits[4], prevhash[32];
+        if (!merkleRoot(job, client, "00000000", root) || !hex2bin(version, job.version.c_str(), 4) ||
+            !hex2bin(ntime, job.ntime.c_str(), 4) || !hex2bin(nbits, job.nbits.c_str(), 4) ||
+            !hex2bin(prevhash, job.prevhash.c_str(), 32))
+            return;
+        const uint32_t jobId = (uint32_t)strtoul(job.id.c_str(), NULL, 16);
+
+        if (clean)
+        {
+            client.notifyTimes.clear();
+            client.jobDiffs.clear();
+            client.jobsWithShare.clear();
+            client.submitted.clear();
+        }
+        client.jobDiffs[job.id] = m_difficulty;
+
+        lycl::Sv2Writer newJob(lycl::SV2_NewMiningJob, true);
+        newJob.u32(1);
+        newJob.u32(jobId);
+        newJob.u8(clean ? 0 : 1);
+        if (!clean)
+            newJob.u32(be32dec(ntime));
+        newJob.u32(be32dec(version));
+        newJob.b032(root, 32);
+        queueFrame(client, newJob, clean ? std::string() : job.id, -1.0);
+        if (!clean)
+            return;
+
+        // mining.notify words are byte swapped, SV2 sends the hash in header byte order
+        unsigned char headerPrevhash[32];
+        for (int i = 0; i < 32; ++i)
+            headerPrevhash[i] = prevhash[(i & ~3) + 3 - (i & 3)];
+        lycl::Sv2Writer prev(lycl::SV2_SetNewPrevHash, true);
+        prev.u32(1);
+        prev.u32(jobId);
+        prev.u256(headerPrevhash);
+        prev.u32(be32dec(ntime));
+        prev.u32(be32dec(nbits));
+        queueFrame(client, prev, job.id, -1.0);
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::handleFrame(poolClient& client, const lycl::sv2Frame& frame)
+    {
+        lycl::Sv2Reader in(frame);
+        switch (frame.type)
+        {
+            case lycl::SV2_SetupConnection:
+            {
+                lycl::Sv2Writer success(lycl::SV2_SetupConnectionSuccess, false);
+                success.u16(2);
+                // version rolling allowed
+                success.u32(0);
+                queueFrame(client, success, std::string(), -1.0);
+                break;
+            }
+            case lycl::SV2_OpenStandardMiningChannel:
+            {
+                const uint32_t requestId = in.u32();
+                char user[256];
+                in.str(user, sizeof(user));
+                std::cout << "channel opened by " << user << ", xnonce1: " << client.xnonce1 << std::endl;
+
+                // the extranonce prefix is the part of the coinbase fixed for this channel
+                unsigned char prefix[c_xnonce2Size + 4] = { 0 };
+                hex2bin(prefix, client.xnonce1.c_str(), 4);
+                lycl::Sv2Writer success(lycl::SV2_OpenStandardMiningChannelSuccess, false);
+                success.u32(requestId);
+                success.u32(1);
+                writeTarget(success);
+                success.b032(prefix, sizeof(prefix));
+                success.u32(0);
+                queueFrame(client, success, std::string(), -1.0);
+
+                client.authorized = true;
+                if (!m_jobs.empty())
+                    sendJobV2(client, m_jobs.back(), true);
+                break;
+            }
+            case lycl::SV2_SubmitSharesStandard:
+                handleSubmitV2(client, in);
+                break;
+            case lycl::SV2_UpdateChannel:
+            {
+                in.u32(); // channel id
+                const float hashrate = in.f32();
+                uint32_t maxTarget[8];
+                unsigned char target[32];
+                in.u256(target);
+                for (int i = 0; i < 8; ++i)
+                    maxTarget[i] = le32dec(target + 4 * i);
+                std::cout << "client " << client.xnonce1 << " updated channel: " << hashrate << " H/s, maximum target difficulty "
+                          << lycl::StratumV2Channel::targetToDifficulty(maxTarget) << std::endl;
+                break;
+            }
+            default:
+                std::cerr << "unsupported Stratum V2 message 0x" << std::hex << (int)frame.type << std::dec << std::endl;
+                break;
+        }
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::handleSubmitV2(poolClient& client, lycl::Sv2Reader& in)
+    {
+        const double submitTime = nowMs();
+        in.u32(); // channel id
+        const uint32_t sequence = in.u32();
+        const uint32_t jobNumber = in.u32();
+        const uint32_t nonce = in.u32();
+        const uint32_t ntime = in.u32();
+        const uint32_t version = in.u32();
+        if (!in.isValid())
+        {
+            respondSubmitV2(client, sequence, "invalid-parameters", submitTime);
+            return;
+        }
+
+        char jobId[16];
+        snprintf(jobId, sizeof(jobId), "%x", jobNumber);
+        std::map<std::string, double>::const_iterator notifyIt = client.notifyTimes.find(jobId);
+        if (notifyIt != client.notifyTimes.end() && client.jobsWithShare.insert(jobId).second)
+            m_stats.notifyToShare.push_back(submitTime - notifyIt->second);
+
+        const poolJob* job = findJob(jobId);
+        std::map<std::string, double>::const_iterator diffIt = client.jobDiffs.find(jobId);
+        if (!job || diffIt == client.jobDiffs.end())
+        {
+            ++m_stats.rejectedStale;
+            respondSubmitV2(client, sequence, "stale-share", submitTime);
+            return;
+        }
+
+        char key[64];
+        snprintf(key, sizeof(key), "%s/%08x/%08x/%08x", jobId, version, ntime, nonce);
+        if (!client.submitted.insert(key).second)
+        {
+            ++m_stats.rejectedDuplicate;
+            respondSubmitV2(client, sequence, "duplicate-share", submitTime);
+            return;
+        }
+
+        // same header as shareHash, with the rolled version and an empty extranonce2
+        unsigned char root[32], jobVersion[4], prevhash[32], nbits[4];
+        bool valid = merkleRoot(*job, client, "00000000", root) && hex2bin(jobVersion, job->version.c_str(), 4) &&
+                     hex2bin(prevhash, job->prevhash.c_str(), 32) && hex2bin(nbits, job->nbits.c_str(), 4) &&
+                     !((version ^ be32dec(jobVersion)) & ~lycl::c_sv2VersionRollingMask);
+        if (valid)
+        {
+            uint32_t data[20];
+            uint32_t hash[8];
+            data[0] = swab32(version);
+            for (int i = 0; i < 8; ++i)
+                data[1 + i] = le32dec(prevhash + 4 * i);
+            for (int i = 0; i < 8; ++i)
+                data[9 + i] = be32dec(root + 4 * i);
+            data[17] = swab32(ntime);
+            data[18] = le32dec(nbits);
+            data[19] = swab32(nonce);
+            lycl::ref::alliumHash(data, hash);
+            valid = validShare(hash, diffIt->second);
+        }
+
+        if (valid)
+        {
+            ++m_stats.accepted;
+            respondSubmitV2(client, sequence, nullptr, submitTime);
+        }
+        else
+        {
+            ++m_stats.rejectedLowDiff;
+            respondSubmitV2(client, sequence, "difficulty-too-low", submitTime);
+        }
+    }
+    //-----------------------------------------------------------------------------
+    //! SubmitShares.Success for this share only, or SubmitShares.Error with (error).
+    void MockPool::respondSubmitV2(poolClient& client, uint32_t sequence, const char* error, double submit_time)
+    {
+        lycl::Sv2Writer response(error ? lycl::SV2_SubmitSharesError : lycl::SV2_SubmitSharesSuccess, true);
+        response.u32(1);
+        response.u32(sequence);
+        if (error)
+            response.str(error);
+        else
+        {
+            response.u32(1);
+            response.u64((uint64_t)m_difficulty);
+        }
+        queueFrame(client, response, std::string(), submit_time);
+    }
+    //-----------------------------------------------------------------------------
+    //! latency percentile of sorted samples.
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+        const size_t index = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+    //-----------------------------------------------------------------------------
+    void printLatency(const char* name, std::vector<double> samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        printf("%-22s n=%-6u min %8.2f  p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f ms\n", name, (uint32_t)samples.size(),
+               percentile(samples, 0.0), percentile(samples, 0.5), percentile(samples, 0.9), percentile(samples, 0.99),
+               percentile(samples, 1.0));
+    }
+    //-----------------------------------------------------------------------------
+    void MockPool::printStats()
+    {
+        printf("jobs: %u, connections: %u, reconnect requests: %u\n", (uint32_t)m_stats.jobs,
+               (uint32_t)m_stats.connections, (uint32_t)m_stats.reconnects);
+        printf("shares: accepted %u, rejected %u (job not found %u, duplicate %u, low difficulty %u)\n",
+               (uint32_t)m_stats.accepted,
+               (uint32_t)(m_stats.rejectedStale + m_stats.rejectedDuplicate + m_stats.rejectedLowDiff),
+               (uint32_t)m_stats.rejectedStale, (uint32_t)m_stats.rejectedDuplicate, (uint32_t)m_stats.rejectedLowDiff);
+        printLatency("notify-to-first-share", m_stats.notifyToShare);
+        printLatency("submit-to-ack", m_stats.submitToAck);
+        fflush(stdout);
+    }
+    //-----------------------------------------------------------------------------
+    json_t* latencyJson(std::vector<double> samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        json_t* obj = json_object();
+        json_object_set_new(obj, "count", json_integer((json_int_t)samples.size()));
+        json_object_set_new(obj, "min", json_real(percentile(samples, 0.0)));
+        json_object_set_new(obj, "p50", json_real(percentile(samples, 0.5)));
+        json_object_set_new(obj, "p90", json_real(percentile(samples, 0.9)));
+        json_object_set_new(obj, "p99", json_real(percentile(samples, 0.99)));
+        json_object_set_new(obj, "max", json_real(percentile(samples, 1.0)));
+        return obj;
+    }
+    //-----------------------------------------------------------------------------
+    bool MockPool::writeJson(const char* file_name)
+    {
+        json_t* root = json_object();
+        json_object_set_new(root, "latency", json_real(m_options.latency));
+        json_object_set_new(root, "jobs", json_integer((json_int_t)m_stats.jobs));
+        json_object_set_new(root, "connections", json_integer((json_int_t)m_stats.connections));
+        json_object_set_new(root, "accepted", json_integer((json_int_t)m_stats.accepted));
+        json_object_set_new(root, "rejectedStale", json_integer((json_int_t)m_stats.rejectedStale));
+        json_object_set_new(root, "rejectedDuplicate", json_integer((json_int_t)m_stats.rejectedDuplicate));
+        json_object_set_new(root, "rejectedLowDifficulty", json_integer((json_int_t)m_stats.rejectedLowDiff));
+        json_object_set_new(root, "notifyToFirstShare", latencyJson(m_stats.notifyToShare));
+        json_object_set_new(root, "submitToAck", latencyJson(m_stats.submitToAck));
+
+        const bool ok = json_dump_file(root, file_name, JSON_INDENT(2)) == 0;
+        json_decref(root);
+        return ok;
+    }
+}
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    poolOptions options;
+    options.port = 3333;
+    options.host = "127.0.0.1";
+    options.difficulty = 0.01;
+    options.jobInterval = 30000.0;
+    options.cleanEvery = 4;
+    options.latency = 0.0;
+    options.jitter = 0.0;
+    options.numBranches = 12;
+    options.duration = 0.0;
+    options.sv2 = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = (i + 1 < argc);
+        const char* arg = argv[i];
+        if (!strcmp(arg, "--port") && hasValue)
+            options.port = atoi(argv[++i]);
+        else if (!strcmp(arg, "--host") && hasValue)
+            options.host = argv[++i];
+        else if (!strcmp(arg, "--diff") && hasValue)
+            options.difficulty = atof(argv[++i]);
+        else if (!strcmp(arg, "--job-interval") && hasValue)
+            options.jobInterval = atof(argv[++i]);
+        else if (!strcmp(arg, "--clean-every") && hasValue)
+            options.cleanEvery = atoi(argv[++i]);
+        else if (!strcmp(arg, "--latency") && hasValue)
+            options.latency = atof(argv[++i]);
+        else if (!strcmp(arg, "--jitter") && hasValue)
+            options.jitter = atof(argv[++i]);
+        else if (!strcmp(arg, "--branches") && hasValue)
+            options.numBranches = atoi(argv[++i]);
+        else if (!strcmp(arg, "--duration") && hasValue)
+            options.duration = atof(argv[++i]);
+        else if (!strcmp(arg, "--script") && hasValue)
+            options.scriptFileName = argv[++i];
+        else if (!strcmp(arg, "--json") && hasValue)
+            options.jsonFileName = argv[++i];
+        else if (!strcmp(arg, "--sv2"))
+            options.sv2 = true;
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--port 3333] [--host 127.0.0.1] [--diff 0.01] [--job-interval ms]" << std::endl
+                      << "       [--clean-every jobs] [--latency ms] [--jitter ms] [--branches count]" << std::endl
+                      << "       [--duration seconds] [--script file] [--json file] [--sv2]" << std::endl;
+            return 1;
+        }
+    }
+    if (options.port <= 0 || options.port > 65535 || options.difficulty <= 0.0 || options.jobInterval <= 0.0 ||
+        options.cleanEvery <= 0 || options.latency < 0.0 || options.numBranches < 0)
+    {
+        std::cerr << "Invalid parameters." << std::endl;
+        return 1;
+    }
+
+    std::vector<scriptStep> script;
+    if (!options.scriptFileName.empty())
+    {
+        std::ifstream scriptFile(options.scriptFileName.c_str());
+        if (!scriptFile.is_open())
+        {
+            std::cerr << "Failed to open script: " << options.scriptFileName << std::endl;
+            return 1;
+        }
+        if (!parseScript(scriptFile, script))
+            return 1;
+    }
+    else
+    {
+        std::istringstream iss(defaultScript(options));
+        parseScript(iss, script);
+    }
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        std::cerr << "WSAStartup failed." << std::endl;
+        return 1;
+    }
+#else
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    pthread_mutex_init(&Log::applog_lock, NULL);
+
+    MockPool pool(options, script);
+    if (!pool.listen())
+    {
+        std::cerr << "Failed to listen on port " << options.port << std::endl;
+        return 1;
+    }
+    std::cout << "Mock pool listening on " << (options.sv2 ? "stratum2+tcp://" : "stratum+tcp://") << options.host << ":" << options.port
+              << ", latency " << options.latency << " ms" << std::endl;
+
+    pool.run();
+    pool.printStats();
+
+    int rc = 0;
+    if (!options.jsonFileName.empty() && !pool.writeJson(options.jsonFileName.c_str()))
+    {
+        std::cerr << "Failed to write " << options.jsonFileName << std::endl;
+        rc = 1;
+    }
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return rc;
+}